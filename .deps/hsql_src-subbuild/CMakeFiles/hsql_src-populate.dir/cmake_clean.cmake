@@ -0,0 +1,16 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/hsql_src-populate"
+  "CMakeFiles/hsql_src-populate-complete"
+  "hsql_src-populate-prefix/src/hsql_src-populate-stamp/hsql_src-populate-build"
+  "hsql_src-populate-prefix/src/hsql_src-populate-stamp/hsql_src-populate-configure"
+  "hsql_src-populate-prefix/src/hsql_src-populate-stamp/hsql_src-populate-download"
+  "hsql_src-populate-prefix/src/hsql_src-populate-stamp/hsql_src-populate-install"
+  "hsql_src-populate-prefix/src/hsql_src-populate-stamp/hsql_src-populate-mkdir"
+  "hsql_src-populate-prefix/src/hsql_src-populate-stamp/hsql_src-populate-patch"
+  "hsql_src-populate-prefix/src/hsql_src-populate-stamp/hsql_src-populate-test"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/hsql_src-populate.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,22 @@
+# Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+# file Copyright.txt or https://cmake.org/licensing for details.
+
+cmake_minimum_required(VERSION 3.5)
+
+file(MAKE_DIRECTORY
+  "/root/repo/.deps/hsql_src-src"
+  "/root/repo/.deps/hsql_src-build"
+  "/root/repo/.deps/hsql_src-subbuild/hsql_src-populate-prefix"
+  "/root/repo/.deps/hsql_src-subbuild/hsql_src-populate-prefix/tmp"
+  "/root/repo/.deps/hsql_src-subbuild/hsql_src-populate-prefix/src/hsql_src-populate-stamp"
+  "/root/repo/.deps/hsql_src-subbuild/hsql_src-populate-prefix/src"
+  "/root/repo/.deps/hsql_src-subbuild/hsql_src-populate-prefix/src/hsql_src-populate-stamp"
+)
+
+set(configSubDirs )
+foreach(subDir IN LISTS configSubDirs)
+    file(MAKE_DIRECTORY "/root/repo/.deps/hsql_src-subbuild/hsql_src-populate-prefix/src/hsql_src-populate-stamp/${subDir}")
+endforeach()
+if(cfgdir)
+  file(MAKE_DIRECTORY "/root/repo/.deps/hsql_src-subbuild/hsql_src-populate-prefix/src/hsql_src-populate-stamp${cfgdir}") # cfgdir has leading slash
+endif()
@@ -0,0 +1,173 @@
+// BufferPoolManager fetch/unpin on its hit and miss paths, NewPage, and a
+// parallel scan with and without NUMA-aware frame placement.
+
+#include "harness.h"
+#include "columnar_db/common/metrics.h"
+#include "columnar_db/common/numa.h"
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/storage/disk_manager.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using db::bench::State;
+
+constexpr size_t POOL_SIZE = 64;
+
+// Creates `count` pages through `bpm` and unpins them.
+std::vector<db::page_id_t> create_pages(db::BufferPoolManager* bpm, size_t count) {
+    std::vector<db::page_id_t> page_ids;
+    for (size_t i = 0; i < count; ++i) {
+        db::page_id_t page_id;
+        db::Page* page = bpm->NewPage(&page_id, page_ids.empty() ? db::INVALID_PAGE_ID : page_ids.back() + 1);
+        if (page == nullptr) {
+            throw std::runtime_error("NewPage failed");
+        }
+        bpm->UnpinPage(page_id, true);
+        page_ids.push_back(page_id);
+    }
+    bpm->FlushAllPages();
+    return page_ids;
+}
+
+// Reports the pool's hit and miss counts over the timed loop.
+void fetch_loop(State& state, db::BufferPoolManager* bpm, const std::vector<db::page_id_t>& page_ids) {
+    db::MetricsSnapshot before = db::Metrics::CollectThread();
+    size_t i = 0;
+    for (auto _ : state) {
+        db::Page* page = bpm->FetchPage(page_ids[i++ % page_ids.size()]);
+        if (page == nullptr) {
+            throw std::runtime_error("FetchPage failed");
+        }
+        bpm->UnpinPage(page->page_id(), false);
+    }
+    db::MetricsSnapshot delta = db::Metrics::CollectThread() - before;
+    state.SetItemsProcessed(state.iterations());
+    state.counters["misses_per_fetch"] = static_cast<double>(delta.Get(db::Counter::BUFFER_POOL_MISSES)) /
+                                         static_cast<double>(state.iterations());
+}
+
+// Every page fits in the pool.
+void BufferPoolFetchHit(State& state) {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    db::BufferPoolManager bpm(POOL_SIZE, &disk_manager);
+    std::vector<db::page_id_t> page_ids = create_pages(&bpm, POOL_SIZE / 2);
+    fetch_loop(state, &bpm, page_ids);
+}
+DB_BENCHMARK("buffer_pool/fetch_hit", BufferPoolFetchHit);
+
+// Cycling through four times the pool's pages misses on every fetch (LRU),
+// so each one evicts a clean page and reads from the file.
+void BufferPoolFetchMiss(State& state) {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    db::BufferPoolManager bpm(POOL_SIZE, &disk_manager);
+    std::vector<db::page_id_t> page_ids = create_pages(&bpm, POOL_SIZE * 4);
+    fetch_loop(state, &bpm, page_ids);
+}
+DB_BENCHMARK("buffer_pool/fetch_miss", BufferPoolFetchMiss);
+
+// Misses where every victim is dirty and has to be written back first.
+void BufferPoolFetchMissDirty(State& state) {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    db::BufferPoolManager bpm(POOL_SIZE, &disk_manager);
+    std::vector<db::page_id_t> page_ids = create_pages(&bpm, POOL_SIZE * 4);
+    size_t i = 0;
+    for (auto _ : state) {
+        db::Page* page = bpm.FetchPage(page_ids[i++ % page_ids.size()]);
+        if (page == nullptr) {
+            throw std::runtime_error("FetchPage failed");
+        }
+        bpm.UnpinPage(page->page_id(), true);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("buffer_pool/fetch_miss_dirty", BufferPoolFetchMissDirty);
+
+void BufferPoolNewPage(State& state) {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    db::BufferPoolManager bpm(POOL_SIZE, &disk_manager);
+    db::page_id_t last = db::INVALID_PAGE_ID;
+    for (auto _ : state) {
+        db::page_id_t page_id;
+        if (bpm.NewPage(&page_id, last == db::INVALID_PAGE_ID ? last : last + 1) == nullptr) {
+            throw std::runtime_error("NewPage failed");
+        }
+        bpm.UnpinPage(page_id, true);
+        last = page_id;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("buffer_pool/new_page", BufferPoolNewPage);
+
+// One thread per NUMA node (at least two) repeatedly reads every byte of
+// its own slice of pages, as partition scan threads do. The pool holds every
+// page; what differs is where the frames' memory is. By default it is one
+// allocation, which the constructor zero-fills from one thread and so places
+// on one node. NUMA-aware, each thread is pinned to a node and the frames
+// its pages land in are allocated on that node.
+void parallel_scan(State& state, bool numa_aware) {
+    constexpr size_t SCAN_PAGES = 1024;
+    const size_t nodes = db::NumaTopology::Get().NodeCount();
+    const size_t threads = std::max<size_t>(2, nodes);
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    std::vector<db::page_id_t> page_ids;
+    {
+        db::BufferPoolManager setup(POOL_SIZE, &disk_manager);
+        page_ids = create_pages(&setup, SCAN_PAGES);
+    }
+    // The pool starts empty, so each page's frame is taken by the thread that scans it.
+    db::BufferPoolManager bpm(SCAN_PAGES, &disk_manager, nullptr, 0, numa_aware);
+
+    std::vector<uint64_t> sums(threads);
+    auto scan = [&](size_t t) {
+        if (numa_aware && nodes > 1) {
+            db::NumaTopology::Get().PinThread(static_cast<int>(t % nodes));
+        }
+        uint64_t sum = 0;
+        for (size_t i = t; i < page_ids.size(); i += threads) {
+            db::Page* page = bpm.FetchPage(page_ids[i]);
+            if (page == nullptr) {
+                throw std::runtime_error("FetchPage failed");
+            }
+            const auto* bytes = reinterpret_cast<const unsigned char*>(page->data());
+            for (size_t b = 0; b < db::PAGE_SIZE - db::PAGE_HEADER_SIZE; ++b) {
+                sum += bytes[b];
+            }
+            bpm.UnpinPage(page->page_id(), false);
+        }
+        sums[t] += sum;
+    };
+    for (auto _ : state) {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back(scan, t);
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * SCAN_PAGES);
+    state.SetBytesProcessed(state.iterations() * SCAN_PAGES * db::PAGE_SIZE);
+    state.counters["numa_nodes"] = static_cast<double>(nodes);
+}
+
+void BufferPoolParallelScan(State& state) {
+    parallel_scan(state, false);
+}
+DB_BENCHMARK("buffer_pool/parallel_scan", BufferPoolParallelScan);
+
+void BufferPoolParallelScanNuma(State& state) {
+    parallel_scan(state, true);
+}
+DB_BENCHMARK("buffer_pool/parallel_scan_numa", BufferPoolParallelScanNuma);
+
+} // namespace
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Compares two benchmark result files written by db_benchmarks --json=FILE.
+
+Usage: compare.py OLD.json NEW.json [--threshold=PERCENT]
+
+Prints the change in time per iteration of every benchmark found in both
+files and exits with status 1 if any got slower by more than the threshold
+(10% by default).
+"""
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b for b in json.load(f)["benchmarks"]}
+
+
+def main(argv):
+    threshold = 10.0
+    paths = []
+    for arg in argv[1:]:
+        if arg.startswith("--threshold="):
+            threshold = float(arg.split("=", 1)[1])
+        else:
+            paths.append(arg)
+    if len(paths) != 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+
+    old, new = load(paths[0]), load(paths[1])
+    regressions = 0
+    print(f"{'Benchmark':<40} {'Old (ns)':>14} {'New (ns)':>14} {'Change':>9}")
+    for name in sorted(old.keys() & new.keys()):
+        before, after = old[name]["real_time"], new[name]["real_time"]
+        change = (after - before) / before * 100 if before > 0 else 0.0
+        marker = ""
+        if change > threshold:
+            marker = "  SLOWER"
+            regressions += 1
+        elif change < -threshold:
+            marker = "  faster"
+        print(f"{name:<40} {before:>14.1f} {after:>14.1f} {change:>+8.1f}%{marker}")
+    for name in sorted(old.keys() - new.keys()):
+        print(f"{name:<40} only in {paths[0]}")
+    for name in sorted(new.keys() - old.keys()):
+        print(f"{name:<40} only in {paths[1]}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
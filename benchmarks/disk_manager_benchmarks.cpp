@@ -0,0 +1,179 @@
+// DiskManager page I/O, in each of the ways the engine uses the file: checked
+// reads and stamped writes through pread/pwrite, synced writes, and the
+// read-only mapping. Plain pread/pwrite of the same pages is the baseline for
+// what the page checksum costs.
+//
+// The files are small enough to stay in the page cache, which is the worst
+// case for the checksum: there is no device latency to hide behind.
+
+#include "harness.h"
+#include "columnar_db/common/crc32c.h"
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/storage/disk_manager.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using db::bench::State;
+
+constexpr int FILE_PAGES = 4096; // 16MB
+
+// Allocates FILE_PAGES pages in `disk_manager` and writes each of them once.
+std::vector<db::page_id_t> fill_file(db::DiskManager* disk_manager) {
+    std::vector<char> page(db::PAGE_SIZE, 7);
+    std::vector<db::page_id_t> page_ids;
+    for (int i = 0; i < FILE_PAGES; ++i) {
+        page_ids.push_back(disk_manager->AllocatePage(page_ids.empty() ? db::INVALID_PAGE_ID : page_ids.back() + 1));
+        disk_manager->WritePage(page_ids.back(), page.data(), 1);
+    }
+    return page_ids;
+}
+
+void Crc32cPage(State& state) {
+    std::vector<char> page(db::PAGE_SIZE);
+    for (size_t i = 0; i < page.size(); ++i) {
+        page[i] = static_cast<char>(i * 31);
+    }
+    uint32_t crc = 0;
+    for (auto _ : state) {
+        crc = db::Crc32c(page.data(), page.size(), crc);
+    }
+    db::bench::DoNotOptimize(crc);
+    state.SetBytesProcessed(state.iterations() * db::PAGE_SIZE);
+}
+DB_BENCHMARK("crc32c/page", Crc32cPage);
+
+void DiskReadPage(State& state) {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    std::vector<db::page_id_t> page_ids = fill_file(&disk_manager);
+    std::vector<char> page(db::PAGE_SIZE);
+    size_t i = 0;
+    for (auto _ : state) {
+        if (!disk_manager.ReadPage(page_ids[i++ % page_ids.size()], page.data())) {
+            throw std::runtime_error("ReadPage failed");
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * db::PAGE_SIZE);
+}
+DB_BENCHMARK("disk/read_page", DiskReadPage);
+
+void DiskWritePage(State& state) {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    std::vector<db::page_id_t> page_ids = fill_file(&disk_manager);
+    std::vector<char> page(db::PAGE_SIZE, 3);
+    size_t i = 0;
+    for (auto _ : state) {
+        disk_manager.WritePage(page_ids[i % page_ids.size()], page.data(), static_cast<db::lsn_t>(i));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * db::PAGE_SIZE);
+}
+DB_BENCHMARK("disk/write_page", DiskWritePage);
+
+// A checkpoint-like pattern: 64 pages, then one fsync.
+void DiskWritePageSynced(State& state) {
+    constexpr int PAGES_PER_SYNC = 64;
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    std::vector<db::page_id_t> page_ids = fill_file(&disk_manager);
+    std::vector<char> page(db::PAGE_SIZE, 3);
+    size_t i = 0;
+    for (auto _ : state) {
+        for (int p = 0; p < PAGES_PER_SYNC; ++p) {
+            disk_manager.WritePage(page_ids[i % page_ids.size()], page.data(), static_cast<db::lsn_t>(i));
+            ++i;
+        }
+        disk_manager.Sync();
+    }
+    state.SetItemsProcessed(state.iterations() * PAGES_PER_SYNC);
+    state.SetBytesProcessed(state.iterations() * PAGES_PER_SYNC * db::PAGE_SIZE);
+}
+DB_BENCHMARK("disk/write_page_synced", DiskWritePageSynced);
+
+void RawPread(State& state) {
+    db::bench::TempDir dir;
+    std::vector<db::page_id_t> page_ids;
+    {
+        db::DiskManager disk_manager(dir.Path("bench.db"));
+        page_ids = fill_file(&disk_manager);
+    }
+    int fd = ::open(dir.Path("bench.db").c_str(), O_RDONLY);
+    std::vector<char> page(db::PAGE_SIZE);
+    size_t i = 0;
+    for (auto _ : state) {
+        off_t offset = static_cast<off_t>(page_ids[i++ % page_ids.size()]) * db::PAGE_SIZE;
+        if (::pread(fd, page.data(), page.size(), offset) != db::PAGE_SIZE) {
+            throw std::runtime_error("pread failed");
+        }
+    }
+    ::close(fd);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * db::PAGE_SIZE);
+}
+DB_BENCHMARK("disk/raw_pread", RawPread);
+
+void RawPwrite(State& state) {
+    db::bench::TempDir dir;
+    std::vector<db::page_id_t> page_ids;
+    {
+        db::DiskManager disk_manager(dir.Path("bench.db"));
+        page_ids = fill_file(&disk_manager);
+    }
+    int fd = ::open(dir.Path("bench.db").c_str(), O_RDWR);
+    std::vector<char> page(db::PAGE_SIZE, 3);
+    size_t i = 0;
+    for (auto _ : state) {
+        off_t offset = static_cast<off_t>(page_ids[i++ % page_ids.size()]) * db::PAGE_SIZE;
+        if (::pwrite(fd, page.data(), page.size(), offset) != db::PAGE_SIZE) {
+            throw std::runtime_error("pwrite failed");
+        }
+    }
+    ::close(fd);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * db::PAGE_SIZE);
+}
+DB_BENCHMARK("disk/raw_pwrite", RawPwrite);
+
+// Read-only mode: pages come straight from the mapping, verified on first use.
+void DiskMappedFetch(State& state) {
+    db::bench::TempDir dir;
+    std::vector<db::page_id_t> page_ids;
+    {
+        db::DiskManager disk_manager(dir.Path("bench.db"));
+        page_ids = fill_file(&disk_manager);
+    }
+    db::DiskManager disk_manager(dir.Path("bench.db"), true);
+    db::BufferPoolManager bpm(&disk_manager);
+    int64_t sum = 0;
+    size_t i = 0;
+    for (auto _ : state) {
+        db::Page* page = bpm.FetchPage(page_ids[i++ % page_ids.size()]);
+        sum += page->data()[0];
+        bpm.UnpinPage(page->page_id(), false);
+    }
+    db::bench::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("disk/mapped_fetch", DiskMappedFetch);
+
+void DiskScrub(State& state) {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager(dir.Path("bench.db"));
+    fill_file(&disk_manager);
+    uint64_t pages = 0;
+    for (auto _ : state) {
+        pages += disk_manager.Scrub().pages_checked;
+    }
+    state.SetItemsProcessed(pages);
+    state.SetBytesProcessed(pages * db::PAGE_SIZE);
+}
+DB_BENCHMARK("disk/scrub", DiskScrub);
+
+} // namespace
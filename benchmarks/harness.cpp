@@ -0,0 +1,231 @@
+#include "harness.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace db::bench {
+
+namespace {
+
+struct Benchmark {
+    std::string name;
+    std::function<void(State&)> fn;
+    uint64_t iterations;
+};
+
+struct Run {
+    std::string name;
+    uint64_t iterations;
+    double real_ns_per_iter;
+    double cpu_ns_per_iter;
+    double items_per_second;
+    double bytes_per_second;
+    std::map<std::string, double> counters;
+};
+
+std::vector<Benchmark>& registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+uint64_t process_cpu_ns() {
+    timespec ts;
+    ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+Run run_benchmark(const Benchmark& benchmark, double min_time) {
+    uint64_t iterations = benchmark.iterations != 0 ? benchmark.iterations : 1;
+    while (true) {
+        State state(iterations);
+        benchmark.fn(state);
+        double seconds = state.real_seconds();
+        if (benchmark.iterations != 0 || seconds >= min_time || iterations >= 1000000000ULL) {
+            Run run;
+            run.name = benchmark.name;
+            run.iterations = iterations;
+            run.real_ns_per_iter = state.real_seconds() * 1e9 / static_cast<double>(iterations);
+            run.cpu_ns_per_iter = state.cpu_seconds() * 1e9 / static_cast<double>(iterations);
+            run.items_per_second = seconds > 0 ? static_cast<double>(state.items()) / seconds : 0;
+            run.bytes_per_second = seconds > 0 ? static_cast<double>(state.bytes()) / seconds : 0;
+            run.counters = state.counters;
+            return run;
+        }
+        // Aim a little past the minimum time, growing by at most 10x per attempt.
+        double factor = seconds > 0 ? min_time * 1.4 / seconds : 10.0;
+        iterations = static_cast<uint64_t>(static_cast<double>(iterations) * std::clamp(factor, 2.0, 10.0));
+    }
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+void write_json(std::ostream& out, const std::vector<Run>& runs) {
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+#ifdef NDEBUG
+    const char* build_type = "release";
+#else
+    const char* build_type = "debug";
+#endif
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+        << "    \"library_build_type\": \"" << build_type << "\"\n"
+        << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run& run = runs[i];
+        out << (i > 0 ? "," : "") << "\n    {\n"
+            << "      \"name\": \"" << json_escape(run.name) << "\",\n"
+            << "      \"run_name\": \"" << json_escape(run.name) << "\",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << run.iterations << ",\n"
+            << "      \"real_time\": " << run.real_ns_per_iter << ",\n"
+            << "      \"cpu_time\": " << run.cpu_ns_per_iter << ",\n"
+            << "      \"time_unit\": \"ns\"";
+        if (run.items_per_second > 0) {
+            out << ",\n      \"items_per_second\": " << run.items_per_second;
+        }
+        if (run.bytes_per_second > 0) {
+            out << ",\n      \"bytes_per_second\": " << run.bytes_per_second;
+        }
+        for (const auto& [name, value] : run.counters) {
+            out << ",\n      \"" << json_escape(name) << "\": " << value;
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::string human_rate(double value, const char* unit) {
+    const char* prefixes[] = {"", "k", "M", "G", "T"};
+    size_t p = 0;
+    while (value >= 1000 && p + 1 < sizeof(prefixes) / sizeof(prefixes[0])) {
+        value /= 1000;
+        ++p;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.2f %s%s/s", value, prefixes[p], unit);
+    return buffer;
+}
+
+} // namespace
+
+void State::start_timer() {
+    if (!running_) {
+        running_ = true;
+        real_start_ = std::chrono::steady_clock::now();
+        cpu_start_ = process_cpu_ns();
+    }
+}
+
+void State::stop_timer() {
+    if (running_) {
+        running_ = false;
+        real_ns_ += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - real_start_).count();
+        cpu_ns_ += static_cast<double>(process_cpu_ns() - cpu_start_);
+    }
+}
+
+bool Register(const char* name, std::function<void(State&)> fn, uint64_t iterations) {
+    registry().push_back(Benchmark{name, std::move(fn), iterations});
+    return true;
+}
+
+TempDir::TempDir() {
+    std::string pattern = (std::filesystem::temp_directory_path() / "pesdb_bench_XXXXXX").string();
+    if (::mkdtemp(pattern.data()) == nullptr) {
+        throw std::runtime_error("Failed to create a temporary directory: " + std::string(std::strerror(errno)));
+    }
+    path_ = pattern;
+}
+
+TempDir::~TempDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+}
+
+} // namespace db::bench
+
+int main(int argc, char** argv) {
+    std::string filter;
+    std::string json_file;
+    double min_time = 0.5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) {
+            filter = arg.substr(9);
+        } else if (arg.rfind("--json=", 0) == 0) {
+            json_file = arg.substr(7);
+        } else if (arg.rfind("--min_time=", 0) == 0) {
+            min_time = std::atof(arg.c_str() + 11);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter=SUBSTRING] [--min_time=SECONDS] [--json=FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    auto& benchmarks = db::bench::registry();
+    std::sort(benchmarks.begin(), benchmarks.end(),
+              [](const auto& a, const auto& b) { return a.name < b.name; });
+
+    std::vector<db::bench::Run> runs;
+    std::printf("%-40s %14s %14s %12s  %s\n", "Benchmark", "Time/op (ns)", "CPU/op (ns)", "Iterations", "Rate");
+    for (const auto& benchmark : benchmarks) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        db::bench::Run run;
+        try {
+            run = db::bench::run_benchmark(benchmark, min_time);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s failed: %s\n", benchmark.name.c_str(), e.what());
+            return 1;
+        }
+        std::string rate;
+        if (run.items_per_second > 0) {
+            rate += db::bench::human_rate(run.items_per_second, "items") + " ";
+        }
+        if (run.bytes_per_second > 0) {
+            rate += db::bench::human_rate(run.bytes_per_second, "B") + " ";
+        }
+        for (const auto& [name, value] : run.counters) {
+            std::ostringstream counter;
+            counter << name << "=" << value << " ";
+            rate += counter.str();
+        }
+        std::printf("%-40s %14.1f %14.1f %12llu  %s\n", run.name.c_str(), run.real_ns_per_iter, run.cpu_ns_per_iter,
+                    static_cast<unsigned long long>(run.iterations), rate.c_str());
+        std::fflush(stdout);
+        runs.push_back(std::move(run));
+    }
+
+    if (!json_file.empty()) {
+        std::ofstream out(json_file);
+        db::bench::write_json(out, runs);
+        if (!out) {
+            std::cerr << "Error: Failed to write " << json_file << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+// A small in-tree benchmark harness, modeled on Google Benchmark so its JSON
+// output can be compared with the same tools:
+//
+//   void BufferPoolFetchHit(db::bench::State& state) {
+//       ...setup, not timed...
+//       for (auto _ : state) {
+//           ...the operation being measured...
+//       }
+//       state.SetItemsProcessed(state.iterations());
+//   }
+//   DB_BENCHMARK("buffer_pool/fetch_hit", BufferPoolFetchHit);
+//
+// The harness calls the function with more and more iterations until the
+// timed loop runs for at least --min_time seconds. Benchmarks registered
+// with a fixed iteration count (end-to-end workloads) run exactly that many.
+//
+// Usage: db_benchmarks [--filter=SUBSTRING] [--min_time=SECONDS] [--json=FILE]
+
+namespace db::bench {
+
+class State {
+public:
+    explicit State(uint64_t iterations) : iterations_(iterations) {}
+
+    // The timed loop: `for (auto _ : state)`. The clock runs from begin() until
+    // the loop has done its iterations.
+    struct Iterator {
+        State* state;
+        uint64_t remaining;
+        bool operator!=(const Iterator&) {
+            if (remaining != 0) {
+                return true;
+            }
+            state->stop_timer();
+            return false;
+        }
+        Iterator& operator++() {
+            --remaining;
+            return *this;
+        }
+        struct [[maybe_unused]] Value {}; // So that `auto _` is not reported as unused
+        Value operator*() const { return {}; }
+    };
+    Iterator begin() {
+        start_timer();
+        return Iterator{this, iterations_};
+    }
+    Iterator end() { return Iterator{this, 0}; }
+
+    // Leaves work done inside the loop (e.g. per-iteration setup) out of the time.
+    void PauseTiming() { stop_timer(); }
+    void ResumeTiming() { start_timer(); }
+
+    uint64_t iterations() const { return iterations_; }
+    void SetItemsProcessed(uint64_t items) { items_ = items; }
+    void SetBytesProcessed(uint64_t bytes) { bytes_ = bytes; }
+
+    // Extra values reported alongside the timings, e.g. buffer pool misses.
+    std::map<std::string, double> counters;
+
+    double real_seconds() const { return real_ns_ / 1e9; }
+    double cpu_seconds() const { return cpu_ns_ / 1e9; }
+    uint64_t items() const { return items_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    void start_timer();
+    void stop_timer();
+
+    uint64_t iterations_;
+    bool running_ = false;
+    std::chrono::steady_clock::time_point real_start_;
+    uint64_t cpu_start_ = 0;
+    double real_ns_ = 0;
+    double cpu_ns_ = 0;
+    uint64_t items_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+// Registers a benchmark. `iterations` of 0 lets the harness pick.
+bool Register(const char* name, std::function<void(State&)> fn, uint64_t iterations = 0);
+
+// A directory for the database files of one benchmark, removed with everything
+// in it when it goes out of scope.
+class TempDir {
+public:
+    TempDir();
+    ~TempDir();
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    std::string Path(const std::string& file_name) const { return path_ + "/" + file_name; }
+
+private:
+    std::string path_;
+};
+
+// Keeps the compiler from optimizing away a value that is computed but never used.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace db::bench
+
+#define DB_BENCHMARK_CONCAT_(a, b) a##b
+#define DB_BENCHMARK_CONCAT(a, b) DB_BENCHMARK_CONCAT_(a, b)
+
+// DB_BENCHMARK(name, fn) or DB_BENCHMARK(name, fn, iterations)
+#define DB_BENCHMARK(...) \
+    static const bool DB_BENCHMARK_CONCAT(db_benchmark_registered_, __LINE__) = ::db::bench::Register(__VA_ARGS__)
@@ -0,0 +1,248 @@
+// Table inserts and scans, and the predicate kernels a scan runs.
+//
+// The pool is large enough to hold the tables, so these measure the table
+// code rather than the buffer pool's miss path.
+
+#include "harness.h"
+#include "columnar_db/concurrency/transaction_manager.h"
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/storage/catalog.h"
+#include "columnar_db/storage/column_kernels.h"
+#include "columnar_db/storage/disk_manager.h"
+#include "columnar_db/storage/table.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using db::bench::State;
+
+constexpr size_t POOL_SIZE = 4096;
+constexpr uint64_t SCAN_ROWS = 200000;
+constexpr size_t USER_COLUMNS = 4;
+
+// A database with one table of USER_COLUMNS columns, c0 ... c3. All are
+// BIGINT except c1, which has type `c1_type`.
+struct Database {
+    db::bench::TempDir dir;
+    db::DiskManager disk_manager;
+    db::BufferPoolManager bpm;
+    db::Catalog catalog;
+    db::TransactionManager txn_manager;
+    const db::TableSchema* schema;
+
+    explicit Database(db::DataType c1_type = db::DataType::BIGINT)
+        : disk_manager(dir.Path("bench.db")), bpm(POOL_SIZE, &disk_manager), catalog(&bpm, true), txn_manager(1) {
+        db::TableSchema new_schema{};
+        std::strcpy(new_schema.name, "t");
+        for (size_t c = 0; c < USER_COLUMNS; ++c) {
+            db::Column col{};
+            col.name[0] = 'c';
+            col.name[1] = static_cast<char>('0' + c);
+            col.type = c == 1 ? c1_type : db::DataType::BIGINT;
+            new_schema.columns.push_back(col);
+        }
+        if (!catalog.CreateTable(new_schema)) {
+            throw std::runtime_error("CreateTable failed");
+        }
+        schema = catalog.GetTableSchema("t");
+    }
+
+    // Appends `rows` committed rows: c0 = row number, c1 = row % 100, c2 and c3 derived.
+    void Load(uint64_t rows) {
+        db::Table table(schema, &bpm);
+        std::vector<std::vector<int64_t>> columns(schema->columns.size(), std::vector<int64_t>(rows));
+        for (uint64_t r = 0; r < rows; ++r) {
+            auto v = static_cast<int64_t>(r);
+            columns[0][r] = v;
+            columns[1][r] = v % 100;
+            columns[2][r] = v * 7;
+            columns[3][r] = v ^ 0x5555;
+            columns[schema->XminColumn()][r] = db::INVALID_TXN_ID; // Frozen: visible to everyone
+            columns[schema->XmaxColumn()][r] = db::INVALID_TXN_ID;
+        }
+        if (!table.AppendRows(columns)) {
+            throw std::runtime_error("AppendRows failed");
+        }
+    }
+};
+
+void TableInsertTuple(State& state) {
+    Database database;
+    db::Table table(database.schema, &database.bpm);
+    std::vector<int64_t> tuple(database.schema->columns.size(), 0);
+    int64_t i = 0;
+    for (auto _ : state) {
+        tuple[0] = i++;
+        if (!table.InsertTuple(tuple)) {
+            throw std::runtime_error("InsertTuple failed");
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("table/insert_tuple", TableInsertTuple);
+
+// What IMPORT does: whole pages of each column at a time.
+void TableAppendRows(State& state) {
+    constexpr size_t BATCH = 1024;
+    Database database;
+    db::Table table(database.schema, &database.bpm);
+    std::vector<std::vector<int64_t>> columns(database.schema->columns.size(), std::vector<int64_t>(BATCH, 1));
+    for (auto _ : state) {
+        if (!table.AppendRows(columns)) {
+            throw std::runtime_error("AppendRows failed");
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+DB_BENCHMARK("table/append_rows", TableAppendRows);
+
+// Opening a table walks its column chains to count the rows.
+void TableOpen(State& state) {
+    Database database;
+    database.Load(SCAN_ROWS);
+    for (auto _ : state) {
+        db::Table table(database.schema, &database.bpm);
+        db::bench::DoNotOptimize(table.GetNumRows());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("table/open", TableOpen);
+
+// Opening it from the catalog's handle, as statements do.
+void TableOpenCached(State& state) {
+    Database database;
+    database.Load(SCAN_ROWS);
+    for (auto _ : state) {
+        db::Table table(database.catalog.GetTableHandle(database.schema), &database.bpm);
+        db::bench::DoNotOptimize(table.GetNumRows());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("table/open_cached", TableOpenCached);
+
+// The row-at-a-time iterator SELECT uses, with MVCC visibility checks.
+void TableScanIterator(State& state) {
+    Database database;
+    database.Load(SCAN_ROWS);
+    std::unique_ptr<db::Transaction> txn = database.txn_manager.Begin();
+    db::Table table(database.schema, &database.bpm, &txn->GetSnapshot());
+    int64_t sum = 0;
+    for (auto _ : state) {
+        for (const auto& tuple : table) {
+            sum += tuple[0];
+        }
+    }
+    db::bench::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * SCAN_ROWS);
+}
+DB_BENCHMARK("table/scan_iterator", TableScanIterator);
+
+// One column, a page at a time.
+void TableScanColumnPages(State& state) {
+    Database database;
+    database.Load(SCAN_ROWS);
+    db::Table table(database.schema, &database.bpm);
+    int64_t sum = 0;
+    for (auto _ : state) {
+        table.ForEachColumnPage(0, [&](uint64_t, const int64_t* values, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                sum += values[i];
+            }
+        });
+    }
+    db::bench::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * SCAN_ROWS);
+    state.SetBytesProcessed(state.iterations() * SCAN_ROWS * sizeof(int64_t));
+}
+DB_BENCHMARK("table/scan_column_pages", TableScanColumnPages);
+
+// The executor's predicate: a std::function over a materialized tuple.
+void PredicateTupleFunction(State& state) {
+    Database database;
+    database.Load(SCAN_ROWS);
+    std::unique_ptr<db::Transaction> txn = database.txn_manager.Begin();
+    db::Table table(database.schema, &database.bpm, &txn->GetSnapshot());
+    std::function<bool(const std::vector<int64_t>&)> predicate = [](const std::vector<int64_t>& tuple) {
+        return tuple[1] == 42;
+    };
+    uint64_t matched = 0;
+    for (auto _ : state) {
+        for (const auto& tuple : table) {
+            matched += predicate(tuple) ? 1 : 0;
+        }
+    }
+    db::bench::DoNotOptimize(matched);
+    state.SetItemsProcessed(state.iterations() * SCAN_ROWS);
+}
+DB_BENCHMARK("predicate/tuple_function", PredicateTupleFunction);
+
+// The same equality test as a loop over one column's pages.
+void PredicateColumnEquals(State& state) {
+    Database database;
+    database.Load(SCAN_ROWS);
+    db::Table table(database.schema, &database.bpm);
+    uint64_t matched = 0;
+    for (auto _ : state) {
+        table.ForEachColumnPage(1, [&](uint64_t, const int64_t* values, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                matched += values[i] == 42;
+            }
+        });
+    }
+    db::bench::DoNotOptimize(matched);
+    state.SetItemsProcessed(state.iterations() * SCAN_ROWS);
+}
+DB_BENCHMARK("predicate/column_equals", PredicateColumnEquals);
+
+// A range test, written without branches.
+void PredicateColumnRange(State& state) {
+    Database database;
+    database.Load(SCAN_ROWS);
+    db::Table table(database.schema, &database.bpm);
+    uint64_t matched = 0;
+    for (auto _ : state) {
+        table.ForEachColumnPage(2, [&](uint64_t, const int64_t* values, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                matched += static_cast<uint64_t>(values[i] - 1000) < 50000;
+            }
+        });
+    }
+    db::bench::DoNotOptimize(matched);
+    state.SetItemsProcessed(state.iterations() * SCAN_ROWS);
+}
+DB_BENCHMARK("predicate/column_range", PredicateColumnRange);
+
+// The range kernel over c1 stored as T, as Table::FilterRange runs it.
+template <typename T>
+void PredicateMatchRange(State& state, db::DataType type) {
+    Database database(type);
+    database.Load(SCAN_ROWS);
+    db::Table table(database.schema, &database.bpm);
+    std::vector<uint64_t> bits((SCAN_ROWS + 63) / 64);
+    for (auto _ : state) {
+        std::fill(bits.begin(), bits.end(), 0);
+        table.ForEachColumnPageAs<T>(1, [&](uint64_t first_row, const T* values, uint32_t count) {
+            db::MatchRange(values, count, T{40}, T{44}, bits.data(), first_row);
+        });
+    }
+    db::bench::DoNotOptimize(bits[0]);
+    state.SetItemsProcessed(state.iterations() * SCAN_ROWS);
+    state.SetBytesProcessed(state.iterations() * SCAN_ROWS * sizeof(T));
+}
+
+void PredicateMatchRangeBigint(State& state) {
+    PredicateMatchRange<int64_t>(state, db::DataType::BIGINT);
+}
+DB_BENCHMARK("predicate/match_range_bigint", PredicateMatchRangeBigint);
+
+void PredicateMatchRangeInt8(State& state) {
+    PredicateMatchRange<int8_t>(state, db::DataType::INT8);
+}
+DB_BENCHMARK("predicate/match_range_int8", PredicateMatchRangeInt8);
+
+} // namespace
@@ -0,0 +1,253 @@
+// End-to-end statements through the parser and the QueryExecutor, on a small
+// star schema in the style of the Star Schema Benchmark: a lineorder fact
+// table and customer, part and dates dimensions, generated with a fixed seed.
+//
+// The tables are written to columnar files and loaded with COPY ... FROM,
+// the same way a user would bulk load them. The database runs with the same
+// buffer pool size as the columnar_db executable.
+
+#include "harness.h"
+#include "columnar_db/concurrency/transaction_manager.h"
+#include "columnar_db/engine/query_executor.h"
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/storage/catalog.h"
+#include "columnar_db/storage/columnar_file.h"
+#include "columnar_db/storage/disk_manager.h"
+#include "columnar_db/storage/table.h"
+#include "columnar_db/wal/log_manager.h"
+#include "SQLParser.h"
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using db::bench::State;
+
+constexpr uint64_t LINEORDER_ROWS = 100000;
+constexpr uint64_t CUSTOMER_ROWS = 3000;
+constexpr uint64_t PART_ROWS = 2000;
+constexpr uint64_t DATE_ROWS = 2556; // Seven years of days
+
+// Sends std::cout to nowhere while in scope; SELECT prints every row.
+class SilenceStdout {
+public:
+    SilenceStdout() : saved_(std::cout.rdbuf(nullptr)) {}
+    ~SilenceStdout() { std::cout.rdbuf(saved_); }
+
+private:
+    std::streambuf* saved_;
+};
+
+struct TableSpec {
+    const char* name;
+    std::vector<const char*> columns;
+    uint64_t rows;
+};
+
+const std::vector<TableSpec>& star_schema() {
+    static const std::vector<TableSpec> tables = {
+        {"lineorder", {"orderkey", "custkey", "partkey", "orderdate", "quantity", "extendedprice", "discount", "revenue"},
+         LINEORDER_ROWS},
+        {"customer", {"custkey", "nation", "region"}, CUSTOMER_ROWS},
+        {"part", {"partkey", "category", "brand"}, PART_ROWS},
+        {"dates", {"datekey", "year", "month"}, DATE_ROWS},
+    };
+    return tables;
+}
+
+// Value of column `col` of row `row` of `table`.
+int64_t generate(const TableSpec& table, size_t col, uint64_t row, std::mt19937_64* rng) {
+    const auto r = static_cast<int64_t>(row);
+    const std::string name = table.name;
+    if (col == 0) {
+        return r + 1; // Keys
+    }
+    if (name == "lineorder") {
+        switch (col) {
+            case 1: return static_cast<int64_t>((*rng)() % CUSTOMER_ROWS) + 1;
+            case 2: return static_cast<int64_t>((*rng)() % PART_ROWS) + 1;
+            case 3: return static_cast<int64_t>((*rng)() % DATE_ROWS) + 1;
+            case 4: return static_cast<int64_t>((*rng)() % 50) + 1;
+            case 5: return static_cast<int64_t>((*rng)() % 100000) + 100;
+            case 6: return static_cast<int64_t>((*rng)() % 11);
+            default: return static_cast<int64_t>((*rng)() % 1000000);
+        }
+    }
+    if (name == "customer") {
+        return col == 1 ? r % 25 : r % 5;
+    }
+    if (name == "part") {
+        return col == 1 ? r % 25 : r % 1000;
+    }
+    return col == 1 ? 1992 + r / 365 : (r % 365) / 31 + 1; // dates
+}
+
+// Writes `table` to a columnar file for COPY ... FROM.
+void write_table_file(const TableSpec& table, const std::string& file_name) {
+    std::vector<db::Column> columns;
+    for (const char* name : table.columns) {
+        db::Column col{};
+        std::strncpy(col.name, name, sizeof(col.name) - 1);
+        col.type = db::DataType::BIGINT;
+        columns.push_back(col);
+    }
+    db::ColumnarFileWriter writer(file_name, columns);
+    std::mt19937_64 rng(42);
+    std::vector<int64_t> values(table.rows);
+    for (size_t c = 0; c < table.columns.size(); ++c) {
+        rng.seed(42 + c);
+        for (uint64_t r = 0; r < table.rows; ++r) {
+            values[r] = generate(table, c, r, &rng);
+        }
+        writer.BeginColumn(c);
+        writer.Append(values.data(), values.size());
+    }
+    writer.Finish();
+}
+
+// A database with its own files, driven through SQL.
+class Database {
+public:
+    Database()
+        : disk_manager_(dir_.Path("bench.db")), log_manager_(dir_.Path("bench.wal")),
+          bpm_(db::BUFFER_POOL_SIZE, &disk_manager_, &log_manager_), catalog_(&bpm_, true), txn_manager_(1),
+          executor_(&catalog_, &bpm_, &log_manager_, &txn_manager_) {}
+
+    // Parses and runs `sql`, throwing if it does not parse.
+    void Execute(const std::string& sql) {
+        hsql::SQLParserResult result;
+        hsql::SQLParser::parseSQLString(sql, &result);
+        if (!result.isValid()) {
+            throw std::runtime_error("Invalid benchmark statement: " + sql);
+        }
+        SilenceStdout silence;
+        executor_.Execute(result.getStatement(0));
+    }
+
+    // Creates the star schema's tables and bulk loads them.
+    void CreateAndLoad(State* state) {
+        for (const TableSpec& table : star_schema()) {
+            std::ostringstream create;
+            create << "CREATE TABLE " << table.name << " (";
+            for (size_t c = 0; c < table.columns.size(); ++c) {
+                create << (c > 0 ? ", " : "") << table.columns[c] << " BIGINT";
+            }
+            create << ");";
+            Execute(create.str());
+
+            const std::string file_name = dir_.Path(std::string(table.name) + ".pcf");
+            if (state != nullptr) {
+                state->PauseTiming();
+            }
+            write_table_file(table, file_name);
+            if (state != nullptr) {
+                state->ResumeTiming();
+            }
+            Execute("COPY " + std::string(table.name) + " FROM '" + file_name + "';");
+            if (RowCount(table.name) != table.rows) {
+                throw std::runtime_error(std::string("Failed to load ") + table.name);
+            }
+        }
+    }
+
+    uint64_t RowCount(const char* table_name) {
+        db::Table table(catalog_.GetTableHandle(catalog_.GetTableSchema(table_name)), &bpm_);
+        return table.GetNumRows();
+    }
+
+    std::string Path(const std::string& file_name) const { return dir_.Path(file_name); }
+
+private:
+    db::bench::TempDir dir_;
+    db::DiskManager disk_manager_;
+    db::LogManager log_manager_;
+    db::BufferPoolManager bpm_;
+    db::Catalog catalog_;
+    db::TransactionManager txn_manager_;
+    db::QueryExecutor executor_;
+};
+
+// Loaded once and shared by the query benchmarks, which run in name order.
+Database& loaded_database() {
+    static std::unique_ptr<Database> database = [] {
+        auto d = std::make_unique<Database>();
+        d->CreateAndLoad(nullptr);
+        return d;
+    }();
+    return *database;
+}
+
+// Runs `sql` once per iteration; each run processes `rows` rows.
+void run_statement(State& state, const std::string& sql, uint64_t rows) {
+    Database& database = loaded_database();
+    for (auto _ : state) {
+        database.Execute(sql);
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+// Creating the four tables and importing their files (generation not timed).
+void WorkloadLoad(State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto database = std::make_unique<Database>();
+        state.ResumeTiming();
+        database->CreateAndLoad(&state);
+        state.PauseTiming();
+        database.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * (LINEORDER_ROWS + CUSTOMER_ROWS + PART_ROWS + DATE_ROWS));
+}
+DB_BENCHMARK("workload/load", WorkloadLoad, 3);
+
+void WorkloadFilterFact(State& state) {
+    run_statement(state, "SELECT * FROM lineorder WHERE discount = 3;", LINEORDER_ROWS);
+}
+DB_BENCHMARK("workload/q1_filter_fact", WorkloadFilterFact);
+
+void WorkloadLookupDimension(State& state) {
+    run_statement(state, "SELECT * FROM customer WHERE custkey = 1234;", CUSTOMER_ROWS);
+}
+DB_BENCHMARK("workload/q2_lookup_dimension", WorkloadLookupDimension);
+
+void WorkloadScanDimension(State& state) {
+    run_statement(state, "SELECT * FROM part;", PART_ROWS);
+}
+DB_BENCHMARK("workload/q3_scan_dimension", WorkloadScanDimension);
+
+void WorkloadExport(State& state) {
+    run_statement(state, "COPY lineorder TO '" + loaded_database().Path("export.pcf") + "';", LINEORDER_ROWS);
+}
+DB_BENCHMARK("workload/q4_export_fact", WorkloadExport);
+
+// Single-row commits, each waiting for its group flush.
+void WorkloadInsert(State& state) {
+    Database& database = loaded_database();
+    uint64_t key = LINEORDER_ROWS + 1;
+    for (auto _ : state) {
+        database.Execute("INSERT INTO lineorder VALUES (" + std::to_string(key++) + ", 1, 1, 1, 1, 100, 0, 100);");
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("workload/u1_insert", WorkloadInsert);
+
+void WorkloadPointUpdate(State& state) {
+    Database& database = loaded_database();
+    uint64_t i = 0;
+    for (auto _ : state) {
+        database.Execute("UPDATE customer SET region = " + std::to_string(i % 5) + " WHERE custkey = " +
+                         std::to_string(i % CUSTOMER_ROWS + 1) + ";");
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+DB_BENCHMARK("workload/u2_point_update", WorkloadPointUpdate);
+
+} // namespace
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class BloomFilter
+ * @brief A split-block Bloom filter over int64_t values.
+ *
+ * Each value sets one bit in each of the eight 32-bit words of a single
+ * 256-bit block, so a probe touches one cache line and is decided with a
+ * few AVX2 instructions when the CPU has them. With BLOOM_BITS_PER_VALUE
+ * bits per value, about 1% of absent values pass.
+ */
+class BloomFilter {
+public:
+    // An empty filter, which holds nothing and rules nothing out.
+    BloomFilter() = default;
+
+    // A filter sized for `expected_values` values.
+    explicit BloomFilter(size_t expected_values);
+
+    void Add(int64_t value);
+
+    // False only if `value` was never added. Always true for an empty filter.
+    bool MayContain(int64_t value) const;
+
+    bool Empty() const { return blocks_.empty(); }
+
+    // Bytes of the filter's blocks.
+    size_t GetSize() const { return blocks_.size() * sizeof(Block); }
+
+private:
+    struct alignas(32) Block {
+        uint32_t words[8];
+    };
+
+    // Index of the block a value with hash `hash` falls in.
+    size_t block_index(uint64_t hash) const;
+
+    std::vector<Block> blocks_;
+};
+
+} // namespace db
@@ -1,14 +1,69 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace db {
 
 using page_id_t = int32_t;
 using frame_id_t = int32_t;
+using lsn_t = int64_t;
+using txn_id_t = int64_t; // Stored in the hidden MVCC columns, so it shares their type
 
 constexpr page_id_t INVALID_PAGE_ID = -1;
+constexpr lsn_t INVALID_LSN = -1;
+constexpr txn_id_t INVALID_TXN_ID = 0; // Also means "frozen" (always committed) in xmin and "not deleted" in xmax
 static constexpr int PAGE_SIZE = 4096; // 4KB pages
-static constexpr int BUFFER_POOL_SIZE = 10; // A small pool of 10 pages for learning
+static constexpr int PAGE_HEADER_SIZE = 16; // Checksum, page id and LSN, stamped by the DiskManager
+static constexpr int PAGE_DATA_SIZE = PAGE_SIZE - PAGE_HEADER_SIZE; // What a page's owner can use
+static constexpr size_t BUFFER_POOL_SIZE = 1024; // Frames of the shell's buffer pool (4MB); --buffer-pool MB overrides
+static constexpr size_t SERVER_BUFFER_POOL_SIZE = 64 * 1024; // Frames when serving (256MB), for every worker's scans at once
+static constexpr int EXTENT_SIZE = 16; // Pages reserved together for one column chain (must divide 64)
+static constexpr size_t COMPRESSED_PAGE_MAX_SIZE = PAGE_SIZE * 3 / 4; // Pages that compress worse skip the second tier
 
-} // namespace db
\ No newline at end of file
+// --- Write-ahead log ---
+static constexpr size_t LOG_BUFFER_SIZE = 1 << 20;       // In-memory ring buffer for log records (must be a power of two)
+static constexpr size_t LOG_FLUSH_THRESHOLD = 64 * 1024; // Flush once this many bytes are pending...
+static constexpr int LOG_FLUSH_INTERVAL_US = 1000;       // ...or after this much time, whichever comes first
+static constexpr size_t CHECKPOINT_INTERVAL_BYTES = 4 << 20; // Checkpoint after this much log; bounds redo work on restart
+
+// --- Compaction ---
+static constexpr int COMPACTION_INTERVAL_MS = 5000;    // How often the background compactor looks for work
+static constexpr uint64_t COMPACTION_MIN_DEAD_ROWS = 1024; // Rewrite a table once it has this many dead rows...
+static constexpr double COMPACTION_MIN_DEAD_RATIO = 0.2;   // ...and they make up at least this fraction of it
+static constexpr uint64_t CLUSTER_MERGE_MIN_TAIL_ROWS = 4096; // Merge a clustered table's unsorted tail once it has this many rows...
+static constexpr double CLUSTER_MERGE_MIN_TAIL_RATIO = 0.1;    // ...and this fraction of its sealed segment's
+static constexpr uint64_t VIEW_FOLD_MIN_DELTA_ROWS = 1024; // Fold a materialized view's change rows once it has this many, and more than groups
+
+// --- Partitioning ---
+static constexpr size_t PARTITION_SCAN_THREADS = 8; // Partitions one statement scans at once
+
+// --- Bloom filters ---
+static constexpr size_t BLOOM_BITS_PER_VALUE = 10; // ~1% false positives
+
+// --- Approximate queries ---
+static constexpr int HLL_PRECISION = 14; // 2^14 registers: 16KB per sketch, ~0.8% standard error
+
+// --- Query memory ---
+static constexpr size_t QUERY_MEMORY_BUDGET = 1024 * 1024 * 1024; // Shared by the statements buffering output at once
+static constexpr size_t QUERY_MEMORY_GRANT = 64 * 1024 * 1024;    // Most one statement is granted; past it, output spills
+static constexpr size_t SPILL_BLOCK_SIZE = 64 * 1024;             // Unit in which buffered output is granted
+static constexpr size_t QUERY_OUTPUT_BYTES_PER_VALUE = 12;        // Printed width of a value, for sizing grants
+
+// --- Result cache ---
+static constexpr size_t RESULT_CACHE_BYTES = 64 * 1024 * 1024;  // Output of SELECTs kept for repeats
+static constexpr size_t RESULT_CACHE_MAX_ENTRY_BYTES = 1 << 20; // Larger outputs are not kept
+
+// --- Columnar export files ---
+static constexpr uint64_t ROW_GROUP_SIZE = 64 * 1024;  // Rows per row group
+static constexpr uint32_t COLUMNAR_PAGE_VALUES = 1024; // Values per page of a column chunk
+
+// --- Server ---
+static constexpr int SERVER_DEFAULT_PORT = 5544;
+static constexpr size_t SERVER_WORKER_THREADS = 16;      // Statements running at once; more sessions wait their turn
+static constexpr size_t SERVER_MAX_MESSAGE_SIZE = 1 << 20; // Longest command a client may send
+static constexpr int SERVER_LISTEN_BACKLOG = 512;
+static constexpr size_t SERVER_OUTPUT_FRAME_SIZE = 64 * 1024; // Largest 'D' message; output is sent as it is produced
+static constexpr size_t SERVER_OUTPUT_WINDOW = 1 << 20;       // Unsent output a statement may queue before it waits for its client
+
+} // namespace db
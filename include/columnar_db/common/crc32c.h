@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace db {
+
+/**
+ * @brief Computes the CRC32C (Castagnoli) checksum of `len` bytes.
+ *
+ * Uses the SSE4.2 crc32 instruction when the CPU has it and falls back to a
+ * table-driven implementation otherwise. `crc` lets a checksum be extended
+ * over several buffers: Crc32c(b, n2, Crc32c(a, n1)) == Crc32c(a ++ b).
+ */
+uint32_t Crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+} // namespace db
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class HyperLogLog
+ * @brief Estimates how many distinct values were added to it, in fixed memory.
+ *
+ * Each value's hash picks one of 2^HLL_PRECISION one-byte registers, which
+ * keeps the longest run of leading zeros seen among the rest of the hashes
+ * routed to it. The estimate's standard error is about 1.04 / sqrt(2^HLL_PRECISION),
+ * however many values there are. Merging two sketches gives the sketch of
+ * the union of their values, so parts of a table can be sketched apart.
+ */
+class HyperLogLog {
+public:
+    HyperLogLog();
+
+    void Add(int64_t value);
+    void Merge(const HyperLogLog& other);
+    uint64_t Estimate() const;
+
+private:
+    std::vector<uint8_t> registers_;
+};
+
+} // namespace db
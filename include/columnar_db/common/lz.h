@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace db {
+
+// A small LZ77 codec in the style of LZ4, fast enough to run on every page
+// the buffer pool evicts. The input is a series of sequences, each a token
+// byte (literal count in the high nibble, match length - 4 in the low one;
+// 15 means more length bytes follow, each added until one is below 255),
+// the literals, and a 2-byte little-endian offset back to the match. The
+// last sequence has literals only. Inputs must be under 64KB.
+
+// Compresses `size` bytes at `src`, replacing the contents of `out`.
+void LzCompress(const char* src, size_t size, std::vector<char>* out);
+
+// Decompresses [src, src + size) into exactly `dst_size` bytes at `dst`.
+// Returns false if the input is corrupt or decodes to another length.
+bool LzDecompress(const char* src, size_t size, char* dst, size_t dst_size);
+
+} // namespace db
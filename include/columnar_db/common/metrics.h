@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace db {
+
+/**
+ * @brief Event counts and totals kept by the storage engine.
+ */
+enum class Counter : uint8_t {
+    BUFFER_POOL_HITS,       // FetchPage found the page in a frame
+    BUFFER_POOL_MISSES,     // FetchPage had to read the page
+    BUFFER_POOL_EVICTIONS,  // A frame was taken from another page
+    BUFFER_POOL_WRITEBACKS, // A dirty page was written back, on eviction or flush
+    BUFFER_POOL_PIN_WAIT_NS, // Time blocked on the pool latch, or on the log before writing a page back
+    BLOOM_PAGES_SKIPPED,    // Pages an equality filter ruled out with their Bloom filter, unread
+    COMPACTIONS,            // The Compactor rewrote a table to drop its dead rows
+    COMPACTION_DEAD_ROWS,   // Rows those rewrites dropped
+    COMPACTION_MERGES,      // A clustered table's unsorted tail was merged into its sorted segment
+    COMPACTION_VIEW_FOLDS,  // A materialized view's change rows were folded into one row per group
+    COMPRESSED_CACHE_HITS,  // FetchPage found an evicted page in the compressed tier
+    COMPRESSED_CACHE_MISSES,
+    COMPRESSED_CACHE_INSERTS, // An evicted page was compressed into the tier
+    COMPRESSED_CACHE_INSERT_BYTES, // Their compressed size
+    COMPRESSED_CACHE_EVICTIONS, // A page was dropped from the tier to make room
+    DISK_READS,
+    DISK_READ_BYTES,
+    DISK_WRITES,
+    DISK_WRITE_BYTES,
+    DISK_SYNCS,
+    LOG_RECORDS,            // Records appended to the write-ahead log
+    LOG_BYTES,
+    LOG_FLUSHES,            // Group commits: one write and fdatasync each
+    LOG_BYTES_RECLAIMED,    // Log before a checkpoint whose disk space was freed
+    QUERY_ADMISSION_WAITS,  // A statement waited for a memory grant
+    QUERY_SPILL_BYTES,      // Output written to temporary files beyond a statement's grant
+    RESULT_CACHE_HITS,      // A SELECT's output was served from the result cache
+    RESULT_CACHE_MISSES,
+    RESULT_CACHE_EVICTIONS, // A result was dropped to make room for another
+    COUNT
+};
+
+/**
+ * @brief Latency distributions kept by the storage engine, in microseconds.
+ */
+enum class Histogram : uint8_t {
+    DISK_READ_LATENCY,
+    DISK_WRITE_LATENCY,
+    DISK_SYNC_LATENCY,
+    LOG_FLUSH_LATENCY,
+    COUNT
+};
+
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+constexpr size_t HISTOGRAM_COUNT = static_cast<size_t>(Histogram::COUNT);
+
+// Bucket 0 holds latencies under 1us, bucket i those in [2^(i-1), 2^i) us;
+// the last bucket also takes everything slower.
+constexpr size_t HISTOGRAM_BUCKETS = 32;
+
+/**
+ * @brief The values of every counter and histogram at one point in time.
+ */
+struct MetricsSnapshot {
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+    std::array<std::array<uint64_t, HISTOGRAM_BUCKETS>, HISTOGRAM_COUNT> histograms{};
+
+    uint64_t Get(Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+
+    // Number of latencies recorded in `histogram`.
+    uint64_t Count(Histogram histogram) const;
+
+    // Upper bound, in microseconds, of the bucket holding the `p`th percentile (0 < p <= 1).
+    uint64_t Percentile(Histogram histogram, double p) const;
+
+    // What happened between `earlier` and this snapshot.
+    MetricsSnapshot operator-(const MetricsSnapshot& earlier) const;
+
+    // One line per counter and histogram, for people.
+    std::string ToText() const;
+
+    // A single JSON object, for tools.
+    std::string ToJson() const;
+};
+
+/**
+ * @class Metrics
+ * @brief Process-wide counters and latency histograms, kept per thread.
+ *
+ * Every thread updates its own block of counters, so recording an event is
+ * a relaxed load and store with no shared cache line. Collect() sums the
+ * blocks of all threads (plus whatever exited threads left behind), and
+ * CollectThread() reads only the caller's, which is how EXPLAIN ANALYZE
+ * attributes work to one statement.
+ */
+class Metrics {
+public:
+    static void Add(Counter counter, uint64_t value = 1);
+    static void Record(Histogram histogram, uint64_t micros);
+
+    // Totals over every thread, past and present.
+    static MetricsSnapshot Collect();
+
+    // Totals of the calling thread.
+    static MetricsSnapshot CollectThread();
+
+    static const char* Name(Counter counter);
+    static const char* Name(Histogram histogram);
+};
+
+/**
+ * @brief Records the time from its construction to its destruction in a histogram.
+ */
+class LatencyTimer {
+public:
+    explicit LatencyTimer(Histogram histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~LatencyTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        Metrics::Record(histogram_, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+private:
+    Histogram histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace db
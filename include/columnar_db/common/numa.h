@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class NumaTopology
+ * @brief The NUMA nodes of the machine and the CPUs of each, read once from
+ * /sys/devices/system/node.
+ *
+ * The online nodes are numbered 0 .. NodeCount() - 1 here, in the order of
+ * their kernel ids, which need not be contiguous (a node may be offline).
+ * A machine without NUMA, or one whose topology cannot be read, is a
+ * single node holding every CPU; every call then does nothing harmful.
+ */
+class NumaTopology {
+public:
+    static const NumaTopology& Get();
+
+    size_t NodeCount() const { return node_cpus_.size(); }
+
+    // The node of the CPU the calling thread is running on.
+    int CurrentNode() const;
+
+    // Restricts the calling thread to the CPUs of `node`. Returns false if it could not.
+    bool PinThread(int node) const;
+
+    // Maps `size` bytes of zeroed memory whose pages the kernel places on
+    // `node` when they are first touched. Throws std::bad_alloc on failure.
+    void* AllocateOnNode(size_t size, int node) const;
+
+    // Unmaps memory from AllocateOnNode.
+    static void Free(void* memory, size_t size);
+
+private:
+    NumaTopology();
+
+    std::vector<int> node_ids_;               // The kernel id of each node
+    std::vector<std::vector<int>> node_cpus_; // The CPUs of each node
+    std::vector<int> cpu_nodes_;              // The node of each CPU
+};
+
+} // namespace db
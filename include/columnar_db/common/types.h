@@ -1,16 +1,96 @@
 #pragma once
 
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <variant>
 
 // A simple type definition for our table cells
 using TableCell = std::variant<long, std::string>;
 
 namespace db {
-// Enum for column data types
+// Enum for column data types. The values are persisted in the catalog and in
+// columnar files, so new types go at the end.
 enum class DataType {
     INVALID,
-    BIGINT, // For now, we'll only handle 8-byte integers
-    // We will add VARCHAR later, as variable-length data is more complex
+    BIGINT,    // 8-byte integer
+    INT32,
+    INT16,
+    INT8,      // Also used for BOOLEAN (0 or 1)
+    DOUBLE,
+    DATE,      // Days since 1970-01-01, in 4 bytes
+    TIMESTAMP, // Microseconds since 1970-01-01 00:00:00 UTC
 };
+
+// Values of every type travel through tuples, log records and columnar files
+// as an int64_t: integers, dates and timestamps as themselves, a DOUBLE as its
+// bit pattern. Only column pages store them in their type's own width.
+
+// Calls `fn(T{})`, where T is the C++ type a column of `type` stores in its pages.
+template <typename Fn>
+decltype(auto) VisitStorageType(DataType type, Fn&& fn) {
+    switch (type) {
+        case DataType::INT8:
+            return fn(int8_t{});
+        case DataType::INT16:
+            return fn(int16_t{});
+        case DataType::INT32:
+        case DataType::DATE:
+            return fn(int32_t{});
+        case DataType::DOUBLE:
+            return fn(double{});
+        default:
+            return fn(int64_t{});
+    }
+}
+
+// Converts a value from its int64_t form to the form stored in a page.
+template <typename T>
+T ToStored(int64_t value) {
+    if constexpr (std::is_same_v<T, double>) {
+        return std::bit_cast<double>(value);
+    } else {
+        return static_cast<T>(value);
+    }
+}
+
+// Converts a stored value back to its int64_t form.
+template <typename T>
+int64_t FromStored(T value) {
+    if constexpr (std::is_same_v<T, double>) {
+        return std::bit_cast<int64_t>(value);
+    } else {
+        return static_cast<int64_t>(value);
+    }
+}
+
+// Maps the int64_t form of a value of `type` to an integer that sorts in the
+// value's order. A DOUBLE sorts by the IEEE total order: -0.0 just before 0.0,
+// NaNs at either end.
+inline int64_t SortKey(DataType type, int64_t value) {
+    if (type != DataType::DOUBLE) {
+        return value;
+    }
+    // Negative doubles sort backwards as integers; flip all but their sign bit.
+    return value ^ static_cast<int64_t>(static_cast<uint64_t>(value >> 63) >> 1);
+}
+
+// Bytes one value of `type` takes in a column page.
+size_t TypeSize(DataType type);
+
+// The SQL name of `type`, e.g. "INT32".
+const char* TypeName(DataType type);
+
+// Whether the int64_t form `value` can be stored in a column of `type` without losing anything.
+bool FitsType(DataType type, int64_t value);
+
+// Formats a value for display: dates as YYYY-MM-DD, timestamps as YYYY-MM-DD HH:MM:SS[.ffffff].
+std::string FormatValue(DataType type, int64_t value);
+
+// Parses a DATE ('YYYY-MM-DD') or TIMESTAMP ('YYYY-MM-DD[ HH:MM:SS[.ffffff]]')
+// literal into its int64_t form. Returns false if `text` is not one, or is
+// outside the type's range (about 292,000 years either side of 1970 for TIMESTAMP).
+bool ParseDateTime(DataType type, const std::string& text, int64_t* value);
 }
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace db {
+
+// LEB128-style variable-length integers: 7 bits per byte, high bit set on
+// every byte but the last. Small magnitudes take one or two bytes instead of eight.
+
+inline void PutVarint(std::vector<char>* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+// Decodes a varint from [*p, end). Advances *p and returns false on truncated input.
+inline bool GetVarint(const char** p, const char* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        auto byte = static_cast<uint8_t>(*(*p)++);
+        result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Zigzag maps signed to unsigned so that small negative numbers stay small:
+// 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3, ...
+inline uint64_t ZigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t ZigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace db
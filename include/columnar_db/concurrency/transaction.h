@@ -0,0 +1,89 @@
+#pragma once
+
+#include "columnar_db/common/config.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace db {
+
+/**
+ * @struct Snapshot
+ * @brief The set of transactions whose effects a reader may see.
+ *
+ * Taken when a transaction begins. A transaction's changes are visible to
+ * the snapshot iff it committed before the snapshot was taken (or it is the
+ * snapshot's own transaction).
+ */
+struct Snapshot {
+    txn_id_t txn_id = INVALID_TXN_ID; // The owning transaction; its own changes are always visible
+    txn_id_t xmin = 0;                // Every id below this had finished when the snapshot was taken
+    txn_id_t xmax = 0;                // Ids at or above this had not started yet
+    std::vector<txn_id_t> active;     // Sorted ids in [xmin, xmax) that were still running
+    std::shared_ptr<const std::unordered_set<txn_id_t>> aborted;
+
+    // True if `id`'s changes are part of this snapshot.
+    bool IsCommitted(txn_id_t id) const {
+        if (id == INVALID_TXN_ID || id == txn_id) {
+            return true;
+        }
+        if (id >= xmax) {
+            return false;
+        }
+        if (id >= xmin && std::binary_search(active.begin(), active.end(), id)) {
+            return false;
+        }
+        return aborted == nullptr || aborted->count(id) == 0;
+    }
+
+    // True if a row inserted by `row_xmin` and deleted by `row_xmax` (0 if never) is visible.
+    bool IsVisible(txn_id_t row_xmin, txn_id_t row_xmax) const {
+        if (!IsCommitted(row_xmin)) {
+            return false;
+        }
+        return row_xmax == INVALID_TXN_ID || !IsCommitted(row_xmax);
+    }
+};
+
+enum class TransactionState { RUNNING, COMMITTED, ABORTED };
+
+/**
+ * @class Transaction
+ * @brief A unit of work with its own id and a snapshot of what it can read.
+ *
+ * It also records the rows it appended, so that an abort can mark them
+ * deleted by the transaction itself: the rows are then invisible whether or
+ * not its id is remembered as aborted, which keeps the aborted set empty.
+ */
+class Transaction {
+public:
+    // Rows [first_row, first_row + row_count) appended to table `table_id`.
+    struct InsertedRows {
+        uint32_t table_id;
+        uint64_t first_row;
+        uint64_t row_count;
+    };
+
+    explicit Transaction(Snapshot snapshot) : snapshot_(std::move(snapshot)) {}
+
+    txn_id_t GetId() const { return snapshot_.txn_id; }
+    const Snapshot& GetSnapshot() const { return snapshot_; }
+    TransactionState GetState() const { return state_; }
+
+    // Records rows the transaction appended. Called by the statement's thread only.
+    void RecordInsert(uint32_t table_id, uint64_t first_row, uint64_t row_count) {
+        inserts_.push_back({table_id, first_row, row_count});
+    }
+    const std::vector<InsertedRows>& GetInserts() const { return inserts_; }
+
+private:
+    friend class TransactionManager;
+
+    Snapshot snapshot_;
+    TransactionState state_ = TransactionState::RUNNING;
+    std::vector<InsertedRows> inserts_;
+};
+
+} // namespace db
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "columnar_db/concurrency/transaction.h"
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace db {
+
+/**
+ * @class TransactionManager
+ * @brief Hands out transaction ids and snapshots for snapshot isolation.
+ *
+ * Rows are never updated in place: each row records the id of the
+ * transaction that inserted it (xmin) and the one that deleted it (xmax) in
+ * hidden columns, and readers filter rows through their snapshot. Readers
+ * therefore never wait for writers and writers never wait for readers; the
+ * only shared state is this manager's short critical section at begin/commit.
+ */
+class TransactionManager {
+public:
+    // `next_txn_id` must be greater than any id already stored in the database.
+    explicit TransactionManager(txn_id_t next_txn_id);
+
+    std::unique_ptr<Transaction> Begin();
+    void Commit(Transaction* txn);
+
+    // Ends `txn` as aborted. If `changes_undone`, every row it changed has
+    // been put back (delete marks cleared, inserted rows marked deleted by
+    // itself), so its id may read as committed and is not remembered.
+    void Abort(Transaction* txn, bool changes_undone = false);
+
+    // The aborted ids whose changes may still be in the tables.
+    std::shared_ptr<const std::unordered_set<txn_id_t>> GetAborted();
+
+    // Forgets aborted `ids` once no row refers to them (see Compactor).
+    void ForgetAborted(const std::unordered_set<txn_id_t>& ids);
+
+    // The id the next transaction will get; persisted at checkpoints.
+    txn_id_t GetNextTxnId();
+
+private:
+    std::mutex latch_;
+    txn_id_t next_txn_id_;
+    std::set<txn_id_t> active_;
+
+    // Copy-on-write so snapshots can share it without holding the latch.
+    // Kept small, since any entry keeps scans off the fast visibility path.
+    // Lost on restart, so nothing may depend on it then: recovery rolls back
+    // every transaction that did not log COMMIT.
+    std::shared_ptr<const std::unordered_set<txn_id_t>> aborted_;
+};
+
+} // namespace db
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "columnar_db/engine/query_executor.h"
+#include "columnar_db/recovery/backup_manager.h"
+#include "columnar_db/recovery/checkpoint_manager.h"
+#include <ostream>
+#include <string>
+
+namespace db {
+
+/**
+ * @class CommandProcessor
+ * @brief Runs one command typed by a client: a SQL statement, EXPLAIN ANALYZE,
+ * SHOW STATS [JSON], CLUSTER table BY column, PARTITION table BY ..., CREATE
+ * PARTITION name OF table ..., CREATE MATERIALIZED VIEW name AS SELECT ..., a
+ * SELECT with TABLESAMPLE SYSTEM (percent) or "backup [incremental] DIR".
+ *
+ * The REPL and every server session share one processor; it keeps no state
+ * of its own, so commands from different sessions may run at the same time.
+ */
+class CommandProcessor {
+public:
+    // `checkpoint_manager` and `backup_manager` are null when the database is read-only.
+    CommandProcessor(QueryExecutor* executor, CheckpointManager* checkpoint_manager, BackupManager* backup_manager);
+
+    // Runs `command`, writing its results to `out` and any errors to `err`.
+    void Run(const std::string& command, std::ostream& out, std::ostream& err);
+
+private:
+    // Starts a backup in the background for "backup [incremental] DIR"; `args` is what follows "backup".
+    void run_backup(const std::string& args, std::ostream& out, std::ostream& err);
+
+    // Sets a table's sort key for "CLUSTER table BY column".
+    void run_cluster(const std::string& command, std::ostream& out, std::ostream& err);
+
+    // Partitions a table for "PARTITION table BY RANGE (column)" or
+    // "PARTITION table BY HASH (column) INTO n".
+    void run_partition(const std::string& command, std::ostream& out, std::ostream& err);
+
+    // Adds a range partition for "CREATE PARTITION name OF table FROM lo TO hi".
+    void run_create_partition(const std::string& command, std::ostream& out, std::ostream& err);
+
+    // Runs a SELECT with a "TABLESAMPLE SYSTEM (percent)" clause starting at `sample_at`.
+    void run_sample(const std::string& command, size_t sample_at, std::ostream& out, std::ostream& err);
+
+    // Creates a materialized view for "CREATE MATERIALIZED VIEW name AS SELECT ...".
+    void run_create_view(const std::string& command, std::ostream& out, std::ostream& err);
+
+    // Takes a checkpoint once enough log has built up, between statements.
+    void maybe_checkpoint();
+
+    QueryExecutor* executor_;
+    CheckpointManager* checkpoint_manager_;
+    BackupManager* backup_manager_;
+};
+
+} // namespace db
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "columnar_db/concurrency/transaction_manager.h"
+#include "columnar_db/recovery/checkpoint_manager.h"
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/storage/catalog.h"
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class Compactor
+ * @brief Rewrites a table's column chains without its dead rows.
+ *
+ * A row is dead once it was deleted by a committed transaction that every
+ * possible reader can see, or inserted by one that aborted. Compaction copies
+ * the live rows into new chains, freezing their __xmin to 0 so later scans
+ * take the fast visibility path, and then switches the catalog over.
+ *
+ * Row ids change, so log records from before the switch must never be
+ * replayed against the new chains. The switch is therefore bracketed by two
+ * checkpoints and runs with the statement latch held exclusively: no
+ * statement is in flight, so every transaction has finished and the log has
+ * nothing past the first checkpoint.
+ *
+ * The same rewrite merges a clustered table: the live rows are written out
+ * sorted by the sort column, and they all become the table's sealed segment.
+ * A materialized view's live rows are instead summed into one per group,
+ * written out in key order.
+ */
+class Compactor {
+public:
+    Compactor(Catalog* catalog, BufferPoolManager* bpm, TransactionManager* txn_manager,
+              CheckpointManager* checkpoint_manager, std::shared_mutex* statement_latch, std::shared_mutex* ddl_latch);
+    ~Compactor();
+
+    // Compacts one table. The caller must hold the DDL and statement latches exclusively.
+    // Returns the number of dead rows dropped.
+    uint64_t CompactTable(const std::string& table_name);
+
+    // Starts a background thread that compacts every table with at least
+    // COMPACTION_MIN_DEAD_ROWS dead rows making up COMPACTION_MIN_DEAD_RATIO of
+    // it, and every clustered table whose unsorted tail has grown to
+    // CLUSTER_MERGE_MIN_TAIL_ROWS rows and CLUSTER_MERGE_MIN_TAIL_RATIO of its
+    // sealed segment, and every materialized view with at least
+    // VIEW_FOLD_MIN_DELTA_ROWS change rows, more than it has groups, to fold,
+    // and every table that still refers to an aborted transaction.
+    // What it does is counted in Metrics (COMPACTIONS and the like).
+    void Start();
+    void Stop();
+
+private:
+    void compact_loop();
+
+    // Marks which rows of `schema`'s table survive. Returns the number that do
+    // not. Sets `has_aborted` if any row refers to an aborted transaction.
+    uint64_t find_live_rows(const TableSchema* schema, std::vector<bool>* live, bool* has_aborted = nullptr);
+
+    // The live rows of a clustered table, ordered by its sort column.
+    std::vector<uint64_t> sorted_order(const TableSchema* schema, const std::vector<bool>& live);
+
+    // The live rows of a materialized view, folded into one per group in key order.
+    std::vector<std::vector<int64_t>> fold_view(const TableSchema* schema, const std::vector<bool>& live);
+
+    // Copies the live values of column `col_idx` into a new chain, in the row
+    // order `order` if it is not empty; returns the chain's first page.
+    page_id_t rewrite_column(const TableSchema* schema, size_t col_idx, const std::vector<bool>& live,
+                             const std::vector<uint64_t>& order);
+
+    Catalog* catalog_;
+    BufferPoolManager* bpm_;
+    TransactionManager* txn_manager_;
+    CheckpointManager* checkpoint_manager_;
+    std::shared_mutex* statement_latch_;
+    std::shared_mutex* ddl_latch_; // Keeps backups out while pages change unlogged
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+} // namespace db
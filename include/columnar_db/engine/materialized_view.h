@@ -0,0 +1,50 @@
+#pragma once
+
+#include "columnar_db/storage/catalog.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class ViewAggregator
+ * @brief Sums rows into the groups of a materialized view.
+ *
+ * Fed rows of the view's base table, it works out what they add to (or take
+ * away from) each group: the change rows a statement appends to the view.
+ * Fed the view table's own rows, it folds them into the view's value.
+ */
+class ViewAggregator {
+public:
+    explicit ViewAggregator(const TableSchema* view);
+
+    const TableSchema* GetView() const { return view_; }
+
+    // Adds a row of the base table (its user columns, at least) to its group;
+    // a `sign` of -1 takes it away again.
+    void AddBaseRow(const std::vector<int64_t>& row, int64_t sign);
+
+    // Adds a row of the view table (its user columns, at least) to its group.
+    void AddViewRow(const std::vector<int64_t>& row);
+
+    // The groups as rows of the view's user columns, ordered by their keys.
+    // The view's value leaves out the groups whose COUNT is 0; a change
+    // (`delta`) leaves out only the groups it does not change at all.
+    std::vector<std::vector<int64_t>> Rows(bool delta) const;
+
+    bool Empty() const { return groups_.empty(); }
+
+private:
+    void add(const std::vector<int64_t>& key, const std::vector<int64_t>& values, int64_t sign);
+
+    const TableSchema* view_;
+    std::vector<size_t> key_columns_;       // The view's GROUP_KEY columns
+    std::vector<size_t> aggregate_columns_; // Its COUNT and SUM columns
+    size_t count_ = 0;                      // Index in aggregate_columns_ of the first COUNT
+
+    // Group key (as SortKeys, so the map orders groups by value) -> one sum per aggregate column.
+    std::map<std::vector<int64_t>, std::vector<int64_t>> groups_;
+};
+
+} // namespace db
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace db {
+
+class MemoryManager;
+
+/**
+ * @class MemoryGrant
+ * @brief The memory one statement may use, handed out by MemoryManager::Admit.
+ *
+ * Operators reserve what they allocate against the grant, and spill or fail
+ * when it runs out. The grant goes back to the manager when it is destroyed,
+ * at the end of the statement. Reserve and Release may be called from
+ * several threads at once, e.g. by the scans of a partitioned table.
+ */
+class MemoryGrant {
+public:
+    MemoryGrant(MemoryManager* manager, size_t size) : manager_(manager), size_(size) {}
+    ~MemoryGrant();
+
+    MemoryGrant(const MemoryGrant&) = delete;
+    MemoryGrant& operator=(const MemoryGrant&) = delete;
+
+    // Takes `bytes` of the grant. Returns false, taking nothing, if fewer are left.
+    bool Reserve(size_t bytes);
+
+    // Gives back `bytes` taken by Reserve.
+    void Release(size_t bytes);
+
+    size_t GetSize() const { return size_; }
+    size_t GetUsed() const { return used_.load(std::memory_order_relaxed); }
+
+private:
+    MemoryManager* manager_;
+    size_t size_;
+    std::atomic<size_t> used_{0};
+};
+
+/**
+ * @class MemoryManager
+ * @brief Shares a fixed memory budget among the statements that buffer output.
+ *
+ * Only statements that hold output back ask for a grant, sized to what they
+ * expect to buffer; the others never wait here. Once the budget is handed
+ * out, further grants wait until running statements give theirs back, so
+ * the budget bounds memory, not the number of statements. Thread-safe.
+ */
+class MemoryManager {
+public:
+    /**
+     * @param budget Bytes shared by all statements.
+     * @param max_grant Most bytes granted to one statement; at most `budget`.
+     */
+    MemoryManager(size_t budget, size_t max_grant);
+
+    /**
+     * @brief Blocks until `bytes` (at most max_grant) of the budget are free,
+     * then hands them to the calling statement.
+     */
+    std::unique_ptr<MemoryGrant> Admit(size_t bytes);
+
+private:
+    friend class MemoryGrant;
+
+    // Called by a grant when it is destroyed.
+    void release(size_t bytes);
+
+    std::mutex latch_;
+    std::condition_variable released_;
+    size_t budget_;
+    size_t max_grant_;
+    size_t granted_ = 0;
+};
+
+} // namespace db
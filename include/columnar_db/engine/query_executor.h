@@ -1,13 +1,26 @@
 #pragma once
 
+#include "columnar_db/concurrency/transaction_manager.h"
+#include "columnar_db/engine/materialized_view.h"
+#include "columnar_db/engine/memory_manager.h"
+#include "columnar_db/engine/query_profile.h"
+#include "columnar_db/engine/result_cache.h"
 #include "columnar_db/storage/buffer_pool_manager.h"
 #include "columnar_db/storage/catalog.h"
 #include "columnar_db/wal/log_manager.h"
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <vector>
 
-namespace hsql { struct SQLStatement; }
+namespace hsql { struct SQLStatement; struct SelectStatement; struct Expr; }
 
 namespace db {
 
+class Table;
+
 /**
  * @class QueryExecutor
  * @brief Executes parsed SQL statements against the persistent storage.
@@ -18,28 +31,284 @@ public:
      * @brief Constructs a new QueryExecutor.
      * @param catalog The database catalog to find table schemas.
      * @param bpm The buffer pool manager to pass to Table objects.
+     * @param log_manager The write-ahead log that inserts are appended to.
+     * @param txn_manager Hands out the transaction and snapshot each statement runs in.
      */
-    QueryExecutor(Catalog* catalog, BufferPoolManager* bpm, LogManager* log_manager);
+    QueryExecutor(Catalog* catalog, BufferPoolManager* bpm, LogManager* log_manager,
+                  TransactionManager* txn_manager);
 
     /**
      * @brief Main entry point for executing a parsed statement.
+     * @param out Where results and row counts are written.
+     * @param err Where errors are written.
+     * @param profile If given, the steps of the statement are timed into it and a
+     *        SELECT's rows are counted rather than printed.
+     *
+     * Safe to call from several threads at once, e.g. one per client session.
+     * A SELECT that must hold rows back (from several partitions, or for the
+     * result cache) first waits for a memory grant sized to them, so the
+     * buffered output of the statements running at once stays within the
+     * query memory budget.
+     */
+    void Execute(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                 QueryProfile* profile = nullptr);
+
+    /**
+     * @brief Executes a statement, writing to std::cout and std::cerr.
+     */
+    void Execute(const hsql::SQLStatement* statement, QueryProfile* profile = nullptr);
+
+    /**
+     * @brief Executes a statement given with its text `query`. The output of
+     * a SELECT is served from the result cache while the table it reads is
+     * unchanged, and kept there otherwise.
+     */
+    void ExecuteCached(const std::string& query, const hsql::SQLStatement* statement, std::ostream& out,
+                       std::ostream& err);
+
+    /**
+     * @brief Executes a statement and prints its profile (EXPLAIN ANALYZE) to `out`.
+     */
+    void ExplainAnalyze(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err);
+
+    /**
+     * @brief Executes a SELECT over a random sample of about `percent` percent
+     * of the table's pages (SELECT ... FROM table TABLESAMPLE SYSTEM (percent)).
+     *
+     * Skipped pages are never read, so the cost shrinks with the sample.
+     */
+    void ExecuteSample(const hsql::SQLStatement* statement, double percent, std::ostream& out, std::ostream& err);
+
+    /**
+     * @brief Clusters a table by one of its columns (CLUSTER table BY column).
+     *
+     * The rows already in the table become its unsorted tail; the Compactor
+     * sorts them into the sealed segment in the background.
+     */
+    void Cluster(const std::string& table_name, const std::string& column_name, std::ostream& out,
+                 std::ostream& err);
+
+    /**
+     * @brief Partitions an empty table by RANGE or HASH of one of its columns
+     * (PARTITION table BY RANGE|HASH (column) [INTO n]).
+     *
+     * HASH partitioning creates its `partition_count` partitions right away,
+     * named table_p0, table_p1 and so on; a RANGE-partitioned table gets its
+     * partitions from CreatePartition.
      */
-    void Execute(const hsql::SQLStatement* statement);
+    void Partition(const std::string& table_name, PartitionKind kind, const std::string& column_name,
+                   uint32_t partition_count, std::ostream& out, std::ostream& err);
+
+    /**
+     * @brief Adds a partition to a RANGE-partitioned table (CREATE PARTITION
+     * name OF table FROM lo TO hi) holding the rows with lo <= value < hi.
+     *
+     * `from` may be MINVALUE and `to` MAXVALUE. The partition is a table of
+     * its own: DROP TABLE on it drops its rows at once.
+     */
+    void CreatePartition(const std::string& partition_name, const std::string& table_name, const std::string& from,
+                         const std::string& to, std::ostream& out, std::ostream& err);
+
+    /**
+     * @brief Creates a materialized view (CREATE MATERIALIZED VIEW name AS
+     * SELECT g, COUNT(*), SUM(x) FROM table GROUP BY g) from its query.
+     *
+     * The view is stored as a table of partial aggregates per group. Every
+     * statement that changes the base table appends, in its own transaction,
+     * the change it makes to each group, so reading the view costs the number
+     * of groups plus the change rows the Compactor has not folded in yet.
+     * The query must select COUNT(*) and every GROUP BY column.
+     */
+    void CreateMaterializedView(const std::string& view_name, const hsql::SelectStatement* query, std::ostream& out,
+                                std::ostream& err);
+
+    /**
+     * @brief Held shared by every statement; the Compactor takes it exclusively.
+     */
+    std::shared_mutex* GetStatementLatch() { return &statement_latch_; }
+
+    /**
+     * @brief Taken exclusively, before the statement latch, by work that changes
+     * pages without logging them (DDL and compaction); a backup holds it shared.
+     */
+    std::shared_mutex* GetDdlLatch() { return &ddl_latch_; }
 
 private:
     /**
-     * @brief Executes a SELECT statement.
+     * @brief Executes a SELECT statement, reading about `sample_fraction` of
+     * each table's pages. Selecting APPROX_COUNT_DISTINCT(column) prints one
+     * row of estimates instead of the matching rows. Output that waits on
+     * other partitions is buffered within `memory`, and spilled beyond it;
+     * without one, the statement is admitted for what it will buffer.
+     */
+    void ExecuteSelect(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                       QueryProfile* profile, MemoryGrant* memory, double sample_fraction = 1.0);
+
+    /**
+     * @brief Reads a materialized view, folding its rows into one per group.
      */
-    void ExecuteSelect(const hsql::SQLStatement* statement);
+    void ExecuteSelectView(const hsql::SelectStatement* select_stmt, const TableSchema* schema, std::ostream& out,
+                    std::ostream& err, QueryProfile* profile);
 
     /**
      * @brief Executes an INSERT statement.
      */
-    void ExecuteInsert(const hsql::SQLStatement* statement);
+    void ExecuteInsert(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                       QueryProfile* profile);
+
+    /**
+     * @brief Executes a DELETE statement by marking the matching rows' __xmax.
+     */
+    void ExecuteDelete(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                       QueryProfile* profile);
+
+    /**
+     * @brief Executes an UPDATE statement as a delete plus an insert of the new versions.
+     */
+    void ExecuteUpdate(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                       QueryProfile* profile);
+
+    /**
+     * @brief Executes a CREATE TABLE statement.
+     */
+    void ExecuteCreate(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                       QueryProfile* profile);
+
+    /**
+     * @brief Executes a DROP TABLE statement, freeing the table's pages.
+     */
+    void ExecuteDrop(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                     QueryProfile* profile);
+
+    /**
+     * @brief Executes an EXPORT (COPY ... TO) statement, writing the visible rows to a columnar file.
+     */
+    void ExecuteExport(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                       QueryProfile* profile);
+
+    /**
+     * @brief Executes an IMPORT (COPY ... FROM) statement, appending a columnar file's rows in one transaction.
+     */
+    void ExecuteImport(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                       QueryProfile* profile);
+
+    // A condition of a WHERE clause: user column `column` lies in [lo, hi]
+    // (in int64_t form). A scan applies it with Table::FilterRange.
+    struct ColumnRange {
+        int column;
+        int64_t lo;
+        int64_t hi;
+    };
+
+    /**
+     * @brief Turns a WHERE clause (or nullptr) into a predicate over user columns.
+     * The clause is also returned as the `ranges` a row must lie in, one per column.
+     * @return false, after writing an error to `err`, if the clause is not supported.
+     */
+    bool BuildPredicate(const hsql::Expr* where, const TableSchema* schema,
+                        std::function<bool(const std::vector<int64_t>&)>* predicate,
+                        std::vector<ColumnRange>* ranges, std::ostream& err);
+
+    // Narrows `ranges` by one condition of a WHERE clause: a comparison of a
+    // column with a value, BETWEEN, or an AND of those.
+    static bool add_condition(const hsql::Expr* expr, const TableSchema* schema, std::vector<ColumnRange>* ranges,
+                              std::ostream& err);
+
+    // The tables a statement on `schema` reads: the table itself, or if it is
+    // partitioned, those of its partitions that may hold rows in `ranges`.
+    std::vector<const TableSchema*> scan_targets(const TableSchema* schema, const std::vector<ColumnRange>& ranges);
+
+    // Bytes the printed rows of `targets` may take, at `sample_fraction` of
+    // their rows: the size of the grant to buffer them, capped at QUERY_MEMORY_GRANT.
+    size_t estimate_output_bytes(const std::vector<const TableSchema*>& targets, double sample_fraction);
+
+    // The partition among `partitions` (of partitioned table `schema`) that
+    // holds rows whose partition column is `value`, or nullptr.
+    static const TableSchema* find_partition(const TableSchema* schema,
+                                             const std::vector<const TableSchema*>& partitions, int64_t value);
+
+    // Returns false, after writing an error to `err`, if `schema` is a
+    // partition or a materialized view: rows are only written through its
+    // parent, and a view only changes with its base table.
+    bool check_writable(const TableSchema* schema, std::ostream& err);
+
+    // One aggregator per materialized view of the table `schema` (or of its
+    // parent, for a partition), to collect the changes of a statement on it.
+    std::vector<ViewAggregator> view_deltas(const TableSchema* schema);
+
+    // Appends the changes collected in `deltas` to their views as rows of
+    // `txn`, leaving the future of the last one in `commit`. Throws on failure.
+    void append_view_deltas(const std::vector<ViewAggregator>& deltas, Transaction* txn,
+                            std::optional<LsnFuture>* commit);
+
+    // Bumps the data version of table `schema` and of every table whose rows
+    // change with it: its parent and sibling partitions, and their views.
+    void bump_versions(const TableSchema* schema);
+
+    // Logs and appends rows (at least one) of `txn`, given column-wise with
+    // their MVCC columns, to `table` in batches that fit the log buffer.
+    // Returns the future of the last batch; throws on failure.
+    LsnFuture append_batches(Table* table, Transaction* txn, const std::vector<std::vector<int64_t>>& columns);
+
+    // The columns of a select list of APPROX_COUNT_DISTINCT(column) items, or
+    // none for any other select list. Returns false, after writing an error
+    // to `err`, if it mixes those items with others.
+    static bool approx_distinct_columns(const hsql::SelectStatement* select_stmt, const TableSchema* schema,
+                                        std::vector<int>* columns, std::ostream& err);
+
+    // Writes the column header of a SELECT's output.
+    static void print_header(const TableSchema* schema, std::ostream& out);
+
+    // Runs fn(0) ... fn(targets.size() - 1), one call per target, on up to
+    // PARTITION_SCAN_THREADS threads, the calling one included. With a
+    // NUMA-aware buffer pool, target i belongs to node table_id % nodes and
+    // each thread is a helper pinned to a node that takes that node's targets
+    // first, so the frames it reads them into are local.
+    void run_parallel(const std::vector<const TableSchema*>& targets, const std::function<void(size_t)>& fn) const;
+
+    // Adds an operator to `profile`, or returns nullptr when not profiling.
+    static OperatorProfile* add_operator(QueryProfile* profile, std::string name);
+
+    // Index of the user column named `col_name`, or -1.
+    static int find_user_column(const TableSchema* schema, const char* col_name);
+
+    // Converts literal `expr` to the int64_t form of a value of `column`. Returns
+    // false, after writing an error to `err`, if it is not a valid one.
+    static bool parse_value(const hsql::Expr* expr, const Column& column, int64_t* value, std::ostream& err);
+
+    // Like parse_value, for a value written as text outside of SQL: an
+    // integer, or a quoted date or timestamp.
+    static bool parse_text_value(const std::string& text, const Column& column, int64_t* value, std::ostream& err);
+
+    // Logs and applies the deletion of `row_ids` by `txn`, in records that fit
+    // the log buffer, once every row is known to be free to delete. Returns the
+    // future of the last record, or nothing (with every mark undone) on failure.
+    std::optional<LsnFuture> delete_rows(Table* table, Transaction* txn, const std::vector<uint64_t>& row_ids,
+                                         std::ostream& err);
+
+    // Clears the delete marks on `row_ids` and logs compensating records.
+    // Returns false if the marks could not be cleared.
+    bool undo_delete(Table* table, const std::vector<uint64_t>& row_ids, std::ostream& err);
+
+    // Logs the COMMIT record of `txn`, which has logged changes, and waits
+    // until it is durable. The log is flushed in order, so every change of
+    // `txn` is durable too. Throws on failure.
+    void log_commit(Transaction* txn);
+
+    // Aborts `txn`, first marking the rows it appended as deleted by it, with
+    // compensating records, then logs its ABORT record. `deletes_undone` says
+    // the caller has cleared every delete mark of `txn`; unless that and the
+    // undo of the inserts succeeded, its id is remembered as aborted.
+    void abort(Transaction* txn, std::ostream& err, bool deletes_undone = true);
 
     Catalog* catalog_;
     BufferPoolManager* bpm_;
     LogManager* log_manager_;
+    TransactionManager* txn_manager_;
+    std::shared_mutex statement_latch_;
+    std::shared_mutex ddl_latch_;
+    MemoryManager memory_manager_;
+    ResultCache result_cache_;
 };
 
 } // namespace db
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "columnar_db/common/metrics.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+
+namespace db {
+
+/**
+ * @brief Rows produced by, and time spent in, one step of a statement.
+ */
+struct OperatorProfile {
+    std::string name;
+    uint64_t rows = 0;
+    uint64_t time_ns = 0;
+};
+
+/**
+ * @class QueryProfile
+ * @brief What EXPLAIN ANALYZE reports about one statement.
+ *
+ * The executor adds an operator for each step it runs and times it. The
+ * profile also takes the calling thread's Metrics at the start and the end,
+ * so the buffer pool and I/O numbers are the statement's own. Work done on
+ * other threads for it (the log flusher, parallel decoding) is not included.
+ */
+class QueryProfile {
+public:
+    QueryProfile();
+
+    // The returned pointer stays valid for the lifetime of the profile.
+    OperatorProfile* AddOperator(std::string name);
+
+    // Stops the clock and the counters.
+    void Finish();
+
+    void Print(std::ostream& out) const;
+
+private:
+    std::deque<OperatorProfile> operators_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t total_ns_ = 0;
+    MetricsSnapshot start_metrics_;
+    MetricsSnapshot metrics_;
+};
+
+/**
+ * @brief Adds the time from its construction to its destruction to an
+ *        operator. Does nothing if the operator is null (not profiling).
+ */
+class OperatorTimer {
+public:
+    explicit OperatorTimer(OperatorProfile* op) : op_(op) {
+        if (op_ != nullptr) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~OperatorTimer() { Stop(); }
+
+    OperatorTimer(const OperatorTimer&) = delete;
+    OperatorTimer& operator=(const OperatorTimer&) = delete;
+
+    // Stops the clock before the end of the scope.
+    void Stop() {
+        if (op_ != nullptr) {
+            op_->time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count();
+            op_ = nullptr;
+        }
+    }
+
+private:
+    OperatorProfile* op_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace db
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace db {
+
+/**
+ * @class ResultCache
+ * @brief The output of recent SELECTs, kept under their normalized text.
+ *
+ * Every table has a data version, bumped after each statement that changes
+ * its rows or its definition commits. A result is only served while the
+ * version of the table it read is the one it was computed at, so a change to
+ * one table drops exactly the results of that table. Results are evicted
+ * least recently used first once they hold more than RESULT_CACHE_BYTES.
+ * Thread-safe.
+ */
+class ResultCache {
+public:
+    // `query` with runs of whitespace outside quotes collapsed to one space,
+    // and without surrounding whitespace or a trailing ';'.
+    static std::string Normalize(const std::string& query);
+
+    // The data version of table `table_id`. A reader must take it before
+    // its snapshot, so a result is never kept under a version that is newer
+    // than what the result saw.
+    uint64_t GetVersion(uint32_t table_id);
+
+    // Bumps the data version of table `table_id`, once the change is committed.
+    void BumpVersion(uint32_t table_id);
+
+    // The output kept for normalized `query` on table `table_id`, if it is still current.
+    std::optional<std::string> Lookup(const std::string& query, uint32_t table_id);
+
+    // Keeps the output of normalized `query`, computed at `version` of table `table_id`.
+    void Insert(const std::string& query, uint32_t table_id, uint64_t version, std::string output);
+
+private:
+    struct Entry {
+        std::string query;
+        uint32_t table_id;
+        uint64_t version;
+        std::string output;
+    };
+
+    // Drops `it` from the cache. Requires latch_.
+    void erase(std::list<Entry>::iterator it);
+
+    std::mutex latch_;
+    std::unordered_map<uint32_t, uint64_t> versions_;
+    std::list<Entry> lru_; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
+    size_t bytes_ = 0;     // Size of the kept queries and outputs
+};
+
+} // namespace db
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "columnar_db/engine/memory_manager.h"
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class SpillBuffer
+ * @brief A stream buffer holding output a statement cannot print yet.
+ *
+ * Text goes into blocks of SPILL_BLOCK_SIZE bytes reserved from the
+ * statement's grant, and given back all at once when the buffer is
+ * destroyed. Once the grant runs out, the rest of the text goes to a
+ * temporary file instead, so the buffer never holds more than its share.
+ * A buffer without a grant sends all of its text to the file.
+ */
+class SpillBuffer : public std::streambuf {
+public:
+    explicit SpillBuffer(MemoryGrant* grant) : grant_(grant) {}
+    ~SpillBuffer() override;
+
+    SpillBuffer(const SpillBuffer&) = delete;
+    SpillBuffer& operator=(const SpillBuffer&) = delete;
+
+    // Writes the text, in order, to `out`. Returns false if some of it could
+    // not be spilled or read back.
+    bool WriteTo(std::ostream& out);
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+private:
+    // Makes room for more text: a new block, or else the temporary file.
+    // Returns false if neither is available.
+    bool grow();
+
+    MemoryGrant* grant_;
+    std::vector<std::unique_ptr<char[]>> blocks_; // All full but the last
+    std::FILE* file_ = nullptr;
+    bool failed_ = false;
+};
+
+} // namespace db
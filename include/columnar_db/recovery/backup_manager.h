@@ -0,0 +1,74 @@
+#pragma once
+
+#include "columnar_db/concurrency/transaction_manager.h"
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/wal/log_manager.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class BackupManager
+ * @brief Takes online full and incremental backups of the database.
+ *
+ * A backup copies pages straight from the data file through its own
+ * read-only descriptor while statements keep running, so the copy is fuzzy.
+ * It also keeps the log from the latest checkpoint at the start of the copy
+ * up to a flush at the end, holding back the log's reclaim meanwhile. Restoring replays that log over the pages, the
+ * same way crash recovery would. DDL and compaction change pages without
+ * logging, so they wait (on the DDL latch) until the backup is done; other
+ * statements and checkpoints do not. Each copied page is checked against its
+ * checksum, and read again if it was caught halfway through being written.
+ *
+ * A full backup copies every page. An incremental backup copies only the
+ * pages the BufferPoolManager reports as changed on disk since the previous
+ * backup. That bitmap lives in memory, so the first backup after a restart
+ * must be a full one.
+ *
+ * A backup directory holds the pages (`data` for a full backup, `pages` for
+ * an incremental one), the log segment (`wal`), and a `MANIFEST` written last.
+ */
+class BackupManager {
+public:
+    BackupManager(const std::string& db_file, const std::string& log_file, BufferPoolManager* bpm,
+                  LogManager* log_manager, TransactionManager* txn_manager, std::shared_mutex* ddl_latch);
+    ~BackupManager();
+
+    // Backs up into the new directory `backup_dir`. Throws std::runtime_error on failure.
+    void Backup(const std::string& backup_dir, bool incremental);
+
+    // Runs Backup on a background thread and reports the outcome on stdout.
+    // Returns false if a backup is already running.
+    bool StartBackup(const std::string& backup_dir, bool incremental);
+
+    // Waits for a backup started with StartBackup to finish.
+    void Wait();
+
+    // Rebuilds `db_file` and `log_file` from `backup_dir` and the backups it is
+    // based on. Starting the database on them afterwards replays the log.
+    static void Restore(const std::string& backup_dir, const std::string& db_file, const std::string& log_file);
+
+private:
+    // Copies the data file's pages to `out_fd` (full) or as page records (incremental).
+    // Returns the number of pages in the data file once the copy was done.
+    page_id_t copy_pages(int out_fd, const std::vector<uint64_t>* changed, uint64_t* pages_copied);
+
+    std::string db_file_;
+    std::string log_file_;
+    BufferPoolManager* bpm_;
+    LogManager* log_manager_;
+    TransactionManager* txn_manager_;
+    std::shared_mutex* ddl_latch_;
+
+    std::mutex backup_latch_;        // One backup at a time
+    std::string last_backup_dir_;    // What the next incremental backup is based on
+    std::atomic<bool> running_{false}; // A StartBackup thread is still working
+    std::thread thread_;
+};
+
+} // namespace db
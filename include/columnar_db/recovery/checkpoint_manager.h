@@ -0,0 +1,49 @@
+#pragma once
+
+#include "columnar_db/concurrency/transaction_manager.h"
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/storage/disk_manager.h"
+#include "columnar_db/wal/log_manager.h"
+#include <mutex>
+
+namespace db {
+
+/**
+ * @class CheckpointManager
+ * @brief Periodically bounds the amount of log that recovery has to replay.
+ *
+ * A checkpoint flushes the log, writes every dirty page back, syncs the data
+ * file and then records the log position in the log header. Changes after
+ * that position may or may not have reached the data file; recovery redoes
+ * them and skips the ones that did.
+ *
+ * Checkpoints must be taken between statements, when every appended log
+ * record has also been applied to its pages; with several sessions that
+ * means holding the statement latch exclusively. They may be requested from
+ * several threads (sessions and the Compactor); they are serialized here.
+ */
+class CheckpointManager {
+public:
+    CheckpointManager(BufferPoolManager* bpm, DiskManager* disk_manager, LogManager* log_manager,
+                      TransactionManager* txn_manager);
+
+    // Takes a checkpoint unconditionally.
+    void Checkpoint();
+
+    // Takes a checkpoint if CHECKPOINT_INTERVAL_BYTES of log have been written
+    // since the last one. Returns true if it did.
+    bool MaybeCheckpoint();
+
+    // Whether MaybeCheckpoint would take a checkpoint now. Cheap, and safe to
+    // call while statements run.
+    bool CheckpointDue() const;
+
+private:
+    BufferPoolManager* bpm_;
+    DiskManager* disk_manager_;
+    LogManager* log_manager_;
+    TransactionManager* txn_manager_;
+    std::mutex latch_;
+};
+
+} // namespace db
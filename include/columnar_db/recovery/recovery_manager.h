@@ -0,0 +1,61 @@
+#pragma once
+
+#include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/storage/catalog.h"
+#include "columnar_db/wal/log_manager.h"
+#include <vector>
+
+namespace db {
+
+/**
+ * @class RecoveryManager
+ * @brief Brings the data file up to date with the write-ahead log after a crash.
+ *
+ * Only the log after the last checkpoint is read. Its records are split into
+ * one redo stream per (table, column); because each column lives in its own
+ * page chain, the streams touch disjoint pages and are replayed on parallel
+ * workers. Within a stream, an append is skipped if the column already holds
+ * that row id, and a delete mark is simply rewritten; both are idempotent.
+ *
+ * The changes of a transaction with no COMMIT record in the log are rolled
+ * back as they are replayed: its delete marks are cleared and the rows it
+ * inserted are marked deleted by it. After a restart every id below the next
+ * transaction id reads as committed, so no aborted ids need to be kept.
+ */
+class RecoveryManager {
+public:
+    RecoveryManager(Catalog* catalog, BufferPoolManager* bpm, LogManager* log_manager);
+
+    // Replays the log tail. Returns the number of log records that were read.
+    size_t Recover();
+
+    // The first transaction id that is safe to hand out after recovery: above
+    // both the checkpoint's high-water mark and every id found in the log tail.
+    txn_id_t GetNextTxnId() const { return next_txn_id_; }
+
+private:
+    // One change to one column: append `value` as row `row_id`, or overwrite row `row_id` with it.
+    struct RedoOp {
+        lsn_t lsn;
+        uint64_t row_id;
+        int64_t value;
+        bool is_append;
+    };
+
+    // The redo work for a single column, in LSN order, then the rollback of
+    // uncommitted inserts.
+    struct ColumnRedo {
+        const TableSchema* schema;
+        size_t column;
+        std::vector<RedoOp> ops;
+    };
+
+    void redo_column(const ColumnRedo& redo);
+
+    Catalog* catalog_;
+    BufferPoolManager* bpm_;
+    LogManager* log_manager_;
+    txn_id_t next_txn_id_ = 1;
+};
+
+} // namespace db
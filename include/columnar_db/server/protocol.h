@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// The wire protocol between the server and its clients.
+//
+// Both directions are a stream of messages, each a one-byte type, a four-byte
+// big-endian payload length and the payload:
+//
+//   client -> server   'Q' command   Run one command (SQL, EXPLAIN ANALYZE, SHOW STATS, backup)
+//                      'X'           Close the session
+//   server -> client   'D' text      What the command printed
+//                      'E' text      The errors it reported
+//                      'Z'           Ready for the next command
+//
+// The server sends 'Z' once a session is accepted, and then answers each 'Q'
+// with any number of 'D' and 'E' messages and a 'Z'. Output is sent in 'D'
+// messages of at most SERVER_OUTPUT_FRAME_SIZE bytes while the command runs;
+// concatenated they are what it printed, and likewise for 'E'. A client may
+// send more commands before the answers arrive; they run one at a time, in order.
+
+namespace db::protocol {
+
+enum class MessageType : char {
+    QUERY = 'Q',
+    TERMINATE = 'X',
+    OUTPUT = 'D',
+    ERROR = 'E',
+    READY = 'Z',
+};
+
+constexpr size_t HEADER_SIZE = 5;
+
+// Appends a message to `buffer`. Throws std::runtime_error if the payload
+// does not fit the four-byte length.
+void AppendMessage(std::string* buffer, MessageType type, std::string_view payload = {});
+
+// If `buffer` starts with a whole message, sets *type and *payload and returns
+// the message's size; returns 0 if more bytes are needed. Throws
+// std::runtime_error if the payload is longer than `max_payload`.
+size_t ParseMessage(std::string_view buffer, MessageType* type, std::string* payload, size_t max_payload);
+
+} // namespace db::protocol
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "columnar_db/common/config.h"
+#include "columnar_db/engine/command_processor.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class Server
+ * @brief Serves many client sessions on one database, speaking the protocol in protocol.h.
+ *
+ * One thread runs an epoll loop that accepts connections and does all socket
+ * I/O without blocking. Complete commands are handed to a pool of worker
+ * threads that run them through the shared CommandProcessor, so every session
+ * shares the one BufferPoolManager and Catalog. Each session has at most one
+ * command running; the next one waits in its input buffer (and the loop stops
+ * reading from it) until the answer is queued.
+ *
+ * Workers hand their answers back through a queue and wake the loop with an
+ * eventfd. Output is handed back in frames of SERVER_OUTPUT_FRAME_SIZE as the
+ * command produces it, never built up whole. Once SERVER_OUTPUT_WINDOW bytes
+ * of a session's output are waiting to be sent, its worker waits for the
+ * client to read them. A session that disconnects while its command runs is
+ * simply forgotten; the rest of its output is dropped.
+ */
+class Server {
+public:
+    struct Options {
+        int port = -1;            // TCP port on the loopback interface; -1 for none
+        std::string socket_path;  // Unix socket; empty for none
+        size_t worker_threads = SERVER_WORKER_THREADS;
+    };
+
+    // Binds the listening sockets. Throws std::runtime_error on failure.
+    Server(CommandProcessor* processor, Options options);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Serves clients until Stop is called. Commands still running finish
+    // first; open sessions are then closed.
+    void Run();
+
+    // Makes Run return. Async-signal-safe, so it may be called from a signal handler.
+    void Stop();
+
+private:
+    // Output of a running command that the client has not received yet.
+    // Guarded by answers_latch_.
+    struct Backlog {
+        size_t unsent = 0;   // Bytes handed to the loop and not yet sent
+        bool closed = false; // The session is gone, or the server is stopping
+    };
+
+    struct Session {
+        uint64_t id;
+        int fd;
+        std::string input;      // Bytes received and not yet parsed
+        std::string output;     // Bytes not yet sent
+        bool busy = false;      // A command is running on a worker
+        std::shared_ptr<Backlog> backlog; // Of the running command
+        bool closing = false;   // Close once the output is sent
+        bool registered = false; // Added to the epoll set
+        uint32_t events = 0;     // What it is registered for
+    };
+
+    struct Job {
+        uint64_t session_id;
+        std::string command;
+        std::shared_ptr<Backlog> backlog;
+    };
+
+    struct Answer {
+        uint64_t session_id;
+        std::string messages;
+        bool last; // Ends with 'Z': the command has finished
+    };
+
+    int listen_tcp(int port);
+    int listen_unix(const std::string& path);
+
+    void accept_sessions(int listen_fd);
+
+    // Reads what the client sent. Returns false if the session was closed.
+    bool receive(Session* session);
+
+    // Sends as much output as the socket takes. Returns false if the session was closed.
+    bool send_output(Session* session);
+
+    // Starts the session's next command if it is idle and one has arrived.
+    void dispatch(Session* session);
+
+    // Registers the session for the events its state calls for.
+    void update_events(Session* session);
+
+    void close_session(Session* session);
+
+    // Moves the answers of finished commands to their sessions.
+    void deliver_answers();
+
+    void worker_loop();
+
+    // Hands messages of the job's answer to the loop. Unless they are the
+    // last, first waits while the client has a window's worth unsent; returns
+    // false, dropping them, if the session is gone.
+    bool post_answer(const Job& job, std::string messages, bool last);
+
+    // Waits for the running commands and stops the workers.
+    void stop_workers();
+
+    CommandProcessor* processor_;
+    Options options_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1; // eventfd: Stop and finished commands
+    std::vector<int> listen_fds_;
+    std::atomic<bool> stop_requested_{false};
+
+    // Owned by the loop thread.
+    std::unordered_map<uint64_t, std::unique_ptr<Session>> sessions_;
+    uint64_t next_session_id_;
+
+    std::mutex jobs_latch_;
+    std::condition_variable jobs_cv_;
+    std::deque<Job> jobs_;
+    bool stopping_workers_ = false;
+    std::vector<std::thread> workers_;
+
+    std::mutex answers_latch_;
+    std::condition_variable backlog_cv_; // A backlog shrank or was closed
+    std::vector<Answer> answers_;
+};
+
+} // namespace db
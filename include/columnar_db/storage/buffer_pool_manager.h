@@ -1,56 +1,197 @@
 #pragma once
 
+#include "columnar_db/storage/compressed_page_cache.h"
 #include "columnar_db/storage/disk_manager.h"
 #include "columnar_db/storage/page.h"
+#include "columnar_db/wal/log_manager.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace db {
 
-
+/**
+ * @class BufferPoolManager
+ * @brief Caches pages of the database file in a fixed number of frames.
+ *
+ * In mmap mode (for read-only replicas) there are no frames: the file is
+ * mapped and FetchPage returns a Page that points straight into the mapping,
+ * with no hashing, pinning or LRU bookkeeping. Every method that would
+ * modify the file fails in that mode.
+ *
+ * Given a `compressed_cache_size`, evicted pages are kept compressed in a
+ * CompressedPageCache of that many bytes, and FetchPage looks there before
+ * reading from disk. A victim is copied under the latch and compressed
+ * after it is released; until it is in the tier, FetchPage takes the copy.
+ *
+ * In NUMA-aware mode the frames are split into one arena per NUMA node,
+ * each allocated on its node, with a free list per node. A miss takes a
+ * frame from the arena of the node the calling thread runs on, so a worker
+ * pinned to a node (see NumaTopology::PinThread) reads its pages from
+ * local memory; other nodes' frames are used only when there is none.
+ *
+ * Page I/O runs outside the latch. A frame is in the page table while its
+ * page is read in, and a thread that finds it there waits until the read
+ * is done. A dirty victim is written back after it has left the page table,
+ * and a miss on it waits until the write is done, so it never reads the
+ * copy on disk that the write-back is replacing.
+ *
+ * Hits, misses, evictions, write-backs and time spent waiting are counted
+ * in Metrics.
+ *
+ * The pool also keeps a bitmap of the pages it has changed on disk (written
+ * back, allocated or freed) so that incremental backups only copy those.
+ */
 class BufferPoolManager {
 public:
-    BufferPoolManager(size_t pool_size, DiskManager* disk_manager);
+    // If `log_manager` is given, a dirty page is never written back before the
+    // log is durable up to its page LSN (write-ahead logging).
+    BufferPoolManager(size_t pool_size, DiskManager* disk_manager, LogManager* log_manager = nullptr,
+                      size_t compressed_cache_size = 0, bool numa_aware = false);
+
+    // Creates a BufferPoolManager in mmap mode. `disk_manager` must be read-only.
+    explicit BufferPoolManager(DiskManager* disk_manager);
     ~BufferPoolManager();
 
     BufferPoolManager(const BufferPoolManager &) = delete;
     BufferPoolManager &operator=(const BufferPoolManager &) = delete;
 
     // Fetches a page from the buffer pool, reading from disk if necessary.
+    // With every frame pinned, waits until one is unpinned; returns nullptr
+    // only if the page cannot be read. The pool must therefore hold more
+    // frames than all threads together ever keep pinned at once.
     Page* FetchPage(page_id_t page_id);
 
-    // Creates a new page in the buffer pool and allocates it on disk.
-    Page* NewPage(page_id_t* page_id);
+    // Creates a new page in the buffer pool and allocates it on disk, waiting
+    // for a frame like FetchPage. `hint` is passed on to
+    // DiskManager::AllocatePage to keep chains contiguous.
+    Page* NewPage(page_id_t* page_id, page_id_t hint = INVALID_PAGE_ID);
 
     // Unpins a page, making it a candidate for eviction.
     bool UnpinPage(page_id_t page_id, bool is_dirty);
 
+    // Drops a page from the pool without writing it back and returns it to
+    // the DiskManager's free space. Fails if the page is pinned.
+    bool DeletePage(page_id_t page_id);
+
     // Flushes a specific page to disk, regardless of its pin count.
     bool FlushPage(page_id_t page_id);
 
     // Flushes all dirty pages to disk.
     void FlushAllPages();
 
+    // Hints that the chain continuing at `page_id` is about to be scanned.
+    void Prefetch(page_id_t page_id);
+
+    // Returns the bitmap of pages changed on disk since the last call (bit
+    // page_id % 64 of word page_id / 64) and starts a new one.
+    std::vector<uint64_t> TakeChangedPages();
+
+    // Adds `changed` back into the bitmap, e.g. after a backup that took it failed.
+    void MergeChangedPages(const std::vector<uint64_t>& changed);
+
+    size_t GetPoolSize() const { return pool_size_; }
+    bool IsReadOnly() const { return !mapped_pages_.empty(); }
+    bool IsNumaAware() const { return numa_aware_; }
+
 private:
-    // Tries to find a victim page to evict and returns its frame_id.
-    bool find_victim_frame(frame_id_t* frame_id);
+    // One node's share of the frames' memory, allocated on that node.
+    struct NodeArena {
+        char* memory;
+        size_t frame_count;
+    };
+
+    // A page on its way to the compressed tier: a copy of its bytes, taken
+    // under the latch and compressed once it is released.
+    struct Eviction {
+        page_id_t page_id = INVALID_PAGE_ID;
+        std::shared_ptr<std::vector<char>> data;
+    };
+
+    // Takes a frame for a new page: a free one, else an evicted one, from the
+    // calling thread's node if it has one. Must hold `latch_`.
+    bool take_frame(frame_id_t* frame_id, Eviction* eviction);
+
+    // Tries to find a victim page to evict and returns its frame_id,
+    // preferring a frame of `node`. If there is a compressed tier, the
+    // victim is copied into `eviction` and recorded in evicting_.
+    bool find_victim_frame(frame_id_t* frame_id, size_t node, Eviction* eviction);
+
+    // Compresses the victim of `eviction` and, unless it was fetched, freed or
+    // evicted again meanwhile, moves it from evicting_ to the compressed tier.
+    // Must not hold `latch_`.
+    void finish_eviction(const Eviction& eviction);
     
     // Updates the LRU replacer when a page is accessed.
     void update_replacer(frame_id_t frame_id);
 
+    // Drops the pin of a thread that waited on a frame whose page could not be
+    // read, freeing the frame once no thread holds it. Must hold `latch_`.
+    void release_failed_frame(frame_id_t frame_id);
+
+    // Waits on frame_cv_ through `lock` for a frame to be unpinned or freed,
+    // counting the time spent.
+    void wait_for_frame(std::unique_lock<std::mutex>* lock);
+
+    // Waits on io_cv_ through `lock` until `done`, counting the time spent.
+    void wait_for_io(std::unique_lock<std::mutex>* lock, const std::function<bool()>& done);
+
+    // Blocks until the log is durable up to `page_lsn`, so the page may be written.
+    void wait_for_log(lsn_t page_lsn);
+
+    // Locks `latch_` through `lock`, counting the time spent waiting for it.
+    void lock_latch(std::unique_lock<std::mutex>* lock);
+
+    // Records that `page_id` changed on disk. Called after the write, so a
+    // backup that takes the bitmap in between still sees the page in the next one.
+    void mark_changed(page_id_t page_id);
+
     const size_t pool_size_;
     DiskManager* const disk_manager_;
+    LogManager* const log_manager_;
+    const bool numa_aware_ = false;
 
-    // The array of Page objects that make up the buffer pool frames.
+    // The array of Page objects that make up the buffer pool frames, and their memory.
     std::vector<Page> pages_;
+    std::vector<char> frame_memory_;
+
+    // NUMA-aware mode: the frames' memory, one arena per node, and the node of each frame.
+    std::vector<NodeArena> arenas_;
+    std::vector<size_t> frame_nodes_;
+
+    // mmap mode: one Page per page of the file, pointing into the mapping,
+    // and whether its checksum has been verified yet.
+    std::vector<Page> mapped_pages_;
+    std::vector<std::atomic<bool>> mapped_verified_;
 
     // Mapping from page_id to the frame_id where it is stored.
     std::unordered_map<page_id_t, frame_id_t> page_table_;
 
-    // A list of frame_ids that are currently free.
-    std::list<frame_id_t> free_list_;
+    // Frames whose page is still being read in, and victims whose write-back
+    // is still running, by page id. Guarded by latch_; io_cv_ is notified
+    // when either finishes.
+    std::vector<bool> reading_;
+    std::unordered_set<page_id_t> writing_;
+    std::condition_variable io_cv_;
+
+    // Notified when a frame's pin count drops to zero or a frame is freed.
+    std::condition_variable frame_cv_;
+
+    // Second tier for evicted pages, or nullptr. Guarded by latch_.
+    std::unique_ptr<CompressedPageCache> compressed_cache_;
+
+    // Victims being compressed for the tier, by page id. Guarded by latch_.
+    std::unordered_map<page_id_t, std::shared_ptr<std::vector<char>>> evicting_;
+
+    // The frame_ids that are currently free, one list per node (a single
+    // list unless NUMA-aware).
+    std::vector<std::list<frame_id_t>> free_lists_;
 
     // A list of frame_ids of occupied pages, for the LRU replacer.
     // The front is the most recently used, the back is the least recently used.
@@ -58,6 +199,10 @@ private:
 
     // A mutex to protect the internal data structures of the BPM.
     std::mutex latch_;
+
+    // Pages changed on disk since the last TakeChangedPages, one bit per page.
+    std::vector<uint64_t> changed_pages_;
+    std::mutex changed_latch_;
 };
 
 } // namespace db
\ No newline at end of file
@@ -3,36 +3,199 @@
 #include "columnar_db/common/types.h"
 #include "columnar_db/common/config.h"
 #include "columnar_db/storage/buffer_pool_manager.h"
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <map>
 
 namespace db {
 
+struct TableHandle;
+
 struct Column {
     char name[32];
     DataType type;
     page_id_t first_page_id;
 };
 
+// Every table ends with two hidden MVCC columns: the id of the transaction
+// that inserted each row and the id of the one that deleted it (0 if none).
+constexpr const char* XMIN_COLUMN_NAME = "__xmin";
+constexpr const char* XMAX_COLUMN_NAME = "__xmax";
+constexpr size_t MVCC_COLUMN_COUNT = 2;
+
+// How a partitioned table spreads its rows over its partitions.
+enum class PartitionKind : uint8_t {
+    NONE,
+    RANGE, // By the value of the partition column
+    HASH,  // By the hash of that value
+};
+
+// How a column of a materialized view is computed from its base table's rows.
+enum class ViewAggregate : uint8_t {
+    GROUP_KEY, // A column of the GROUP BY
+    COUNT,     // COUNT(*)
+    SUM,       // SUM(base_column)
+};
+
+struct ViewColumn {
+    ViewAggregate aggregate;
+    int32_t base_column; // A user column of the base table; -1 for COUNT
+};
+
 struct TableSchema {
     char name[32];
-    std::vector<Column> columns;
+    uint32_t table_id = 0; // Stable id used in place of the name in log records
+    std::vector<Column> columns; // User columns followed by the MVCC columns
+
+    // A clustered table keeps its rows sorted by `sort_column` (a user column;
+    // -1 if none) in a sealed segment, its first `sorted_rows` rows. Rows
+    // appended after it form an unsorted tail until the Compactor merges them in.
+    int32_t sort_column = -1;
+    uint64_t sorted_rows = 0;
+
+    // A partitioned table holds no rows itself. Each of its partitions is a
+    // table of its own, with the same columns, whose `parent_table_id` names
+    // it; a row goes to the partition whose [partition_lo, partition_hi]
+    // holds the row's PartitionKey.
+    PartitionKind partition_kind = PartitionKind::NONE;
+    int32_t partition_column = -1; // An integer, DATE or TIMESTAMP user column
+    uint32_t partition_count = 0;  // HASH: the number of buckets
+    uint32_t parent_table_id = 0;  // On a partition; 0 otherwise
+    int64_t partition_lo = 0;
+    int64_t partition_hi = 0;
+
+    // A materialized view is a table whose rows hold partial aggregates of
+    // table `view_base_table_id`'s rows, one user column per `view_columns`
+    // entry. Summing them per group gives the view; every change to the base
+    // table appends the change it makes to each group.
+    uint32_t view_base_table_id = 0;
+    std::vector<ViewColumn> view_columns;
+
+    bool IsView() const { return view_base_table_id != 0; }
+    bool IsPartitioned() const { return partition_kind != PartitionKind::NONE; }
+    bool IsPartition() const { return parent_table_id != 0; }
+
+    // The key a partitioned table places a row by, given the row's value of
+    // the partition column: the value itself for RANGE, its bucket for HASH.
+    int64_t PartitionKey(int64_t value) const {
+        if (partition_kind != PartitionKind::HASH) {
+            return value;
+        }
+        // The finalizer of splitmix64, so neighbouring values land in different buckets.
+        uint64_t h = static_cast<uint64_t>(value);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return static_cast<int64_t>(h % partition_count);
+    }
+
+    size_t UserColumnCount() const { return columns.size() - MVCC_COLUMN_COUNT; }
+    size_t XminColumn() const { return columns.size() - 2; }
+    size_t XmaxColumn() const { return columns.size() - 1; }
 };
 
+/**
+ * @class Catalog
+ * @brief The table schemas, stored as a system table spanning a chain of pages.
+ *
+ * The root page holds the next table id and the head of a chain of entry
+ * pages; each entry page holds as many table entries as fit. Creating,
+ * dropping or re-pointing a table rewrites and flushes only the entry page
+ * that holds it (plus the root when the chain grows), so DDL cost does not
+ * grow with the number of tables.
+ *
+ * The catalog also keeps an open TableHandle per table, so statements do not
+ * re-walk a table's chains to find its row count and last pages. Dropping a
+ * table or replacing its segments discards its handle.
+ *
+ * The partitions of a partitioned table are entries like any other table's,
+ * with segments of their own, so they are logged, recovered and compacted on
+ * their own, and dropping one frees its pages without touching the others.
+ *
+ * The catalog is not internally synchronized, except for handing out table
+ * handles: DDL must not run concurrently with any other statement.
+ */
 class Catalog {
 public:
     explicit Catalog(BufferPoolManager* buffer_pool_manager, bool is_new_db);
 
-    bool CreateTable(TableSchema& schema);
+    // Creates a table from the user columns in `schema`; the MVCC columns are
+    // appended to the catalog's copy. On failure nothing is left allocated.
+    bool CreateTable(const TableSchema& schema);
+
+    // Removes a table and returns all of its pages to the free space. Dropping
+    // a partitioned table drops its partitions too, and dropping a table drops
+    // its materialized views.
+    bool DropTable(const std::string& table_name);
+
+    // Makes an empty table partitioned by `partition_column`; HASH
+    // partitioning spreads rows over `partition_count` buckets. Persists the change.
+    bool SetPartitioning(const std::string& table_name, PartitionKind kind, int32_t partition_column,
+                         uint32_t partition_count);
+
+    // Creates table `partition_name` as the partition of `parent_name` that
+    // holds the rows whose partition key lies in [lo, hi]. It takes the
+    // parent's columns and sort column. The caller checks that it overlaps
+    // no other partition.
+    bool CreatePartition(const std::string& parent_name, const std::string& partition_name, int64_t lo, int64_t hi);
+
+    // The partitions of `parent`, by their lowest partition key.
+    std::vector<const TableSchema*> GetPartitions(const TableSchema* parent) const;
+
+    // The materialized views whose base table is `base`.
+    std::vector<const TableSchema*> GetViews(const TableSchema* base) const;
+
     const TableSchema* GetTableSchema(const std::string& table_name);
+    const TableSchema* GetTableSchema(uint32_t table_id);
+    std::vector<std::string> GetTableNames() const;
+
+    // The open handle of `schema`'s table, built on first use. Safe to call from
+    // concurrent statements; the handle stays valid while the caller holds it.
+    std::shared_ptr<TableHandle> GetTableHandle(const TableSchema* schema);
+
+    // Clusters the table by user column `sort_column`. Its rows count as
+    // unsorted until the Compactor next merges them. Persists the change.
+    bool SetSortColumn(const std::string& table_name, int32_t sort_column);
+
+    // Points the table's columns at new page chains (one first page per
+    // column, in schema order) whose first `sorted_rows` rows are sorted by
+    // the table's sort column, and persists the change. Used by compaction.
+    bool ReplaceColumnSegments(const std::string& table_name, const std::vector<page_id_t>& first_page_ids,
+                               uint64_t sorted_rows = 0);
+
+    // Returns every page of the column chains starting at `first_page_ids` to the free space.
+    void FreeSegments(const std::vector<page_id_t>& first_page_ids);
+
+    // The most columns (including the MVCC columns) a table entry can hold.
+    static size_t MaxColumnCount();
 
 private:
     void LoadFromDisk();
-    void PersistToDisk();
+    void persist_root();
+
+    // Writes `schema`'s entry into an entry page with room, appending a page if none has.
+    void add_entry(const TableSchema& schema);
+
+    // Removes the entry of table `table_id` from entry page `page_id`.
+    void remove_entry(page_id_t page_id, uint32_t table_id);
+
+    // Overwrites the entry of `schema` in place; the column count must not have changed.
+    void update_entry(const TableSchema& schema);
 
     BufferPoolManager* bpm_;
     std::map<std::string, TableSchema> schemas_;
+    std::map<uint32_t, std::string> table_names_; // table_id -> name
+    uint32_t next_table_id_ = 1;
+
+    // The entry pages in chain order, with the free bytes left in each.
+    std::vector<std::pair<page_id_t, uint32_t>> entry_pages_;
+    std::map<std::string, page_id_t> entry_page_of_; // table name -> entry page holding it
+
+    std::mutex handles_latch_;
+    std::unordered_map<uint32_t, std::shared_ptr<TableHandle>> handles_; // table_id -> open handle
 };
 
-} // namespace db
\ No newline at end of file
+} // namespace db
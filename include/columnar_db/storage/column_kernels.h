@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace db {
+
+// Kernels over the values of one column page, instantiated for the page's
+// storage type. They work on plain arrays in fixed-length inner loops, which
+// the compiler vectorizes; a narrower T fits more values per register.
+
+// Sets bit `first_bit + i` of `bits` for every values[i] in [lo, hi].
+// Other bits are left alone.
+template <typename T>
+void MatchRange(const T* values, uint32_t count, T lo, T hi, uint64_t* bits, uint64_t first_bit) {
+    uint32_t i = 0;
+    while (i < count) {
+        const uint64_t bit = first_bit + i;
+        const uint32_t n = std::min<uint32_t>(count - i, static_cast<uint32_t>(64 - bit % 64));
+        uint64_t word = 0;
+        for (uint32_t j = 0; j < n; ++j) {
+            word |= static_cast<uint64_t>((values[i + j] >= lo) & (values[i + j] <= hi)) << j;
+        }
+        bits[bit / 64] |= word << (bit % 64);
+        i += n;
+    }
+}
+
+} // namespace db
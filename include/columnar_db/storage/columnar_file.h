@@ -0,0 +1,139 @@
+#pragma once
+
+#include "columnar_db/storage/catalog.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Zone map and location of one column chunk of a columnar file.
+ */
+struct ColumnChunkInfo {
+    uint64_t offset = 0;     // Byte offset of the chunk's first page in the file
+    uint64_t length = 0;     // Total bytes of the chunk's pages
+    uint32_t page_count = 0;
+    int64_t min_value = 0;   // Smallest and largest value in the chunk, compared by value (DOUBLEs
+    int64_t max_value = 0;   // in IEEE 754 totalOrder, so NaNs lie past the infinities)
+};
+
+/**
+ * @brief How the values of one page of a columnar file are stored.
+ */
+enum class ColumnEncoding : uint8_t {
+    PLAIN = 0,        // Raw int64 values, as in a ColumnDataPage
+    DELTA_VARINT = 1, // Zigzag varints of the difference from the previous value, as in the log
+};
+
+/*
+ * Columnar files hold an immutable copy of a table's user columns, for
+ * backup, restore and interchange. The layout follows Parquet's:
+ *
+ *   | magic (u32) | version (u32) | column chunks... | footer | footer length (u32) | footer crc32c (u32) | magic (u32) |
+ *
+ * Rows are split into row groups of ROW_GROUP_SIZE rows, and each row group
+ * holds one chunk per column. A chunk is a sequence of pages of at most
+ * COLUMNAR_PAGE_VALUES values, each with its own header and checksum:
+ *
+ *   | crc32c (u32) | value count (u32) | data length (u32) | encoding (u8) | reserved (3) | data |
+ *
+ * The checksum covers the rest of the header and the data. The footer lists
+ * the columns, then for every row group its row count and, per column, the
+ * chunk's offset, length, page count and min/max values (all varints, min
+ * and max zigzag encoded). Chunks can be placed anywhere in the file, since
+ * readers only find them through the footer; the writer stores them column
+ * by column because it reads one column chain at a time.
+ *
+ * The min/max values form a zone map for skipping row groups, but no reader
+ * consults them yet: an import reads every row group.
+ */
+
+/**
+ * @class ColumnarFileWriter
+ * @brief Writes a columnar file one column at a time, holding one page of values in memory.
+ *
+ * Values are appended column by column: BeginColumn(0), Append()..., BeginColumn(1), ...
+ * The file is written under a temporary name and only appears under its own
+ * name once Finish() has made it durable, so a failed export leaves nothing behind.
+ */
+class ColumnarFileWriter {
+public:
+    // Creates the file for `columns`. Throws std::runtime_error on failure.
+    ColumnarFileWriter(const std::string& file_name, std::vector<Column> columns);
+    ~ColumnarFileWriter();
+
+    ColumnarFileWriter(const ColumnarFileWriter&) = delete;
+    ColumnarFileWriter& operator=(const ColumnarFileWriter&) = delete;
+
+    // Starts column `col_idx`; columns must be written in order.
+    void BeginColumn(size_t col_idx);
+
+    // Appends the next `count` values of the current column.
+    void Append(const int64_t* values, size_t count);
+
+    // Writes the footer, syncs the file and moves it into place. Every column
+    // must have been given the same number of values.
+    void Finish();
+
+private:
+    // Encodes and writes the buffered page, and closes the chunk at a row group boundary.
+    void flush_page();
+    void write_all(const char* data, size_t size);
+
+    std::string file_name_;
+    std::string temp_name_;
+    int fd_ = -1;
+    bool finished_ = false;
+    uint64_t offset_ = 0;
+
+    std::vector<Column> columns_;
+    std::vector<std::vector<ColumnChunkInfo>> chunks_; // chunks_[col][row_group]
+    std::vector<uint64_t> column_rows_;
+    size_t current_column_ = 0;
+    bool column_open_ = false;
+    std::vector<int64_t> page_;    // Values of the page being filled
+    std::vector<char> encoded_;    // Scratch buffer for encoding it
+};
+
+/**
+ * @class ColumnarFileReader
+ * @brief Reads a columnar file a row group at a time, decoding its columns in parallel.
+ *
+ * The footer is read and validated on open. ReadRowGroup is const and only
+ * uses pread, so different row groups can be read concurrently.
+ */
+class ColumnarFileReader {
+public:
+    // Opens the file and reads its footer. Throws std::runtime_error if the
+    // file is not a valid columnar file.
+    explicit ColumnarFileReader(const std::string& file_name);
+    ~ColumnarFileReader();
+
+    ColumnarFileReader(const ColumnarFileReader&) = delete;
+    ColumnarFileReader& operator=(const ColumnarFileReader&) = delete;
+
+    const std::vector<Column>& GetColumns() const { return columns_; }
+    size_t GetRowGroupCount() const { return row_group_rows_.size(); }
+    uint64_t GetRowGroupRows(size_t row_group) const { return row_group_rows_[row_group]; }
+    uint64_t GetRowCount() const;
+    const ColumnChunkInfo& GetChunk(size_t row_group, size_t col_idx) const { return chunks_[row_group][col_idx]; }
+
+    // Decodes row group `row_group` into `columns[c][r]`, verifying every page's
+    // checksum. Throws std::runtime_error on corruption.
+    void ReadRowGroup(size_t row_group, std::vector<std::vector<int64_t>>* columns) const;
+
+private:
+    // Decodes one chunk of `rows` values into `out`.
+    void read_chunk(const ColumnChunkInfo& chunk, uint64_t rows, std::vector<int64_t>* out) const;
+    void read_exact(uint64_t offset, char* buffer, size_t size) const;
+
+    std::string file_name_;
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    std::vector<Column> columns_;
+    std::vector<uint64_t> row_group_rows_;
+    std::vector<std::vector<ColumnChunkInfo>> chunks_; // chunks_[row_group][col]
+};
+
+} // namespace db
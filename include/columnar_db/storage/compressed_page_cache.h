@@ -0,0 +1,68 @@
+#pragma once
+
+#include "columnar_db/common/config.h"
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace db {
+
+/**
+ * @class CompressedPageCache
+ * @brief A second cache tier holding pages evicted from the buffer pool,
+ * compressed, within a budget of its own.
+ *
+ * A page lives in the buffer pool or in this tier, never both: the pool
+ * inserts every page it evicts, clean or dirty, and takes a page back out
+ * before reading it from disk. Pages that compress to more than
+ * COMPRESSED_PAGE_MAX_SIZE are not kept. The least recently inserted pages
+ * go first once the tier is full.
+ *
+ * Hits, misses, insertions and evictions are counted in Metrics. Not
+ * thread-safe: the BufferPoolManager calls it under its latch. Compress
+ * touches no state, so the pool compresses an evicted page after releasing
+ * its latch and only inserts the result under it.
+ */
+class CompressedPageCache {
+public:
+    explicit CompressedPageCache(size_t capacity) : capacity_(capacity) {}
+
+    // Compresses the PAGE_SIZE bytes at `data` into `compressed`. Returns
+    // false if they take more than COMPRESSED_PAGE_MAX_SIZE, and are not worth keeping.
+    static bool Compress(const char* data, std::vector<char>* compressed);
+
+    // Keeps `compressed`, from Compress, as the copy of page `page_id`,
+    // replacing any it holds already.
+    void Insert(page_id_t page_id, std::vector<char> compressed);
+
+    // Decompresses page `page_id` into the PAGE_SIZE bytes at `data` and
+    // drops it from the tier. Returns false if the tier does not hold it.
+    bool Take(page_id_t page_id, char* data);
+
+    // Drops page `page_id`, e.g. once it is freed.
+    void Erase(page_id_t page_id);
+
+    size_t GetCapacity() const { return capacity_; }
+
+    // Bytes the tier holds, bookkeeping included.
+    size_t GetSize() const { return size_; }
+
+private:
+    struct Entry {
+        page_id_t page_id;
+        std::vector<char> data;
+    };
+
+    // Bytes `entry` takes in the tier.
+    static size_t entry_size(const Entry& entry) { return sizeof(Entry) + entry.data.size(); }
+
+    void erase(std::list<Entry>::iterator it);
+
+    const size_t capacity_;
+    size_t size_ = 0;
+    std::list<Entry> lru_; // Most recently inserted first
+    std::unordered_map<page_id_t, std::list<Entry>::iterator> entries_;
+};
+
+} // namespace db
@@ -1,30 +1,144 @@
 #pragma once
 
 #include "columnar_db/common/config.h"
-#include <fstream>
 #include <string>
 #include <mutex>
+#include <set>
+#include <vector>
 
 namespace db {
 
+/**
+ * @class DiskManager
+ * @brief Reads and writes pages of the database file and manages its space.
+ *
+ * The file is divided into groups of PAGES_PER_GROUP pages. The first page of
+ * each group is a space map page: a bitmap of which pages in the group are
+ * in use. Page 0 is therefore the first space map, and its header doubles
+ * as the file header.
+ *
+ * Space is handed out in extents of EXTENT_SIZE contiguous pages so that a
+ * column chain stays sequential on disk. A page allocated with a hint (the
+ * page after the chain's current tail) continues the chain's extent, or
+ * starts a wholly free one when the extent is used up. Pages allocated
+ * without a hint (catalog pages, segment heads) share an extent of their
+ * own, so they never break up a chain's run. Wholly free extents are kept
+ * in an index. The file grows an extent at a time with fallocate, and newly
+ * allocated pages read as zeros without being written.
+ *
+ * Space maps are updated in memory and written at Sync (checkpoints) and on
+ * close, not on every allocation. To stay safe across a crash, the first
+ * allocation from an extent in a session "claims" it: the map is written at
+ * once with the whole extent marked used, and stays that way on disk until
+ * the exact map is written on close. After a crash, the unused pages of the
+ * extents claimed in that session stay marked used.
+ *
+ * A DiskManager opened read-only never modifies the file and can map it
+ * into memory for zero-copy reads (see BufferPoolManager's mmap mode).
+ *
+ * Every page starts with a PAGE_HEADER_SIZE header holding a CRC32C of the
+ * rest of the page, the page's own id and the LSN it was written at.
+ * WritePage stamps it and ReadPage checks it, so a torn write, a misdirected
+ * write or bit rot is reported instead of being read as data. A page that
+ * has never been written reads as all zeros and is valid.
+ */
 class DiskManager {
 public:
-    explicit DiskManager(const std::string& db_file);
+    explicit DiskManager(const std::string& db_file, bool read_only = false);
     ~DiskManager();
 
-    // Change void to bool
+    // Reads a whole page, header included. Returns false if the page is
+    // outside the file or fails its checksum.
     bool ReadPage(page_id_t page_id, char* page_data);
-    void WritePage(page_id_t page_id, const char* page_data);
-    page_id_t AllocatePage();
+
+    // Writes a whole page, stamping its header. `lsn` is the page LSN to record;
+    // INVALID_LSN keeps the one already in `page_data`'s header.
+    void WritePage(page_id_t page_id, const char* page_data, lsn_t lsn = INVALID_LSN);
+
+    // True if `page_data` is a valid image of page `page_id`, or has never been written.
+    static bool VerifyPage(page_id_t page_id, const char* page_data);
+
+    // Allocates a page, preferring `hint` (normally the page after the
+    // caller's last one) if that keeps its chain contiguous.
+    page_id_t AllocatePage(page_id_t hint = INVALID_PAGE_ID);
+
+    // Returns a page to the free space. The caller must ensure nothing refers to it any more.
+    void DeallocatePage(page_id_t page_id);
+
+    uint32_t GetFreePageCount();
+
+    // Writes the changed space maps and forces all written pages to stable
+    // storage (used by checkpoints).
+    void Sync();
+
+    // Hints that pages [page_id, page_id + count) will be read soon.
+    void Prefetch(page_id_t page_id, page_id_t count);
+
+    // Maps the whole file read-only (once) and returns its first byte. Only
+    // valid for a read-only DiskManager, whose file never changes size.
+    const char* Map();
+
+    bool IsReadOnly() const { return read_only_; }
+    page_id_t GetPageCount() const { return next_page_id_; }
+
+    // Outcome of checking every page of the file.
+    struct ScrubResult {
+        page_id_t pages_checked = 0;
+        page_id_t unwritten_pages = 0;
+        std::vector<page_id_t> corrupted_pages;
+        lsn_t max_lsn = INVALID_LSN;
+    };
+
+    // Reads the whole file in large batches and verifies every page's checksum.
+    // Pages that are being written while the scrub runs may be reported; check them again.
+    ScrubResult Scrub();
+
+    // Pages covered by one space map page.
+    static constexpr page_id_t PAGES_PER_GROUP = (PAGE_DATA_SIZE - 16) * 8;
 
 private:
-    // Helper function to extend the file and zero out the new page.
-    void allocate_and_zero_out_page(page_id_t page_id);
+    bool is_used(page_id_t page_id) const { return (used_[page_id / 64] >> (page_id % 64)) & 1; }
+    void set_used(page_id_t page_id, bool used);
+
+    // Number of pages in use in extent `extent`.
+    int extent_used_count(page_id_t extent) const;
+
+    // The first free page of extent `extent`, or INVALID_PAGE_ID if it is full.
+    page_id_t first_free_page(page_id_t extent) const;
+
+    // Returns the first page of a wholly free extent, growing the file if there is none.
+    page_id_t find_free_extent();
+
+    // Extends the file by one extent.
+    void grow();
+
+    // Loads or writes the space map page of group `group`. Unless `exact`,
+    // the extents claimed this session are written as wholly used.
+    void load_space_maps();
+    void write_space_map(page_id_t group, bool exact);
+
+    // Records on disk that extent `extent` is in use before its first page is handed out.
+    void claim_extent(page_id_t extent);
+    bool group_has_claims(page_id_t group) const;
+
+    // Stamps the header of a copy of `page_data` and writes it.
+    void write_page(page_id_t page_id, const char* page_data, lsn_t lsn);
+
+    void read_exact(off_t offset, char* buffer, size_t size);
+    void write_exact(off_t offset, const char* buffer, size_t size);
 
     std::string file_name_;
-    std::fstream file_stream_;
-    page_id_t next_page_id_ = 0;
+    int fd_ = -1;
+    const bool read_only_;
+    char* mapping_ = nullptr;
+    page_id_t next_page_id_ = 0; // Size of the file in pages
+    std::vector<uint64_t> used_; // One bit per page of the file
+    std::set<page_id_t> free_extents_; // Extents with no page in use
+    std::vector<bool> claimed_; // Extents allocated from this session
+    std::vector<bool> dirty_groups_; // Groups whose space map differs from disk
+    page_id_t misc_extent_ = INVALID_PAGE_ID; // Extent of the pages allocated without a hint
+    uint32_t free_page_count_ = 0;
     std::mutex latch_;
 };
 
-} // namespace db
\ No newline at end of file
+} // namespace db
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "columnar_db/common/config.h"
+#include <algorithm>
 #include <shared_mutex>
 #include <cstring> // For std::memset
 
@@ -12,10 +13,12 @@ class BufferPoolManager; // Forward declaration
  * @class Page
  * @brief Represents a single page in the buffer pool.
  *
- * The Page class is a container for a fixed-size block of memory (PAGE_SIZE)
- * that is read from or written to the disk. It also holds metadata about the
- * page's state, such as its ID, pin count, and dirty flag. It is managed
- * exclusively by the BufferPoolManager.
+ * The Page class describes a fixed-size block of memory (PAGE_SIZE) that is
+ * read from or written to the disk. Its first PAGE_HEADER_SIZE bytes belong
+ * to the DiskManager, which stamps a checksum there; data() starts after them. It also holds metadata about the page's
+ * state, such as its ID, pin count, and dirty flag. It is managed exclusively
+ * by the BufferPoolManager, which points it at one of its frames (or, in
+ * read-only mmap mode, straight into the mapped file).
  */
 class Page {
     // The BufferPoolManager needs to modify the private members of Page.
@@ -23,11 +26,9 @@ class Page {
 
 public:
     /**
-     * @brief Default constructor. Initializes page memory to zeros.
+     * @brief Default constructor. The BufferPoolManager assigns the page's memory.
      */
-    Page() {
-        reset_memory();
-    }
+    Page() = default;
 
     /**
      * @brief Default destructor.
@@ -39,15 +40,29 @@ public:
     Page &operator=(const Page &) = delete;
 
     /**
-     * @return A pointer to the raw data block of the page.
+     * @return A pointer to the page's PAGE_DATA_SIZE bytes of contents.
      */
-    char* data() { return data_; }
+    char* data() { return data_ + PAGE_HEADER_SIZE; }
 
     /**
      * @return The unique identifier of this page.
      */
     page_id_t page_id() const { return page_id_; }
 
+    /**
+     * @return The LSN of the latest log record applied to this page in memory.
+     * The BufferPoolManager will not write the page back before the log is
+     * durable up to this LSN.
+     */
+    lsn_t page_lsn() const { return page_lsn_; }
+
+    /**
+     * @brief Records that the change logged at `lsn` has been applied to this page.
+     * Must be called while holding the write latch. The page LSN never moves
+     * backwards, whatever order changes are applied in.
+     */
+    void set_page_lsn(lsn_t lsn) { page_lsn_ = std::max(page_lsn_, lsn); }
+
     /**
      * @brief Acquires a read (shared) lock on the page.
      * Prevents other threads from acquiring a write lock.
@@ -78,8 +93,8 @@ private:
         std::memset(data_, 0, PAGE_SIZE);
     }
 
-    // The raw data of the page.
-    char data_[PAGE_SIZE]{};
+    // The whole page, header included: a frame of the buffer pool or part of a mapping.
+    char* data_ = nullptr;
 
     // The page's unique identifier.
     page_id_t page_id_ = INVALID_PAGE_ID;
@@ -91,6 +106,9 @@ private:
     // True if the page has been modified since being read from disk.
     bool is_dirty_ = false;
 
+    // LSN of the latest logged change to this page (INVALID_LSN if none since it was loaded).
+    lsn_t page_lsn_ = INVALID_LSN;
+
     // A read-write latch to protect the page's contents from concurrent access.
     std::shared_mutex latch_;
 };
@@ -1,39 +1,228 @@
 #pragma once
 
+#include "columnar_db/common/bloom_filter.h"
+#include "columnar_db/concurrency/transaction.h"
 #include "columnar_db/storage/buffer_pool_manager.h"
 #include "columnar_db/storage/catalog.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace db {
 
 /**
- * @struct ColumnDataPage
- * @brief Represents the memory layout of a data page for a single column.
+ * @struct ColumnPage
+ * @brief Represents the memory layout of a data page for a single column
+ * whose values are stored as T.
  *
- * This struct is memcpy'd to/from the raw data of a Page object.
+ * This struct is memcpy'd to/from the raw data of a Page object. Every
+ * instantiation has the same header, so a page's header can be read through
+ * ColumnDataPage whatever its column's type.
  */
-struct ColumnDataPage {
+template <typename T>
+struct ColumnPage {
     // Header
     page_id_t next_page_id_{INVALID_PAGE_ID};
     uint32_t value_count_{0};
+    lsn_t page_lsn_{0}; // LSN of the latest log record applied to this page
 
     // The rest of the page is data. We calculate how many values can fit.
-    static constexpr uint32_t MAX_VALUES = (PAGE_SIZE - sizeof(page_id_t) - sizeof(uint32_t)) / sizeof(int64_t);
+    static constexpr uint32_t MAX_VALUES = (PAGE_DATA_SIZE - sizeof(page_id_t) - sizeof(uint32_t) - sizeof(lsn_t)) / sizeof(T);
 
     // Data area
-    int64_t values_[MAX_VALUES];
+    T values_[MAX_VALUES];
+};
+
+// The page of a BIGINT or TIMESTAMP column, and of the MVCC columns.
+using ColumnDataPage = ColumnPage<int64_t>;
+
+static_assert(offsetof(ColumnPage<int8_t>, values_) == offsetof(ColumnDataPage, values_),
+              "Column pages of every type must share one header layout.");
+
+// Values a page of a column of `type` holds.
+inline uint32_t ColumnPageCapacity(DataType type) {
+    return VisitStorageType(type, [](auto stored) { return ColumnPage<decltype(stored)>::MAX_VALUES; });
+}
+
+// Reads slot `slot` of a page of a column of `type`, in its int64_t form.
+inline int64_t ReadColumnValue(const ColumnDataPage* page, DataType type, uint32_t slot) {
+    return VisitStorageType(type, [page, slot](auto stored) {
+        using T = decltype(stored);
+        return FromStored(reinterpret_cast<const ColumnPage<T>*>(page)->values_[slot]);
+    });
+}
+
+// Writes `value`, in its int64_t form, to slot `slot` of a page of a column of `type`.
+inline void WriteColumnValue(ColumnDataPage* page, DataType type, uint32_t slot, int64_t value) {
+    VisitStorageType(type, [page, slot, value](auto stored) {
+        using T = decltype(stored);
+        reinterpret_cast<ColumnPage<T>*>(page)->values_[slot] = ToStored<T>(value);
+    });
+}
+
+// Stamps `page` (whose contents are `data_page`) with the LSN of a change
+// applied to it. Writers of different rows of one page, such as an append
+// and a delete mark, take its latch in any order, so the LSN only ever grows.
+template <typename T>
+void StampColumnPage(Page* page, ColumnPage<T>* data_page, lsn_t lsn) {
+    data_page->page_lsn_ = std::max(data_page->page_lsn_, lsn);
+    page->set_page_lsn(lsn);
+}
+
+/**
+ * @struct TableHandle
+ * @brief The state of a table that is costly to rebuild: its row count, the
+ * last page of every column chain and a directory of the pages.
+ *
+ * Building one walks every column chain. The Catalog keeps a handle per table
+ * until the table's chains are replaced or dropped, so statements open their
+ * Table from it in constant time; every Table opened from the same handle
+ * appends through it.
+ */
+struct TableHandle {
+    // A page of a column chain and the row id of its first value.
+    struct PageRef {
+        page_id_t page_id;
+        uint64_t first_row;
+    };
+
+    TableHandle(const TableSchema* table_schema, BufferPoolManager* bpm);
+
+    const TableSchema* schema;
+
+    // Rows that every column holds. Raised only once the last column of an
+    // append is written, so a concurrent reader never sees a row half-written.
+    std::atomic<uint64_t> num_rows{0};
+
+    // Held by an appender from choosing the new rows' ids until they are applied.
+    std::mutex append_latch;
+
+    // Held by a deleter from checking that its rows are free to delete until
+    // it has marked them, so no other deleter marks one in between.
+    std::mutex delete_latch;
+
+    // The last page of each column's chain. Guarded by append_latch.
+    std::vector<page_id_t> last_page_ids;
+
+    // The pages of each column's chain when the handle was built, in row
+    // order. Pages never move or shrink until the chains are replaced, so
+    // this lets a scan jump to a row without walking the chain; pages
+    // appended since are reached from the last one listed.
+    std::vector<std::vector<PageRef>> pages;
+
+    // For a clustered table, the SortKey of the first value of each page of
+    // the sort column listed in `pages`. Binary-searched to find key ranges
+    // in the sealed segment.
+    std::vector<int64_t> first_keys;
+
+    // Bloom filters of the values of a column's sealed pages: those that
+    // appends can no longer reach (every page but the last of the chain),
+    // which never change until the chains are replaced.
+    struct PageBlooms {
+        struct Entry {
+            page_id_t page_id;
+            uint64_t first_row;
+            BloomFilter bloom;
+        };
+        std::vector<Entry> pages;  // The first sealed pages of the chain, in row order
+        page_id_t next_page_id;    // The page after them
+        uint64_t next_first_row;   // And its first row
+    };
+
+    // Per column, built by equality filters as they scan (see Table::FilterRange),
+    // or nullptr before the first. Guarded by bloom_latch.
+    std::vector<std::shared_ptr<const PageBlooms>> page_blooms;
+    std::mutex bloom_latch;
 };
 
 /**
  * @class Table
  * @brief Manages all data for a single table, providing insert and scan capabilities.
+ *
+ * Scans only return rows visible to the snapshot the table was opened with
+ * (all rows if none), and only their user columns. Deleting a row sets its
+ * __xmax in place; that column is the table's delete vector, and the row
+ * stays in the column chains until the Compactor rewrites them.
  */
 class Table {
 public:
-    Table(const TableSchema* schema, BufferPoolManager* bpm);
+    // Opens the table on a handle of its own, walking the column chains.
+    Table(const TableSchema* schema, BufferPoolManager* bpm, const Snapshot* snapshot = nullptr);
+
+    // Opens the table on a shared handle, e.g. the Catalog's, without touching any page.
+    Table(std::shared_ptr<TableHandle> handle, BufferPoolManager* bpm, const Snapshot* snapshot = nullptr);
+
+    // Serializes appends with every other Table on the same handle. Hold the lock
+    // from reading GetNumRows (the first new row's id) until the rows are appended;
+    // taking it also brings GetNumRows up to date with appends since the open.
+    std::unique_lock<std::mutex> LockAppends();
 
     // Inserts a new tuple into the table. Returns true on success.
-    bool InsertTuple(const std::vector<int64_t>& tuple);
+    // `tuple` holds every physical column, including the MVCC columns.
+    // `lsn` is the LSN of the tuple's log record; it is stamped on every page touched.
+    // All or nothing: the last page of every column is pinned before any is
+    // written, and pages added after it are waited for rather than failing.
+    bool InsertTuple(const std::vector<int64_t>& tuple, lsn_t lsn = INVALID_LSN);
+
+    // Appends a batch of rows given column-wise (`columns[c][r]`), filling a page
+    // at a time. `lsn` is the LSN of the batch's INSERT_BATCH record; each page
+    // is stamped with the LogRecord::RowLsn of the last row written to it.
+    // All or nothing, like InsertTuple.
+    bool AppendRows(const std::vector<std::vector<int64_t>>& columns, lsn_t lsn = INVALID_LSN);
+
+    // Serializes deletes with every other Table on the same handle. Hold the
+    // lock from checking rows with CanDeleteRow until they are marked.
+    std::unique_lock<std::mutex> LockDeletes();
+
+    // True unless a transaction that has not aborted deleted row `row_id`
+    // (a write-write conflict with the snapshot's transaction).
+    bool CanDeleteRow(uint64_t row_id);
+
+    // Marks row `row_id` as deleted by the snapshot's transaction. Returns false
+    // if a transaction that has not aborted deleted it first (write-write conflict).
+    bool DeleteRow(uint64_t row_id, lsn_t lsn = INVALID_LSN);
+
+    // Clears the delete mark of row `row_id`, e.g. when the deleting transaction aborts.
+    void UndeleteRow(uint64_t row_id, lsn_t lsn = INVALID_LSN);
+
+    // Marks rows [first_row, first_row + row_count), appended by the snapshot's
+    // transaction, as deleted by it when it aborts. Such a row stays invisible
+    // after a restart, when its xmin no longer reads as aborted.
+    void UndoAppend(uint64_t first_row, uint64_t row_count, lsn_t lsn = INVALID_LSN);
+
+    // Calls `fn(first_row, values, count)` for each page of column `col_idx`, in row order.
+    // Values of narrower types are widened to their int64_t form a page at a time.
+    void ForEachColumnPage(size_t col_idx,
+                           const std::function<void(uint64_t, const int64_t*, uint32_t)>& fn) const;
+
+    // Like ForEachColumnPage, but passes the page's values as stored, so a kernel
+    // instantiated for T reads them in place. T must be the column's storage type.
+    template <typename T>
+    void ForEachColumnPageAs(size_t col_idx, const std::function<void(uint64_t, const T*, uint32_t)>& fn) const {
+        for_each_page(col_idx, 0, [&fn](uint64_t first_row, const ColumnDataPage* page, uint32_t count) {
+            fn(first_row, reinterpret_cast<const ColumnPage<T>*>(page)->values_, count);
+        });
+    }
+
+    // Restricts scans to the rows whose column `col_idx` lies in [lo, hi] (both
+    // in their int64_t form; compared as doubles for a DOUBLE column). Calls
+    // add up: a row must pass every one. Rows in the sealed segment of the sort
+    // column are found by binary search; the others are matched a page at a
+    // time with a kernel for the column's type. An equality filter (lo == hi)
+    // on a column other than DOUBLE skips the pages whose Bloom filter rules
+    // the value out, building the filters of the pages it does read.
+    void FilterRange(size_t col_idx, int64_t lo, int64_t hi);
+
+    // Restricts scans to a random sample of about `fraction` of the table's
+    // pages (TABLESAMPLE SYSTEM). The rows of a page of the MVCC columns are
+    // kept or skipped together, so a scan never reads the pages it skips.
+    // The same `seed` picks the same pages. Adds up with FilterRange.
+    void SamplePages(double fraction, uint64_t seed);
 
     // Forward declaration of the iterator
     class Iterator;
@@ -42,24 +231,84 @@ public:
     Iterator end();
 
     uint64_t GetNumRows() const { return num_rows_; }
+    const TableSchema* GetSchema() const { return schema_; }
 
 private:
     friend class Iterator; // Allow iterator to access private members
 
+    // Fetches the page of column `col_idx` holding row `row_id` and write-latches it.
+    // Returns the page and sets *slot to the row's index within it.
+    Page* fetch_row_page(size_t col_idx, uint64_t row_id, uint32_t* slot);
+
+    // True if the snapshot's transaction may mark a row whose __xmax is `current`.
+    bool can_delete(txn_id_t current) const;
+
+    // Sets row `row_id`'s __xmax to `xmax` if `can_overwrite(current_xmax)` allows it.
+    bool set_xmax(uint64_t row_id, txn_id_t xmax, lsn_t lsn, const std::function<bool(txn_id_t)>& can_overwrite);
+
+    // Publishes `row_count` rows appended at the end of the table.
+    void publish_rows(uint64_t row_count);
+
+    // Pins the last page of every column, or none if one cannot be read.
+    bool pin_tails(std::vector<Page*>* tails);
+
+    // Appends `values` to column `col_idx`, stored as T, starting on its
+    // pinned last page `page`, which it unpins. See AppendRows.
+    template <typename T>
+    void append_column(size_t col_idx, Page* page, const std::vector<int64_t>& values, lsn_t lsn);
+
+    // Calls `fn(first_row, page, count)` for each page of column `col_idx`
+    // from the one holding row `start_row` on, read-latched.
+    void for_each_page(size_t col_idx, uint64_t start_row,
+                       const std::function<void(uint64_t, const ColumnDataPage*, uint32_t)>& fn) const;
+
+    // Like for_each_page, walking the chain from page `page_id` (whose first
+    // row is `first_row`) and stopping after `max_pages` pages.
+    void walk_pages(page_id_t page_id, uint64_t first_row, uint64_t start_row,
+                    const std::function<void(uint64_t, const ColumnDataPage*, uint32_t)>& fn,
+                    size_t max_pages = SIZE_MAX) const;
+
+    // Matches the rows whose column `col_idx` equals `value` into `matches`,
+    // calling `match_page` on the pages that may hold it. Pages whose Bloom
+    // filter rules it out are not read; the filters of the sealed pages read
+    // past the known ones are added to the handle.
+    void match_equal(size_t col_idx, int64_t value,
+                     const std::function<void(uint64_t, const ColumnDataPage*, uint32_t)>& match_page);
+
+    // The listed page of column `col_idx` holding row `row_id` (or the last
+    // listed page, if the row was appended after the handle was built).
+    const TableHandle::PageRef& find_page(size_t col_idx, uint64_t row_id) const;
+
+    // The first row of the sealed segment whose sort key is at least `key`
+    // (greater than `key` if `after`). Both keys are SortKeys.
+    uint64_t sorted_bound(int64_t key, bool after) const;
+
+    // Narrows the row filter to the rows set in `matches`.
+    void restrict_rows(std::vector<uint64_t> matches);
+
+    // The first row at or after `row_id` that the row filter lets through, or num_rows_.
+    uint64_t next_filtered_row(uint64_t row_id) const;
+
+    std::shared_ptr<TableHandle> handle_;
     const TableSchema* schema_;
     BufferPoolManager* bpm_;
+    const Snapshot* snapshot_;
 
-    // Total number of rows in the table.
+    // Number of rows this table scans: the handle's count when it was opened,
+    // or when appends were last locked or made through it.
     uint64_t num_rows_ = 0;
 
-    // A cache of the last page_id for each column's segment to avoid
-    // traversing the linked list on every insert.
-    std::vector<page_id_t> last_page_ids_;
+    // Rows a scan may return, one bit per row, if FilterRange was called.
+    std::vector<uint64_t> row_filter_;
 };
 
 /**
  * @class Table::Iterator
  * @brief An iterator for scanning tuples in the table.
+ *
+ * Keeps a cursor on the current page of every column, so a sequential scan
+ * touches each page once instead of re-walking the chains for every row.
+ * Visibility is decided a page at a time with ComputeVisibilityMask.
  */
 class Table::Iterator {
 public:
@@ -72,12 +321,45 @@ public:
     // Comparison operator.
     bool operator!=(const Iterator& other) const { return row_id_ != other.row_id_; }
 
+    // Position of the current row in the table; stable until the table is compacted.
+    uint64_t GetRowId() const { return row_id_; }
+
 private:
     friend class Table; // Allow Table to construct the iterator
-    Iterator(Table* table, uint64_t row_id) : table_(table), row_id_(row_id) {}
+    Iterator(Table* table, uint64_t row_id);
+
+    // The page of one column that the iterator is currently positioned on.
+    struct Cursor {
+        page_id_t page_id = INVALID_PAGE_ID;
+        page_id_t next_page_id = INVALID_PAGE_ID;
+        uint64_t first_row = 0;  // Row id of the page's first value
+        uint32_t value_count = 0;
+    };
+
+    // Moves the cursor of column `col_idx` forward to the page holding row_id_.
+    void seek(size_t col_idx) const;
+
+    // Reads column `col_idx` of the current row.
+    int64_t read(size_t col_idx) const;
+
+    // Advances row_id_ to the next row visible to the table's snapshot.
+    void skip_invisible();
+
+    // Computes the visibility mask for the MVCC pages holding row_id_, or with
+    // no snapshot, the mask of every row; either way ANDed with the row filter.
+    void load_mask();
+
+    // Computes the visibility mask alone.
+    void load_visibility_mask();
 
     Table* table_;
     uint64_t row_id_;
+    mutable std::vector<Cursor> cursors_;
+
+    // Rows [mask_first_row_, mask_end_row_) to return, one bit per row.
+    uint64_t mask_first_row_ = 0;
+    uint64_t mask_end_row_ = 0;
+    std::vector<uint64_t> mask_;
 };
 
-} // namespace db
\ No newline at end of file
+} // namespace db
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "columnar_db/concurrency/transaction.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace db {
+
+/**
+ * @brief Computes which of `n` rows are visible to `snapshot`.
+ *
+ * `xmin` and `xmax` point at the rows' MVCC column values. On return bit i of
+ * `mask` is set iff row i is visible; `mask` must hold (n + 63) / 64 words.
+ *
+ * Rows inserted before every running transaction and never deleted -- the
+ * common case -- are decided four at a time with AVX2 compares when the CPU
+ * has them. Only the remaining rows go through Snapshot::IsVisible.
+ */
+void ComputeVisibilityMask(const int64_t* xmin, const int64_t* xmax, size_t n, const Snapshot& snapshot,
+                           uint64_t* mask);
+
+} // namespace db
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "columnar_db/common/config.h"
+#include "columnar_db/wal/log_record.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace db {
+
+class LogManager;
+
+/**
+ * @class LsnFuture
+ * @brief A handle to a log record that has been appended but may not be durable yet.
+ *
+ * Appending is cheap; the caller decides when it needs durability and calls
+ * Wait() at commit time, so the work between append and commit overlaps with
+ * the flusher's fsync.
+ */
+class LsnFuture {
+public:
+    LsnFuture(LogManager* log_manager, lsn_t lsn) : log_manager_(log_manager), lsn_(lsn) {}
+
+    lsn_t lsn() const { return lsn_; }
+
+    // True once the record has been fsynced.
+    bool IsReady() const;
+
+    // Blocks until the record has been fsynced.
+    void Wait() const;
+
+private:
+    LogManager* log_manager_;
+    lsn_t lsn_;
+};
+
+/**
+ * @class LogManager
+ * @brief Appends records to the write-ahead log using group commit.
+ *
+ * Appenders reserve space in an in-memory ring buffer with a CAS on the tail,
+ * copy their record in and publish it in LSN order, all without taking a lock.
+ * A dedicated flusher thread writes everything published so far and fsyncs it
+ * as one batch once LOG_FLUSH_THRESHOLD bytes are pending or
+ * LOG_FLUSH_INTERVAL_US has elapsed. A record's LSN is the file offset just
+ * past its last byte, so "durable" simply means persistent_lsn >= lsn.
+ *
+ * The first LOG_HEADER_SIZE bytes of the file hold the LSN of the latest
+ * checkpoint, where recovery starts reading, and the next transaction id
+ * as of that checkpoint.
+ *
+ * The log before the latest checkpoint is never read again, so writing a
+ * checkpoint gives its disk space back by punching a hole in the file. LSNs
+ * are file offsets, so the file keeps its length and only its blocks are
+ * freed. A backup copying the log holds the reclaim back with RetainLog.
+ */
+class LogManager {
+public:
+    explicit LogManager(const std::string& log_file);
+    ~LogManager();
+
+    LogManager(const LogManager &) = delete;
+    LogManager &operator=(const LogManager &) = delete;
+
+    // Appends a record to the log buffer. Returns without waiting for the disk.
+    LsnFuture AppendLogRecord(const LogRecord& record);
+
+    // Blocks until every record with an LSN <= `lsn` is durable.
+    void WaitForFlush(lsn_t lsn);
+
+    // Forces everything appended so far to disk and waits for it.
+    // Returns the LSN that is now durable.
+    lsn_t Flush();
+
+    // The highest LSN known to be on disk.
+    lsn_t GetPersistentLsn() const { return persistent_lsn_.load(std::memory_order_acquire); }
+
+    // Where recovery starts reading: every change before this LSN is already in the data file.
+    lsn_t GetCheckpointLsn() const { return checkpoint_lsn_.load(std::memory_order_acquire); }
+
+    // The next transaction id recorded by the latest checkpoint.
+    txn_id_t GetCheckpointTxnId() const { return checkpoint_txn_id_.load(std::memory_order_acquire); }
+
+    // Durably records that all changes up to `lsn` have been written to the
+    // data file, and that no transaction id at or above `next_txn_id` is in use.
+    void WriteCheckpoint(lsn_t lsn, txn_id_t next_txn_id);
+
+    // Keeps the log from the latest checkpoint on until ReleaseLog, however
+    // many checkpoints are written meanwhile. Returns that checkpoint's LSN.
+    lsn_t RetainLog();
+    void ReleaseLog();
+
+    // Calls `fn(lsn, record)` for every complete record starting at `from`, in LSN order.
+    // Returns the LSN just past the last complete record.
+    lsn_t ScanLog(lsn_t from, const std::function<void(lsn_t, const LogRecord&)>& fn);
+
+    static constexpr size_t LOG_HEADER_SIZE = 512;
+
+private:
+    // Creates the log header in a new file, or reads it from an existing one.
+    void init_header();
+    // Body of the background flusher thread.
+    void flush_loop();
+
+    // Copies `len` bytes to the ring buffer starting at logical offset `pos`, handling wrap-around.
+    void copy_to_ring(uint64_t pos, const char* src, size_t len);
+
+    // Writes the ring buffer range [begin, end) to the log file and fsyncs it.
+    void write_and_sync(uint64_t begin, uint64_t end);
+
+    // Frees the disk space of the log before `lsn`, or before the retained
+    // LSN if that is lower. The caller must hold reclaim_latch_.
+    void reclaim(lsn_t lsn);
+
+    std::string file_name_;
+    int fd_ = -1;
+
+    // File offset that logical ring position 0 corresponds to.
+    lsn_t base_offset_ = 0;
+
+    std::unique_ptr<char[]> buffer_;
+
+    // Logical (ever-increasing) positions into the ring buffer:
+    //   flushed_ <= committed_ <= reserved_ <= flushed_ + LOG_BUFFER_SIZE
+    std::atomic<uint64_t> reserved_{0};   // Space handed out to appenders.
+    std::atomic<uint64_t> committed_{0};  // Records fully copied in and visible to the flusher.
+    std::atomic<uint64_t> flushed_{0};    // Records written to the file; space before this is reusable.
+    std::atomic<lsn_t> persistent_lsn_{0};
+    std::atomic<lsn_t> checkpoint_lsn_{0};
+    std::atomic<txn_id_t> checkpoint_txn_id_{1};
+    std::atomic<bool> io_error_{false};
+
+    std::mutex reclaim_latch_;
+    lsn_t reclaimed_lsn_ = LOG_HEADER_SIZE; // Space before this has been freed
+    lsn_t retained_lsn_ = INVALID_LSN;      // Held by RetainLog
+
+    // Wakes the flusher early (size threshold reached, explicit Flush, shutdown).
+    std::mutex flush_mutex_;
+    std::condition_variable flush_cv_;
+    std::atomic<bool> flush_requested_{false};
+    bool stop_ = false;
+
+    // Wakes committers waiting for their LSN to become durable.
+    std::mutex durable_mutex_;
+    std::condition_variable durable_cv_;
+
+    std::thread flush_thread_;
+};
+
+} // namespace db
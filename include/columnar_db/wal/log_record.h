@@ -0,0 +1,103 @@
+#pragma once
+
+#include "columnar_db/common/config.h"
+#include <cstdint>
+#include <vector>
+
+namespace db {
+
+enum class LogRecordType : uint8_t {
+    INVALID = 0,
+    INSERT_TUPLE, // One row
+    INSERT_BATCH, // N rows of the same table, stored column by column
+    DELETE_ROWS,  // Sets the __xmax of N rows to the same value
+    COMMIT,       // A transaction's changes are complete
+    ABORT,        // A transaction's changes have been undone
+};
+
+/**
+ * @class LogRecord
+ * @brief A single logical change written to the write-ahead log.
+ *
+ * Rows are kept column-wise so a batch of N rows is N values per column
+ * rather than N tuples. Inserts carry the row id of their first row so that
+ * redo can tell whether a row is already in a column without relying on
+ * page LSNs. On disk a record is laid out as:
+ *
+ *   | length (varint) | crc32c (u32) | type (u8) | table_id (varint) | body |
+ *
+ * INSERT_TUPLE body: | first_row_id | column_count | columns... |
+ * INSERT_BATCH body: | first_row_id | row_count | column_count | columns... |
+ * DELETE_ROWS body:  | xmax (zigzag) | row_count | row ids... |
+ * COMMIT / ABORT body: | txn_id (zigzag) |  (table_id is 0)
+ *
+ * A transaction that changed rows logs COMMIT after its last change and is
+ * durable once that record is. Recovery rolls back the changes of any
+ * transaction whose COMMIT is not in the log.
+ *
+ * All fields after the type are varints. `length` counts the bytes after
+ * itself and the checksum covers everything after the checksum. Column values
+ * and row ids are zigzag varints of the difference from the previous row's
+ * value, so sequential ids and small values take a byte or two instead of eight.
+ */
+class LogRecord {
+public:
+    LogRecord() = default;
+
+    // An INSERT_TUPLE record for a single row that becomes row `row_id`.
+    LogRecord(LogRecordType type, uint32_t table_id, uint64_t row_id, const std::vector<int64_t>& tuple);
+
+    // An INSERT_BATCH record; `columns[c][r]` is the value of column c in row first_row_id + r.
+    LogRecord(LogRecordType type, uint32_t table_id, uint64_t first_row_id, std::vector<std::vector<int64_t>> columns);
+
+    // A DELETE_ROWS record setting __xmax of each row in `row_ids` to `xmax`.
+    // An xmax of INVALID_TXN_ID undoes an earlier delete.
+    LogRecord(LogRecordType type, uint32_t table_id, txn_id_t xmax, std::vector<uint64_t> row_ids);
+
+    // A COMMIT or ABORT record for transaction `txn_id`.
+    LogRecord(LogRecordType type, txn_id_t txn_id);
+
+    LogRecordType GetType() const { return type_; }
+    uint32_t GetTableId() const { return table_id_; }
+    uint64_t GetFirstRowId() const { return first_row_id_; }
+    uint32_t GetRowCount() const;
+    const std::vector<std::vector<int64_t>>& GetColumns() const { return columns_; }
+    txn_id_t GetXmax() const { return xmax_; }
+    txn_id_t GetTxnId() const { return xmax_; }
+    const std::vector<uint64_t>& GetRowIds() const { return row_ids_; }
+
+    // The row as a tuple. Only meaningful for INSERT_TUPLE records.
+    std::vector<int64_t> GetTuple() const;
+
+    // Appends the encoded record to `out`.
+    void SerializeTo(std::vector<char>* out) const;
+
+    // Parses one record from `buf`. Returns false if `len` bytes do not hold a
+    // complete record with a valid checksum (e.g. a torn write at the end of the log).
+    static bool DeserializeFrom(const char* buf, size_t len, LogRecord* record, uint32_t* consumed);
+
+    /**
+     * @brief The LSN that row `row` of a record ending at `record_lsn` is stamped with.
+     *
+     * Rows of a batch get distinct, increasing LSNs inside the record's byte
+     * range (every row takes at least one byte), so the page LSN always
+     * names the exact row a page was last written for.
+     */
+    static lsn_t RowLsn(lsn_t record_lsn, uint32_t row, uint32_t row_count) {
+        return record_lsn - static_cast<lsn_t>(row_count - 1 - row);
+    }
+
+private:
+    LogRecordType type_ = LogRecordType::INVALID;
+    uint32_t table_id_ = 0;
+
+    // Inserts
+    uint64_t first_row_id_ = 0;
+    std::vector<std::vector<int64_t>> columns_;
+
+    // Deletes; the transaction of a COMMIT or ABORT
+    txn_id_t xmax_ = INVALID_TXN_ID;
+    std::vector<uint64_t> row_ids_;
+};
+
+} // namespace db
@@ -0,0 +1,82 @@
+#include "columnar_db/common/bloom_filter.h"
+#include "columnar_db/common/config.h"
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PESDB_HAVE_AVX2_KERNELS 1
+#endif
+
+namespace db {
+
+namespace {
+
+// One odd multiplier per word of a block; each maps the value's 32-bit key
+// to the bit it sets in that word.
+constexpr uint32_t SALTS[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                               0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+// splitmix64's finalizer, as in the HyperLogLog sketch.
+uint64_t hash_value(int64_t value) {
+    uint64_t h = static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+bool contains_scalar(const uint32_t* words, uint32_t key) {
+    for (int i = 0; i < 8; ++i) {
+        if ((words[i] & (uint32_t{1} << ((key * SALTS[i]) >> 27))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef PESDB_HAVE_AVX2_KERNELS
+__attribute__((target("avx2")))
+bool contains_avx2(const uint32_t* words, uint32_t key) {
+    const __m256i salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(SALTS));
+    const __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(key)), salts), 27);
+    const __m256i bits = _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+    // Set iff every bit of `bits` is also set in the block.
+    return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(words)), bits) != 0;
+}
+
+const bool HAS_AVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+} // namespace
+
+BloomFilter::BloomFilter(size_t expected_values)
+    : blocks_(std::max<size_t>(1, (expected_values * BLOOM_BITS_PER_VALUE + 255) / 256), Block{}) {}
+
+size_t BloomFilter::block_index(uint64_t hash) const {
+    // The high half of the hash picks the block, without a division.
+    return static_cast<size_t>(((hash >> 32) * blocks_.size()) >> 32);
+}
+
+void BloomFilter::Add(int64_t value) {
+    const uint64_t hash = hash_value(value);
+    Block& block = blocks_[block_index(hash)];
+    const auto key = static_cast<uint32_t>(hash);
+    for (int i = 0; i < 8; ++i) {
+        block.words[i] |= uint32_t{1} << ((key * SALTS[i]) >> 27);
+    }
+}
+
+bool BloomFilter::MayContain(int64_t value) const {
+    if (blocks_.empty()) {
+        return true;
+    }
+    const uint64_t hash = hash_value(value);
+    const uint32_t* words = blocks_[block_index(hash)].words;
+#ifdef PESDB_HAVE_AVX2_KERNELS
+    if (HAS_AVX2) {
+        return contains_avx2(words, static_cast<uint32_t>(hash));
+    }
+#endif
+    return contains_scalar(words, static_cast<uint32_t>(hash));
+}
+
+} // namespace db
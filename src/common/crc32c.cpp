@@ -0,0 +1,71 @@
+#include "columnar_db/common/crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define PESDB_HAVE_SSE42_CRC 1
+#endif
+
+namespace db {
+
+namespace {
+
+constexpr uint32_t CRC32C_POLY = 0x82F63B78; // Reflected Castagnoli polynomial
+
+constexpr std::array<uint32_t, 256> make_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> CRC_TABLE = make_table();
+
+uint32_t crc32c_sw(const uint8_t* p, size_t len, uint32_t crc) {
+    while (len--) {
+        crc = CRC_TABLE[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef PESDB_HAVE_SSE42_CRC
+__attribute__((target("sse4.2")))
+uint32_t crc32c_hw(const uint8_t* p, size_t len, uint32_t crc) {
+    uint64_t crc64 = crc;
+    while (len >= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += sizeof(word);
+        len -= sizeof(word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+const bool HAS_SSE42 = __builtin_cpu_supports("sse4.2");
+#endif
+
+} // namespace
+
+uint32_t Crc32c(const void* data, size_t len, uint32_t crc) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#ifdef PESDB_HAVE_SSE42_CRC
+    if (HAS_SSE42) {
+        return ~crc32c_hw(p, len, crc);
+    }
+#endif
+    return ~crc32c_sw(p, len, crc);
+}
+
+} // namespace db
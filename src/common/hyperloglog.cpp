@@ -0,0 +1,57 @@
+#include "columnar_db/common/hyperloglog.h"
+#include "columnar_db/common/config.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace db {
+
+namespace {
+
+constexpr size_t REGISTER_COUNT = size_t{1} << HLL_PRECISION;
+
+// splitmix64: neighbouring values get unrelated hashes, spread over all 64 bits.
+uint64_t hash_value(int64_t value) {
+    uint64_t h = static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+} // namespace
+
+HyperLogLog::HyperLogLog() : registers_(REGISTER_COUNT, 0) {}
+
+void HyperLogLog::Add(int64_t value) {
+    const uint64_t h = hash_value(value);
+    const size_t index = h >> (64 - HLL_PRECISION);
+    // The bit below the remaining ones bounds the run when they are all zero.
+    const uint64_t rest = (h << HLL_PRECISION) | (uint64_t{1} << (HLL_PRECISION - 1));
+    const auto rank = static_cast<uint8_t>(std::countl_zero(rest) + 1);
+    registers_[index] = std::max(registers_[index], rank);
+}
+
+void HyperLogLog::Merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+
+uint64_t HyperLogLog::Estimate() const {
+    const auto m = static_cast<double>(REGISTER_COUNT);
+    double sum = 0;
+    size_t empty = 0;
+    for (uint8_t rank : registers_) {
+        sum += std::ldexp(1.0, -rank);
+        empty += rank == 0 ? 1 : 0;
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double estimate = alpha * m * m / sum;
+    // Few values leave many registers empty; counting those is more accurate then.
+    if (estimate <= 2.5 * m && empty > 0) {
+        return static_cast<uint64_t>(std::llround(m * std::log(m / static_cast<double>(empty))));
+    }
+    return static_cast<uint64_t>(std::llround(estimate));
+}
+
+} // namespace db
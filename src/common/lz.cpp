@@ -0,0 +1,130 @@
+#include "columnar_db/common/lz.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace db {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr int HASH_BITS = 12;
+
+uint32_t load32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hash4(const char* p) {
+    return (load32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void put_length(std::vector<char>* out, size_t length) {
+    while (length >= 255) {
+        out->push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out->push_back(static_cast<char>(length));
+}
+
+bool get_length(const unsigned char** p, const unsigned char* end, size_t* length) {
+    unsigned char byte;
+    do {
+        if (*p == end) {
+            return false;
+        }
+        byte = *(*p)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+void put_sequence(std::vector<char>* out, const char* literals, size_t literal_count, size_t match_length,
+                  size_t offset) {
+    const size_t match_code = match_length >= MIN_MATCH ? match_length - MIN_MATCH : 0;
+    out->push_back(static_cast<char>((std::min<size_t>(literal_count, 15) << 4) | std::min<size_t>(match_code, 15)));
+    if (literal_count >= 15) {
+        put_length(out, literal_count - 15);
+    }
+    out->insert(out->end(), literals, literals + literal_count);
+    if (match_length == 0) {
+        return; // The last sequence
+    }
+    out->push_back(static_cast<char>(offset & 0xFF));
+    out->push_back(static_cast<char>(offset >> 8));
+    if (match_code >= 15) {
+        put_length(out, match_code - 15);
+    }
+}
+
+} // namespace
+
+void LzCompress(const char* src, size_t size, std::vector<char>* out) {
+    out->clear();
+    // Positions + 1 of the last 4-byte string with each hash; 0 means none.
+    uint16_t table[1 << HASH_BITS] = {};
+    size_t anchor = 0; // Start of the literals not yet written
+    size_t pos = 0;
+    while (pos + MIN_MATCH <= size) {
+        const uint32_t h = hash4(src + pos);
+        const size_t candidate = table[h];
+        table[h] = static_cast<uint16_t>(pos + 1);
+        if (candidate == 0 || load32(src + candidate - 1) != load32(src + pos)) {
+            ++pos;
+            continue;
+        }
+        const size_t match = candidate - 1;
+        size_t length = MIN_MATCH;
+        while (pos + length < size && src[match + length] == src[pos + length]) {
+            ++length;
+        }
+        put_sequence(out, src + anchor, pos - anchor, length, pos - match);
+        pos += length;
+        anchor = pos;
+    }
+    put_sequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+bool LzDecompress(const char* src, size_t size, char* dst, size_t dst_size) {
+    const auto* p = reinterpret_cast<const unsigned char*>(src);
+    const auto* end = p + size;
+    size_t written = 0;
+    while (p < end) {
+        const unsigned char token = *p++;
+        size_t literal_count = token >> 4;
+        if (literal_count == 15 && !get_length(&p, end, &literal_count)) {
+            return false;
+        }
+        if (literal_count > static_cast<size_t>(end - p) || literal_count > dst_size - written) {
+            return false;
+        }
+        std::memcpy(dst + written, p, literal_count);
+        p += literal_count;
+        written += literal_count;
+        if (p == end) {
+            break; // The last sequence
+        }
+
+        if (end - p < 2) {
+            return false;
+        }
+        const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+        p += 2;
+        size_t length = (token & 0x0F);
+        if (length == 15 && !get_length(&p, end, &length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if (offset == 0 || offset > written || length > dst_size - written) {
+            return false;
+        }
+        // Byte by byte: a match may overlap the bytes it produces (a run).
+        for (size_t i = 0; i < length; ++i, ++written) {
+            dst[written] = dst[written - offset];
+        }
+    }
+    return written == dst_size;
+}
+
+} // namespace db
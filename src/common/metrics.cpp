@@ -0,0 +1,222 @@
+#include "columnar_db/common/metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace db {
+
+namespace {
+
+constexpr const char* COUNTER_NAMES[COUNTER_COUNT] = {
+    "buffer_pool_hits",
+    "buffer_pool_misses",
+    "buffer_pool_evictions",
+    "buffer_pool_writebacks",
+    "buffer_pool_pin_wait_ns",
+    "bloom_pages_skipped",
+    "compactions",
+    "compaction_dead_rows",
+    "compaction_merges",
+    "compaction_view_folds",
+    "compressed_cache_hits",
+    "compressed_cache_misses",
+    "compressed_cache_inserts",
+    "compressed_cache_insert_bytes",
+    "compressed_cache_evictions",
+    "disk_reads",
+    "disk_read_bytes",
+    "disk_writes",
+    "disk_write_bytes",
+    "disk_syncs",
+    "log_records",
+    "log_bytes",
+    "log_flushes",
+    "log_bytes_reclaimed",
+    "query_admission_waits",
+    "query_spill_bytes",
+    "result_cache_hits",
+    "result_cache_misses",
+    "result_cache_evictions",
+};
+
+constexpr const char* HISTOGRAM_NAMES[HISTOGRAM_COUNT] = {
+    "disk_read_latency_us",
+    "disk_write_latency_us",
+    "disk_sync_latency_us",
+    "log_flush_latency_us",
+};
+
+// One thread's counters. Only the owning thread writes them; collectors read
+// them concurrently, hence the atomics.
+struct ThreadBlock {
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+    std::array<std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS>, HISTOGRAM_COUNT> histograms{};
+
+    ThreadBlock();
+    ~ThreadBlock();
+
+    void AddTo(MetricsSnapshot* snapshot) const {
+        for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+            snapshot->counters[i] += counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t h = 0; h < HISTOGRAM_COUNT; ++h) {
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                snapshot->histograms[h][b] += histograms[h][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// The blocks of the running threads, and the totals of the ones that exited.
+struct Registry {
+    std::mutex latch;
+    std::vector<const ThreadBlock*> blocks;
+    MetricsSnapshot retired;
+};
+
+// Never destroyed: threads may still exit while static destructors run.
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+ThreadBlock::ThreadBlock() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.latch);
+    r.blocks.push_back(this);
+}
+
+ThreadBlock::~ThreadBlock() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.latch);
+    AddTo(&r.retired);
+    r.blocks.erase(std::find(r.blocks.begin(), r.blocks.end(), this));
+}
+
+ThreadBlock& thread_block() {
+    thread_local ThreadBlock block;
+    return block;
+}
+
+// A single writer needs no read-modify-write instruction.
+inline void bump(std::atomic<uint64_t>& slot, uint64_t value) {
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+void Metrics::Add(Counter counter, uint64_t value) {
+    bump(thread_block().counters[static_cast<size_t>(counter)], value);
+}
+
+void Metrics::Record(Histogram histogram, uint64_t micros) {
+    size_t bucket = std::min<size_t>(std::bit_width(micros), HISTOGRAM_BUCKETS - 1);
+    bump(thread_block().histograms[static_cast<size_t>(histogram)][bucket], 1);
+}
+
+MetricsSnapshot Metrics::Collect() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.latch);
+    MetricsSnapshot snapshot = r.retired;
+    for (const ThreadBlock* block : r.blocks) {
+        block->AddTo(&snapshot);
+    }
+    return snapshot;
+}
+
+MetricsSnapshot Metrics::CollectThread() {
+    MetricsSnapshot snapshot;
+    thread_block().AddTo(&snapshot);
+    return snapshot;
+}
+
+const char* Metrics::Name(Counter counter) {
+    return COUNTER_NAMES[static_cast<size_t>(counter)];
+}
+
+const char* Metrics::Name(Histogram histogram) {
+    return HISTOGRAM_NAMES[static_cast<size_t>(histogram)];
+}
+
+uint64_t MetricsSnapshot::Count(Histogram histogram) const {
+    uint64_t count = 0;
+    for (uint64_t n : histograms[static_cast<size_t>(histogram)]) {
+        count += n;
+    }
+    return count;
+}
+
+uint64_t MetricsSnapshot::Percentile(Histogram histogram, double p) const {
+    const auto& buckets = histograms[static_cast<size_t>(histogram)];
+    uint64_t total = Count(histogram);
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(total) + 0.5));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return uint64_t{1} << b;
+        }
+    }
+    return uint64_t{1} << (HISTOGRAM_BUCKETS - 1);
+}
+
+MetricsSnapshot MetricsSnapshot::operator-(const MetricsSnapshot& earlier) const {
+    MetricsSnapshot delta;
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        delta.counters[i] = counters[i] - earlier.counters[i];
+    }
+    for (size_t h = 0; h < HISTOGRAM_COUNT; ++h) {
+        for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+            delta.histograms[h][b] = histograms[h][b] - earlier.histograms[h][b];
+        }
+    }
+    return delta;
+}
+
+std::string MetricsSnapshot::ToText() const {
+    std::ostringstream out;
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        out << COUNTER_NAMES[i] << ": " << counters[i] << "\n";
+    }
+    uint64_t lookups = Get(Counter::BUFFER_POOL_HITS) + Get(Counter::BUFFER_POOL_MISSES);
+    if (lookups > 0) {
+        out << "buffer_pool_hit_ratio: " << static_cast<double>(Get(Counter::BUFFER_POOL_HITS)) / lookups << "\n";
+    }
+    for (size_t h = 0; h < HISTOGRAM_COUNT; ++h) {
+        auto histogram = static_cast<Histogram>(h);
+        out << HISTOGRAM_NAMES[h] << ": count " << Count(histogram) << ", p50 < " << Percentile(histogram, 0.5)
+            << ", p99 < " << Percentile(histogram, 0.99) << ", max < " << Percentile(histogram, 1.0) << "\n";
+    }
+    return out.str();
+}
+
+std::string MetricsSnapshot::ToJson() const {
+    std::ostringstream out;
+    out << "{\"counters\": {";
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        out << (i > 0 ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << counters[i];
+    }
+    // Buckets are listed by their upper bound and only when non-empty.
+    out << "}, \"histograms\": {";
+    for (size_t h = 0; h < HISTOGRAM_COUNT; ++h) {
+        out << (h > 0 ? ", " : "") << "\"" << HISTOGRAM_NAMES[h] << "\": {";
+        bool first = true;
+        for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+            if (histograms[h][b] != 0) {
+                out << (first ? "" : ", ") << "\"" << (uint64_t{1} << b) << "\": " << histograms[h][b];
+                first = false;
+            }
+        }
+        out << "}";
+    }
+    out << "}}";
+    return out.str();
+}
+
+} // namespace db
@@ -0,0 +1,130 @@
+#include "columnar_db/common/numa.h"
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace db {
+
+namespace {
+
+constexpr int MAX_NODES = 64; // Nodes a node mask passed to mbind can name
+
+// Parses a sysfs list of CPUs or nodes such as "0-3,8-11".
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    std::istringstream ranges(text);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+
+const NumaTopology& NumaTopology::Get() {
+    static const NumaTopology topology;
+    return topology;
+}
+
+NumaTopology::NumaTopology() {
+    // Node ids can have gaps, so take the online ones from their list rather
+    // than probing node0, node1, ... until one is missing.
+    try {
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string text;
+        if (online && std::getline(online, text)) {
+            for (int node : parse_cpu_list(text)) {
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                if (node >= MAX_NODES || !file || !std::getline(file, text)) {
+                    continue; // Beyond what mbind can name, or gone meanwhile
+                }
+                node_ids_.push_back(node);
+                node_cpus_.push_back(parse_cpu_list(text));
+            }
+        }
+    } catch (const std::exception&) {
+        node_ids_.clear();
+        node_cpus_.clear();
+    }
+    if (node_cpus_.empty()) {
+        node_ids_.push_back(0);
+        node_cpus_.emplace_back(); // One node, no CPU list: pinning does nothing
+    }
+    for (size_t node = 0; node < node_cpus_.size(); ++node) {
+        for (int cpu : node_cpus_[node]) {
+            if (static_cast<size_t>(cpu) >= cpu_nodes_.size()) {
+                cpu_nodes_.resize(cpu + 1, 0);
+            }
+            cpu_nodes_[cpu] = static_cast<int>(node);
+        }
+    }
+}
+
+int NumaTopology::CurrentNode() const {
+#if defined(__linux__)
+    const int cpu = sched_getcpu();
+    if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_nodes_.size()) {
+        return cpu_nodes_[cpu];
+    }
+#endif
+    return 0;
+}
+
+bool NumaTopology::PinThread(int node) const {
+#if defined(__linux__)
+    if (node < 0 || static_cast<size_t>(node) >= node_cpus_.size() || node_cpus_[node].empty()) {
+        return false;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : node_cpus_[node]) {
+        CPU_SET(cpu, &cpus);
+    }
+    return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+void* NumaTopology::AllocateOnNode(size_t size, int node) const {
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+#if defined(__linux__) && defined(SYS_mbind)
+    if (node_cpus_.size() > 1) {
+        // MPOL_PREFERRED: place the pages on `node`, or elsewhere if it runs out.
+        // Without a NUMA kernel this fails, and first touch decides as usual.
+        constexpr int MPOL_PREFERRED_MODE = 1;
+        unsigned long mask = 1UL << node_ids_[node];
+        syscall(SYS_mbind, memory, size, MPOL_PREFERRED_MODE, &mask, MAX_NODES + 1, 0);
+    }
+#else
+    (void)node;
+#endif
+    return memory;
+}
+
+void NumaTopology::Free(void* memory, size_t size) {
+    munmap(memory, size);
+}
+
+} // namespace db
@@ -0,0 +1,171 @@
+#include "columnar_db/common/types.h"
+#include <charconv>
+#include <cstdio>
+#include <limits>
+
+namespace db {
+
+namespace {
+
+constexpr int64_t MICROS_PER_DAY = 86400LL * 1000000;
+constexpr long long MAX_PARSED_YEAR = 1LL << 40; // Past every type's range; days_from_civil cannot overflow below it
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar.
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const auto yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// The inverse of days_from_civil.
+void civil_from_days(int64_t z, int64_t* y, unsigned* m, unsigned* d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const auto doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = static_cast<int64_t>(yoe) + era * 400 + (*m <= 2);
+}
+
+bool is_leap(int64_t y) {
+    return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+unsigned days_in_month(int64_t y, unsigned m) {
+    static const unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return m == 2 && is_leap(y) ? 29 : days[m - 1];
+}
+
+template <typename T>
+bool fits(int64_t value) {
+    return value >= std::numeric_limits<T>::min() && value <= std::numeric_limits<T>::max();
+}
+
+} // namespace
+
+size_t TypeSize(DataType type) {
+    return VisitStorageType(type, [](auto stored) { return sizeof(stored); });
+}
+
+const char* TypeName(DataType type) {
+    switch (type) {
+        case DataType::BIGINT: return "BIGINT";
+        case DataType::INT32: return "INT32";
+        case DataType::INT16: return "INT16";
+        case DataType::INT8: return "INT8";
+        case DataType::DOUBLE: return "DOUBLE";
+        case DataType::DATE: return "DATE";
+        case DataType::TIMESTAMP: return "TIMESTAMP";
+        default: return "INVALID";
+    }
+}
+
+bool FitsType(DataType type, int64_t value) {
+    switch (type) {
+        case DataType::INT8: return fits<int8_t>(value);
+        case DataType::INT16: return fits<int16_t>(value);
+        case DataType::INT32:
+        case DataType::DATE: return fits<int32_t>(value);
+        default: return true;
+    }
+}
+
+std::string FormatValue(DataType type, int64_t value) {
+    char buffer[64];
+    if (type == DataType::DOUBLE) {
+        // The shortest text that reads back as the same double.
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), std::bit_cast<double>(value));
+        return std::string(buffer, result.ptr);
+    }
+    if (type != DataType::DATE && type != DataType::TIMESTAMP) {
+        return std::to_string(value);
+    }
+
+    int64_t days = value;
+    int64_t micros = 0;
+    if (type == DataType::TIMESTAMP) {
+        days = value / MICROS_PER_DAY;
+        micros = value % MICROS_PER_DAY;
+        if (micros < 0) {
+            days -= 1;
+            micros += MICROS_PER_DAY;
+        }
+    }
+    int64_t y;
+    unsigned m;
+    unsigned d;
+    civil_from_days(days, &y, &m, &d);
+    int n = std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u", static_cast<long long>(y), m, d);
+    if (type == DataType::TIMESTAMP) {
+        const int64_t seconds = micros / 1000000;
+        n += std::snprintf(buffer + n, sizeof(buffer) - n, " %02d:%02d:%02d", static_cast<int>(seconds / 3600),
+                           static_cast<int>(seconds / 60 % 60), static_cast<int>(seconds % 60));
+        if (micros % 1000000 != 0) {
+            std::snprintf(buffer + n, sizeof(buffer) - n, ".%06d", static_cast<int>(micros % 1000000));
+        }
+    }
+    return buffer;
+}
+
+bool ParseDateTime(DataType type, const std::string& text, int64_t* value) {
+    if (type != DataType::DATE && type != DataType::TIMESTAMP) {
+        return false;
+    }
+    long long y;
+    unsigned m;
+    unsigned d;
+    int consumed = 0;
+    if (std::sscanf(text.c_str(), "%lld-%u-%u%n", &y, &m, &d, &consumed) != 3 || y < -MAX_PARSED_YEAR ||
+        y > MAX_PARSED_YEAR || m < 1 || m > 12 || d < 1 || d > days_in_month(y, m)) {
+        return false;
+    }
+    const int64_t days = days_from_civil(y, m, d);
+    if (type == DataType::DATE) {
+        *value = days;
+        return static_cast<size_t>(consumed) == text.size() && FitsType(DataType::DATE, days);
+    }
+    // The whole day must fit, so that adding the time of day cannot overflow either.
+    if (days < std::numeric_limits<int64_t>::min() / MICROS_PER_DAY ||
+        days >= std::numeric_limits<int64_t>::max() / MICROS_PER_DAY) {
+        return false;
+    }
+
+    unsigned hh = 0;
+    unsigned mm = 0;
+    unsigned ss = 0;
+    int64_t fraction = 0;
+    size_t pos = consumed;
+    if (pos < text.size()) {
+        int time_consumed = 0;
+        if ((text[pos] != ' ' && text[pos] != 'T') ||
+            std::sscanf(text.c_str() + pos + 1, "%u:%u:%u%n", &hh, &mm, &ss, &time_consumed) != 3 || hh > 23 ||
+            mm > 59 || ss > 59) {
+            return false;
+        }
+        pos += 1 + time_consumed;
+        if (pos < text.size() && text[pos] == '.') {
+            int digits = 0;
+            for (++pos; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos, ++digits) {
+                if (digits < 6) {
+                    fraction = fraction * 10 + (text[pos] - '0');
+                }
+            }
+            for (; digits < 6; ++digits) {
+                fraction *= 10;
+            }
+        }
+        if (pos != text.size()) {
+            return false;
+        }
+    }
+    *value = days * MICROS_PER_DAY + (hh * 3600LL + mm * 60LL + ss) * 1000000 + fraction;
+    return true;
+}
+
+} // namespace db
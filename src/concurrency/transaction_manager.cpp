@@ -0,0 +1,68 @@
+#include "columnar_db/concurrency/transaction_manager.h"
+#include <stdexcept>
+
+namespace db {
+
+TransactionManager::TransactionManager(txn_id_t next_txn_id)
+    : next_txn_id_(std::max<txn_id_t>(next_txn_id, 1)),
+      aborted_(std::make_shared<const std::unordered_set<txn_id_t>>()) {}
+
+std::unique_ptr<Transaction> TransactionManager::Begin() {
+    std::lock_guard<std::mutex> lock(latch_);
+
+    Snapshot snapshot;
+    snapshot.txn_id = next_txn_id_++;
+    snapshot.xmax = snapshot.txn_id;
+    snapshot.xmin = active_.empty() ? snapshot.xmax : *active_.begin();
+    snapshot.active.assign(active_.begin(), active_.end());
+    snapshot.aborted = aborted_;
+
+    active_.insert(snapshot.txn_id);
+    return std::make_unique<Transaction>(std::move(snapshot));
+}
+
+void TransactionManager::Commit(Transaction* txn) {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (txn->state_ != TransactionState::RUNNING) {
+        throw std::logic_error("Cannot commit a transaction that is not running.");
+    }
+    active_.erase(txn->GetId());
+    txn->state_ = TransactionState::COMMITTED;
+}
+
+void TransactionManager::Abort(Transaction* txn, bool changes_undone) {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (txn->state_ != TransactionState::RUNNING) {
+        throw std::logic_error("Cannot abort a transaction that is not running.");
+    }
+    // Snapshots taken until now see the id as active, and later ones find
+    // nothing of it left, so an undone transaction need not be remembered.
+    if (!changes_undone) {
+        auto aborted = std::make_shared<std::unordered_set<txn_id_t>>(*aborted_);
+        aborted->insert(txn->GetId());
+        aborted_ = std::move(aborted);
+    }
+    active_.erase(txn->GetId());
+    txn->state_ = TransactionState::ABORTED;
+}
+
+std::shared_ptr<const std::unordered_set<txn_id_t>> TransactionManager::GetAborted() {
+    std::lock_guard<std::mutex> lock(latch_);
+    return aborted_;
+}
+
+void TransactionManager::ForgetAborted(const std::unordered_set<txn_id_t>& ids) {
+    std::lock_guard<std::mutex> lock(latch_);
+    auto aborted = std::make_shared<std::unordered_set<txn_id_t>>(*aborted_);
+    for (txn_id_t id : ids) {
+        aborted->erase(id);
+    }
+    aborted_ = std::move(aborted);
+}
+
+txn_id_t TransactionManager::GetNextTxnId() {
+    std::lock_guard<std::mutex> lock(latch_);
+    return next_txn_id_;
+}
+
+} // namespace db
@@ -0,0 +1,261 @@
+#include "columnar_db/engine/command_processor.h"
+#include "columnar_db/common/metrics.h"
+#include "SQLParser.h"
+#include "sql/SelectStatement.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <vector>
+
+namespace db {
+
+namespace {
+
+// Splits `text` into words at whitespace, parentheses and a trailing ';'.
+// A quoted literal stays one word, quotes included.
+std::vector<std::string> split_words(const std::string& text) {
+    std::vector<std::string> words;
+    std::string word;
+    bool quoted = false;
+    for (char c : text) {
+        if (c == '\'') {
+            quoted = !quoted;
+        } else if (!quoted && (std::isspace(static_cast<unsigned char>(c)) || c == '(' || c == ')' || c == ';')) {
+            if (!word.empty()) {
+                words.push_back(std::move(word));
+                word.clear();
+            }
+            continue;
+        }
+        word += c;
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+std::string to_upper(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::toupper(c); });
+    return text;
+}
+
+} // namespace
+
+CommandProcessor::CommandProcessor(QueryExecutor* executor, CheckpointManager* checkpoint_manager,
+                                   BackupManager* backup_manager)
+    : executor_(executor), checkpoint_manager_(checkpoint_manager), backup_manager_(backup_manager) {}
+
+void CommandProcessor::Run(const std::string& command, std::ostream& out, std::ostream& err) {
+    if (command == "backup" || command.rfind("backup ", 0) == 0) {
+        run_backup(command.substr(6), out, err);
+        return;
+    }
+
+    // The parser knows none of these, so they are recognized here.
+    std::string upper = command;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+    while (!upper.empty() && (upper.back() == ';' || std::isspace(static_cast<unsigned char>(upper.back())))) {
+        upper.pop_back();
+    }
+    if (upper == "SHOW STATS" || upper == "SHOW STATS JSON") {
+        MetricsSnapshot stats = Metrics::Collect();
+        out << (upper == "SHOW STATS" ? stats.ToText() : stats.ToJson() + "\n") << std::endl;
+        return;
+    }
+    if (upper.rfind("CLUSTER ", 0) == 0) {
+        run_cluster(command, out, err);
+        return;
+    }
+    if (upper.rfind("PARTITION ", 0) == 0) {
+        run_partition(command, out, err);
+        return;
+    }
+    if (upper.rfind("CREATE PARTITION ", 0) == 0) {
+        run_create_partition(command, out, err);
+        return;
+    }
+    if (upper.rfind("CREATE MATERIALIZED VIEW ", 0) == 0) {
+        run_create_view(command, out, err);
+        maybe_checkpoint();
+        return;
+    }
+    const size_t sample_at = upper.find(" TABLESAMPLE ");
+    if (sample_at != std::string::npos) {
+        run_sample(command, sample_at, out, err);
+        return;
+    }
+    const std::string explain_prefix = "EXPLAIN ANALYZE ";
+    const bool explain = upper.rfind(explain_prefix, 0) == 0;
+    const std::string query = explain ? command.substr(explain_prefix.size()) : command;
+
+    hsql::SQLParserResult result;
+    hsql::SQLParser::parseSQLString(query, &result);
+    if (!result.isValid()) {
+        err << "Error: Invalid SQL query." << std::endl;
+        err << "  " << result.errorMsg() << " (L:" << result.errorLine() << ", C:" << result.errorColumn() << ")" << std::endl;
+        return;
+    }
+    // One statement per command: the result cache and EXPLAIN key on the whole text.
+    if (result.size() != 1) {
+        err << "Error: Expected one statement, got " << result.size() << "." << std::endl;
+        return;
+    }
+    if (explain) {
+        executor_->ExplainAnalyze(result.getStatement(0), out, err);
+    } else {
+        executor_->ExecuteCached(query, result.getStatement(0), out, err);
+    }
+    maybe_checkpoint();
+}
+
+void CommandProcessor::run_backup(const std::string& args, std::ostream& out, std::ostream& err) {
+    std::istringstream words(args);
+    std::string dir;
+    std::string extra;
+    bool incremental = false;
+    words >> dir;
+    if (dir == "incremental") {
+        incremental = true;
+        dir.clear();
+        words >> dir;
+    }
+    if (dir.empty() || words >> extra) {
+        err << "Usage: backup [incremental] DIR" << std::endl;
+    } else if (backup_manager_ == nullptr) {
+        err << "Error: The database is open read-only; back up the original instead." << std::endl;
+    } else if (!backup_manager_->StartBackup(dir, incremental)) {
+        err << "Error: A backup is already running." << std::endl;
+    } else {
+        out << "Backup to '" << dir << "' started." << std::endl;
+    }
+}
+
+void CommandProcessor::run_cluster(const std::string& command, std::ostream& out, std::ostream& err) {
+    std::string text = command;
+    while (!text.empty() && (text.back() == ';' || std::isspace(static_cast<unsigned char>(text.back())))) {
+        text.pop_back();
+    }
+    std::istringstream words(text);
+    std::string keyword;
+    std::string table_name;
+    std::string by;
+    std::string column_name;
+    std::string extra;
+    words >> keyword >> table_name >> by >> column_name;
+    std::transform(by.begin(), by.end(), by.begin(), [](unsigned char c) { return std::toupper(c); });
+    if (table_name.empty() || by != "BY" || column_name.empty() || words >> extra) {
+        err << "Usage: CLUSTER table BY column" << std::endl;
+        return;
+    }
+    executor_->Cluster(table_name, column_name, out, err);
+}
+
+void CommandProcessor::run_partition(const std::string& command, std::ostream& out, std::ostream& err) {
+    // PARTITION table BY RANGE (column) | PARTITION table BY HASH (column) INTO n
+    std::vector<std::string> words = split_words(command);
+    const std::string kind = words.size() >= 4 ? to_upper(words[3]) : "";
+    uint32_t partition_count = 0;
+    bool valid = false;
+    if (words.size() == 5 && to_upper(words[2]) == "BY" && kind == "RANGE") {
+        valid = true;
+    } else if (words.size() == 7 && to_upper(words[2]) == "BY" && kind == "HASH" && to_upper(words[5]) == "INTO") {
+        const std::string& count = words[6];
+        auto result = std::from_chars(count.data(), count.data() + count.size(), partition_count);
+        valid = result.ec == std::errc() && result.ptr == count.data() + count.size();
+    }
+    if (!valid) {
+        err << "Usage: PARTITION table BY RANGE (column) | PARTITION table BY HASH (column) INTO n" << std::endl;
+        return;
+    }
+    executor_->Partition(words[1], kind == "HASH" ? PartitionKind::HASH : PartitionKind::RANGE, words[4],
+                         partition_count, out, err);
+}
+
+void CommandProcessor::run_create_partition(const std::string& command, std::ostream& out, std::ostream& err) {
+    // CREATE PARTITION name OF table FROM lo TO hi
+    std::vector<std::string> words = split_words(command);
+    if (words.size() != 9 || to_upper(words[3]) != "OF" || to_upper(words[5]) != "FROM" ||
+        to_upper(words[7]) != "TO") {
+        err << "Usage: CREATE PARTITION name OF table FROM (lo | MINVALUE) TO (hi | MAXVALUE)" << std::endl;
+        return;
+    }
+    const std::string from = to_upper(words[6]) == "MINVALUE" ? "MINVALUE" : words[6];
+    const std::string to = to_upper(words[8]) == "MAXVALUE" ? "MAXVALUE" : words[8];
+    executor_->CreatePartition(words[2], words[4], from, to, out, err);
+}
+
+void CommandProcessor::run_create_view(const std::string& command, std::ostream& out, std::ostream& err) {
+    // CREATE MATERIALIZED VIEW name AS SELECT ...; the query is left to the parser.
+    std::istringstream words(command);
+    std::string create;
+    std::string materialized;
+    std::string view;
+    std::string view_name;
+    std::string as;
+    words >> create >> materialized >> view >> view_name >> as;
+    std::string query;
+    std::getline(words, query, '\0');
+
+    hsql::SQLParserResult result;
+    if (!view_name.empty() && to_upper(as) == "AS") {
+        hsql::SQLParser::parseSQLString(query, &result);
+    }
+    if (!result.isValid() || result.size() != 1 || result.getStatement(0)->type() != hsql::kStmtSelect) {
+        err << "Usage: CREATE MATERIALIZED VIEW name AS SELECT columns, COUNT(*), SUM(column) ... FROM table "
+            << "GROUP BY columns" << std::endl;
+        return;
+    }
+    executor_->CreateMaterializedView(view_name, static_cast<const hsql::SelectStatement*>(result.getStatement(0)),
+                                      out, err);
+}
+
+void CommandProcessor::run_sample(const std::string& command, size_t sample_at, std::ostream& out,
+                                  std::ostream& err) {
+    // SELECT ... FROM table TABLESAMPLE SYSTEM (p) [WHERE ...]: the parser does
+    // not know the clause, so it is cut out and the rest parsed as usual.
+    const std::string usage = "Usage: SELECT ... FROM table TABLESAMPLE SYSTEM (percent) [WHERE ...]";
+    std::istringstream clause(command.substr(sample_at));
+    std::string keyword;
+    std::string method;
+    clause >> keyword >> method;
+    const size_t open = command.find('(', sample_at);
+    const size_t close = open != std::string::npos ? command.find(')', open) : std::string::npos;
+    double percent = 0;
+    bool valid = to_upper(method) == "SYSTEM" && close != std::string::npos;
+    if (valid) {
+        std::string text = command.substr(open + 1, close - open - 1);
+        text.erase(0, text.find_first_not_of(" \t"));
+        text.erase(text.find_last_not_of(" \t") + 1);
+        auto result = std::from_chars(text.data(), text.data() + text.size(), percent);
+        valid = !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+    if (!valid) {
+        err << usage << std::endl;
+        return;
+    }
+
+    hsql::SQLParserResult result;
+    hsql::SQLParser::parseSQLString(command.substr(0, sample_at) + " " + command.substr(close + 1), &result);
+    if (!result.isValid()) {
+        err << "Error: Invalid SQL query." << std::endl;
+        err << "  " << result.errorMsg() << " (L:" << result.errorLine() << ", C:" << result.errorColumn() << ")" << std::endl;
+        return;
+    }
+    executor_->ExecuteSample(result.getStatement(0), percent, out, err);
+}
+
+void CommandProcessor::maybe_checkpoint() {
+    if (checkpoint_manager_ == nullptr || !checkpoint_manager_->CheckpointDue()) {
+        return;
+    }
+    // Other sessions may be between logging a change and applying it; wait
+    // for them to finish, and keep new statements out, while checkpointing.
+    std::unique_lock<std::shared_mutex> exclusive(*executor_->GetStatementLatch());
+    checkpoint_manager_->MaybeCheckpoint();
+}
+
+} // namespace db
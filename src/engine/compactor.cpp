@@ -0,0 +1,342 @@
+#include "columnar_db/engine/compactor.h"
+#include "columnar_db/common/metrics.h"
+#include "columnar_db/engine/materialized_view.h"
+#include "columnar_db/storage/table.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace db {
+
+namespace {
+
+// Writes values of one type into a new column chain, a page after another.
+class ChainWriter {
+public:
+    ChainWriter(BufferPoolManager* bpm, DataType type) : bpm_(bpm), type_(type), capacity_(ColumnPageCapacity(type)) {
+        current_ = new_page(&first_page_id_, INVALID_PAGE_ID);
+        current_pid_ = first_page_id_;
+    }
+
+    void Append(int64_t value) {
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(current_->data());
+        if (data_page->value_count_ == capacity_) {
+            page_id_t next_pid;
+            Page* next = new_page(&next_pid, current_pid_ + 1);
+            data_page->next_page_id_ = next_pid;
+            bpm_->UnpinPage(current_pid_, true);
+            current_ = next;
+            current_pid_ = next_pid;
+            data_page = reinterpret_cast<ColumnDataPage*>(current_->data());
+        }
+        WriteColumnValue(data_page, type_, data_page->value_count_++, value);
+    }
+
+    // Releases the last page; returns the chain's first.
+    page_id_t Finish() {
+        bpm_->UnpinPage(current_pid_, true);
+        return first_page_id_;
+    }
+
+private:
+    Page* new_page(page_id_t* page_id, page_id_t hint) {
+        Page* page = bpm_->NewPage(page_id, hint);
+        if (page == nullptr) {
+            throw std::runtime_error("Buffer pool exhausted during compaction.");
+        }
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+        data_page->next_page_id_ = INVALID_PAGE_ID;
+        data_page->value_count_ = 0;
+        data_page->page_lsn_ = 0;
+        return page;
+    }
+
+    BufferPoolManager* bpm_;
+    DataType type_;
+    uint32_t capacity_;
+    page_id_t first_page_id_;
+    page_id_t current_pid_;
+    Page* current_;
+};
+
+} // namespace
+
+Compactor::Compactor(Catalog* catalog, BufferPoolManager* bpm, TransactionManager* txn_manager,
+                     CheckpointManager* checkpoint_manager, std::shared_mutex* statement_latch,
+                     std::shared_mutex* ddl_latch)
+    : catalog_(catalog), bpm_(bpm), txn_manager_(txn_manager), checkpoint_manager_(checkpoint_manager),
+      statement_latch_(statement_latch), ddl_latch_(ddl_latch) {}
+
+Compactor::~Compactor() {
+    Stop();
+}
+
+void Compactor::Start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    stop_ = false;
+    thread_ = std::thread(&Compactor::compact_loop, this);
+}
+
+void Compactor::Stop() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Compactor::compact_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cv_.wait_for(lock, std::chrono::milliseconds(COMPACTION_INTERVAL_MS), [this] { return stop_; })) {
+        lock.unlock();
+        try {
+            // Look for work alongside running statements; the counts are only
+            // estimates, since rows deleted by in-flight transactions still look live.
+            std::vector<std::string> candidates;
+            // A table holding an aborted id is rewritten even with nothing to drop,
+            // which resets its MVCC columns; after this pass no row refers to the
+            // ids aborted before it, so they are forgotten (see TransactionManager).
+            const std::shared_ptr<const std::unordered_set<txn_id_t>> aborted = txn_manager_->GetAborted();
+            {
+                std::shared_lock<std::shared_mutex> shared(*statement_latch_);
+                for (const std::string& name : catalog_->GetTableNames()) {
+                    const TableSchema* schema = catalog_->GetTableSchema(name);
+                    std::vector<bool> live;
+                    bool has_aborted = false;
+                    uint64_t dead = find_live_rows(schema, &live, &has_aborted);
+                    const uint64_t tail = live.size() - std::min<uint64_t>(schema->sorted_rows, live.size());
+                    const bool merge = schema->sort_column >= 0 && tail >= CLUSTER_MERGE_MIN_TAIL_ROWS &&
+                                       static_cast<double>(tail) >=
+                                           CLUSTER_MERGE_MIN_TAIL_RATIO * static_cast<double>(schema->sorted_rows);
+                    // A view is read whole, so fold it once its change rows outnumber its groups.
+                    const bool fold = schema->IsView() && tail >= VIEW_FOLD_MIN_DELTA_ROWS && tail > schema->sorted_rows;
+                    if (merge || fold || has_aborted || (dead >= COMPACTION_MIN_DEAD_ROWS &&
+                                  static_cast<double>(dead) >= COMPACTION_MIN_DEAD_RATIO * static_cast<double>(live.size()))) {
+                        candidates.push_back(name);
+                    }
+                }
+            }
+            // Runs on its own thread, so it reports through Metrics (SHOW STATS)
+            // rather than writing between a client's prompt and its output.
+            for (const std::string& name : candidates) {
+                std::unique_lock<std::shared_mutex> ddl(*ddl_latch_);
+                std::unique_lock<std::shared_mutex> exclusive(*statement_latch_);
+                const TableSchema* schema = catalog_->GetTableSchema(name);
+                const uint64_t sorted_before = schema != nullptr ? schema->sorted_rows : 0;
+                const uint64_t rows_before =
+                    schema != nullptr && schema->IsView() ? Table(catalog_->GetTableHandle(schema), bpm_).GetNumRows() : 0;
+                uint64_t dropped = CompactTable(name);
+                if (dropped > 0) {
+                    Metrics::Add(Counter::COMPACTIONS);
+                    Metrics::Add(Counter::COMPACTION_DEAD_ROWS, dropped);
+                }
+                schema = catalog_->GetTableSchema(name);
+                if (schema != nullptr && schema->IsView()) {
+                    if (Table(catalog_->GetTableHandle(schema), bpm_).GetNumRows() < rows_before) {
+                        Metrics::Add(Counter::COMPACTION_VIEW_FOLDS);
+                    }
+                } else if (schema != nullptr && schema->sort_column >= 0 && schema->sorted_rows > sorted_before) {
+                    Metrics::Add(Counter::COMPACTION_MERGES);
+                }
+            }
+            if (!aborted->empty()) {
+                txn_manager_->ForgetAborted(*aborted);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Compaction failed: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+uint64_t Compactor::find_live_rows(const TableSchema* schema, std::vector<bool>* live, bool* has_aborted) {
+    // A fresh snapshot: any id it considers committed is committed for every
+    // later reader too, so a delete it sees can never be seen "undone".
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    const Snapshot& snapshot = txn->GetSnapshot();
+
+    Table table(catalog_->GetTableHandle(schema), bpm_);
+    live->assign(table.GetNumRows(), true);
+    uint64_t dead = 0;
+    bool found_aborted = false;
+    auto is_aborted = [&snapshot](int64_t id) { return !snapshot.aborted->empty() && snapshot.aborted->count(id) > 0; };
+
+    table.ForEachColumnPage(schema->XminColumn(), [&](uint64_t first_row, const int64_t* values, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            // Inserted by a transaction that aborted (or has not finished yet; the
+            // exclusive latch rules that out when actually compacting).
+            if (!snapshot.IsCommitted(values[i])) {
+                (*live)[first_row + i] = false;
+            }
+            found_aborted = found_aborted || is_aborted(values[i]);
+        }
+    });
+    table.ForEachColumnPage(schema->XmaxColumn(), [&](uint64_t first_row, const int64_t* values, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (values[i] != INVALID_TXN_ID && snapshot.IsCommitted(values[i])) {
+                (*live)[first_row + i] = false;
+            }
+            found_aborted = found_aborted || is_aborted(values[i]);
+        }
+    });
+    txn_manager_->Commit(txn.get());
+    if (has_aborted != nullptr) {
+        *has_aborted = found_aborted;
+    }
+
+    for (bool is_live : *live) {
+        dead += is_live ? 0 : 1;
+    }
+    return dead;
+}
+
+uint64_t Compactor::CompactTable(const std::string& table_name) {
+    const TableSchema* schema = catalog_->GetTableSchema(table_name);
+    if (schema == nullptr) {
+        return 0;
+    }
+
+    std::vector<bool> live;
+    bool has_aborted = false;
+    uint64_t dead = find_live_rows(schema, &live, &has_aborted);
+    // A clustered table is also rewritten to merge its unsorted tail into the
+    // sealed segment, and a materialized view to fold its change rows. One
+    // with marks of aborted transactions is rewritten to clear them.
+    const bool merge = schema->sort_column >= 0 || schema->IsView();
+    if (dead == 0 && !has_aborted && (!merge || schema->sorted_rows >= live.size())) {
+        return 0;
+    }
+
+    // 1. Build the new chains. Nothing points at them yet, so a crash here
+    //    only leaks their pages.
+    std::vector<page_id_t> first_page_ids;
+    uint64_t sorted_rows = live.size() - dead;
+    if (schema->IsView()) {
+        // One row per group, in key order, with the MVCC columns reset as in rewrite_column.
+        const std::vector<std::vector<int64_t>> groups = fold_view(schema, live);
+        sorted_rows = groups.size();
+        for (size_t i = 0; i < schema->columns.size(); ++i) {
+            ChainWriter writer(bpm_, schema->columns[i].type);
+            for (const auto& group : groups) {
+                writer.Append(i < group.size() ? group[i] : INVALID_TXN_ID);
+            }
+            first_page_ids.push_back(writer.Finish());
+        }
+    } else {
+        std::vector<uint64_t> order;
+        if (merge) {
+            order = sorted_order(schema, live);
+        }
+        for (size_t i = 0; i < schema->columns.size(); ++i) {
+            first_page_ids.push_back(rewrite_column(schema, i, live, order));
+        }
+    }
+
+    // 2. Make the new chains durable and move the checkpoint past every log
+    //    record that refers to the old row ids.
+    checkpoint_manager_->Checkpoint();
+
+    // 3. Switch over, and make the switch durable before any statement logs
+    //    a row id in the new numbering.
+    std::vector<page_id_t> old_first_page_ids;
+    for (const auto& col : schema->columns) {
+        old_first_page_ids.push_back(col.first_page_id);
+    }
+    if (!catalog_->ReplaceColumnSegments(table_name, first_page_ids, sorted_rows)) {
+        throw std::runtime_error("Failed to switch table '" + table_name + "' to its compacted segments.");
+    }
+    checkpoint_manager_->Checkpoint();
+
+    // 4. Nothing can reach the old chains any more.
+    catalog_->FreeSegments(old_first_page_ids);
+    return dead;
+}
+
+std::vector<uint64_t> Compactor::sorted_order(const TableSchema* schema, const std::vector<bool>& live) {
+    const auto sort_column = static_cast<size_t>(schema->sort_column);
+    const DataType type = schema->columns[sort_column].type;
+    Table table(catalog_->GetTableHandle(schema), bpm_);
+    std::vector<int64_t> keys(live.size());
+    table.ForEachColumnPage(sort_column, [&](uint64_t first_row, const int64_t* values, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            keys[first_row + i] = SortKey(type, values[i]);
+        }
+    });
+
+    std::vector<uint64_t> order;
+    for (uint64_t row = 0; row < live.size(); ++row) {
+        if (live[row]) {
+            order.push_back(row);
+        }
+    }
+    // The sealed segment is sorted already: sort the tail and merge the two.
+    // Both steps are stable, so rows with equal keys keep their order.
+    auto by_key = [&keys](uint64_t a, uint64_t b) { return keys[a] < keys[b]; };
+    auto tail = std::lower_bound(order.begin(), order.end(), std::min<uint64_t>(schema->sorted_rows, live.size()));
+    std::stable_sort(tail, order.end(), by_key);
+    std::inplace_merge(order.begin(), tail, order.end(), by_key);
+    return order;
+}
+
+page_id_t Compactor::rewrite_column(const TableSchema* schema, size_t col_idx, const std::vector<bool>& live,
+                                    const std::vector<uint64_t>& order) {
+    // Surviving rows have a committed __xmin and no committed __xmax, so both
+    // MVCC columns can be reset: 0 is "frozen" in xmin and "not deleted" in xmax.
+    const bool reset_value = col_idx == schema->XminColumn() || col_idx == schema->XmaxColumn();
+    ChainWriter writer(bpm_, schema->columns[col_idx].type);
+    auto append = [&](int64_t value) { writer.Append(reset_value ? INVALID_TXN_ID : value); };
+
+    Table table(catalog_->GetTableHandle(schema), bpm_);
+    if (order.empty() || reset_value) {
+        // The live rows in place (an MVCC column's values are all reset anyway).
+        table.ForEachColumnPage(col_idx, [&](uint64_t first_row, const int64_t* values, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                if (live[first_row + i]) {
+                    append(values[i]);
+                }
+            }
+        });
+    } else {
+        // Reordered: gather the column, then write it out in the new order.
+        std::vector<int64_t> values(live.size());
+        table.ForEachColumnPage(col_idx, [&](uint64_t first_row, const int64_t* page_values, uint32_t count) {
+            std::copy(page_values, page_values + count, values.begin() + static_cast<ptrdiff_t>(first_row));
+        });
+        for (uint64_t row : order) {
+            append(values[row]);
+        }
+    }
+
+    return writer.Finish();
+}
+
+std::vector<std::vector<int64_t>> Compactor::fold_view(const TableSchema* schema, const std::vector<bool>& live) {
+    Table table(catalog_->GetTableHandle(schema), bpm_);
+    std::vector<std::vector<int64_t>> columns(schema->UserColumnCount());
+    for (size_t c = 0; c < columns.size(); ++c) {
+        columns[c].reserve(live.size());
+        table.ForEachColumnPage(c, [&](uint64_t, const int64_t* values, uint32_t count) {
+            columns[c].insert(columns[c].end(), values, values + count);
+        });
+    }
+    ViewAggregator groups(schema);
+    std::vector<int64_t> row(columns.size());
+    for (uint64_t r = 0; r < live.size(); ++r) {
+        if (!live[r]) {
+            continue;
+        }
+        for (size_t c = 0; c < columns.size(); ++c) {
+            row[c] = columns[c][r];
+        }
+        groups.AddViewRow(row);
+    }
+    return groups.Rows(false);
+}
+
+} // namespace db
@@ -0,0 +1,93 @@
+#include "columnar_db/engine/materialized_view.h"
+#include <bit>
+
+namespace db {
+
+ViewAggregator::ViewAggregator(const TableSchema* view) : view_(view) {
+    bool found_count = false;
+    for (size_t c = 0; c < view->view_columns.size(); ++c) {
+        const ViewAggregate aggregate = view->view_columns[c].aggregate;
+        if (aggregate == ViewAggregate::GROUP_KEY) {
+            key_columns_.push_back(c);
+            continue;
+        }
+        if (aggregate == ViewAggregate::COUNT && !found_count) {
+            found_count = true;
+            count_ = aggregate_columns_.size();
+        }
+        aggregate_columns_.push_back(c);
+    }
+}
+
+void ViewAggregator::AddBaseRow(const std::vector<int64_t>& row, int64_t sign) {
+    std::vector<int64_t> key;
+    key.reserve(key_columns_.size());
+    for (size_t c : key_columns_) {
+        key.push_back(SortKey(view_->columns[c].type, row[view_->view_columns[c].base_column]));
+    }
+    std::vector<int64_t> values;
+    values.reserve(aggregate_columns_.size());
+    for (size_t c : aggregate_columns_) {
+        const ViewColumn& column = view_->view_columns[c];
+        values.push_back(column.aggregate == ViewAggregate::COUNT ? 1 : row[column.base_column]);
+    }
+    add(key, values, sign);
+}
+
+void ViewAggregator::AddViewRow(const std::vector<int64_t>& row) {
+    std::vector<int64_t> key;
+    key.reserve(key_columns_.size());
+    for (size_t c : key_columns_) {
+        key.push_back(SortKey(view_->columns[c].type, row[c]));
+    }
+    std::vector<int64_t> values;
+    values.reserve(aggregate_columns_.size());
+    for (size_t c : aggregate_columns_) {
+        values.push_back(row[c]);
+    }
+    add(key, values, 1);
+}
+
+void ViewAggregator::add(const std::vector<int64_t>& key, const std::vector<int64_t>& values, int64_t sign) {
+    std::vector<int64_t>& sums = groups_.try_emplace(key, aggregate_columns_.size(), 0).first->second;
+    for (size_t i = 0; i < aggregate_columns_.size(); ++i) {
+        if (view_->columns[aggregate_columns_[i]].type == DataType::DOUBLE) {
+            const double sum = std::bit_cast<double>(sums[i]) + static_cast<double>(sign) * std::bit_cast<double>(values[i]);
+            sums[i] = std::bit_cast<int64_t>(sum);
+        } else {
+            // Integer sums wrap around rather than overflow, like they would in the base table's column.
+            sums[i] = static_cast<int64_t>(static_cast<uint64_t>(sums[i]) +
+                                           static_cast<uint64_t>(sign) * static_cast<uint64_t>(values[i]));
+        }
+    }
+}
+
+std::vector<std::vector<int64_t>> ViewAggregator::Rows(bool delta) const {
+    std::vector<std::vector<int64_t>> rows;
+    for (const auto& [key, sums] : groups_) {
+        bool keep;
+        if (delta) {
+            keep = false;
+            for (size_t i = 0; i < sums.size(); ++i) {
+                const bool is_double = view_->columns[aggregate_columns_[i]].type == DataType::DOUBLE;
+                keep = keep || (is_double ? std::bit_cast<double>(sums[i]) != 0.0 : sums[i] != 0);
+            }
+        } else {
+            keep = sums[count_] != 0;
+        }
+        if (!keep) {
+            continue;
+        }
+        std::vector<int64_t>& row = rows.emplace_back(view_->view_columns.size());
+        for (size_t k = 0; k < key_columns_.size(); ++k) {
+            // SortKey is its own inverse.
+            row[key_columns_[k]] = SortKey(view_->columns[key_columns_[k]].type, key[k]);
+        }
+        for (size_t i = 0; i < aggregate_columns_.size(); ++i) {
+            row[aggregate_columns_[i]] = sums[i];
+        }
+    }
+    return rows;
+}
+
+} // namespace db
@@ -0,0 +1,48 @@
+#include "columnar_db/engine/memory_manager.h"
+#include "columnar_db/common/metrics.h"
+#include <algorithm>
+
+namespace db {
+
+MemoryGrant::~MemoryGrant() {
+    manager_->release(size_);
+}
+
+bool MemoryGrant::Reserve(size_t bytes) {
+    size_t used = used_.load(std::memory_order_relaxed);
+    do {
+        if (bytes > size_ - used) {
+            return false;
+        }
+    } while (!used_.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+    return true;
+}
+
+void MemoryGrant::Release(size_t bytes) {
+    used_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryManager::MemoryManager(size_t budget, size_t max_grant)
+    : budget_(budget), max_grant_(std::min(max_grant, budget)) {}
+
+std::unique_ptr<MemoryGrant> MemoryManager::Admit(size_t bytes) {
+    const size_t size = std::min(bytes, max_grant_);
+    std::unique_lock<std::mutex> lock(latch_);
+    if (budget_ - granted_ < size) {
+        Metrics::Add(Counter::QUERY_ADMISSION_WAITS);
+        released_.wait(lock, [this, size] { return budget_ - granted_ >= size; });
+    }
+    granted_ += size;
+    return std::make_unique<MemoryGrant>(this, size);
+}
+
+void MemoryManager::release(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(latch_);
+        granted_ -= bytes;
+    }
+    // Waiters ask for different sizes, so any of them may fit now.
+    released_.notify_all();
+}
+
+} // namespace db
@@ -1,130 +1,1560 @@
 #include "columnar_db/engine/query_executor.h"
+#include "columnar_db/common/hyperloglog.h"
+#include "columnar_db/common/numa.h"
+#include "columnar_db/engine/spill_buffer.h"
+#include "columnar_db/storage/columnar_file.h"
 #include "columnar_db/storage/table.h"
 #include "SQLParser.h"
 #include "sql/SelectStatement.h"
 #include "sql/InsertStatement.h"
+#include "sql/DeleteStatement.h"
+#include "sql/UpdateStatement.h"
+#include "sql/CreateStatement.h"
+#include "sql/DropStatement.h"
+#include "sql/ExportStatement.h"
+#include "sql/ImportStatement.h"
 #include "sql/Expr.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <functional> // For std::function
+#include <mutex>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <tuple>
 #include "columnar_db/wal/log_manager.h"
 
 namespace db {
 
-QueryExecutor::QueryExecutor(Catalog* catalog, BufferPoolManager* bpm, LogManager* log_manager)
-    : catalog_(catalog), bpm_(bpm), log_manager_(log_manager) {}
+namespace {
+
+// Holds a SELECT's output back while it is small enough for the result cache
+// (RESULT_CACHE_MAX_ENTRY_BYTES). Past that, it sends what it holds on to
+// `out`, and the rest straight after it as it is written.
+class CacheCapture : public std::streambuf {
+public:
+    explicit CacheCapture(std::ostream& out) : out_(out) {}
+
+    // Whether the output outgrew the cache and was passed on.
+    bool PassedOn() const { return passing_; }
+
+    // Sends the held output on to `out` and returns it.
+    std::string Finish() {
+        if (!passing_) {
+            out_.write(held_.data(), static_cast<std::streamsize>(held_.size()));
+        }
+        return std::move(held_);
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        const char ch = traits_type::to_char_type(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (!passing_ && held_.size() + static_cast<size_t>(n) > RESULT_CACHE_MAX_ENTRY_BYTES) {
+            out_.write(held_.data(), static_cast<std::streamsize>(held_.size()));
+            std::string().swap(held_);
+            passing_ = true;
+        }
+        if (passing_) {
+            out_.write(s, n);
+            return out_ ? n : 0;
+        }
+        held_.append(s, static_cast<size_t>(n));
+        return n;
+    }
+
+private:
+    std::ostream& out_;
+    std::string held_;
+    bool passing_ = false;
+};
+
+} // namespace
+
+QueryExecutor::QueryExecutor(Catalog* catalog, BufferPoolManager* bpm, LogManager* log_manager,
+                             TransactionManager* txn_manager)
+    : catalog_(catalog), bpm_(bpm), log_manager_(log_manager), txn_manager_(txn_manager),
+      memory_manager_(QUERY_MEMORY_BUDGET, QUERY_MEMORY_GRANT) {}
+
+void QueryExecutor::Execute(const hsql::SQLStatement* statement, QueryProfile* profile) {
+    Execute(statement, std::cout, std::cerr, profile);
+}
+
+void QueryExecutor::Execute(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                            QueryProfile* profile) {
+    // Statements run concurrently with each other, but never with compaction.
+    // DDL changes the catalog, which the others read without locking, so it runs alone.
+    const bool is_ddl = statement->type() == hsql::kStmtCreate || statement->type() == hsql::kStmtDrop;
+    std::unique_lock<std::shared_mutex> ddl(ddl_latch_, std::defer_lock);
+    std::shared_lock<std::shared_mutex> shared(statement_latch_, std::defer_lock);
+    std::unique_lock<std::shared_mutex> exclusive(statement_latch_, std::defer_lock);
+    if (is_ddl) {
+        ddl.lock();
+        exclusive.lock();
+    } else {
+        shared.lock();
+    }
+
+    if (bpm_->IsReadOnly() && statement->type() != hsql::kStmtSelect && statement->type() != hsql::kStmtExport) {
+        err << "Error: The database is open read-only. Only SELECT and EXPORT statements are supported." << std::endl;
+        return;
+    }
 
-void QueryExecutor::Execute(const hsql::SQLStatement* statement) {
     switch (statement->type()) {
         case hsql::kStmtSelect:
-            ExecuteSelect(statement);
+            ExecuteSelect(statement, out, err, profile, nullptr);
             break;
         case hsql::kStmtInsert:
-            ExecuteInsert(statement);
+            ExecuteInsert(statement, out, err, profile);
+            break;
+        case hsql::kStmtDelete:
+            ExecuteDelete(statement, out, err, profile);
+            break;
+        case hsql::kStmtUpdate:
+            ExecuteUpdate(statement, out, err, profile);
+            break;
+        case hsql::kStmtCreate:
+            ExecuteCreate(statement, out, err, profile);
+            break;
+        case hsql::kStmtDrop:
+            ExecuteDrop(statement, out, err, profile);
+            break;
+        case hsql::kStmtExport:
+            ExecuteExport(statement, out, err, profile);
+            break;
+        case hsql::kStmtImport:
+            ExecuteImport(statement, out, err, profile);
             break;
         default:
-            std::cerr << "Error: Only SELECT and INSERT statements are supported." << std::endl;
+            err << "Error: Only SELECT, INSERT, DELETE, UPDATE, CREATE TABLE, DROP TABLE, EXPORT and IMPORT statements are supported." << std::endl;
             break;
     }
 }
 
-void QueryExecutor::ExecuteSelect(const hsql::SQLStatement* statement) {
-    const auto* select_stmt = static_cast<const hsql::SelectStatement*>(statement);
-    
-    const char* table_name = select_stmt->fromTable->getName();
-    if (table_name == nullptr) {
-        std::cerr << "Error: SELECT must be from a table." << std::endl;
+void QueryExecutor::ExplainAnalyze(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err) {
+    QueryProfile profile;
+    Execute(statement, out, err, &profile);
+    profile.Finish();
+    profile.Print(out);
+}
+
+void QueryExecutor::ExecuteCached(const std::string& query, const hsql::SQLStatement* statement, std::ostream& out,
+                                  std::ostream& err) {
+    if (statement->type() != hsql::kStmtSelect) {
+        Execute(statement, out, err);
+        return;
+    }
+    std::shared_lock<std::shared_mutex> shared(statement_latch_);
+    const auto* select_stmt = static_cast<const hsql::SelectStatement*>(statement);
+    const char* table_name = select_stmt->fromTable != nullptr ? select_stmt->fromTable->getName() : nullptr;
+    const TableSchema* schema = table_name != nullptr ? catalog_->GetTableSchema(table_name) : nullptr;
+    if (schema == nullptr) {
+        ExecuteSelect(statement, out, err, nullptr, nullptr);
+        return;
+    }
+
+    const std::string key = ResultCache::Normalize(query);
+    if (std::optional<std::string> cached = result_cache_.Lookup(key, schema->table_id)) {
+        out << *cached;
+        return;
+    }
+    // A result small enough to cache is held back until it is known to be
+    // complete; a larger one is streamed out as it is produced.
+    std::unique_ptr<MemoryGrant> memory = memory_manager_.Admit(estimate_output_bytes(scan_targets(schema, {}), 1));
+    // Taken before the SELECT's snapshot: a change committed in between
+    // bumps the version, so the result is never kept as newer than it is.
+    const uint64_t version = result_cache_.GetVersion(schema->table_id);
+    CacheCapture output(out);
+    std::ostream output_stream(&output);
+    std::ostringstream errors;
+    ExecuteSelect(statement, output_stream, errors, nullptr, memory.get());
+    std::string text = output.Finish();
+    err << errors.str();
+    if (errors.tellp() == 0 && !output.PassedOn()) {
+        result_cache_.Insert(key, schema->table_id, version, std::move(text));
+    }
+}
+
+void QueryExecutor::ExecuteSample(const hsql::SQLStatement* statement, double percent, std::ostream& out,
+                                  std::ostream& err) {
+    std::shared_lock<std::shared_mutex> shared(statement_latch_);
+    if (statement->type() != hsql::kStmtSelect) {
+        err << "Error: TABLESAMPLE is only supported in SELECT statements." << std::endl;
+        return;
+    }
+    if (!(percent >= 0 && percent <= 100)) {
+        err << "Error: The TABLESAMPLE percentage must be between 0 and 100." << std::endl;
+        return;
+    }
+    const hsql::TableRef* from = static_cast<const hsql::SelectStatement*>(statement)->fromTable;
+    const char* table_name = from != nullptr ? from->getName() : nullptr;
+    const TableSchema* schema = table_name != nullptr ? catalog_->GetTableSchema(table_name) : nullptr;
+    if (schema != nullptr && schema->IsView()) {
+        err << "Error: Table '" << table_name << "' is a materialized view and cannot be sampled." << std::endl;
+        return;
+    }
+    ExecuteSelect(statement, out, err, nullptr, nullptr, percent / 100);
+}
+
+void QueryExecutor::Cluster(const std::string& table_name, const std::string& column_name, std::ostream& out,
+                            std::ostream& err) {
+    // Like other DDL, this changes the catalog and runs alone.
+    std::unique_lock<std::shared_mutex> ddl(ddl_latch_);
+    std::unique_lock<std::shared_mutex> exclusive(statement_latch_);
+    if (bpm_->IsReadOnly()) {
+        err << "Error: The database is open read-only." << std::endl;
+        return;
+    }
+    const TableSchema* schema = catalog_->GetTableSchema(table_name);
+    if (schema == nullptr) {
+        err << "Error: Table '" << table_name << "' not found." << std::endl;
+        return;
+    }
+    if (schema->IsView()) {
+        err << "Error: Table '" << table_name << "' is a materialized view, kept ordered by its groups." << std::endl;
+        return;
+    }
+    int col_idx = find_user_column(schema, column_name.c_str());
+    if (col_idx == -1) {
+        err << "Error: Column '" << column_name << "' not found in table '" << table_name << "'." << std::endl;
+        return;
+    }
+    // A partitioned table's partitions are clustered with it, and new ones inherit its sort column.
+    std::vector<const TableSchema*> tables = {schema};
+    if (schema->IsPartitioned()) {
+        std::vector<const TableSchema*> partitions = catalog_->GetPartitions(schema);
+        tables.insert(tables.end(), partitions.begin(), partitions.end());
+    }
+    for (const TableSchema* table : tables) {
+        if (table->sort_column != col_idx && !catalog_->SetSortColumn(table->name, col_idx)) {
+            err << "Error: Failed to cluster table '" << table->name << "'." << std::endl;
+            return;
+        }
+    }
+    bump_versions(schema);
+    out << "Table '" << table_name << "' clustered by '" << column_name << "'." << std::endl;
+}
+
+void QueryExecutor::Partition(const std::string& table_name, PartitionKind kind, const std::string& column_name,
+                              uint32_t partition_count, std::ostream& out, std::ostream& err) {
+    std::unique_lock<std::shared_mutex> ddl(ddl_latch_);
+    std::unique_lock<std::shared_mutex> exclusive(statement_latch_);
+    if (bpm_->IsReadOnly()) {
+        err << "Error: The database is open read-only." << std::endl;
+        return;
+    }
+    const TableSchema* schema = catalog_->GetTableSchema(table_name);
+    if (schema == nullptr) {
+        err << "Error: Table '" << table_name << "' not found." << std::endl;
+        return;
+    }
+    if (schema->IsPartitioned() || schema->IsPartition() || schema->IsView()) {
+        err << "Error: Table '" << table_name << "' is already partitioned, a partition or a materialized view."
+            << std::endl;
+        return;
+    }
+    int col_idx = find_user_column(schema, column_name.c_str());
+    if (col_idx == -1) {
+        err << "Error: Column '" << column_name << "' not found in table '" << table_name << "'." << std::endl;
+        return;
+    }
+    if (schema->columns[col_idx].type == DataType::DOUBLE) {
+        err << "Error: A table can only be partitioned by an integer, DATE or DATETIME column." << std::endl;
+        return;
+    }
+    if (Table(catalog_->GetTableHandle(schema), bpm_).GetNumRows() != 0) {
+        err << "Error: Only an empty table can be partitioned." << std::endl;
+        return;
+    }
+    std::vector<std::string> partition_names;
+    if (kind == PartitionKind::HASH) {
+        if (partition_count == 0) {
+            err << "Error: A table needs at least one hash partition." << std::endl;
+            return;
+        }
+        for (uint32_t i = 0; i < partition_count; ++i) {
+            std::string name = table_name + "_p" + std::to_string(i);
+            if (name.size() >= sizeof(schema->name) || catalog_->GetTableSchema(name) != nullptr) {
+                err << "Error: Partition name '" << name << "' is too long or already taken." << std::endl;
+                return;
+            }
+            partition_names.push_back(std::move(name));
+        }
+    }
+
+    if (!catalog_->SetPartitioning(table_name, kind, col_idx, partition_count)) {
+        err << "Error: Failed to partition table '" << table_name << "'." << std::endl;
+        return;
+    }
+    for (uint32_t i = 0; i < partition_names.size(); ++i) {
+        if (!catalog_->CreatePartition(table_name, partition_names[i], i, i)) {
+            err << "Error: Failed to create partition '" << partition_names[i] << "'." << std::endl;
+            return;
+        }
+    }
+    bump_versions(schema);
+    out << "Table '" << table_name << "' partitioned by " << (kind == PartitionKind::HASH ? "hash" : "range")
+        << " of '" << column_name << "'." << std::endl;
+}
+
+void QueryExecutor::CreatePartition(const std::string& partition_name, const std::string& table_name,
+                                    const std::string& from, const std::string& to, std::ostream& out,
+                                    std::ostream& err) {
+    std::unique_lock<std::shared_mutex> ddl(ddl_latch_);
+    std::unique_lock<std::shared_mutex> exclusive(statement_latch_);
+    if (bpm_->IsReadOnly()) {
+        err << "Error: The database is open read-only." << std::endl;
+        return;
+    }
+    const TableSchema* schema = catalog_->GetTableSchema(table_name);
+    if (schema == nullptr) {
+        err << "Error: Table '" << table_name << "' not found." << std::endl;
+        return;
+    }
+    if (schema->partition_kind != PartitionKind::RANGE) {
+        err << "Error: Table '" << table_name << "' is not partitioned by range." << std::endl;
+        return;
+    }
+    if (partition_name.size() >= sizeof(schema->name) || catalog_->GetTableSchema(partition_name) != nullptr) {
+        err << "Error: Table name '" << partition_name << "' is too long or already taken." << std::endl;
+        return;
+    }
+
+    // The bounds become the inclusive range [lo, hi].
+    const Column& column = schema->columns[schema->partition_column];
+    int64_t lo = std::numeric_limits<int64_t>::min();
+    int64_t hi = std::numeric_limits<int64_t>::max();
+    if (from != "MINVALUE" && !parse_text_value(from, column, &lo, err)) {
+        return;
+    }
+    if (to != "MAXVALUE") {
+        if (!parse_text_value(to, column, &hi, err)) {
+            return;
+        }
+        // The upper bound is exclusive; nothing lies below the smallest value.
+        if (hi == std::numeric_limits<int64_t>::min()) {
+            lo = 0;
+            hi = -1;
+        } else {
+            --hi;
+        }
+    }
+    if (lo > hi) {
+        err << "Error: The range of partition '" << partition_name << "' is empty." << std::endl;
+        return;
+    }
+    for (const TableSchema* partition : catalog_->GetPartitions(schema)) {
+        if (partition->partition_lo <= hi && lo <= partition->partition_hi) {
+            err << "Error: Partition '" << partition_name << "' would overlap partition '" << partition->name << "'."
+                << std::endl;
+            return;
+        }
+    }
+    if (!catalog_->CreatePartition(table_name, partition_name, lo, hi)) {
+        err << "Error: Failed to create partition '" << partition_name << "'." << std::endl;
+        return;
+    }
+    bump_versions(schema);
+    out << "Partition '" << partition_name << "' of table '" << table_name << "' created." << std::endl;
+}
+
+void QueryExecutor::CreateMaterializedView(const std::string& view_name, const hsql::SelectStatement* query,
+                                           std::ostream& out, std::ostream& err) {
+    // Like other DDL, this changes the catalog and runs alone.
+    std::unique_lock<std::shared_mutex> ddl(ddl_latch_);
+    std::unique_lock<std::shared_mutex> exclusive(statement_latch_);
+    if (bpm_->IsReadOnly()) {
+        err << "Error: The database is open read-only." << std::endl;
+        return;
+    }
+    const char* base_name = query->fromTable != nullptr ? query->fromTable->getName() : nullptr;
+    if (base_name == nullptr) {
+        err << "Error: A materialized view must select from a table." << std::endl;
+        return;
+    }
+    const TableSchema* base = catalog_->GetTableSchema(base_name);
+    if (base == nullptr) {
+        err << "Error: Table '" << base_name << "' not found." << std::endl;
+        return;
+    }
+    if (base->IsView() || base->IsPartition()) {
+        err << "Error: Table '" << base_name << "' is a materialized view or a partition." << std::endl;
+        return;
+    }
+    if (query->selectDistinct || query->whereClause != nullptr || query->order != nullptr || query->limit != nullptr ||
+        (query->groupBy != nullptr && query->groupBy->having != nullptr)) {
+        err << "Error: A materialized view supports only SELECT ... FROM table GROUP BY columns." << std::endl;
+        return;
+    }
+    TableSchema schema{};
+    if (view_name.size() >= sizeof(schema.name) || catalog_->GetTableSchema(view_name) != nullptr) {
+        err << "Error: Table name '" << view_name << "' is too long or already taken." << std::endl;
+        return;
+    }
+    std::strncpy(schema.name, view_name.c_str(), sizeof(schema.name) - 1);
+    schema.view_base_table_id = base->table_id;
+
+    std::vector<int> group_columns;
+    if (query->groupBy != nullptr && query->groupBy->columns != nullptr) {
+        for (const hsql::Expr* expr : *query->groupBy->columns) {
+            const int col_idx = expr->type == hsql::kExprColumnRef ? find_user_column(base, expr->name) : -1;
+            if (col_idx == -1) {
+                err << "Error: A materialized view can only group by columns of table '" << base_name << "'."
+                    << std::endl;
+                return;
+            }
+            group_columns.push_back(col_idx);
+        }
+    }
+
+    // Each selected expression becomes a column of the view.
+    for (const hsql::Expr* expr : *query->selectList) {
+        Column column{};
+        ViewColumn view_column{};
+        std::string name;
+        if (expr->type == hsql::kExprColumnRef) {
+            const int col_idx = find_user_column(base, expr->name);
+            if (std::find(group_columns.begin(), group_columns.end(), col_idx) == group_columns.end()) {
+                err << "Error: Column '" << expr->name << "' must be in the GROUP BY of a materialized view." << std::endl;
+                return;
+            }
+            view_column = {ViewAggregate::GROUP_KEY, col_idx};
+            column.type = base->columns[col_idx].type;
+            name = expr->name;
+        } else if (expr->type == hsql::kExprFunctionRef && !expr->distinct && expr->exprList != nullptr &&
+                   expr->exprList->size() == 1) {
+            std::string function = expr->name;
+            std::transform(function.begin(), function.end(), function.begin(),
+                           [](unsigned char c) { return std::toupper(c); });
+            const hsql::Expr* arg = (*expr->exprList)[0];
+            const int col_idx = arg->type == hsql::kExprColumnRef ? find_user_column(base, arg->name) : -1;
+            if (function == "COUNT" && (arg->type == hsql::kExprStar || col_idx != -1)) {
+                // No value is ever NULL, so COUNT(column) counts every row as well.
+                view_column = {ViewAggregate::COUNT, -1};
+                column.type = DataType::BIGINT;
+                name = "count";
+            } else if (function == "SUM" && col_idx != -1 && base->columns[col_idx].type != DataType::DATE &&
+                       base->columns[col_idx].type != DataType::TIMESTAMP) {
+                view_column = {ViewAggregate::SUM, col_idx};
+                column.type = base->columns[col_idx].type == DataType::DOUBLE ? DataType::DOUBLE : DataType::BIGINT;
+                name = std::string("sum_") + arg->name;
+            }
+        }
+        if (name.empty()) {
+            err << "Error: A materialized view can only select its GROUP BY columns, COUNT(*) and SUM of a "
+                << "numeric column." << std::endl;
+            return;
+        }
+        if (expr->alias != nullptr) {
+            name = expr->alias;
+        }
+        if (name.size() >= sizeof(column.name) || name.rfind("__", 0) == 0) {
+            err << "Error: Invalid column name '" << name << "'." << std::endl;
+            return;
+        }
+        if (std::any_of(schema.columns.begin(), schema.columns.end(),
+                        [&name](const Column& c) { return name == c.name; })) {
+            err << "Error: Duplicate column name '" << name << "'; name it with AS." << std::endl;
+            return;
+        }
+        std::strncpy(column.name, name.c_str(), sizeof(column.name) - 1);
+        if (view_column.aggregate == ViewAggregate::GROUP_KEY && schema.sort_column == -1) {
+            // Folding writes the groups out in key order.
+            schema.sort_column = static_cast<int32_t>(schema.columns.size());
+        }
+        schema.columns.push_back(column);
+        schema.view_columns.push_back(view_column);
+    }
+    // COUNT(*) tells an empty group, which the view leaves out, from one whose sums are 0.
+    if (std::none_of(schema.view_columns.begin(), schema.view_columns.end(),
+                     [](const ViewColumn& c) { return c.aggregate == ViewAggregate::COUNT; })) {
+        err << "Error: A materialized view must select COUNT(*)." << std::endl;
+        return;
+    }
+    for (int col_idx : group_columns) {
+        if (std::none_of(schema.view_columns.begin(), schema.view_columns.end(),
+                         [col_idx](const ViewColumn& c) {
+                             return c.aggregate == ViewAggregate::GROUP_KEY && c.base_column == col_idx;
+                         })) {
+            err << "Error: A materialized view must select every GROUP BY column." << std::endl;
+            return;
+        }
+    }
+    if (!catalog_->CreateTable(schema)) {
+        err << "Error: Failed to create materialized view '" << view_name << "'." << std::endl;
+        return;
+    }
+
+    // Fill the view from the base table's rows. No other statement runs, so
+    // later changes to the table apply exactly on top of these.
+    const TableSchema* view = catalog_->GetTableSchema(view_name);
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    std::vector<ViewAggregator> groups;
+    groups.emplace_back(view);
+    std::optional<LsnFuture> commit;
+    try {
+        for (const TableSchema* target : scan_targets(base, {})) {
+            Table table(catalog_->GetTableHandle(target), bpm_, &txn->GetSnapshot());
+            for (const auto& tuple : table) {
+                groups[0].AddBaseRow(tuple, 1);
+            }
+        }
+        append_view_deltas(groups, txn.get(), &commit);
+        if (commit) {
+            log_commit(txn.get());
+        }
+    } catch (const std::exception& e) {
+        err << "Error: Failed to fill materialized view '" << view_name << "': " << e.what() << std::endl;
+        // Dropping the view takes its rows with it.
+        catalog_->DropTable(view_name);
+        txn_manager_->Abort(txn.get(), true);
+        return;
+    }
+    txn_manager_->Commit(txn.get());
+    out << "Materialized view '" << view_name << "' created." << std::endl;
+}
+
+size_t QueryExecutor::estimate_output_bytes(const std::vector<const TableSchema*>& targets, double sample_fraction) {
+    double bytes = 0;
+    for (const TableSchema* target : targets) {
+        const uint64_t rows = catalog_->GetTableHandle(target)->num_rows.load(std::memory_order_relaxed);
+        bytes += static_cast<double>(rows) * static_cast<double>(target->UserColumnCount()) *
+                 QUERY_OUTPUT_BYTES_PER_VALUE * sample_fraction;
+    }
+    // Whole blocks, at least one, and never more than the largest grant.
+    const double blocks = std::ceil(std::min(bytes, static_cast<double>(QUERY_MEMORY_GRANT)) / SPILL_BLOCK_SIZE);
+    return std::max<size_t>(1, static_cast<size_t>(blocks)) * SPILL_BLOCK_SIZE;
+}
+
+std::vector<const TableSchema*> QueryExecutor::scan_targets(const TableSchema* schema,
+                                                             const std::vector<ColumnRange>& ranges) {
+    if (!schema->IsPartitioned()) {
+        return {schema};
+    }
+    std::vector<const TableSchema*> partitions = catalog_->GetPartitions(schema);
+    auto range = std::find_if(ranges.begin(), ranges.end(),
+                              [schema](const ColumnRange& r) { return r.column == schema->partition_column; });
+    if (range == ranges.end()) {
+        return partitions;
+    }
+    std::vector<const TableSchema*> targets;
+    if (range->lo > range->hi) {
+        return targets;
+    }
+    if (schema->partition_kind == PartitionKind::RANGE) {
+        for (const TableSchema* partition : partitions) {
+            if (partition->partition_lo <= range->hi && range->lo <= partition->partition_hi) {
+                targets.push_back(partition);
+            }
+        }
+        return targets;
+    }
+
+    // Hashing scatters a range, so only one with fewer values than buckets prunes anything.
+    if (static_cast<uint64_t>(range->hi) - static_cast<uint64_t>(range->lo) >= schema->partition_count) {
+        return partitions;
+    }
+    std::vector<bool> buckets(schema->partition_count, false);
+    for (int64_t value = range->lo;; ++value) {
+        buckets[schema->PartitionKey(value)] = true;
+        if (value == range->hi) {
+            break;
+        }
+    }
+    for (const TableSchema* partition : partitions) {
+        if (buckets[partition->partition_lo]) {
+            targets.push_back(partition);
+        }
+    }
+    return targets;
+}
+
+const TableSchema* QueryExecutor::find_partition(const TableSchema* schema,
+                                                 const std::vector<const TableSchema*>& partitions, int64_t value) {
+    // The partitions do not overlap, so only the last one starting at or below the key can hold it.
+    const int64_t key = schema->PartitionKey(value);
+    auto it = std::upper_bound(partitions.begin(), partitions.end(), key,
+                               [](int64_t k, const TableSchema* partition) { return k < partition->partition_lo; });
+    if (it == partitions.begin() || key > (*std::prev(it))->partition_hi) {
+        return nullptr;
+    }
+    return *std::prev(it);
+}
+
+bool QueryExecutor::check_writable(const TableSchema* schema, std::ostream& err) {
+    if (schema->IsView()) {
+        const TableSchema* base = catalog_->GetTableSchema(schema->view_base_table_id);
+        err << "Error: Table '" << schema->name << "' is a materialized view; it changes only with table '"
+            << (base != nullptr ? base->name : "") << "'." << std::endl;
+        return false;
+    }
+    if (!schema->IsPartition()) {
+        return true;
+    }
+    const TableSchema* parent = catalog_->GetTableSchema(schema->parent_table_id);
+    err << "Error: Table '" << schema->name << "' is a partition; write to table '"
+        << (parent != nullptr ? parent->name : "") << "' instead." << std::endl;
+    return false;
+}
+
+std::vector<ViewAggregator> QueryExecutor::view_deltas(const TableSchema* schema) {
+    const TableSchema* base = schema->IsPartition() ? catalog_->GetTableSchema(schema->parent_table_id) : schema;
+    std::vector<ViewAggregator> deltas;
+    if (base != nullptr) {
+        for (const TableSchema* view : catalog_->GetViews(base)) {
+            deltas.emplace_back(view);
+        }
+    }
+    return deltas;
+}
+
+void QueryExecutor::append_view_deltas(const std::vector<ViewAggregator>& deltas, Transaction* txn,
+                                       std::optional<LsnFuture>* commit) {
+    for (const ViewAggregator& delta : deltas) {
+        const std::vector<std::vector<int64_t>> rows = delta.Rows(true);
+        if (rows.empty()) {
+            continue;
+        }
+        const TableSchema* view = delta.GetView();
+        std::vector<std::vector<int64_t>> columns(view->columns.size());
+        for (const auto& row : rows) {
+            for (size_t c = 0; c < row.size(); ++c) {
+                columns[c].push_back(row[c]);
+            }
+        }
+        columns[view->XminColumn()].assign(rows.size(), txn->GetId());
+        columns[view->XmaxColumn()].assign(rows.size(), INVALID_TXN_ID);
+        Table table(catalog_->GetTableHandle(view), bpm_);
+        *commit = append_batches(&table, txn, columns);
+    }
+}
+
+void QueryExecutor::bump_versions(const TableSchema* schema) {
+    const TableSchema* base = schema->IsPartition() ? catalog_->GetTableSchema(schema->parent_table_id) : schema;
+    result_cache_.BumpVersion(schema->table_id);
+    if (base == nullptr) {
+        return;
+    }
+    result_cache_.BumpVersion(base->table_id);
+    if (base->IsPartitioned()) {
+        for (const TableSchema* partition : catalog_->GetPartitions(base)) {
+            result_cache_.BumpVersion(partition->table_id);
+        }
+    }
+    for (const TableSchema* view : catalog_->GetViews(base)) {
+        result_cache_.BumpVersion(view->table_id);
+    }
+}
+
+LsnFuture QueryExecutor::append_batches(Table* table, Transaction* txn,
+                                        const std::vector<std::vector<int64_t>>& columns) {
+    // Log records must fit in the log buffer; a varint takes at most 10 bytes.
+    const size_t max_batch_rows = std::max<size_t>(1, LOG_BUFFER_SIZE / 2 / (10 * columns.size()));
+    const size_t rows = columns[0].size();
+    std::optional<LsnFuture> logged;
+    for (size_t start = 0; start < rows; start += max_batch_rows) {
+        size_t end = std::min(rows, start + max_batch_rows);
+        std::vector<std::vector<int64_t>> batch;
+        for (const auto& column : columns) {
+            batch.emplace_back(column.begin() + start, column.begin() + end);
+        }
+        std::unique_lock<std::mutex> append_lock = table->LockAppends();
+        LogRecord log_record(LogRecordType::INSERT_BATCH, table->GetSchema()->table_id, table->GetNumRows(),
+                             std::move(batch));
+        logged = log_manager_->AppendLogRecord(log_record);
+        if (!table->AppendRows(log_record.GetColumns(), logged->lsn())) {
+            // The rows already logged stay in the table, invisible: their xmin aborts.
+            throw std::runtime_error("Failed to append rows to table '" + std::string(table->GetSchema()->name) + "'.");
+        }
+        txn->RecordInsert(log_record.GetTableId(), log_record.GetFirstRowId(), end - start);
+    }
+    return *logged;
+}
+
+void QueryExecutor::print_header(const TableSchema* schema, std::ostream& out) {
+    for (size_t i = 0; i < schema->UserColumnCount(); ++i) {
+        out << schema->columns[i].name << "\t";
+    }
+    out << std::endl;
+    for (size_t i = 0; i < schema->UserColumnCount(); ++i) {
+        out << "------\t";
+    }
+    out << std::endl;
+}
+
+void QueryExecutor::run_parallel(const std::vector<const TableSchema*>& targets,
+                                 const std::function<void(size_t)>& fn) const {
+    const size_t count = targets.size();
+    const size_t nodes = bpm_->IsNumaAware() ? NumaTopology::Get().NodeCount() : 1;
+    // The targets of each node, claimed in order through next[node].
+    std::vector<std::vector<size_t>> queues(nodes);
+    for (size_t i = 0; i < count; ++i) {
+        queues[static_cast<size_t>(targets[i]->table_id) % nodes].push_back(i);
+    }
+    std::vector<std::atomic<size_t>> next(nodes);
+    auto work = [&](size_t home) {
+        // This node's targets first, then whatever the other nodes have left.
+        for (size_t k = 0; k < nodes; ++k) {
+            const size_t node = (home + k) % nodes;
+            for (size_t i = next[node]++; i < queues[node].size(); i = next[node]++) {
+                fn(queues[node][i]);
+            }
+        }
+    };
+    // Across nodes, every scan runs on a pinned helper and the calling thread,
+    // which must not be left pinned, only waits. Otherwise it scans too.
+    std::vector<std::future<void>> helpers;
+    for (size_t t = nodes > 1 ? 0 : 1; t < std::min(count, PARTITION_SCAN_THREADS); ++t) {
+        helpers.push_back(std::async(std::launch::async, [&, t]() {
+            if (nodes > 1) {
+                NumaTopology::Get().PinThread(static_cast<int>(t % nodes));
+            }
+            work(t % nodes);
+        }));
+    }
+    if (nodes == 1) {
+        work(0);
+    }
+    for (auto& helper : helpers) {
+        helper.get();
+    }
+}
+
+OperatorProfile* QueryExecutor::add_operator(QueryProfile* profile, std::string name) {
+    return profile != nullptr ? profile->AddOperator(std::move(name)) : nullptr;
+}
+
+void QueryExecutor::ExecuteSelect(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                  QueryProfile* profile, MemoryGrant* memory, double sample_fraction) {
+    const auto* select_stmt = static_cast<const hsql::SelectStatement*>(statement);
+    
+    const char* table_name = select_stmt->fromTable->getName();
+    if (table_name == nullptr) {
+        err << "Error: SELECT must be from a table." << std::endl;
+        return;
+    }
+
+    const TableSchema* schema = catalog_->GetTableSchema(table_name);
+    if (schema == nullptr) {
+        err << "Error: Table '" << table_name << "' not found." << std::endl;
+        return;
+    }
+    if (schema->IsView()) {
+        ExecuteSelectView(select_stmt, schema, out, err, profile);
+        return;
+    }
+
+    std::function<bool(const std::vector<int64_t>&)> predicate;
+    std::vector<ColumnRange> ranges;
+    if (!BuildPredicate(select_stmt->whereClause, schema, &predicate, &ranges, err)) {
+        return;
+    }
+    std::vector<int> distinct_columns;
+    if (!approx_distinct_columns(select_stmt, schema, &distinct_columns, err)) {
+        return;
+    }
+
+    // A partitioned table is read through the partitions the WHERE clause
+    // leaves, in parallel. Each scans into its own buffer, printed in order,
+    // or into its own sketches, merged at the end. The buffers share the
+    // statement's memory grant, and spill to disk once it runs out. Only
+    // such a scan buffers rows, so only it waits for a grant of its own.
+    const std::vector<const TableSchema*> targets = scan_targets(schema, ranges);
+    std::unique_ptr<MemoryGrant> own_memory;
+    if (memory == nullptr && targets.size() > 1 && profile == nullptr && distinct_columns.empty()) {
+        own_memory = memory_manager_.Admit(estimate_output_bytes(targets, sample_fraction));
+        memory = own_memory.get();
+    }
+
+    // The scan sees exactly the rows committed before it started, no matter
+    // how many inserts commit while it runs.
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    const Snapshot* snapshot = &txn->GetSnapshot();
+    struct TargetScan {
+        OperatorProfile* open_op;
+        OperatorProfile* scan_op;
+        OperatorProfile* filter_op;
+        uint64_t rows_scanned = 0;
+        uint64_t rows_matched = 0;
+        std::unique_ptr<SpillBuffer> buffer;
+        std::ostream output{nullptr};
+        std::vector<HyperLogLog> sketches;
+    };
+    std::vector<TargetScan> scans(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        scans[i].open_op = add_operator(profile, std::string("Open ") + targets[i]->name);
+        scans[i].scan_op = add_operator(profile, std::string("Scan ") + targets[i]->name);
+        scans[i].filter_op = select_stmt->whereClause != nullptr ? add_operator(profile, "Filter") : nullptr;
+        scans[i].sketches.resize(distinct_columns.size());
+        scans[i].buffer = std::make_unique<SpillBuffer>(memory);
+        scans[i].output.rdbuf(scans[i].buffer.get());
+    }
+    const uint64_t sample_seed = sample_fraction < 1 ? std::random_device{}() : 0;
+
+    if (profile == nullptr && distinct_columns.empty()) {
+        print_header(schema, out);
+    }
+
+    run_parallel(targets, [&](size_t target) {
+        TargetScan& scan = scans[target];
+        std::ostream& rows_out = targets.size() == 1 ? out : scan.output;
+        OperatorTimer open_timer(scan.open_op);
+        Table table(catalog_->GetTableHandle(targets[target]), bpm_, snapshot);
+        open_timer.Stop();
+
+        // Iterate and print tuples
+        OperatorTimer scan_timer(scan.scan_op);
+        if (sample_fraction < 1) {
+            table.SamplePages(sample_fraction, sample_seed + target);
+        }
+        {
+            // Match the columns a page at a time (or by binary search on a
+            // clustered table's sort key); the scan then skips the other rows.
+            OperatorTimer filter_timer(scan.filter_op);
+            for (const ColumnRange& range : ranges) {
+                table.FilterRange(range.column, range.lo, range.hi);
+            }
+        }
+        for (const auto& tuple : table) {
+            scan.rows_scanned++;
+            // Apply the predicate filter
+            bool matched;
+            {
+                OperatorTimer filter_timer(scan.filter_op);
+                matched = predicate(tuple);
+            }
+            if (matched) {
+                scan.rows_matched++;
+                for (size_t i = 0; i < distinct_columns.size(); ++i) {
+                    scan.sketches[i].Add(tuple[distinct_columns[i]]);
+                }
+                if (profile != nullptr || !distinct_columns.empty()) {
+                    continue;
+                }
+                for (size_t i = 0; i < tuple.size(); ++i) {
+                    rows_out << FormatValue(schema->columns[i].type, tuple[i]) << (i == tuple.size() - 1 ? "" : "\t");
+                }
+                rows_out << std::endl;
+            }
+        }
+    });
+
+    txn_manager_->Commit(txn.get());
+
+    uint64_t rows_scanned = 0;
+    uint64_t rows_matched = 0;
+    for (TargetScan& scan : scans) {
+        rows_scanned += scan.rows_scanned;
+        rows_matched += scan.rows_matched;
+        if (profile != nullptr) {
+            // The scan's time includes the filter's, which is reported on its own.
+            scan.scan_op->rows = scan.rows_scanned;
+            if (scan.filter_op != nullptr) {
+                scan.scan_op->time_ns -= std::min(scan.scan_op->time_ns, scan.filter_op->time_ns);
+                scan.filter_op->rows = scan.rows_matched;
+            }
+        } else if (targets.size() > 1 && !scan.buffer->WriteTo(out)) {
+            err << "Error: Failed to spill the rows of a partition to disk." << std::endl;
+        }
+    }
+    if (profile != nullptr) {
+        return;
+    }
+    if (!distinct_columns.empty()) {
+        for (size_t i = 0; i < distinct_columns.size(); ++i) {
+            out << "approx_count_distinct(" << schema->columns[distinct_columns[i]].name << ")\t";
+            for (size_t t = 1; t < scans.size(); ++t) {
+                scans[0].sketches[i].Merge(scans[t].sketches[i]);
+            }
+        }
+        out << std::endl;
+        for (size_t i = 0; i < distinct_columns.size(); ++i) {
+            out << "------\t";
+        }
+        out << std::endl;
+        for (size_t i = 0; i < distinct_columns.size(); ++i) {
+            out << (scans.empty() ? 0 : scans[0].sketches[i].Estimate()) << (i == distinct_columns.size() - 1 ? "" : "\t");
+        }
+        out << std::endl;
+    }
+    out << "--------------------" << std::endl;
+    out << "Matched " << rows_matched << " rows (scanned " << rows_scanned << " rows";
+    if (schema->IsPartitioned()) {
+        out << " in " << targets.size() << " of " << catalog_->GetPartitions(schema).size() << " partitions";
+    }
+    if (sample_fraction < 1) {
+        out << ", sampling " << sample_fraction * 100 << "% of pages";
+    }
+    out << ")." << std::endl;
+}
+
+bool QueryExecutor::approx_distinct_columns(const hsql::SelectStatement* select_stmt, const TableSchema* schema,
+                                            std::vector<int>* columns, std::ostream& err) {
+    columns->clear();
+    if (select_stmt->selectList == nullptr) {
+        return true;
+    }
+    size_t other_items = 0;
+    for (const hsql::Expr* expr : *select_stmt->selectList) {
+        std::string function = expr->type == hsql::kExprFunctionRef ? expr->name : "";
+        std::transform(function.begin(), function.end(), function.begin(),
+                       [](unsigned char c) { return std::toupper(c); });
+        if (function != "APPROX_COUNT_DISTINCT") {
+            other_items++;
+            continue;
+        }
+        const hsql::Expr* arg = expr->exprList != nullptr && expr->exprList->size() == 1 ? (*expr->exprList)[0] : nullptr;
+        const int col_idx = arg != nullptr && arg->type == hsql::kExprColumnRef ? find_user_column(schema, arg->name) : -1;
+        if (col_idx == -1) {
+            err << "Error: APPROX_COUNT_DISTINCT takes one column of table '" << schema->name << "'." << std::endl;
+            return false;
+        }
+        columns->push_back(col_idx);
+    }
+    if (!columns->empty() && other_items > 0) {
+        err << "Error: APPROX_COUNT_DISTINCT can only be selected along with other APPROX_COUNT_DISTINCT items."
+            << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void QueryExecutor::ExecuteSelectView(const hsql::SelectStatement* select_stmt, const TableSchema* schema,
+                                      std::ostream& out, std::ostream& err, QueryProfile* profile) {
+    std::function<bool(const std::vector<int64_t>&)> predicate;
+    std::vector<ColumnRange> ranges;
+    if (!BuildPredicate(select_stmt->whereClause, schema, &predicate, &ranges, err)) {
+        return;
+    }
+
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    OperatorTimer open_timer(add_operator(profile, std::string("Open ") + schema->name));
+    Table table(catalog_->GetTableHandle(schema), bpm_, &txn->GetSnapshot());
+    open_timer.Stop();
+
+    // Fold the rows committed before we started into one per group. Every row
+    // of a group holds its key, so conditions on the keys can skip rows before
+    // folding; the others only apply to the folded groups.
+    OperatorProfile* scan_op = add_operator(profile, std::string("Scan ") + schema->name);
+    OperatorTimer scan_timer(scan_op);
+    for (const ColumnRange& range : ranges) {
+        if (schema->view_columns[range.column].aggregate == ViewAggregate::GROUP_KEY) {
+            table.FilterRange(range.column, range.lo, range.hi);
+        }
+    }
+    ViewAggregator groups(schema);
+    uint64_t rows_scanned = 0;
+    for (const auto& tuple : table) {
+        rows_scanned++;
+        groups.AddViewRow(tuple);
+    }
+    scan_timer.Stop();
+    txn_manager_->Commit(txn.get());
+
+    OperatorProfile* fold_op = add_operator(profile, "Fold");
+    OperatorTimer fold_timer(fold_op);
+    std::vector<std::vector<int64_t>> rows = groups.Rows(false);
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [&](const std::vector<int64_t>& row) { return !predicate(row); }),
+               rows.end());
+    fold_timer.Stop();
+    if (profile != nullptr) {
+        scan_op->rows = rows_scanned;
+        fold_op->rows = rows.size();
+        return;
+    }
+
+    print_header(schema, out);
+    for (const auto& row : rows) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            out << FormatValue(schema->columns[i].type, row[i]) << (i == row.size() - 1 ? "" : "\t");
+        }
+        out << std::endl;
+    }
+    out << "--------------------" << std::endl;
+    out << "Matched " << rows.size() << " rows (scanned " << rows_scanned << " rows)." << std::endl;
+}
+
+void QueryExecutor::ExecuteCreate(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                  QueryProfile* profile) {
+    const auto* create_stmt = static_cast<const hsql::CreateStatement*>(statement);
+    if (create_stmt->type != hsql::kCreateTable || create_stmt->columns == nullptr) {
+        err << "Error: Only CREATE TABLE with a column list is supported." << std::endl;
+        return;
+    }
+
+    const char* table_name = create_stmt->tableName;
+    if (catalog_->GetTableSchema(table_name) != nullptr) {
+        if (!create_stmt->ifNotExists) {
+            err << "Error: Table '" << table_name << "' already exists." << std::endl;
+        }
+        return;
+    }
+
+    TableSchema schema{};
+    if (std::strlen(table_name) >= sizeof(schema.name)) {
+        err << "Error: Table name '" << table_name << "' is too long." << std::endl;
+        return;
+    }
+    std::strncpy(schema.name, table_name, sizeof(schema.name) - 1);
+
+    for (const auto* def : *create_stmt->columns) {
+        Column col{};
+        if (std::strlen(def->name) >= sizeof(col.name) || std::strncmp(def->name, "__", 2) == 0) {
+            err << "Error: Invalid column name '" << def->name << "'." << std::endl;
+            return;
+        }
+        for (const auto& existing : schema.columns) {
+            if (std::strcmp(existing.name, def->name) == 0) {
+                err << "Error: Duplicate column name '" << def->name << "'." << std::endl;
+                return;
+            }
+        }
+        switch (def->type.data_type) {
+            case hsql::DataType::BIGINT:
+            case hsql::DataType::LONG: col.type = DataType::BIGINT; break;
+            case hsql::DataType::INT: col.type = DataType::INT32; break;
+            case hsql::DataType::SMALLINT: col.type = DataType::INT16; break;
+            case hsql::DataType::BOOLEAN: col.type = DataType::INT8; break;
+            case hsql::DataType::DOUBLE:
+            case hsql::DataType::FLOAT:
+            case hsql::DataType::REAL: col.type = DataType::DOUBLE; break;
+            case hsql::DataType::DATE: col.type = DataType::DATE; break;
+            case hsql::DataType::DATETIME: col.type = DataType::TIMESTAMP; break;
+            default:
+                err << "Error: Column '" << def->name << "' has an unsupported type. Supported types are BIGINT, "
+                    << "INT, SMALLINT, BOOLEAN, DOUBLE, DATE and DATETIME." << std::endl;
+                return;
+        }
+        std::strncpy(col.name, def->name, sizeof(col.name) - 1);
+        schema.columns.push_back(col);
+    }
+    if (schema.columns.size() + MVCC_COLUMN_COUNT > Catalog::MaxColumnCount()) {
+        err << "Error: A table can have at most " << Catalog::MaxColumnCount() - MVCC_COLUMN_COUNT << " columns." << std::endl;
+        return;
+    }
+
+    OperatorTimer create_timer(add_operator(profile, std::string("Create ") + table_name));
+    if (!catalog_->CreateTable(schema)) {
+        err << "Error: Failed to create table '" << table_name << "'." << std::endl;
+        return;
+    }
+    out << "Table '" << table_name << "' created." << std::endl;
+}
+
+void QueryExecutor::ExecuteDrop(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                QueryProfile* profile) {
+    const auto* drop_stmt = static_cast<const hsql::DropStatement*>(statement);
+    if (drop_stmt->type != hsql::kDropTable) {
+        err << "Error: Only DROP TABLE is supported." << std::endl;
+        return;
+    }
+
+    const TableSchema* schema = catalog_->GetTableSchema(drop_stmt->name);
+    if (schema == nullptr) {
+        if (!drop_stmt->ifExists) {
+            err << "Error: Table '" << drop_stmt->name << "' not found." << std::endl;
+        }
+        return;
+    }
+    // Every value hashes to some bucket, so a hash partition cannot go on its own.
+    const TableSchema* parent = schema->IsPartition() ? catalog_->GetTableSchema(schema->parent_table_id) : nullptr;
+    if (parent != nullptr && parent->partition_kind == PartitionKind::HASH) {
+        err << "Error: Table '" << drop_stmt->name << "' is a hash partition; drop table '" << parent->name
+            << "' instead." << std::endl;
+        return;
+    }
+    OperatorTimer drop_timer(add_operator(profile, std::string("Drop ") + drop_stmt->name));
+    bump_versions(schema);
+    if (!catalog_->DropTable(drop_stmt->name)) {
+        err << "Error: Failed to drop table '" << drop_stmt->name << "'." << std::endl;
+        return;
+    }
+    out << "Table '" << drop_stmt->name << "' dropped." << std::endl;
+}
+
+void QueryExecutor::ExecuteExport(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                  QueryProfile* profile) {
+    const auto* export_stmt = static_cast<const hsql::ExportStatement*>(statement);
+    if (export_stmt->select != nullptr || export_stmt->tableName == nullptr) {
+        err << "Error: Only whole tables can be exported." << std::endl;
+        return;
+    }
+    if (export_stmt->type != hsql::kImportAuto && export_stmt->type != hsql::kImportBinary) {
+        err << "Error: Tables can only be exported to columnar files." << std::endl;
+        return;
+    }
+    const TableSchema* schema = catalog_->GetTableSchema(export_stmt->tableName);
+    if (schema == nullptr) {
+        err << "Error: Table '" << export_stmt->tableName << "' not found." << std::endl;
+        return;
+    }
+    if (schema->IsView()) {
+        // Its rows are partial aggregates, not the view's value.
+        err << "Error: Table '" << export_stmt->tableName << "' is a materialized view and cannot be exported."
+            << std::endl;
         return;
     }
 
-    const TableSchema* schema = catalog_->GetTableSchema(table_name);
+    // The file holds exactly the rows committed before the export started.
+    // A partitioned table is written as its partitions, one after another.
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    const Snapshot& snapshot = txn->GetSnapshot();
+    const std::vector<const TableSchema*> targets = scan_targets(schema, {});
+    OperatorTimer open_timer(add_operator(profile, std::string("Open ") + export_stmt->tableName));
+    std::vector<std::unique_ptr<Table>> tables;
+    for (const TableSchema* target : targets) {
+        tables.push_back(std::make_unique<Table>(catalog_->GetTableHandle(target), bpm_, &snapshot));
+    }
+    open_timer.Stop();
+
+    OperatorProfile* visibility_op = add_operator(profile, "Check visibility");
+    OperatorTimer visibility_timer(visibility_op);
+    std::vector<std::vector<bool>> visible;
+    uint64_t row_count = 0;
+    for (const auto& table : tables) {
+        std::vector<bool>& table_visible = visible.emplace_back(table->GetNumRows(), true);
+        table->ForEachColumnPage(schema->XminColumn(), [&](uint64_t first_row, const int64_t* values, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                if (!snapshot.IsCommitted(values[i])) {
+                    table_visible[first_row + i] = false;
+                }
+            }
+        });
+        table->ForEachColumnPage(schema->XmaxColumn(), [&](uint64_t first_row, const int64_t* values, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                if (values[i] != INVALID_TXN_ID && snapshot.IsCommitted(values[i])) {
+                    table_visible[first_row + i] = false;
+                }
+            }
+        });
+        row_count += static_cast<uint64_t>(std::count(table_visible.begin(), table_visible.end(), true));
+    }
+    visibility_timer.Stop();
+    if (visibility_op != nullptr) {
+        visibility_op->rows = row_count;
+    }
+
+    OperatorProfile* write_op = add_operator(profile, std::string("Write ") + export_stmt->filePath);
+    try {
+        OperatorTimer write_timer(write_op);
+        std::vector<Column> columns(schema->columns.begin(), schema->columns.begin() + schema->UserColumnCount());
+        ColumnarFileWriter writer(export_stmt->filePath, std::move(columns));
+        // Stream each column chain a page at a time, dropping the invisible rows.
+        std::vector<int64_t> page_values;
+        for (size_t c = 0; c < schema->UserColumnCount(); ++c) {
+            page_values.reserve(ColumnPageCapacity(schema->columns[c].type));
+            writer.BeginColumn(c);
+            for (size_t t = 0; t < tables.size(); ++t) {
+                tables[t]->ForEachColumnPage(c, [&](uint64_t first_row, const int64_t* values, uint32_t count) {
+                    page_values.clear();
+                    for (uint32_t i = 0; i < count; ++i) {
+                        if (visible[t][first_row + i]) {
+                            page_values.push_back(values[i]);
+                        }
+                    }
+                    writer.Append(page_values.data(), page_values.size());
+                });
+            }
+        }
+        writer.Finish();
+        if (write_op != nullptr) {
+            write_op->rows = row_count;
+        }
+    } catch (const std::exception& e) {
+        err << "Error: Export failed: " << e.what() << std::endl;
+        abort(txn.get(), err);
+        return;
+    }
+    txn_manager_->Commit(txn.get());
+    out << "Exported " << row_count << " rows to '" << export_stmt->filePath << "'." << std::endl;
+}
+
+void QueryExecutor::ExecuteImport(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                  QueryProfile* profile) {
+    const auto* import_stmt = static_cast<const hsql::ImportStatement*>(statement);
+    if (import_stmt->type != hsql::kImportAuto && import_stmt->type != hsql::kImportBinary) {
+        err << "Error: Tables can only be imported from columnar files." << std::endl;
+        return;
+    }
+    const TableSchema* schema = catalog_->GetTableSchema(import_stmt->tableName);
     if (schema == nullptr) {
-        std::cerr << "Error: Table '" << table_name << "' not found." << std::endl;
+        err << "Error: Table '" << import_stmt->tableName << "' not found." << std::endl;
+        return;
+    }
+    if (!check_writable(schema, err)) {
+        return;
+    }
+
+    std::unique_ptr<ColumnarFileReader> reader;
+    try {
+        reader = std::make_unique<ColumnarFileReader>(import_stmt->filePath);
+    } catch (const std::exception& e) {
+        err << "Error: " << e.what() << std::endl;
+        return;
+    }
+    const std::vector<Column>& file_columns = reader->GetColumns();
+    bool columns_match = file_columns.size() == schema->UserColumnCount();
+    for (size_t c = 0; columns_match && c < file_columns.size(); ++c) {
+        columns_match = std::strcmp(file_columns[c].name, schema->columns[c].name) == 0 &&
+                        file_columns[c].type == schema->columns[c].type;
+    }
+    if (!columns_match) {
+        err << "Error: The columns of '" << import_stmt->filePath << "' do not match table '"
+                  << import_stmt->tableName << "'." << std::endl;
         return;
     }
 
-    // --- NEW PREDICATE LOGIC ---
+    // Every row is stamped with our transaction id, so the import becomes
+    // visible all at once when we commit, or not at all.
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    // The rows of a partitioned table go to the partitions that hold them,
+    // each opened when it first gets some.
+    std::vector<const TableSchema*> partitions;
+    std::map<const TableSchema*, std::unique_ptr<Table>> tables;
+    OperatorTimer open_timer(add_operator(profile, std::string("Open ") + import_stmt->tableName));
+    if (schema->IsPartitioned()) {
+        partitions = catalog_->GetPartitions(schema);
+    } else {
+        tables[schema] = std::make_unique<Table>(catalog_->GetTableHandle(schema), bpm_);
+    }
+    open_timer.Stop();
+    // Decoding runs ahead on another thread, so reading only counts the time spent waiting for it.
+    OperatorProfile* read_op = add_operator(profile, std::string("Read ") + import_stmt->filePath);
+    OperatorProfile* append_op = add_operator(profile, "Append");
+    OperatorProfile* commit_op = add_operator(profile, "Commit");
+
+    auto read_row_group = [&reader](size_t row_group) {
+        std::vector<std::vector<int64_t>> columns;
+        reader->ReadRowGroup(row_group, &columns);
+        return columns;
+    };
+
+    uint64_t imported = 0;
+    std::optional<LsnFuture> commit;
+    // The changes the rows make to the table's materialized views, appended once all are in.
+    std::vector<ViewAggregator> deltas = view_deltas(schema);
+    // Appends rows, given column-wise with their MVCC columns, to table `target`.
+    auto append_rows = [&](const TableSchema* target, const std::vector<std::vector<int64_t>>& columns) {
+        const size_t rows = columns[0].size();
+        if (rows == 0) {
+            return;
+        }
+        std::unique_ptr<Table>& table = tables[target];
+        if (table == nullptr) {
+            table = std::make_unique<Table>(catalog_->GetTableHandle(target), bpm_);
+        }
+        commit = append_batches(table.get(), txn.get(), columns);
+        imported += rows;
+        std::vector<int64_t> row(schema->UserColumnCount());
+        for (ViewAggregator& delta : deltas) {
+            for (size_t r = 0; r < rows; ++r) {
+                for (size_t c = 0; c < row.size(); ++c) {
+                    row[c] = columns[c][r];
+                }
+                delta.AddBaseRow(row, 1);
+            }
+        }
+    };
+    try {
+        // Decode the next row group while the current one is being appended.
+        std::future<std::vector<std::vector<int64_t>>> next;
+        if (reader->GetRowGroupCount() > 0) {
+            next = std::async(std::launch::async, read_row_group, 0);
+        }
+        for (size_t rg = 0; rg < reader->GetRowGroupCount(); ++rg) {
+            OperatorTimer read_timer(read_op);
+            std::vector<std::vector<int64_t>> columns = next.get();
+            read_timer.Stop();
+            if (rg + 1 < reader->GetRowGroupCount()) {
+                next = std::async(std::launch::async, read_row_group, rg + 1);
+            }
+            OperatorTimer append_timer(append_op);
+            const size_t rows = columns[0].size();
+            columns.emplace_back(rows, txn->GetId());    // __xmin
+            columns.emplace_back(rows, INVALID_TXN_ID);  // __xmax
+            if (!schema->IsPartitioned()) {
+                append_rows(schema, columns);
+                continue;
+            }
+
+            std::map<const TableSchema*, std::vector<std::vector<int64_t>>> routed;
+            const Column& partition_column = schema->columns[schema->partition_column];
+            for (size_t row = 0; row < rows; ++row) {
+                const int64_t value = columns[schema->partition_column][row];
+                const TableSchema* target = find_partition(schema, partitions, value);
+                if (target == nullptr) {
+                    throw std::runtime_error("No partition of the table holds value " +
+                                             FormatValue(partition_column.type, value) + " of column '" +
+                                             partition_column.name + "'.");
+                }
+                std::vector<std::vector<int64_t>>& target_columns = routed[target];
+                target_columns.resize(columns.size());
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    target_columns[c].push_back(columns[c][row]);
+                }
+            }
+            for (const auto& [target, target_columns] : routed) {
+                append_rows(target, target_columns);
+            }
+        }
+        append_view_deltas(deltas, txn.get(), &commit);
+        OperatorTimer commit_timer(commit_op);
+        if (commit) {
+            log_commit(txn.get());
+        }
+    } catch (const std::exception& e) {
+        err << "Error: Import failed: " << e.what() << std::endl;
+        abort(txn.get(), err);
+        return;
+    }
+    txn_manager_->Commit(txn.get());
+    bump_versions(schema);
+    if (profile != nullptr) {
+        read_op->rows = imported;
+        append_op->rows = imported;
+    }
+    out << "Imported " << imported << " rows from '" << import_stmt->filePath << "'." << std::endl;
+}
 
+bool QueryExecutor::BuildPredicate(const hsql::Expr* where, const TableSchema* schema,
+                                   std::function<bool(const std::vector<int64_t>&)>* predicate,
+                                   std::vector<ColumnRange>* ranges, std::ostream& err) {
     // A predicate is a function that takes a tuple and returns true if
     // it matches the WHERE clause, or false otherwise.
     // By default, it always returns true (matching all rows).
-    std::function<bool(const std::vector<int64_t>&)> predicate = 
-        // FIX for -Wunused-parameter: remove the variable name
-        [](const std::vector<int64_t>&) { return true; };
-
-    if (select_stmt->whereClause != nullptr) {
-        // We have a WHERE clause. Let's try to parse it.
-        // We only support "column_name = integer_value" for now.
-        const hsql::Expr* where = select_stmt->whereClause;
-        
-        // FIX: Replaced 'expr1' with 'expr'
-        if (where->type == hsql::kExprOperator && where->opType == hsql::kOpEquals &&
-            where->expr->type == hsql::kExprColumnRef &&
-            where->expr2->type == hsql::kExprLiteralInt) {
-            
-            // FIX: Replaced 'expr1' with 'expr'
-            const char* col_name = where->expr->name;
-            int64_t value = where->expr2->ival;
-
-            // Find the column index from the schema
-            int col_idx = -1;
-            for (size_t i = 0; i < schema->columns.size(); ++i) {
-                if (std::strcmp(schema->columns[i].name, col_name) == 0) {
-                    col_idx = i;
-                    break;
+    *predicate = [](const std::vector<int64_t>&) { return true; };
+    ranges->clear();
+    if (where == nullptr) {
+        return true;
+    }
+    if (!add_condition(where, schema, ranges, err)) {
+        return false;
+    }
+
+    // Success! Update our predicate to perform the filter.
+    *predicate = [schema, conditions = *ranges](const std::vector<int64_t>& tuple) {
+        for (const ColumnRange& range : conditions) {
+            const int64_t value = tuple[range.column];
+            if (schema->columns[range.column].type == DataType::DOUBLE) {
+                const double d = std::bit_cast<double>(value);
+                if (!(std::bit_cast<double>(range.lo) <= d && d <= std::bit_cast<double>(range.hi))) {
+                    return false;
                 }
+            } else if (value < range.lo || value > range.hi) {
+                return false;
             }
+        }
+        return true;
+    };
+    return true;
+}
 
-            if (col_idx == -1) {
-                std::cerr << "Error: Column '" << col_name << "' not found in table '" << table_name << "'." << std::endl;
-                return;
-            }
+namespace {
+
+// The range holding every value of `type`, in int64_t form.
+std::pair<int64_t, int64_t> full_range(DataType type) {
+    if (type == DataType::DOUBLE) {
+        return {std::bit_cast<int64_t>(-std::numeric_limits<double>::infinity()),
+                std::bit_cast<int64_t>(std::numeric_limits<double>::infinity())};
+    }
+    return {std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()};
+}
 
-            // Success! Update our predicate to perform the filter.
-            predicate = [col_idx, value](const std::vector<int64_t>& tuple) {
-                return tuple[col_idx] == value;
-            };
+// Whether value `a` sorts before `b`, both of `type` in int64_t form.
+bool value_less(DataType type, int64_t a, int64_t b) {
+    return type == DataType::DOUBLE ? std::bit_cast<double>(a) < std::bit_cast<double>(b) : a < b;
+}
 
-        } else {
-            std::cerr << "Error: Unsupported WHERE clause. Only 'column_name = integer_value' is supported." << std::endl;
-            return;
+// Sets *next to the closest value of `type` above (or below, if !up) `value`.
+// Returns false if there is none.
+bool step(DataType type, int64_t value, bool up, int64_t* next) {
+    if (type == DataType::DOUBLE) {
+        const double d = std::bit_cast<double>(value);
+        const double limit = up ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+        if (d == limit) {
+            return false;
         }
+        *next = std::bit_cast<int64_t>(std::nextafter(d, limit));
+        return true;
+    }
+    if (value == (up ? std::numeric_limits<int64_t>::max() : std::numeric_limits<int64_t>::min())) {
+        return false;
     }
-    // --- END NEW PREDICATE LOGIC ---
+    *next = up ? value + 1 : value - 1;
+    return true;
+}
 
+} // namespace
 
-    Table table(schema, bpm_);
+bool QueryExecutor::add_condition(const hsql::Expr* expr, const TableSchema* schema, std::vector<ColumnRange>* ranges,
+                                  std::ostream& err) {
+    if (expr->type == hsql::kExprOperator && expr->opType == hsql::kOpAnd) {
+        return add_condition(expr->expr, schema, ranges, err) && add_condition(expr->expr2, schema, ranges, err);
+    }
+    auto unsupported = [&err]() {
+        err << "Error: Unsupported WHERE clause. Only comparisons of a column with a value (=, <, <=, >, >=, "
+            << "BETWEEN), joined by AND, are supported." << std::endl;
+        return false;
+    };
+    if (expr->type != hsql::kExprOperator || expr->expr == nullptr) {
+        return unsupported();
+    }
 
-    // Print headers
-    for (const auto& col : schema->columns) {
-        std::cout << col.name << "\t";
+    // "value < column" is "column > value".
+    hsql::OperatorType op = expr->opType;
+    const hsql::Expr* column_ref = expr->expr;
+    const hsql::Expr* operand = expr->expr2;
+    if (operand != nullptr && column_ref->type != hsql::kExprColumnRef && operand->type == hsql::kExprColumnRef) {
+        std::swap(column_ref, operand);
+        switch (op) {
+            case hsql::kOpLess: op = hsql::kOpGreater; break;
+            case hsql::kOpLessEq: op = hsql::kOpGreaterEq; break;
+            case hsql::kOpGreater: op = hsql::kOpLess; break;
+            case hsql::kOpGreaterEq: op = hsql::kOpLessEq; break;
+            default: break;
+        }
     }
-    std::cout << std::endl;
-    for (size_t i = 0; i < schema->columns.size(); ++i) {
-        std::cout << "------\t";
+    if (column_ref->type != hsql::kExprColumnRef) {
+        return unsupported();
     }
-    std::cout << std::endl;
 
-    // Iterate and print tuples
-    int rows_scanned = 0;
-    int rows_matched = 0;
-    for (const auto& tuple : table) {
-        rows_scanned++;
-        // Apply the predicate filter
-        if (predicate(tuple)) {
-            for (size_t i = 0; i < tuple.size(); ++i) {
-                std::cout << tuple[i] << (i == tuple.size() - 1 ? "" : "\t");
-            }
-            std::cout << std::endl;
-            rows_matched++;
+    // Find the column index from the schema
+    int col_idx = find_user_column(schema, column_ref->name);
+    if (col_idx == -1) {
+        err << "Error: Column '" << column_ref->name << "' not found in table '" << schema->name << "'." << std::endl;
+        return false;
+    }
+    const Column& column = schema->columns[col_idx];
+
+    auto [lo, hi] = full_range(column.type);
+    bool empty = false;
+    int64_t value;
+    if (op == hsql::kOpBetween) {
+        if (expr->exprList == nullptr || expr->exprList->size() != 2) {
+            return unsupported();
         }
+        if (!parse_value((*expr->exprList)[0], column, &lo, err) || !parse_value((*expr->exprList)[1], column, &hi, err)) {
+            return false;
+        }
+    } else if (operand == nullptr) {
+        return unsupported();
+    } else {
+        switch (op) {
+            case hsql::kOpEquals:
+            case hsql::kOpLess:
+            case hsql::kOpLessEq:
+            case hsql::kOpGreater:
+            case hsql::kOpGreaterEq:
+                break;
+            default:
+                return unsupported();
+        }
+        if (!parse_value(operand, column, &value, err)) {
+            return false;
+        }
+        switch (op) {
+            case hsql::kOpEquals: lo = hi = value; break;
+            case hsql::kOpGreaterEq: lo = value; break;
+            case hsql::kOpLessEq: hi = value; break;
+            case hsql::kOpGreater: empty = !step(column.type, value, true, &lo); break;
+            case hsql::kOpLess: empty = !step(column.type, value, false, &hi); break;
+            default: break;
+        }
+    }
+    if (empty) {
+        // Nothing lies beyond the largest (or below the smallest) value.
+        std::tie(hi, lo) = full_range(column.type);
+    }
+
+    // Conditions on the same column intersect.
+    for (ColumnRange& range : *ranges) {
+        if (range.column == col_idx) {
+            range.lo = value_less(column.type, range.lo, lo) ? lo : range.lo;
+            range.hi = value_less(column.type, hi, range.hi) ? hi : range.hi;
+            return true;
+        }
+    }
+    ranges->push_back({col_idx, lo, hi});
+    return true;
+}
+
+int QueryExecutor::find_user_column(const TableSchema* schema, const char* col_name) {
+    for (size_t i = 0; i < schema->UserColumnCount(); ++i) {
+        if (std::strcmp(schema->columns[i].name, col_name) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool QueryExecutor::parse_value(const hsql::Expr* expr, const Column& column, int64_t* value, std::ostream& err) {
+    // A negative number may arrive as a unary minus around the literal.
+    bool negate = false;
+    if (expr->type == hsql::kExprOperator && expr->opType == hsql::kOpUnaryMinus && expr->expr != nullptr) {
+        negate = true;
+        expr = expr->expr;
     }
 
-    std::cout << "--------------------" << std::endl;
-    std::cout << "Matched " << rows_matched << " rows (scanned " << rows_scanned << " rows)." << std::endl;
+    bool ok = false;
+    switch (column.type) {
+        case DataType::DOUBLE:
+            if (expr->type == hsql::kExprLiteralFloat || expr->type == hsql::kExprLiteralInt) {
+                double d = expr->type == hsql::kExprLiteralFloat ? expr->fval : static_cast<double>(expr->ival);
+                *value = std::bit_cast<int64_t>(negate ? -d : d);
+                ok = true;
+            }
+            break;
+        case DataType::DATE:
+        case DataType::TIMESTAMP:
+            ok = !negate && (expr->type == hsql::kExprLiteralString || expr->type == hsql::kExprLiteralDate) &&
+                 ParseDateTime(column.type, expr->name, value);
+            break;
+        default:
+            if (expr->type == hsql::kExprLiteralInt) {
+                *value = negate ? -expr->ival : expr->ival;
+                ok = FitsType(column.type, *value);
+            }
+            break;
+    }
+    if (!ok) {
+        err << "Error: Invalid " << TypeName(column.type) << " value for column '" << column.name << "'." << std::endl;
+    }
+    return ok;
 }
 
-// ... ExecuteInsert is unchanged ...
-void QueryExecutor::ExecuteInsert(const hsql::SQLStatement* statement) {
+bool QueryExecutor::parse_text_value(const std::string& text, const Column& column, int64_t* value,
+                                     std::ostream& err) {
+    bool ok = false;
+    if (column.type == DataType::DATE || column.type == DataType::TIMESTAMP) {
+        ok = text.size() >= 2 && text.front() == '\'' && text.back() == '\'' &&
+             ParseDateTime(column.type, text.substr(1, text.size() - 2), value);
+    } else if (column.type != DataType::DOUBLE) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), *value);
+        ok = result.ec == std::errc() && result.ptr == text.data() + text.size() && FitsType(column.type, *value);
+    }
+    if (!ok) {
+        err << "Error: Invalid " << TypeName(column.type) << " value for column '" << column.name << "'." << std::endl;
+    }
+    return ok;
+}
+
+void QueryExecutor::ExecuteInsert(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                  QueryProfile* profile) {
     const auto* insert_stmt = static_cast<const hsql::InsertStatement*>(statement);
 
     // Get table name
@@ -133,49 +1563,499 @@ void QueryExecutor::ExecuteInsert(const hsql::SQLStatement* statement) {
     // Get table schema from catalog
     const TableSchema* schema = catalog_->GetTableSchema(table_name);
     if (schema == nullptr) {
-        std::cerr << "Error: Table '" << table_name << "' not found." << std::endl;
+        err << "Error: Table '" << table_name << "' not found." << std::endl;
         return;
     }
 
-    // Create a Table instance
-    Table table(schema, bpm_);
+    if (!check_writable(schema, err)) {
+        return;
+    }
 
     // Validate value list
     if (insert_stmt->values == nullptr) {
-        std::cerr << "Error: INSERT statement must have a VALUES clause." << std::endl;
+        err << "Error: INSERT statement must have a VALUES clause." << std::endl;
         return;
     }
     
-    if (insert_stmt->values->size() != schema->columns.size()) {
-        std::cerr << "Error: Column count doesn't match value count." << std::endl;
+    if (insert_stmt->values->size() != schema->UserColumnCount()) {
+        err << "Error: Column count doesn't match value count." << std::endl;
         return;
     }
     
     // Parse values from the AST (Abstract Syntax Tree)
     std::vector<int64_t> tuple;
     for (const auto* expr : *insert_stmt->values) {
-        if (expr->type != hsql::kExprLiteralInt) {
-            std::cerr << "Error: Only integer literals are supported in INSERT statements." << std::endl;
+        int64_t value;
+        if (!parse_value(expr, schema->columns[tuple.size()], &value, err)) {
+            return;
+        }
+        tuple.push_back(value);
+    }
+
+    // A partitioned table's row goes to the partition that holds it.
+    const TableSchema* target = schema;
+    if (schema->IsPartitioned()) {
+        const int64_t value = tuple[schema->partition_column];
+        target = find_partition(schema, catalog_->GetPartitions(schema), value);
+        if (target == nullptr) {
+            const Column& column = schema->columns[schema->partition_column];
+            err << "Error: No partition of table '" << table_name << "' holds value "
+                << FormatValue(column.type, value) << " of column '" << column.name << "'." << std::endl;
             return;
         }
-        tuple.push_back(expr->ival);
     }
+    OperatorTimer open_timer(add_operator(profile, std::string("Open ") + target->name));
+    Table table(catalog_->GetTableHandle(target), bpm_);
+    open_timer.Stop();
 
-    LogRecord log_record(LogRecordType::INSERT_TUPLE, table_name, tuple);
+    // The row is stamped with our transaction id and stays invisible to
+    // other transactions until we commit.
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    tuple.push_back(txn->GetId());   // __xmin
+    tuple.push_back(INVALID_TXN_ID); // __xmax
+
+    // Appending only buffers the record; the flusher thread makes it durable
+    // as part of a batch while we apply the insert below.
+    OperatorProfile* insert_op = add_operator(profile, "Insert");
+    OperatorTimer insert_timer(insert_op);
+    // Concurrent inserts into the table take turns, so rows are logged in row id order.
+    std::unique_lock<std::mutex> append_lock = table.LockAppends();
+    LogRecord log_record(LogRecordType::INSERT_TUPLE, target->table_id, table.GetNumRows(), tuple);
+    std::optional<LsnFuture> commit;
     try {
-        log_manager_->AppendLogRecord(log_record);
+        commit = log_manager_->AppendLogRecord(log_record);
     } catch (const std::exception& e) {
-        std::cerr << "Error: Failed to append log record: " << e.what() << std::endl;
+        err << "Error: Failed to append log record: " << e.what() << std::endl;
+        abort(txn.get(), err);
+        return;
+    }
+
+    // Insert the tuple, stamping the touched pages with the record's LSN
+    if (!table.InsertTuple(tuple, commit->lsn())) {
+        err << "Error: Failed to insert tuple." << std::endl;
+        abort(txn.get(), err);
         return;
     }
+    txn->RecordInsert(target->table_id, log_record.GetFirstRowId(), 1);
+    append_lock.unlock();
 
+    insert_timer.Stop();
+    if (insert_op != nullptr) {
+        insert_op->rows = 1;
+    }
 
-    // Insert the tuple
-    if (table.InsertTuple(tuple)) {
-        std::cout << "Inserted 1 row." << std::endl;
-    } else {
-        std::cerr << "Error: Failed to insert tuple." << std::endl;
+    // Commit: don't acknowledge the row until its log record is on disk,
+    // along with what it changes in the table's materialized views.
+    try {
+        std::vector<ViewAggregator> deltas = view_deltas(schema);
+        for (ViewAggregator& delta : deltas) {
+            delta.AddBaseRow(tuple, 1);
+        }
+        append_view_deltas(deltas, txn.get(), &commit);
+        OperatorTimer commit_timer(add_operator(profile, "Commit"));
+        log_commit(txn.get());
+    } catch (const std::exception& e) {
+        err << "Error: Failed to commit insert: " << e.what() << std::endl;
+        abort(txn.get(), err);
+        return;
+    }
+    txn_manager_->Commit(txn.get());
+    bump_versions(schema);
+    out << "Inserted 1 row." << std::endl;
+}
+
+void QueryExecutor::ExecuteDelete(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                  QueryProfile* profile) {
+    const auto* delete_stmt = static_cast<const hsql::DeleteStatement*>(statement);
+
+    const TableSchema* schema = catalog_->GetTableSchema(delete_stmt->tableName);
+    if (schema == nullptr) {
+        err << "Error: Table '" << delete_stmt->tableName << "' not found." << std::endl;
+        return;
+    }
+    // Rows may be deleted from a partition directly, but not from a view.
+    if (schema->IsView() && !check_writable(schema, err)) {
+        return;
+    }
+    std::function<bool(const std::vector<int64_t>&)> predicate;
+    std::vector<ColumnRange> ranges;
+    if (!BuildPredicate(delete_stmt->expr, schema, &predicate, &ranges, err)) {
+        return;
+    }
+
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    const Snapshot* snapshot = &txn->GetSnapshot();
+    // The partitions of a partitioned table are scanned in parallel, like a SELECT's.
+    const std::vector<const TableSchema*> targets = scan_targets(schema, ranges);
+    std::vector<std::unique_ptr<Table>> tables(targets.size());
+    std::vector<std::vector<uint64_t>> row_ids(targets.size());
+    // The deleted rows are kept only to take them out of the table's materialized views.
+    std::vector<ViewAggregator> deltas = view_deltas(schema);
+    std::vector<std::vector<std::vector<int64_t>>> deleted_rows(targets.size());
+    std::vector<OperatorProfile*> scan_ops;
+    for (const TableSchema* target : targets) {
+        scan_ops.push_back(add_operator(profile, std::string("Scan ") + target->name));
+    }
+    run_parallel(targets, [&](size_t target) {
+        OperatorTimer scan_timer(scan_ops[target]);
+        tables[target] = std::make_unique<Table>(catalog_->GetTableHandle(targets[target]), bpm_, snapshot);
+        Table& table = *tables[target];
+        for (const ColumnRange& range : ranges) {
+            table.FilterRange(range.column, range.lo, range.hi);
+        }
+        uint64_t rows_scanned = 0;
+        for (auto it = table.begin(); it != table.end(); ++it) {
+            rows_scanned++;
+            if (predicate(*it)) {
+                row_ids[target].push_back(it.GetRowId());
+                if (!deltas.empty()) {
+                    deleted_rows[target].push_back(*it);
+                }
+            }
+        }
+        scan_timer.Stop();
+        if (scan_ops[target] != nullptr) {
+            scan_ops[target]->rows = rows_scanned;
+        }
+    });
+
+    // Undoes the deletes in the first `count` tables. Returns false if any undo failed.
+    auto undo = [&](size_t count) {
+        bool undone = true;
+        for (size_t t = 0; t < count; ++t) {
+            undone = undo_delete(tables[t].get(), row_ids[t], err) && undone;
+        }
+        return undone;
+    };
+    uint64_t deleted = 0;
+    std::optional<LsnFuture> commit;
+    OperatorProfile* delete_op = add_operator(profile, "Delete");
+    OperatorTimer delete_timer(delete_op);
+    for (size_t t = 0; t < tables.size(); ++t) {
+        if (row_ids[t].empty()) {
+            continue;
+        }
+        std::optional<LsnFuture> logged = delete_rows(tables[t].get(), txn.get(), row_ids[t], err);
+        if (!logged) {
+            abort(txn.get(), err, undo(t));
+            return;
+        }
+        commit = std::move(logged);
+        deleted += row_ids[t].size();
+    }
+    delete_timer.Stop();
+    if (delete_op != nullptr) {
+        delete_op->rows = deleted;
+    }
+
+    // Commit once anything was deleted, with the view changes logged after the deletes.
+    if (commit) {
+        try {
+            for (ViewAggregator& delta : deltas) {
+                for (const auto& rows : deleted_rows) {
+                    for (const auto& row : rows) {
+                        delta.AddBaseRow(row, -1);
+                    }
+                }
+            }
+            append_view_deltas(deltas, txn.get(), &commit);
+            OperatorTimer commit_timer(add_operator(profile, "Commit"));
+            log_commit(txn.get());
+        } catch (const std::exception& e) {
+            err << "Error: Failed to commit delete: " << e.what() << std::endl;
+            abort(txn.get(), err, undo(tables.size()));
+            return;
+        }
+    }
+    txn_manager_->Commit(txn.get());
+    bump_versions(schema);
+    out << "Deleted " << deleted << " rows." << std::endl;
+}
+
+void QueryExecutor::ExecuteUpdate(const hsql::SQLStatement* statement, std::ostream& out, std::ostream& err,
+                                  QueryProfile* profile) {
+    const auto* update_stmt = static_cast<const hsql::UpdateStatement*>(statement);
+
+    const char* table_name = update_stmt->table->getName();
+    const TableSchema* schema = catalog_->GetTableSchema(table_name);
+    if (schema == nullptr) {
+        err << "Error: Table '" << table_name << "' not found." << std::endl;
+        return;
+    }
+    if (!check_writable(schema, err)) {
+        return;
+    }
+
+    // Resolve the SET list up front: (column index, new value).
+    std::vector<std::pair<int, int64_t>> assignments;
+    for (const auto* update : *update_stmt->updates) {
+        int col_idx = find_user_column(schema, update->column);
+        if (col_idx == -1) {
+            err << "Error: Column '" << update->column << "' not found in table '" << table_name << "'." << std::endl;
+            return;
+        }
+        int64_t value;
+        if (!parse_value(update->value, schema->columns[col_idx], &value, err)) {
+            return;
+        }
+        assignments.emplace_back(col_idx, value);
+    }
+    std::function<bool(const std::vector<int64_t>&)> predicate;
+    std::vector<ColumnRange> ranges;
+    if (!BuildPredicate(update_stmt->where, schema, &predicate, &ranges, err)) {
+        return;
+    }
+
+    std::unique_ptr<Transaction> txn = txn_manager_->Begin();
+    const Snapshot* snapshot = &txn->GetSnapshot();
+
+    // An update is a delete of the old versions plus an insert of the new ones.
+    // The partitions of a partitioned table are scanned in parallel, like a SELECT's.
+    const std::vector<const TableSchema*> targets = scan_targets(schema, ranges);
+    std::vector<std::unique_ptr<Table>> tables(targets.size());
+    std::vector<std::vector<uint64_t>> row_ids(targets.size());
+    std::vector<std::vector<std::vector<int64_t>>> new_rows(targets.size());
+    // The old versions are kept only to take them out of the table's materialized views.
+    std::vector<ViewAggregator> deltas = view_deltas(schema);
+    std::vector<std::vector<std::vector<int64_t>>> old_rows(targets.size());
+    std::vector<OperatorProfile*> scan_ops;
+    for (const TableSchema* target : targets) {
+        scan_ops.push_back(add_operator(profile, std::string("Scan ") + target->name));
+    }
+    run_parallel(targets, [&](size_t target) {
+        OperatorTimer scan_timer(scan_ops[target]);
+        tables[target] = std::make_unique<Table>(catalog_->GetTableHandle(targets[target]), bpm_, snapshot);
+        Table& table = *tables[target];
+        for (const ColumnRange& range : ranges) {
+            table.FilterRange(range.column, range.lo, range.hi);
+        }
+        uint64_t rows_scanned = 0;
+        for (auto it = table.begin(); it != table.end(); ++it) {
+            rows_scanned++;
+            std::vector<int64_t> tuple = *it;
+            if (predicate(tuple)) {
+                row_ids[target].push_back(it.GetRowId());
+                if (!deltas.empty()) {
+                    old_rows[target].push_back(tuple);
+                }
+                for (const auto& [col_idx, value] : assignments) {
+                    tuple[col_idx] = value;
+                }
+                new_rows[target].push_back(std::move(tuple));
+            }
+        }
+        scan_timer.Stop();
+        if (scan_ops[target] != nullptr) {
+            scan_ops[target]->rows = rows_scanned;
+        }
+    });
+
+    // Place the new versions, column-wise, in the tables that hold them: the
+    // table itself, or the partition their (possibly updated) key falls in.
+    std::vector<const TableSchema*> partitions;
+    if (schema->IsPartitioned()) {
+        partitions = catalog_->GetPartitions(schema);
+    }
+    std::map<const TableSchema*, std::vector<std::vector<int64_t>>> inserts;
+    uint32_t row_count = 0;
+    for (auto& rows : new_rows) {
+        for (auto& tuple : rows) {
+            const TableSchema* target = schema;
+            if (schema->IsPartitioned()) {
+                const int64_t value = tuple[schema->partition_column];
+                target = find_partition(schema, partitions, value);
+                if (target == nullptr) {
+                    const Column& column = schema->columns[schema->partition_column];
+                    err << "Error: No partition of table '" << table_name << "' holds value "
+                        << FormatValue(column.type, value) << " of column '" << column.name << "'." << std::endl;
+                    abort(txn.get(), err);
+                    return;
+                }
+            }
+            for (ViewAggregator& delta : deltas) {
+                delta.AddBaseRow(tuple, 1);
+            }
+            tuple.push_back(txn->GetId());   // __xmin
+            tuple.push_back(INVALID_TXN_ID); // __xmax
+            std::vector<std::vector<int64_t>>& columns = inserts[target];
+            columns.resize(tuple.size());
+            for (size_t i = 0; i < tuple.size(); ++i) {
+                columns[i].push_back(tuple[i]);
+            }
+            row_count++;
+        }
+    }
+    if (row_count == 0) {
+        txn_manager_->Commit(txn.get());
+        out << "Updated 0 rows." << std::endl;
+        return;
+    }
+
+    // Undoes the deletes in the first `count` tables. Returns false if any undo failed.
+    auto undo = [&](size_t count) {
+        bool undone = true;
+        for (size_t t = 0; t < count; ++t) {
+            undone = undo_delete(tables[t].get(), row_ids[t], err) && undone;
+        }
+        return undone;
+    };
+
+    OperatorProfile* delete_op = add_operator(profile, "Delete");
+    OperatorTimer delete_timer(delete_op);
+    for (size_t t = 0; t < tables.size(); ++t) {
+        if (!row_ids[t].empty() && !delete_rows(tables[t].get(), txn.get(), row_ids[t], err)) {
+            abort(txn.get(), err, undo(t));
+            return;
+        }
+    }
+    delete_timer.Stop();
+    OperatorProfile* insert_op = add_operator(profile, "Insert");
+    OperatorTimer insert_timer(insert_op);
+    if (profile != nullptr) {
+        delete_op->rows = row_count;
+        insert_op->rows = row_count;
+    }
+
+    // Log each table's new versions in batches that fit the log buffer.
+    std::optional<LsnFuture> commit;
+    for (const auto& [target, columns] : inserts) {
+        Table table(catalog_->GetTableHandle(target), bpm_);
+        try {
+            commit = append_batches(&table, txn.get(), columns);
+        } catch (const std::exception& e) {
+            err << "Error: Failed to insert updated tuples: " << e.what() << std::endl;
+            abort(txn.get(), err, undo(tables.size()));
+            return;
+        }
+    }
+
+    insert_timer.Stop();
+
+    try {
+        for (ViewAggregator& delta : deltas) {
+            for (const auto& rows : old_rows) {
+                for (const auto& row : rows) {
+                    delta.AddBaseRow(row, -1);
+                }
+            }
+        }
+        append_view_deltas(deltas, txn.get(), &commit);
+        OperatorTimer commit_timer(add_operator(profile, "Commit"));
+        log_commit(txn.get());
+    } catch (const std::exception& e) {
+        err << "Error: Failed to commit update: " << e.what() << std::endl;
+        abort(txn.get(), err, undo(tables.size()));
+        return;
+    }
+    txn_manager_->Commit(txn.get());
+    bump_versions(schema);
+    out << "Updated " << row_count << " rows." << std::endl;
+}
+
+std::optional<LsnFuture> QueryExecutor::delete_rows(Table* table, Transaction* txn,
+                                                    const std::vector<uint64_t>& row_ids, std::ostream& err) {
+    // A record must only name rows this transaction marks, or replaying it
+    // would delete rows it never did; so check them all before logging any.
+    std::unique_lock<std::mutex> delete_lock = table->LockDeletes();
+    for (uint64_t row_id : row_ids) {
+        if (!table->CanDeleteRow(row_id)) {
+            err << "Error: Row " << row_id << " was changed by a concurrent transaction." << std::endl;
+            return std::nullopt;
+        }
+    }
+
+    // Row ids delta-encode to at most 10 bytes each; keep each record well
+    // inside the log buffer, as abort does.
+    const size_t max_record_rows = LOG_BUFFER_SIZE / 2 / 10;
+    std::optional<LsnFuture> logged;
+    for (size_t start = 0; start < row_ids.size(); start += max_record_rows) {
+        const size_t end = std::min(row_ids.size(), start + max_record_rows);
+        LogRecord log_record(LogRecordType::DELETE_ROWS, table->GetSchema()->table_id, txn->GetId(),
+                             std::vector<uint64_t>(row_ids.begin() + start, row_ids.begin() + end));
+        try {
+            logged = log_manager_->AppendLogRecord(log_record);
+        } catch (const std::exception& e) {
+            err << "Error: Failed to append log record: " << e.what() << std::endl;
+            undo_delete(table, std::vector<uint64_t>(row_ids.begin(), row_ids.begin() + start), err);
+            return std::nullopt;
+        }
+        for (size_t i = start; i < end; ++i) {
+            table->DeleteRow(row_ids[i], logged->lsn());
+        }
+    }
+    return logged;
+}
+
+void QueryExecutor::log_commit(Transaction* txn) {
+    log_manager_->AppendLogRecord(LogRecord(LogRecordType::COMMIT, txn->GetId())).Wait();
+}
+
+void QueryExecutor::abort(Transaction* txn, std::ostream& err, bool deletes_undone) {
+    // Row ids of a range delta-encode to a byte each; keep each record well
+    // inside the log buffer, as append_batches does.
+    const uint64_t max_record_rows = LOG_BUFFER_SIZE / 2 / 10;
+    bool undone = deletes_undone;
+    for (const Transaction::InsertedRows& inserted : txn->GetInserts()) {
+        const TableSchema* schema = catalog_->GetTableSchema(inserted.table_id);
+        if (schema == nullptr) {
+            continue; // Dropped, rows and all
+        }
+        Table table(catalog_->GetTableHandle(schema), bpm_, &txn->GetSnapshot());
+        try {
+            for (uint64_t start = 0; start < inserted.row_count; start += max_record_rows) {
+                const uint64_t count = std::min(max_record_rows, inserted.row_count - start);
+                std::vector<uint64_t> row_ids(count);
+                for (uint64_t i = 0; i < count; ++i) {
+                    row_ids[i] = inserted.first_row + start + i;
+                }
+                LogRecord log_record(LogRecordType::DELETE_ROWS, inserted.table_id, txn->GetId(), std::move(row_ids));
+                LsnFuture logged = log_manager_->AppendLogRecord(log_record);
+                table.UndoAppend(inserted.first_row + start, count, logged.lsn());
+            }
+        } catch (const std::exception& e) {
+            err << "Error: Failed to undo insert into table '" << schema->name << "': " << e.what() << std::endl;
+            undone = false;
+        }
+    }
+    // The statement reports failure once this returns, so the undo must last.
+    // Recovery rolls back a transaction with no COMMIT anyway; the ABORT
+    // record only tells it the undo is already in the log.
+    try {
+        log_manager_->AppendLogRecord(LogRecord(LogRecordType::ABORT, txn->GetId())).Wait();
+    } catch (const std::exception& e) {
+        err << "Error: Failed to log abort: " << e.what() << std::endl;
+        undone = false;
+    }
+    txn_manager_->Abort(txn, undone);
+}
+
+bool QueryExecutor::undo_delete(Table* table, const std::vector<uint64_t>& row_ids, std::ostream& err) {
+    if (row_ids.empty()) {
+        return true;
+    }
+    // Recovery rolls back a transaction with no COMMIT anyway, so the marks
+    // are cleared even if the compensating record cannot be logged.
+    const size_t max_record_rows = LOG_BUFFER_SIZE / 2 / 10;
+    try {
+        for (size_t start = 0; start < row_ids.size(); start += max_record_rows) {
+            const size_t end = std::min(row_ids.size(), start + max_record_rows);
+            lsn_t lsn = INVALID_LSN;
+            try {
+                LogRecord log_record(LogRecordType::DELETE_ROWS, table->GetSchema()->table_id, INVALID_TXN_ID,
+                                     std::vector<uint64_t>(row_ids.begin() + start, row_ids.begin() + end));
+                lsn = log_manager_->AppendLogRecord(log_record).lsn();
+            } catch (const std::exception& e) {
+                err << "Error: Failed to log undo of delete: " << e.what() << std::endl;
+            }
+            for (size_t i = start; i < end; ++i) {
+                table->UndeleteRow(row_ids[i], lsn);
+            }
+        }
+    } catch (const std::exception& e) {
+        err << "Error: Failed to undo delete: " << e.what() << std::endl;
+        return false;
     }
+    return true;
 }
 
-} // namespace db
\ No newline at end of file
+} // namespace db
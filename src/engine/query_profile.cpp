@@ -0,0 +1,47 @@
+#include "columnar_db/engine/query_profile.h"
+#include <iomanip>
+
+namespace db {
+
+namespace {
+
+double to_ms(uint64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+} // namespace
+
+QueryProfile::QueryProfile()
+    : start_(std::chrono::steady_clock::now()), start_metrics_(Metrics::CollectThread()) {}
+
+OperatorProfile* QueryProfile::AddOperator(std::string name) {
+    operators_.push_back(OperatorProfile{std::move(name), 0, 0});
+    return &operators_.back();
+}
+
+void QueryProfile::Finish() {
+    total_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    metrics_ = Metrics::CollectThread() - start_metrics_;
+}
+
+void QueryProfile::Print(std::ostream& out) const {
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    for (const auto& op : operators_) {
+        out << "  " << std::left << std::setw(32) << op.name << std::right << " rows=" << std::setw(10) << op.rows
+            << "  time=" << std::setw(10) << to_ms(op.time_ns) << " ms" << std::endl;
+    }
+    out << "Buffer pool: " << metrics_.Get(Counter::BUFFER_POOL_HITS) << " hits, "
+        << metrics_.Get(Counter::BUFFER_POOL_MISSES) << " misses, " << metrics_.Get(Counter::BUFFER_POOL_EVICTIONS)
+        << " evictions, " << metrics_.Get(Counter::BUFFER_POOL_WRITEBACKS) << " write-backs, "
+        << to_ms(metrics_.Get(Counter::BUFFER_POOL_PIN_WAIT_NS)) << " ms waiting" << std::endl;
+    out << "Disk: " << metrics_.Get(Counter::DISK_READS) << " reads (" << metrics_.Get(Counter::DISK_READ_BYTES)
+        << " bytes), " << metrics_.Get(Counter::DISK_WRITES) << " writes (" << metrics_.Get(Counter::DISK_WRITE_BYTES)
+        << " bytes)" << std::endl;
+    out << "Log: " << metrics_.Get(Counter::LOG_RECORDS) << " records (" << metrics_.Get(Counter::LOG_BYTES)
+        << " bytes)" << std::endl;
+    out << "Execution time: " << to_ms(total_ns_) << " ms" << std::endl;
+    out.flags(flags);
+}
+
+} // namespace db
@@ -0,0 +1,96 @@
+#include "columnar_db/engine/result_cache.h"
+#include "columnar_db/common/config.h"
+#include "columnar_db/common/metrics.h"
+#include <cctype>
+#include <iterator>
+
+namespace db {
+
+std::string ResultCache::Normalize(const std::string& query) {
+    std::string normalized;
+    normalized.reserve(query.size());
+    char quote = 0;
+    bool space = false;
+    for (char c : query) {
+        if (quote == 0 && std::isspace(static_cast<unsigned char>(c))) {
+            space = true;
+            continue;
+        }
+        if (space && !normalized.empty()) {
+            normalized.push_back(' ');
+        }
+        space = false;
+        if (quote == 0 && (c == '\'' || c == '"')) {
+            quote = c;
+        } else if (c == quote) {
+            quote = 0;
+        }
+        normalized.push_back(c);
+    }
+    while (!normalized.empty() && (normalized.back() == ';' || normalized.back() == ' ')) {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+uint64_t ResultCache::GetVersion(uint32_t table_id) {
+    std::lock_guard<std::mutex> lock(latch_);
+    auto it = versions_.find(table_id);
+    return it != versions_.end() ? it->second : 0;
+}
+
+void ResultCache::BumpVersion(uint32_t table_id) {
+    std::lock_guard<std::mutex> lock(latch_);
+    ++versions_[table_id];
+}
+
+std::optional<std::string> ResultCache::Lookup(const std::string& query, uint32_t table_id) {
+    std::lock_guard<std::mutex> lock(latch_);
+    auto it = entries_.find(query);
+    if (it == entries_.end()) {
+        Metrics::Add(Counter::RESULT_CACHE_MISSES);
+        return std::nullopt;
+    }
+    auto version = versions_.find(table_id);
+    const Entry& entry = *it->second;
+    if (entry.table_id != table_id || entry.version != (version != versions_.end() ? version->second : 0)) {
+        // The table changed (or was dropped and created again) since.
+        erase(it->second);
+        Metrics::Add(Counter::RESULT_CACHE_MISSES);
+        return std::nullopt;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    Metrics::Add(Counter::RESULT_CACHE_HITS);
+    return entry.output;
+}
+
+void ResultCache::Insert(const std::string& query, uint32_t table_id, uint64_t version, std::string output) {
+    const size_t size = query.size() + output.size();
+    if (size > RESULT_CACHE_MAX_ENTRY_BYTES) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(latch_);
+    auto current = versions_.find(table_id);
+    if (version != (current != versions_.end() ? current->second : 0)) {
+        return; // Already out of date
+    }
+    auto it = entries_.find(query);
+    if (it != entries_.end()) {
+        erase(it->second);
+    }
+    while (!lru_.empty() && bytes_ + size > RESULT_CACHE_BYTES) {
+        erase(std::prev(lru_.end()));
+        Metrics::Add(Counter::RESULT_CACHE_EVICTIONS);
+    }
+    lru_.push_front(Entry{query, table_id, version, std::move(output)});
+    entries_.emplace(query, lru_.begin());
+    bytes_ += size;
+}
+
+void ResultCache::erase(std::list<Entry>::iterator it) {
+    bytes_ -= it->query.size() + it->output.size();
+    entries_.erase(it->query);
+    lru_.erase(it);
+}
+
+} // namespace db
@@ -0,0 +1,88 @@
+#include "columnar_db/engine/spill_buffer.h"
+#include "columnar_db/common/config.h"
+#include "columnar_db/common/metrics.h"
+#include <algorithm>
+
+namespace db {
+
+SpillBuffer::~SpillBuffer() {
+    if (grant_ != nullptr) {
+        grant_->Release(blocks_.size() * SPILL_BLOCK_SIZE);
+    }
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+bool SpillBuffer::grow() {
+    if (file_ == nullptr && grant_ != nullptr && grant_->Reserve(SPILL_BLOCK_SIZE)) {
+        blocks_.push_back(std::make_unique<char[]>(SPILL_BLOCK_SIZE));
+        char* block = blocks_.back().get();
+        setp(block, block + SPILL_BLOCK_SIZE);
+        return true;
+    }
+    if (file_ == nullptr) {
+        // The file is deleted as soon as it is closed, or the process exits.
+        file_ = std::tmpfile();
+        if (file_ == nullptr) {
+            failed_ = true;
+            return false;
+        }
+        // Text now goes straight to the file; the blocks keep what came before.
+        setp(nullptr, nullptr);
+    }
+    return true;
+}
+
+SpillBuffer::int_type SpillBuffer::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+    const char ch = traits_type::to_char_type(c);
+    return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+std::streamsize SpillBuffer::xsputn(const char* s, std::streamsize n) {
+    std::streamsize written = 0;
+    while (written < n) {
+        if (file_ != nullptr) {
+            const size_t count = std::fwrite(s + written, 1, n - written, file_);
+            Metrics::Add(Counter::QUERY_SPILL_BYTES, count);
+            if (count != static_cast<size_t>(n - written)) {
+                failed_ = true;
+            }
+            return written + count;
+        }
+        if (pptr() == epptr() && !grow()) {
+            return written;
+        }
+        if (file_ == nullptr) {
+            const std::streamsize count = std::min<std::streamsize>(n - written, epptr() - pptr());
+            std::copy(s + written, s + written + count, pptr());
+            pbump(static_cast<int>(count));
+            written += count;
+        }
+    }
+    return written;
+}
+
+bool SpillBuffer::WriteTo(std::ostream& out) {
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        // Only the last block may be partly filled, and only if nothing spilled.
+        const bool last = i + 1 == blocks_.size() && file_ == nullptr;
+        out.write(blocks_[i].get(), last ? pptr() - pbase() : static_cast<std::streamsize>(SPILL_BLOCK_SIZE));
+    }
+    if (file_ != nullptr && !failed_) {
+        std::rewind(file_);
+        char chunk[8192];
+        size_t count;
+        while ((count = std::fread(chunk, 1, sizeof(chunk), file_)) > 0) {
+            out.write(chunk, static_cast<std::streamsize>(count));
+        }
+        failed_ = std::ferror(file_) != 0;
+        std::fseek(file_, 0, SEEK_END);
+    }
+    return !failed_;
+}
+
+} // namespace db
@@ -0,0 +1,152 @@
+#include "columnar_db/common/config.h"
+#include "columnar_db/server/protocol.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// A command-line client for a database started with --listen or --socket.
+// Reads one command per line, like the columnar_db REPL.
+
+namespace {
+
+int connect_tcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+int connect_unix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Prints messages from the server until it is ready for the next command.
+// Returns false if the connection was lost.
+bool print_answer(int fd, std::string* buffer) {
+    while (true) {
+        db::protocol::MessageType type;
+        std::string payload;
+        size_t size = db::protocol::ParseMessage(*buffer, &type, &payload, std::string::npos);
+        if (size > 0) {
+            buffer->erase(0, size);
+            if (type == db::protocol::MessageType::READY) {
+                return true;
+            }
+            (type == db::protocol::MessageType::ERROR ? std::cerr : std::cout) << payload;
+            continue;
+        }
+        char data[64 * 1024];
+        ssize_t n = ::recv(fd, data, sizeof(data), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buffer->append(data, static_cast<size_t>(n));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int port = db::SERVER_DEFAULT_PORT;
+    std::string socket_path;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--port PORT | --socket PATH]" << std::endl;
+            return 1;
+        }
+    }
+
+    int fd = socket_path.empty() ? connect_tcp(port) : connect_unix(socket_path);
+    if (fd < 0) {
+        std::cerr << "Error: Failed to connect: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::string buffer;
+    if (!print_answer(fd, &buffer)) {
+        std::cerr << "Error: The server closed the connection." << std::endl;
+        return 1;
+    }
+    std::cout << "Connected to pesdb. Type 'quit' to exit." << std::endl;
+
+    std::string query;
+    while (true) {
+        std::cout << "db > ";
+        if (!std::getline(std::cin, query) || query == "quit") {
+            break;
+        }
+        if (query.empty()) {
+            continue;
+        }
+        std::string message;
+        db::protocol::AppendMessage(&message, db::protocol::MessageType::QUERY, query);
+        if (!send_all(fd, message) || !print_answer(fd, &buffer)) {
+            std::cerr << "Error: The server closed the connection." << std::endl;
+            ::close(fd);
+            return 1;
+        }
+        std::cout << std::endl;
+    }
+
+    std::string terminate;
+    db::protocol::AppendMessage(&terminate, db::protocol::MessageType::TERMINATE);
+    send_all(fd, terminate);
+    ::close(fd);
+    return 0;
+}
@@ -1,33 +1,163 @@
+#include "columnar_db/common/metrics.h"
 #include "columnar_db/storage/buffer_pool_manager.h"
 #include "columnar_db/storage/catalog.h"
 #include "columnar_db/storage/disk_manager.h"
+#include "columnar_db/concurrency/transaction_manager.h"
+#include "columnar_db/engine/command_processor.h"
+#include "columnar_db/engine/compactor.h"
 #include "columnar_db/engine/query_executor.h"
+#include "columnar_db/recovery/backup_manager.h"
+#include "columnar_db/recovery/checkpoint_manager.h"
+#include "columnar_db/recovery/recovery_manager.h"
+#include "columnar_db/server/server.h"
 #include "columnar_db/wal/log_manager.h"
-#include "SQLParser.h"
 
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string> // For std::string and std::getline
 #include <sys/stat.h>
 
-int main() {
+namespace {
+
+db::Server* running_server = nullptr;
+
+extern "C" void stop_server(int) {
+    running_server->Stop();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
     const std::string db_file = "mydb.db";
+    const std::string log_file = "mydb.wal";
     const std::string table_name = "users";
 
+    // --read-only serves a copy of the database (e.g. a reporting replica)
+    // straight from a read-only mapping of the file. The copy must have been
+    // taken after a checkpoint: its log is not replayed.
+    // --restore DIR rebuilds the database from a backup before starting.
+    // --scrub verifies the checksum of every page of the file and exits.
+    // --listen PORT and --socket PATH serve clients (columnar_db_client) on a
+    // loopback TCP port and/or a Unix socket instead of reading stdin.
+    // --compressed-cache MB keeps pages evicted from the buffer pool in up to
+    // MB megabytes of memory, compressed, rather than reading them again.
+    // --numa splits the buffer pool into one arena per NUMA node and pins
+    // partition scan threads to nodes.
+    // --buffer-pool MB sizes the buffer pool (default BUFFER_POOL_SIZE pages,
+    // or SERVER_BUFFER_POOL_SIZE when serving clients). Threads wait for a
+    // frame when all are pinned, so it must outnumber the pages every running
+    // statement and scan thread keeps pinned at once.
+    bool read_only = false;
+    size_t buffer_pool_size = 0;
+    size_t compressed_cache_size = 0;
+    bool numa_aware = false;
+    bool scrub = false;
+    std::string restore_dir;
+    db::Server::Options server_options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--read-only") == 0) {
+            read_only = true;
+        } else if (std::strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+            restore_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--scrub") == 0) {
+            scrub = true;
+        } else if (std::strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            server_options.port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            server_options.socket_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--compressed-cache") == 0 && i + 1 < argc) {
+            compressed_cache_size = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (std::strcmp(argv[i], "--numa") == 0) {
+            numa_aware = true;
+        } else if (std::strcmp(argv[i], "--buffer-pool") == 0 && i + 1 < argc) {
+            buffer_pool_size = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024 / db::PAGE_SIZE;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--read-only | --restore BACKUP_DIR | --scrub]"
+                      << " [--listen PORT] [--socket PATH] [--buffer-pool MB] [--compressed-cache MB] [--numa]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    const bool serve = server_options.port >= 0 || !server_options.socket_path.empty();
+    if (buffer_pool_size == 0) {
+        buffer_pool_size = serve ? db::SERVER_BUFFER_POOL_SIZE : db::BUFFER_POOL_SIZE;
+    }
+    if (scrub) {
+        try {
+            db::DiskManager disk_manager(db_file, true);
+            db::DiskManager::ScrubResult result = disk_manager.Scrub();
+            std::cout << "Checked " << result.pages_checked << " pages of " << db_file << " ("
+                      << result.unwritten_pages << " never written, highest LSN " << result.max_lsn << ")." << std::endl;
+            for (db::page_id_t page_id : result.corrupted_pages) {
+                std::cout << "Page " << page_id << " is corrupted." << std::endl;
+            }
+            return result.corrupted_pages.empty() ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Scrub failed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (read_only && !restore_dir.empty()) {
+        std::cerr << "Error: A restored database must replay its log; it cannot be opened read-only." << std::endl;
+        return 1;
+    }
+    if (!restore_dir.empty()) {
+        try {
+            db::BackupManager::Restore(restore_dir, db_file, log_file);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Restore failed: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Restored the database from '" << restore_dir << "'." << std::endl;
+    }
+
     // --- 1. Database Setup ---
     struct stat stat_buf;
     bool is_new_db = (stat(db_file.c_str(), &stat_buf) != 0 || stat_buf.st_size == 0);
 
-    auto disk_manager = std::make_unique<db::DiskManager>(db_file);
-    auto buffer_pool_manager = std::make_unique<db::BufferPoolManager>(db::BUFFER_POOL_SIZE, disk_manager.get());
-    auto catalog = std::make_unique<db::Catalog>(buffer_pool_manager.get(), is_new_db);
-    auto log_manager = std::make_unique<db::LogManager>("mydb.wal");
+    std::unique_ptr<db::DiskManager> disk_manager;
+    std::unique_ptr<db::LogManager> log_manager;
+    std::unique_ptr<db::BufferPoolManager> buffer_pool_manager;
+    std::unique_ptr<db::Catalog> catalog;
+    std::unique_ptr<db::TransactionManager> txn_manager;
+    std::unique_ptr<db::CheckpointManager> checkpoint_manager;
+
+    if (read_only) {
+        disk_manager = std::make_unique<db::DiskManager>(db_file, true);
+        buffer_pool_manager = std::make_unique<db::BufferPoolManager>(disk_manager.get());
+        catalog = std::make_unique<db::Catalog>(buffer_pool_manager.get(), false);
+        // Nothing is ever written, so every transaction id in the file is in the past.
+        txn_manager = std::make_unique<db::TransactionManager>(std::numeric_limits<db::txn_id_t>::max() / 2);
+    } else {
+        disk_manager = std::make_unique<db::DiskManager>(db_file);
+        log_manager = std::make_unique<db::LogManager>(log_file);
+        buffer_pool_manager = std::make_unique<db::BufferPoolManager>(buffer_pool_size, disk_manager.get(),
+                                                                      log_manager.get(), compressed_cache_size,
+                                                                      numa_aware);
+        catalog = std::make_unique<db::Catalog>(buffer_pool_manager.get(), is_new_db);
+
+        // Redo whatever the log has beyond the last checkpoint, then checkpoint so
+        // the next restart does not have to do it again.
+        db::RecoveryManager recovery_manager(catalog.get(), buffer_pool_manager.get(), log_manager.get());
+        size_t recovered_records = recovery_manager.Recover();
+
+        txn_manager = std::make_unique<db::TransactionManager>(recovery_manager.GetNextTxnId());
+        checkpoint_manager = std::make_unique<db::CheckpointManager>(buffer_pool_manager.get(), disk_manager.get(),
+                                                                     log_manager.get(), txn_manager.get());
+        if (recovered_records > 0) {
+            checkpoint_manager->Checkpoint();
+        }
+    }
 
     // --- 2. Create 'users' table if it doesn't exist (for convenience) ---
     // This is the same logic as before, just to ensure we have a table to query.
-    // In a real DB, you'd send "CREATE TABLE ..." via the REPL.
+    // Other tables can be created with "CREATE TABLE ..." from the REPL.
     const db::TableSchema* schema = catalog->GetTableSchema(table_name);
-    if (schema == nullptr) {
+    if (schema == nullptr && !read_only) {
         std::cout << "Table '" << table_name << "' not found. Creating it..." << std::endl;
         db::TableSchema new_schema;
         strncpy(new_schema.name, table_name.c_str(), sizeof(new_schema.name) - 1);
@@ -54,39 +184,78 @@ int main() {
     }
 
     // --- 3. Instantiate the Query Executor ---
-    auto query_executor = std::make_unique<db::QueryExecutor>(catalog.get(), buffer_pool_manager.get(), log_manager.get());
+    auto query_executor = std::make_unique<db::QueryExecutor>(catalog.get(), buffer_pool_manager.get(), log_manager.get(),
+                                                              txn_manager.get());
 
-    // --- 4. Start the Read-Evaluate-Print Loop (REPL) ---
-    std::string query;
-    std::cout << "Welcome to pesdb. Type 'quit' to exit." << std::endl;
+    // Dead rows left by DELETE and UPDATE are dropped in the background.
+    std::unique_ptr<db::Compactor> compactor;
+    if (!read_only) {
+        compactor = std::make_unique<db::Compactor>(catalog.get(), buffer_pool_manager.get(), txn_manager.get(),
+                                                    checkpoint_manager.get(), query_executor->GetStatementLatch(),
+                                                    query_executor->GetDdlLatch());
+        compactor->Start();
+    }
 
-    while (true) {
-        std::cout << "db > ";
-        std::getline(std::cin, query);
+    // Online backups, taken in the background with "backup [incremental] DIR".
+    std::unique_ptr<db::BackupManager> backup_manager;
+    if (!read_only) {
+        backup_manager = std::make_unique<db::BackupManager>(db_file, log_file, buffer_pool_manager.get(),
+                                                             log_manager.get(), txn_manager.get(),
+                                                             query_executor->GetDdlLatch());
+    }
 
-        if (query == "quit") {
-            break;
-        }
+    db::CommandProcessor command_processor(query_executor.get(), checkpoint_manager.get(), backup_manager.get());
 
-        if (query.empty()) {
-            continue;
+    if (serve) {
+        // --- 4. Serve clients until SIGINT or SIGTERM ---
+        std::unique_ptr<db::Server> server;
+        try {
+            server = std::make_unique<db::Server>(&command_processor, server_options);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
         }
+        if (server != nullptr) {
+            running_server = server.get();
+            std::signal(SIGINT, stop_server);
+            std::signal(SIGTERM, stop_server);
+            std::cout << "pesdb is serving clients. Press Ctrl-C to stop." << std::endl;
+            try {
+                server->Run();
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+            }
+            std::signal(SIGINT, SIG_DFL);
+            std::signal(SIGTERM, SIG_DFL);
+            running_server = nullptr;
+        }
+    } else {
+        // --- 4. Start the Read-Evaluate-Print Loop (REPL) ---
+        std::string query;
+        std::cout << "Welcome to pesdb. Type 'quit' to exit." << std::endl;
 
-        // Parse the query
-        hsql::SQLParserResult result;
-        hsql::SQLParser::parseSQLString(query, &result);
+        while (true) {
+            std::cout << "db > ";
+            std::getline(std::cin, query);
 
-        if (result.isValid()) {
-            // Execute the query
-            query_executor->Execute(result.getStatement(0));
-        } else {
-            std::cerr << "Error: Invalid SQL query." << std::endl;
-            std::cerr << "  " << result.errorMsg() << " (L:" << result.errorLine() << ", C:" << result.errorColumn() << ")" << std::endl;
+            if (query == "quit") {
+                break;
+            }
+
+            if (query.empty()) {
+                continue;
+            }
+
+            command_processor.Run(query, std::cout, std::cerr);
+            std::cout << std::endl;
         }
-        std::cout << std::endl;
     }
 
     std::cout << "\n--- Shutting down ---" << std::endl;
-    // The BufferPoolManager destructor will automatically flush all dirty pages.
+    if (!read_only) {
+        backup_manager->Wait();
+        compactor->Stop();
+        // A final checkpoint writes back all dirty pages and leaves nothing to redo.
+        checkpoint_manager->Checkpoint();
+    }
     return 0;
 }
\ No newline at end of file
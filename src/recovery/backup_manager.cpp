@@ -0,0 +1,419 @@
+#include "columnar_db/recovery/backup_manager.h"
+#include "columnar_db/common/crc32c.h"
+#include "columnar_db/storage/disk_manager.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace db {
+
+namespace {
+
+constexpr page_id_t COPY_CHUNK_PAGES = 256; // Pages read per pread in a full backup
+constexpr int PAGE_READ_ATTEMPTS = 10;      // Reads of a page that keeps failing its checksum
+
+// An incremental backup's `pages` file is a sequence of these, each followed by the page.
+struct PageRecordHeader {
+    uint32_t page_id_;
+    uint32_t crc_;
+};
+
+// What a backup's MANIFEST records.
+struct BackupManifest {
+    bool incremental = false;
+    std::string base;         // Directory of the previous backup (incremental only)
+    lsn_t start_lsn = 0;      // Replay the log from here...
+    lsn_t end_lsn = 0;        // ...to here
+    txn_id_t next_txn_id = 0;
+    page_id_t page_count = 0; // Size of the data file in pages
+    uint64_t pages_copied = 0;
+};
+
+std::string error_text() {
+    return std::strerror(errno);
+}
+
+int open_file(const std::string& path, int flags) {
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + error_text());
+    }
+    return fd;
+}
+
+void read_all(int fd, off_t offset, char* buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, buffer + done, size - done, offset + static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw std::runtime_error("Read failed during backup: " + error_text());
+        }
+        if (n == 0) {
+            std::memset(buffer + done, 0, size - done); // Past the end of the file
+            return;
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+// Reads `count` pages from `first` on and checks each one. A page that fails
+// its checksum was most likely being written as it was read, so it is read
+// again; a page that keeps failing is reported as corrupted.
+void read_pages(int fd, page_id_t first, page_id_t count, char* buffer) {
+    read_all(fd, static_cast<off_t>(first) * PAGE_SIZE, buffer, static_cast<size_t>(count) * PAGE_SIZE);
+    for (page_id_t i = 0; i < count; ++i) {
+        char* page = buffer + static_cast<size_t>(i) * PAGE_SIZE;
+        for (int attempt = 1; !DiskManager::VerifyPage(first + i, page); ++attempt) {
+            if (attempt == PAGE_READ_ATTEMPTS) {
+                throw std::runtime_error("Page " + std::to_string(first + i) + " failed its checksum during backup.");
+            }
+            read_all(fd, static_cast<off_t>(first + i) * PAGE_SIZE, page, PAGE_SIZE);
+        }
+    }
+}
+
+void write_all(int fd, off_t offset, const char* buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pwrite(fd, buffer + done, size - done, offset + static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Write failed during backup: " + error_text());
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+void sync_and_close(int fd, const std::string& path) {
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok) {
+        throw std::runtime_error("Cannot sync " + path + ": " + error_text());
+    }
+}
+
+page_id_t file_pages(int fd) {
+    struct stat stat_buf;
+    if (::fstat(fd, &stat_buf) != 0) {
+        throw std::runtime_error("Cannot stat database file: " + error_text());
+    }
+    return static_cast<page_id_t>(stat_buf.st_size / PAGE_SIZE);
+}
+
+bool is_space_map(page_id_t page_id) {
+    return page_id % DiskManager::PAGES_PER_GROUP == 0;
+}
+
+void write_manifest(const std::string& dir, const BackupManifest& manifest) {
+    const std::string path = dir + "/MANIFEST";
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << "type " << (manifest.incremental ? "incremental" : "full") << "\n"
+            << "base " << (manifest.incremental ? manifest.base : "-") << "\n"
+            << "start_lsn " << manifest.start_lsn << "\n"
+            << "end_lsn " << manifest.end_lsn << "\n"
+            << "next_txn_id " << manifest.next_txn_id << "\n"
+            << "page_count " << manifest.page_count << "\n"
+            << "pages_copied " << manifest.pages_copied << "\n";
+        if (!out.flush()) {
+            throw std::runtime_error("Cannot write " + path);
+        }
+    }
+    sync_and_close(open_file(path + ".tmp", O_RDONLY), path + ".tmp");
+    if (std::rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot write " + path + ": " + error_text());
+    }
+    sync_and_close(open_file(dir, O_RDONLY | O_DIRECTORY), dir);
+}
+
+BackupManifest read_manifest(const std::string& dir) {
+    std::ifstream in(dir + "/MANIFEST");
+    if (!in) {
+        throw std::runtime_error("No complete backup in " + dir + " (MANIFEST is missing).");
+    }
+    BackupManifest manifest;
+    std::string key;
+    std::string type;
+    while (in >> key) {
+        if (key == "type") {
+            in >> type;
+            manifest.incremental = type == "incremental";
+        } else if (key == "base") {
+            in >> manifest.base;
+        } else if (key == "start_lsn") {
+            in >> manifest.start_lsn;
+        } else if (key == "end_lsn") {
+            in >> manifest.end_lsn;
+        } else if (key == "next_txn_id") {
+            in >> manifest.next_txn_id;
+        } else if (key == "page_count") {
+            in >> manifest.page_count;
+        } else if (key == "pages_copied") {
+            in >> manifest.pages_copied;
+        } else {
+            throw std::runtime_error("Unknown key '" + key + "' in " + dir + "/MANIFEST");
+        }
+    }
+    if ((type != "full" && type != "incremental") || manifest.start_lsn < static_cast<lsn_t>(LogManager::LOG_HEADER_SIZE) ||
+        manifest.end_lsn < manifest.start_lsn) {
+        throw std::runtime_error("Invalid MANIFEST in " + dir);
+    }
+    return manifest;
+}
+
+} // namespace
+
+BackupManager::BackupManager(const std::string& db_file, const std::string& log_file, BufferPoolManager* bpm,
+                             LogManager* log_manager, TransactionManager* txn_manager,
+                             std::shared_mutex* ddl_latch)
+    : db_file_(db_file), log_file_(log_file), bpm_(bpm), log_manager_(log_manager), txn_manager_(txn_manager),
+      ddl_latch_(ddl_latch) {}
+
+BackupManager::~BackupManager() {
+    Wait();
+}
+
+void BackupManager::Backup(const std::string& backup_dir, bool incremental) {
+    std::lock_guard<std::mutex> guard(backup_latch_);
+    if (incremental && last_backup_dir_.empty()) {
+        throw std::runtime_error("An incremental backup needs a full backup taken since the database was opened.");
+    }
+    // Statements and checkpoints keep running; only DDL and compaction wait.
+    std::shared_lock<std::shared_mutex> shared(*ddl_latch_);
+
+    BackupManifest manifest;
+    manifest.incremental = incremental;
+    manifest.base = last_backup_dir_;
+    // Read the checkpoint before taking the bitmap: a page changed before the
+    // checkpoint is either already on disk or in the bitmap we are about to copy.
+    // Checkpoints written during the copy must not free the log we copy at the end.
+    manifest.start_lsn = log_manager_->RetainLog();
+    std::vector<uint64_t> changed = bpm_->TakeChangedPages();
+
+    try {
+        if (!std::filesystem::create_directory(backup_dir)) {
+            throw std::runtime_error("Backup directory " + backup_dir + " already exists.");
+        }
+
+        const std::string pages_file = backup_dir + (incremental ? "/pages" : "/data");
+        int out_fd = open_file(pages_file, O_WRONLY | O_CREAT | O_TRUNC);
+        try {
+            manifest.page_count = copy_pages(out_fd, incremental ? &changed : nullptr, &manifest.pages_copied);
+        } catch (...) {
+            ::close(out_fd);
+            throw;
+        }
+        sync_and_close(out_fd, pages_file);
+
+        // Every change the copy may have missed is in the log up to here.
+        manifest.end_lsn = log_manager_->Flush();
+        manifest.next_txn_id = txn_manager_->GetNextTxnId();
+
+        const std::string wal_file = backup_dir + "/wal";
+        int log_fd = open_file(log_file_, O_RDONLY);
+        int wal_fd = open_file(wal_file, O_WRONLY | O_CREAT | O_TRUNC);
+        try {
+            std::vector<char> buffer(1 << 20);
+            for (lsn_t pos = manifest.start_lsn; pos < manifest.end_lsn;) {
+                size_t n = static_cast<size_t>(std::min<lsn_t>(manifest.end_lsn - pos, buffer.size()));
+                read_all(log_fd, pos, buffer.data(), n);
+                write_all(wal_fd, pos - manifest.start_lsn, buffer.data(), n);
+                pos += static_cast<lsn_t>(n);
+            }
+        } catch (...) {
+            ::close(log_fd);
+            ::close(wal_fd);
+            throw;
+        }
+        ::close(log_fd);
+        sync_and_close(wal_fd, wal_file);
+
+        write_manifest(backup_dir, manifest);
+    } catch (...) {
+        log_manager_->ReleaseLog();
+        bpm_->MergeChangedPages(changed);
+        throw;
+    }
+    log_manager_->ReleaseLog();
+    last_backup_dir_ = backup_dir;
+}
+
+page_id_t BackupManager::copy_pages(int out_fd, const std::vector<uint64_t>* changed, uint64_t* pages_copied) {
+    int fd = open_file(db_file_, O_RDONLY);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    std::vector<char> buffer(static_cast<size_t>(COPY_CHUNK_PAGES) * PAGE_SIZE);
+    off_t out_offset = 0;
+    *pages_copied = 0;
+
+    auto is_changed = [changed](page_id_t page_id) {
+        size_t word = static_cast<size_t>(page_id) / 64;
+        return word < changed->size() && ((*changed)[word] >> (page_id % 64)) & 1;
+    };
+    auto append_record = [&](page_id_t page_id, const char* page) {
+        PageRecordHeader header{static_cast<uint32_t>(page_id), Crc32c(page, PAGE_SIZE)};
+        write_all(out_fd, out_offset, reinterpret_cast<const char*>(&header), sizeof(header));
+        write_all(out_fd, out_offset + static_cast<off_t>(sizeof(header)), page, PAGE_SIZE);
+        out_offset += static_cast<off_t>(sizeof(header) + PAGE_SIZE);
+        (*pages_copied)++;
+    };
+
+    page_id_t copied_to = 0;
+    try {
+        // The file may grow while we copy; keep going until we have caught up with it.
+        for (page_id_t page_count = file_pages(fd); copied_to < page_count; page_count = file_pages(fd)) {
+            for (page_id_t first = copied_to; first < page_count; first += COPY_CHUNK_PAGES) {
+                page_id_t n = std::min(COPY_CHUNK_PAGES, page_count - first);
+                if (changed == nullptr) {
+                    read_pages(fd, first, n, buffer.data());
+                    write_all(out_fd, static_cast<off_t>(first) * PAGE_SIZE, buffer.data(), static_cast<size_t>(n) * PAGE_SIZE);
+                    *pages_copied += n;
+                    continue;
+                }
+                for (page_id_t page_id = first; page_id < first + n; ++page_id) {
+                    if (is_changed(page_id) && !is_space_map(page_id)) {
+                        read_pages(fd, page_id, 1, buffer.data());
+                        append_record(page_id, buffer.data());
+                    }
+                }
+            }
+            copied_to = page_count;
+        }
+
+        // Space maps are not logged. Copied last, they cover every page that a
+        // copied page refers to (pages are only freed by DDL and compaction).
+        for (page_id_t map = 0; map < copied_to; map += DiskManager::PAGES_PER_GROUP) {
+            read_pages(fd, map, 1, buffer.data());
+            if (changed == nullptr) {
+                write_all(out_fd, static_cast<off_t>(map) * PAGE_SIZE, buffer.data(), PAGE_SIZE);
+            } else {
+                append_record(map, buffer.data());
+            }
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return copied_to;
+}
+
+bool BackupManager::StartBackup(const std::string& backup_dir, bool incremental) {
+    if (running_.exchange(true)) {
+        return false;
+    }
+    Wait(); // Reap the previous, finished backup thread
+
+    thread_ = std::thread([this, backup_dir, incremental] {
+        try {
+            Backup(backup_dir, incremental);
+            std::cout << (incremental ? "Incremental" : "Full") << " backup written to '" << backup_dir << "'." << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Backup failed: " << e.what() << std::endl;
+        }
+        running_ = false;
+    });
+    return true;
+}
+
+void BackupManager::Wait() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void BackupManager::Restore(const std::string& backup_dir, const std::string& db_file, const std::string& log_file) {
+    // The chain back to the full backup, newest first.
+    std::vector<std::pair<std::string, BackupManifest>> chain;
+    for (std::string dir = backup_dir;;) {
+        BackupManifest manifest = read_manifest(dir);
+        chain.emplace_back(dir, manifest);
+        if (!manifest.incremental) {
+            break;
+        }
+        dir = manifest.base;
+    }
+    const BackupManifest& latest = chain.front().second;
+
+    if (std::filesystem::exists(db_file) || std::filesystem::exists(log_file)) {
+        throw std::runtime_error("Restore would overwrite " + db_file + " or " + log_file + "; move them away first.");
+    }
+
+    // Pages: the full backup, then each incremental one on top, oldest first.
+    int db_fd = open_file(db_file, O_WRONLY | O_CREAT | O_EXCL);
+    try {
+        std::vector<char> buffer(static_cast<size_t>(COPY_CHUNK_PAGES) * PAGE_SIZE);
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            const auto& [dir, manifest] = *it;
+            if (!manifest.incremental) {
+                int in_fd = open_file(dir + "/data", O_RDONLY);
+                for (page_id_t first = 0; first < manifest.page_count; first += COPY_CHUNK_PAGES) {
+                    size_t size = static_cast<size_t>(std::min(COPY_CHUNK_PAGES, manifest.page_count - first)) * PAGE_SIZE;
+                    read_all(in_fd, static_cast<off_t>(first) * PAGE_SIZE, buffer.data(), size);
+                    write_all(db_fd, static_cast<off_t>(first) * PAGE_SIZE, buffer.data(), size);
+                }
+                ::close(in_fd);
+                continue;
+            }
+            int in_fd = open_file(dir + "/pages", O_RDONLY);
+            off_t offset = 0;
+            for (uint64_t i = 0; i < manifest.pages_copied; ++i) {
+                PageRecordHeader header;
+                read_all(in_fd, offset, reinterpret_cast<char*>(&header), sizeof(header));
+                read_all(in_fd, offset + static_cast<off_t>(sizeof(header)), buffer.data(), PAGE_SIZE);
+                offset += static_cast<off_t>(sizeof(header) + PAGE_SIZE);
+                if (Crc32c(buffer.data(), PAGE_SIZE) != header.crc_) {
+                    ::close(in_fd);
+                    throw std::runtime_error("Checksum mismatch for page " + std::to_string(header.page_id_) + " in " + dir);
+                }
+                write_all(db_fd, static_cast<off_t>(header.page_id_) * PAGE_SIZE, buffer.data(), PAGE_SIZE);
+            }
+            ::close(in_fd);
+        }
+        // Pages allocated but never written since the last backup read as zeros.
+        if (::ftruncate(db_fd, static_cast<off_t>(latest.page_count) * PAGE_SIZE) != 0) {
+            throw std::runtime_error("Cannot size " + db_file + ": " + error_text());
+        }
+    } catch (...) {
+        ::close(db_fd);
+        throw;
+    }
+    sync_and_close(db_fd, db_file);
+
+    // Log: a header pointing at the segment, and the segment at its original
+    // offsets so that the LSNs in the pages still match.
+    {
+        LogManager log_manager(log_file);
+        log_manager.WriteCheckpoint(latest.start_lsn, latest.next_txn_id);
+    }
+    int in_fd = open_file(backup_dir + "/wal", O_RDONLY);
+    int log_fd = open_file(log_file, O_WRONLY);
+    try {
+        std::vector<char> buffer(1 << 20);
+        for (lsn_t pos = latest.start_lsn; pos < latest.end_lsn;) {
+            size_t n = static_cast<size_t>(std::min<lsn_t>(latest.end_lsn - pos, buffer.size()));
+            read_all(in_fd, pos - latest.start_lsn, buffer.data(), n);
+            write_all(log_fd, pos, buffer.data(), n);
+            pos += static_cast<lsn_t>(n);
+        }
+    } catch (...) {
+        ::close(in_fd);
+        ::close(log_fd);
+        throw;
+    }
+    ::close(in_fd);
+    sync_and_close(log_fd, log_file);
+}
+
+} // namespace db
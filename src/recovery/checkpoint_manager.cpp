@@ -0,0 +1,33 @@
+#include "columnar_db/recovery/checkpoint_manager.h"
+
+namespace db {
+
+CheckpointManager::CheckpointManager(BufferPoolManager* bpm, DiskManager* disk_manager, LogManager* log_manager,
+                                     TransactionManager* txn_manager)
+    : bpm_(bpm), disk_manager_(disk_manager), log_manager_(log_manager), txn_manager_(txn_manager) {}
+
+void CheckpointManager::Checkpoint() {
+    std::lock_guard<std::mutex> guard(latch_);
+    // Everything up to `lsn` has been applied to pages (we are between
+    // statements), so once the pages are on disk the log before it is redundant.
+    txn_id_t next_txn_id = txn_manager_->GetNextTxnId();
+    lsn_t lsn = log_manager_->Flush();
+    bpm_->FlushAllPages();
+    disk_manager_->Sync();
+    log_manager_->WriteCheckpoint(lsn, next_txn_id);
+}
+
+bool CheckpointManager::MaybeCheckpoint() {
+    if (!CheckpointDue()) {
+        return false;
+    }
+    Checkpoint();
+    return true;
+}
+
+bool CheckpointManager::CheckpointDue() const {
+    lsn_t written = log_manager_->GetPersistentLsn() - log_manager_->GetCheckpointLsn();
+    return written >= static_cast<lsn_t>(CHECKPOINT_INTERVAL_BYTES);
+}
+
+} // namespace db
@@ -0,0 +1,263 @@
+#include "columnar_db/recovery/recovery_manager.h"
+#include "columnar_db/storage/table.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace db {
+
+RecoveryManager::RecoveryManager(Catalog* catalog, BufferPoolManager* bpm, LogManager* log_manager)
+    : catalog_(catalog), bpm_(bpm), log_manager_(log_manager) {}
+
+size_t RecoveryManager::Recover() {
+    // 1. Read the log tail and partition it by (table, column).
+    std::map<std::pair<uint32_t, size_t>, ColumnRedo> partitions;
+    size_t record_count = 0;
+    next_txn_id_ = log_manager_->GetCheckpointTxnId();
+
+    // Whether a change's transaction committed is only known once the whole
+    // tail is read, so its changes are noted here and settled afterwards.
+    // Checkpoints run between statements, so no transaction spans one.
+    struct TxnDelete {
+        ColumnRedo* redo;
+        size_t op;
+        txn_id_t txn_id;
+    };
+    struct TxnInsert {
+        ColumnRedo* redo;
+        uint64_t first_row;
+        uint64_t row_count;
+        txn_id_t txn_id;
+    };
+    std::vector<TxnDelete> deletes;
+    std::vector<TxnInsert> inserts;
+    std::unordered_set<txn_id_t> committed;
+    lsn_t last_lsn = INVALID_LSN;
+
+    log_manager_->ScanLog(log_manager_->GetCheckpointLsn(), [&](lsn_t lsn, const LogRecord& record) {
+        record_count++;
+        last_lsn = lsn;
+        if (record.GetType() == LogRecordType::COMMIT || record.GetType() == LogRecordType::ABORT) {
+            next_txn_id_ = std::max(next_txn_id_, record.GetTxnId() + 1);
+            if (record.GetType() == LogRecordType::COMMIT) {
+                committed.insert(record.GetTxnId());
+            }
+            return;
+        }
+        const TableSchema* schema = catalog_->GetTableSchema(record.GetTableId());
+        if (schema == nullptr) {
+            std::cerr << "Warning: Skipping log record for unknown table id " << record.GetTableId() << "." << std::endl;
+            return;
+        }
+        uint32_t row_count = record.GetRowCount();
+
+        if (record.GetType() == LogRecordType::DELETE_ROWS) {
+            next_txn_id_ = std::max(next_txn_id_, record.GetXmax() + 1);
+            auto& redo = partitions[{record.GetTableId(), schema->XmaxColumn()}];
+            redo.schema = schema;
+            redo.column = schema->XmaxColumn();
+            for (uint64_t row_id : record.GetRowIds()) {
+                // An xmax of INVALID_TXN_ID undoes a delete and holds either way.
+                if (record.GetXmax() != INVALID_TXN_ID) {
+                    deletes.push_back({&redo, redo.ops.size(), record.GetXmax()});
+                }
+                redo.ops.push_back({lsn, row_id, record.GetXmax(), false});
+            }
+            return;
+        }
+
+        const auto& columns = record.GetColumns();
+        if (columns.size() != schema->columns.size()) {
+            std::cerr << "Warning: Skipping log record that does not match table id " << record.GetTableId() << "." << std::endl;
+            return;
+        }
+        const std::vector<int64_t>& xmins = columns[schema->XminColumn()];
+        for (uint32_t row = 0; row < row_count; ++row) {
+            next_txn_id_ = std::max(next_txn_id_, xmins[row] + 1);
+            if (row > 0 && xmins[row] == xmins[row - 1]) {
+                inserts.back().row_count++;
+            } else {
+                inserts.push_back({&partitions[{record.GetTableId(), schema->XmaxColumn()}],
+                                   record.GetFirstRowId() + row, 1, xmins[row]});
+            }
+        }
+        for (size_t i = 0; i < columns.size(); ++i) {
+            auto& redo = partitions[{record.GetTableId(), i}];
+            redo.schema = schema;
+            redo.column = i;
+            for (uint32_t row = 0; row < row_count; ++row) {
+                redo.ops.push_back({LogRecord::RowLsn(lsn, row, row_count), record.GetFirstRowId() + row,
+                                    columns[i][row], true});
+            }
+        }
+    });
+
+    // 2. Roll back the transactions with no COMMIT: they crashed or aborted
+    //    part way. Ids below next_txn_id_ read as committed after a restart,
+    //    so their rows must be hidden by the data itself. Their delete marks
+    //    are cleared, then the rows they inserted are marked deleted by them.
+    std::unordered_set<txn_id_t> rolled_back;
+    for (const TxnDelete& txn_delete : deletes) {
+        if (committed.count(txn_delete.txn_id) == 0) {
+            txn_delete.redo->ops[txn_delete.op].value = INVALID_TXN_ID;
+            rolled_back.insert(txn_delete.txn_id);
+        }
+    }
+    for (const TxnInsert& insert : inserts) {
+        if (committed.count(insert.txn_id) != 0) {
+            continue;
+        }
+        rolled_back.insert(insert.txn_id);
+        for (uint64_t row = 0; row < insert.row_count; ++row) {
+            insert.redo->ops.push_back({last_lsn, insert.first_row + row, insert.txn_id, false});
+        }
+    }
+    if (!rolled_back.empty()) {
+        std::cout << "Rolling back " << rolled_back.size() << " uncommitted transactions." << std::endl;
+    }
+
+    if (partitions.empty()) {
+        return record_count;
+    }
+    std::cout << "Recovering " << record_count << " log records across " << partitions.size() << " columns." << std::endl;
+
+    // 3. Redo the partitions in parallel. Each worker pins at most two pages at
+    //    a time, so the worker count is capped by the size of the buffer pool.
+    std::vector<const ColumnRedo*> work;
+    for (const auto& [key, redo] : partitions) {
+        work.push_back(&redo);
+    }
+    size_t max_workers = std::max<size_t>(1, bpm_->GetPoolSize() / 2 - 1);
+    size_t num_workers = std::min({work.size(), max_workers,
+                                   static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()))});
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    auto worker = [&] {
+        size_t i;
+        while (!failed && (i = next.fetch_add(1)) < work.size()) {
+            try {
+                redo_column(*work[i]);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Recovery failed: " << e.what() << std::endl;
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_workers; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (failed) {
+        throw std::runtime_error("Crash recovery failed.");
+    }
+    return record_count;
+}
+
+void RecoveryManager::redo_column(const ColumnRedo& redo) {
+    // 1. Walk the column's chain, building a directory of (page, first row) so
+    //    delete marks can find their page, and counting the rows already there.
+    struct PageEntry {
+        page_id_t page_id;
+        uint64_t first_row;
+    };
+    std::vector<PageEntry> directory;
+    uint64_t row_count = 0;
+    const Column& column = redo.schema->columns[redo.column];
+    page_id_t current_pid = column.first_page_id;
+
+    while (current_pid != INVALID_PAGE_ID) {
+        Page* page = bpm_->FetchPage(current_pid);
+        if (page == nullptr) {
+            throw std::runtime_error("Failed to fetch page " + std::to_string(current_pid) + " during recovery.");
+        }
+        page->w_latch();
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+
+        // A page that was linked into the chain but never written back reads as
+        // all zeros. Its "next" of 0 would point at the catalog, so end the chain here.
+        bool repaired = false;
+        if (data_page->value_count_ == 0 && data_page->next_page_id_ == 0) {
+            data_page->next_page_id_ = INVALID_PAGE_ID;
+            repaired = true;
+        }
+
+        directory.push_back({current_pid, row_count});
+        row_count += data_page->value_count_;
+        page_id_t next_pid = data_page->next_page_id_;
+
+        page->w_unlatch();
+        bpm_->UnpinPage(current_pid, repaired);
+        current_pid = next_pid;
+    }
+
+    // 2. Apply the ops in LSN order.
+    for (const RedoOp& op : redo.ops) {
+        if (op.is_append && op.row_id < row_count) {
+            continue; // Already on disk.
+        }
+        if (op.is_append && op.row_id > row_count) {
+            throw std::runtime_error("Log is missing rows before row " + std::to_string(op.row_id) + ".");
+        }
+        if (!op.is_append && op.row_id >= row_count) {
+            throw std::runtime_error("Log deletes row " + std::to_string(op.row_id) + " that does not exist.");
+        }
+
+        // The page holding the row (for an append, the tail).
+        auto it = std::upper_bound(directory.begin(), directory.end(), op.row_id,
+                                   [](uint64_t row_id, const PageEntry& entry) { return row_id < entry.first_row; });
+        const PageEntry& entry = op.is_append ? directory.back() : *std::prev(it);
+
+        Page* page = bpm_->FetchPage(entry.page_id);
+        if (page == nullptr) {
+            throw std::runtime_error("Failed to fetch page " + std::to_string(entry.page_id) + " during recovery.");
+        }
+        page->w_latch();
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+
+        if (op.is_append && data_page->value_count_ == ColumnPageCapacity(column.type)) {
+            page_id_t new_pid;
+            Page* new_page = bpm_->NewPage(&new_pid, entry.page_id + 1);
+            if (new_page == nullptr) {
+                page->w_unlatch();
+                bpm_->UnpinPage(entry.page_id, false);
+                throw std::runtime_error("Buffer pool exhausted during recovery.");
+            }
+            data_page->next_page_id_ = new_pid;
+            StampColumnPage(page, data_page, op.lsn);
+            page->w_unlatch();
+            bpm_->UnpinPage(entry.page_id, true);
+
+            directory.push_back({new_pid, row_count});
+            page = new_page;
+            page->w_latch();
+            data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+            data_page->next_page_id_ = INVALID_PAGE_ID;
+            data_page->value_count_ = 0;
+            data_page->page_lsn_ = 0;
+        }
+
+        if (op.is_append) {
+            WriteColumnValue(data_page, column.type, data_page->value_count_++, op.value);
+            row_count++;
+        } else {
+            WriteColumnValue(data_page, column.type, static_cast<uint32_t>(op.row_id - entry.first_row), op.value);
+        }
+        StampColumnPage(page, data_page, op.lsn);
+
+        page->w_unlatch();
+        bpm_->UnpinPage(page->page_id(), true);
+    }
+}
+
+} // namespace db
@@ -0,0 +1,38 @@
+#include "columnar_db/server/protocol.h"
+#include <limits>
+#include <stdexcept>
+
+namespace db::protocol {
+
+void AppendMessage(std::string* buffer, MessageType type, std::string_view payload) {
+    if (payload.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Message of " + std::to_string(payload.size()) + " bytes is too long.");
+    }
+    const auto length = static_cast<uint32_t>(payload.size());
+    buffer->push_back(static_cast<char>(type));
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        buffer->push_back(static_cast<char>((length >> shift) & 0xFF));
+    }
+    buffer->append(payload);
+}
+
+size_t ParseMessage(std::string_view buffer, MessageType* type, std::string* payload, size_t max_payload) {
+    if (buffer.size() < HEADER_SIZE) {
+        return 0;
+    }
+    uint32_t length = 0;
+    for (size_t i = 1; i < HEADER_SIZE; ++i) {
+        length = (length << 8) | static_cast<unsigned char>(buffer[i]);
+    }
+    if (length > max_payload) {
+        throw std::runtime_error("Message of " + std::to_string(length) + " bytes is too long.");
+    }
+    if (buffer.size() < HEADER_SIZE + length) {
+        return 0;
+    }
+    *type = static_cast<MessageType>(buffer[0]);
+    payload->assign(buffer.substr(HEADER_SIZE, length));
+    return HEADER_SIZE + length;
+}
+
+} // namespace db::protocol
@@ -0,0 +1,459 @@
+#include "columnar_db/server/server.h"
+#include "columnar_db/server/protocol.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <ostream>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace db {
+
+namespace {
+
+// epoll tokens: the wake eventfd, then one per listening socket, then sessions.
+constexpr uint64_t WAKE_TOKEN = 0;
+constexpr uint64_t FIRST_SESSION_ID = 1 << 16;
+
+std::runtime_error system_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Cuts what is written to it into messages of one type, at most
+// SERVER_OUTPUT_FRAME_SIZE bytes each, and hands each one to `post` as soon
+// as it is full. Flushing (std::endl) does not cut a message short; Finish
+// sends the rest. Once `post` returns false, the rest is discarded.
+class FrameBuffer : public std::streambuf {
+public:
+    FrameBuffer(protocol::MessageType type, std::function<bool(std::string)> post)
+        : type_(type), post_(std::move(post)), buffer_(SERVER_OUTPUT_FRAME_SIZE) {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    void Finish() { send(); }
+
+protected:
+    int_type overflow(int_type ch) override {
+        send();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    void send() {
+        const auto size = static_cast<size_t>(pptr() - pbase());
+        if (size > 0 && open_) {
+            std::string message;
+            protocol::AppendMessage(&message, type_, std::string_view(pbase(), size));
+            open_ = post_(std::move(message));
+        }
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    const protocol::MessageType type_;
+    std::function<bool(std::string)> post_;
+    std::vector<char> buffer_;
+    bool open_ = true;
+};
+
+} // namespace
+
+Server::Server(CommandProcessor* processor, Options options)
+    : processor_(processor), options_(std::move(options)), next_session_id_(FIRST_SESSION_ID) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        throw system_error("Failed to set up the event loop");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_TOKEN;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+
+    if (options_.port >= 0) {
+        listen_fds_.push_back(listen_tcp(options_.port));
+    }
+    if (!options_.socket_path.empty()) {
+        listen_fds_.push_back(listen_unix(options_.socket_path));
+    }
+    if (listen_fds_.empty()) {
+        throw std::runtime_error("The server needs a port or a socket path to listen on.");
+    }
+    for (size_t i = 0; i < listen_fds_.size(); ++i) {
+        event.events = EPOLLIN;
+        event.data.u64 = i + 1;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fds_[i], &event);
+    }
+}
+
+Server::~Server() {
+    stop_workers();
+    for (auto& [id, session] : sessions_) {
+        ::close(session->fd);
+    }
+    for (int fd : listen_fds_) {
+        ::close(fd);
+    }
+    if (!options_.socket_path.empty()) {
+        ::unlink(options_.socket_path.c_str());
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+    }
+    if (epoll_fd_ >= 0) {
+        ::close(epoll_fd_);
+    }
+}
+
+int Server::listen_tcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw system_error("Failed to create a TCP socket");
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local tools only: there is no authentication
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SERVER_LISTEN_BACKLOG) != 0) {
+        ::close(fd);
+        throw system_error("Failed to listen on port " + std::to_string(port));
+    }
+    return fd;
+}
+
+int Server::listen_unix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path '" + path + "' is too long.");
+    }
+    // A socket left behind by a server that did not shut down cleanly.
+    struct stat stat_buf;
+    if (stat(path.c_str(), &stat_buf) == 0 && S_ISSOCK(stat_buf.st_mode)) {
+        ::unlink(path.c_str());
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw system_error("Failed to create a Unix socket");
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SERVER_LISTEN_BACKLOG) != 0) {
+        ::close(fd);
+        throw system_error("Failed to listen on '" + path + "'");
+    }
+    return fd;
+}
+
+void Server::Stop() {
+    stop_requested_.store(true);
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void Server::Run() {
+    for (size_t i = 0; i < options_.worker_threads; ++i) {
+        workers_.emplace_back(&Server::worker_loop, this);
+    }
+
+    std::vector<epoll_event> events(256);
+    while (!stop_requested_.load()) {
+        int n = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error("epoll_wait failed");
+        }
+        for (int i = 0; i < n; ++i) {
+            const uint64_t token = events[i].data.u64;
+            if (token == WAKE_TOKEN) {
+                uint64_t count;
+                [[maybe_unused]] ssize_t bytes = ::read(wake_fd_, &count, sizeof(count));
+                deliver_answers();
+                continue;
+            }
+            if (token < FIRST_SESSION_ID) {
+                accept_sessions(listen_fds_[token - 1]);
+                continue;
+            }
+            // Closed earlier in this batch.
+            auto it = sessions_.find(token);
+            if (it == sessions_.end()) {
+                continue;
+            }
+            Session* session = it->second.get();
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0 && !receive(session)) {
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) != 0 && !send_output(session)) {
+                continue;
+            }
+            dispatch(session);
+        }
+    }
+
+    stop_workers();
+}
+
+void Server::stop_workers() {
+    // Let the running commands finish; the ones not started yet are dropped.
+    {
+        std::lock_guard<std::mutex> guard(jobs_latch_);
+        stopping_workers_ = true;
+        jobs_.clear();
+    }
+    jobs_cv_.notify_all();
+    // Nothing sends their output any more.
+    {
+        std::lock_guard<std::mutex> guard(answers_latch_);
+        for (auto& [id, session] : sessions_) {
+            if (session->backlog) {
+                session->backlog->closed = true;
+            }
+        }
+    }
+    backlog_cv_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void Server::accept_sessions(int listen_fd) {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return; // EAGAIN, or out of descriptors: try again on the next event
+        }
+        // Answers are often small and each one is waited for; do not hold them back.
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        auto session = std::make_unique<Session>();
+        session->id = next_session_id_++;
+        session->fd = fd;
+        protocol::AppendMessage(&session->output, protocol::MessageType::READY);
+        Session* raw = session.get();
+        sessions_.emplace(raw->id, std::move(session));
+        update_events(raw);
+    }
+}
+
+bool Server::receive(Session* session) {
+    char buffer[64 * 1024];
+    while (true) {
+        ssize_t n = ::recv(session->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            session->input.append(buffer, static_cast<size_t>(n));
+            if (session->input.size() > SERVER_MAX_MESSAGE_SIZE + protocol::HEADER_SIZE) {
+                return true; // Enough for a whole message; the rest waits in the socket
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        close_session(session); // Disconnected or failed
+        return false;
+    }
+}
+
+bool Server::send_output(Session* session) {
+    size_t sent = 0;
+    while (sent < session->output.size()) {
+        ssize_t n = ::send(session->fd, session->output.data() + sent, session->output.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        close_session(session);
+        return false;
+    }
+    session->output.erase(0, sent);
+    if (session->backlog && sent > 0) {
+        // Bytes left from the previous answer count too; that only lets the
+        // worker run a little ahead.
+        {
+            std::lock_guard<std::mutex> guard(answers_latch_);
+            session->backlog->unsent -= std::min(sent, session->backlog->unsent);
+        }
+        backlog_cv_.notify_all();
+    }
+    if (session->output.empty() && session->closing) {
+        close_session(session);
+        return false;
+    }
+    update_events(session);
+    return true;
+}
+
+void Server::dispatch(Session* session) {
+    if (session->busy || session->closing) {
+        return;
+    }
+    protocol::MessageType type;
+    std::string payload;
+    size_t size;
+    try {
+        size = protocol::ParseMessage(session->input, &type, &payload, SERVER_MAX_MESSAGE_SIZE);
+    } catch (const std::exception& e) {
+        protocol::AppendMessage(&session->output, protocol::MessageType::ERROR, std::string("Error: ") + e.what() + "\n");
+        session->closing = true;
+        send_output(session);
+        return;
+    }
+    if (size == 0) {
+        update_events(session);
+        return;
+    }
+    session->input.erase(0, size);
+
+    if (type == protocol::MessageType::QUERY) {
+        session->busy = true;
+        session->backlog = std::make_shared<Backlog>();
+        {
+            std::lock_guard<std::mutex> guard(jobs_latch_);
+            jobs_.push_back(Job{session->id, std::move(payload), session->backlog});
+        }
+        jobs_cv_.notify_one();
+        update_events(session);
+        return;
+    }
+    if (type != protocol::MessageType::TERMINATE) {
+        protocol::AppendMessage(&session->output, protocol::MessageType::ERROR, "Error: Unknown message type.\n");
+    }
+    session->closing = true;
+    send_output(session);
+}
+
+void Server::update_events(Session* session) {
+    // With no events at all, epoll still reports hang-ups and errors.
+    uint32_t events = 0;
+    if (!session->busy && !session->closing) {
+        events |= EPOLLIN;
+    }
+    if (!session->output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (session->registered && events == session->events) {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = session->id;
+    epoll_ctl(epoll_fd_, session->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, session->fd, &event);
+    session->registered = true;
+    session->events = events;
+}
+
+void Server::close_session(Session* session) {
+    if (session->backlog) {
+        {
+            std::lock_guard<std::mutex> guard(answers_latch_);
+            session->backlog->closed = true;
+        }
+        backlog_cv_.notify_all();
+    }
+    ::close(session->fd); // Also removes it from the epoll set
+    sessions_.erase(session->id);
+}
+
+void Server::deliver_answers() {
+    std::vector<Answer> answers;
+    {
+        std::lock_guard<std::mutex> guard(answers_latch_);
+        answers.swap(answers_);
+    }
+    for (Answer& answer : answers) {
+        auto it = sessions_.find(answer.session_id);
+        if (it == sessions_.end()) {
+            continue; // The client left while its command ran
+        }
+        Session* session = it->second.get();
+        session->output += answer.messages;
+        if (answer.last) {
+            session->busy = false;
+            session->backlog.reset();
+        }
+        if (send_output(session) && answer.last) {
+            dispatch(session); // A command sent before the answer arrived
+        }
+    }
+}
+
+void Server::worker_loop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_latch_);
+            jobs_cv_.wait(lock, [this] { return stopping_workers_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        auto post = [this, &job](std::string messages) { return post_answer(job, std::move(messages), false); };
+        FrameBuffer out_buffer(protocol::MessageType::OUTPUT, post);
+        FrameBuffer err_buffer(protocol::MessageType::ERROR, post);
+        std::ostream out(&out_buffer);
+        std::ostream err(&err_buffer);
+        try {
+            processor_->Run(job.command, out, err);
+        } catch (const std::exception& e) {
+            err << "Error: " << e.what() << std::endl;
+        }
+        out_buffer.Finish();
+        err_buffer.Finish();
+        std::string ready;
+        protocol::AppendMessage(&ready, protocol::MessageType::READY);
+        post_answer(job, std::move(ready), true);
+    }
+}
+
+bool Server::post_answer(const Job& job, std::string messages, bool last) {
+    {
+        std::unique_lock<std::mutex> lock(answers_latch_);
+        Backlog& backlog = *job.backlog;
+        if (!last) {
+            backlog_cv_.wait(lock, [&backlog] { return backlog.closed || backlog.unsent < SERVER_OUTPUT_WINDOW; });
+            if (backlog.closed) {
+                return false;
+            }
+        }
+        backlog.unsent += messages.size();
+        answers_.push_back(Answer{job.session_id, std::move(messages), last});
+    }
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+    return true;
+}
+
+} // namespace db
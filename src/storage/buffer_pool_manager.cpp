@@ -1,133 +1,268 @@
 #include "columnar_db/storage/buffer_pool_manager.h"
+#include "columnar_db/common/metrics.h"
+#include "columnar_db/common/numa.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
 #include <stdexcept>
 #include <vector> // Need this for the temp buffer
 
 namespace db {
 
-BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager* disk_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), pages_(pool_size) {
-    for (size_t i = 0; i < pool_size_; ++i) {
-        free_list_.push_back(i);
+BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager* disk_manager, LogManager* log_manager,
+                                     size_t compressed_cache_size, bool numa_aware)
+    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager), numa_aware_(numa_aware),
+      pages_(pool_size), reading_(pool_size, false) {
+    if (compressed_cache_size > 0) {
+        compressed_cache_ = std::make_unique<CompressedPageCache>(compressed_cache_size);
+    }
+    if (!numa_aware_) {
+        frame_memory_.assign(pool_size * PAGE_SIZE, 0);
+        free_lists_.resize(1);
+        for (size_t i = 0; i < pool_size_; ++i) {
+            pages_[i].data_ = &frame_memory_[i * PAGE_SIZE];
+            free_lists_[0].push_back(i);
+        }
+        return;
+    }
+
+    // Node n gets frames [n * pool_size / nodes, (n + 1) * pool_size / nodes).
+    const NumaTopology& topology = NumaTopology::Get();
+    const size_t nodes = topology.NodeCount();
+    free_lists_.resize(nodes);
+    frame_nodes_.resize(pool_size_);
+    for (size_t node = 0; node < nodes; ++node) {
+        const size_t first = node * pool_size_ / nodes;
+        const size_t count = (node + 1) * pool_size_ / nodes - first;
+        if (count == 0) {
+            continue;
+        }
+        char* memory = static_cast<char*>(topology.AllocateOnNode(count * PAGE_SIZE, static_cast<int>(node)));
+        arenas_.push_back(NodeArena{memory, count});
+        for (size_t i = 0; i < count; ++i) {
+            pages_[first + i].data_ = memory + i * PAGE_SIZE;
+            frame_nodes_[first + i] = node;
+            free_lists_[node].push_back(static_cast<frame_id_t>(first + i));
+        }
+    }
+}
+
+BufferPoolManager::BufferPoolManager(DiskManager* disk_manager)
+    : pool_size_(0), disk_manager_(disk_manager), log_manager_(nullptr),
+      mapped_pages_(disk_manager->GetPageCount()), mapped_verified_(disk_manager->GetPageCount()) {
+    // Page objects are never written through: the mapping is read-only.
+    char* base = const_cast<char*>(disk_manager_->Map());
+    for (size_t i = 0; i < mapped_pages_.size(); ++i) {
+        mapped_pages_[i].page_id_ = static_cast<page_id_t>(i);
+        mapped_pages_[i].data_ = base + i * PAGE_SIZE;
     }
 }
 
 BufferPoolManager::~BufferPoolManager() {
     FlushAllPages();
+    for (const NodeArena& arena : arenas_) {
+        NumaTopology::Free(arena.memory, arena.frame_count * PAGE_SIZE);
+    }
 }
 
 Page* BufferPoolManager::FetchPage(page_id_t page_id) {
-    // Use std::unique_lock to allow manually unlocking
-    std::unique_lock<std::mutex> lock(latch_);
-
-    // 1. Search for page in the buffer pool page table.
-    if (page_table_.count(page_id)) {
-        frame_id_t frame_id = page_table_[page_id];
-        pages_[frame_id].pin_count_++;
-        update_replacer(frame_id);
-        return &pages_[frame_id];
+    if (IsReadOnly()) {
+        if (page_id < 0 || static_cast<size_t>(page_id) >= mapped_pages_.size()) {
+            return nullptr;
+        }
+        // Pages are checked the first time they are used rather than all up front.
+        if (!mapped_verified_[page_id].load(std::memory_order_acquire)) {
+            if (!DiskManager::VerifyPage(page_id, mapped_pages_[page_id].data_)) {
+                std::cerr << "Error: Page " << page_id << " failed its checksum." << std::endl;
+                return nullptr;
+            }
+            mapped_verified_[page_id].store(true, std::memory_order_release);
+        }
+        Metrics::Add(Counter::BUFFER_POOL_HITS);
+        return &mapped_pages_[page_id];
     }
 
-    // 2. If not found, find a replacement frame (from free list or by evicting).
+    // Use std::unique_lock to allow manually unlocking
+    std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+    lock_latch(&lock);
+
     frame_id_t frame_id;
-    if (!free_list_.empty()) {
-        frame_id = free_list_.front();
-        free_list_.pop_front();
-    } else {
-        if (!find_victim_frame(&frame_id)) {
-            return nullptr; // No page can be evicted.
+    Eviction eviction;
+
+    // 1. Search for page in the buffer pool page table. A page whose
+    //    write-back as a victim is still running is waited for: reading it
+    //    earlier would find the old copy on disk, and a second write-back of
+    //    it could overtake the first.
+    while (true) {
+        auto it = page_table_.find(page_id);
+        if (it != page_table_.end()) {
+            const frame_id_t hit = it->second;
+            pages_[hit].pin_count_++;
+            update_replacer(hit);
+            Metrics::Add(Counter::BUFFER_POOL_HITS);
+            if (reading_[hit]) {
+                // Another thread is reading the page in.
+                wait_for_io(&lock, [this, hit] { return !reading_[hit]; });
+                if (pages_[hit].page_id_ != page_id) {
+                    release_failed_frame(hit); // The read failed
+                    return nullptr;
+                }
+            }
+            return &pages_[hit];
+        }
+        if (writing_.count(page_id) != 0) {
+            wait_for_io(&lock, [this, page_id] { return writing_.count(page_id) == 0; });
+            continue;
+        }
+
+        // 2. If not found, find a replacement frame (from free list or by
+        //    evicting). With every frame pinned, wait for one to be unpinned
+        //    and look again: another thread may have read the page meanwhile.
+        if (take_frame(&frame_id, &eviction)) {
+            break;
         }
+        wait_for_frame(&lock);
     }
+    Metrics::Add(Counter::BUFFER_POOL_MISSES);
 
     // 3. We have a victim frame. Get its details *while holding the latch*.
     bool victim_is_dirty = pages_[frame_id].is_dirty_;
     page_id_t victim_page_id = pages_[frame_id].page_id();
+    lsn_t victim_lsn = pages_[frame_id].page_lsn_;
     
-    // Copy dirty data to a temp buffer *while holding the latch*.
+    // Copy dirty data to a temp buffer *while holding the latch*, unless the
+    // eviction copied it already.
     std::vector<char> temp_data;
+    if (victim_is_dirty && eviction.data == nullptr) {
+        temp_data.assign(pages_[frame_id].data_, pages_[frame_id].data_ + PAGE_SIZE);
+    }
+    const char* victim_data = eviction.data != nullptr ? eviction.data->data() : temp_data.data();
     if (victim_is_dirty) {
-        temp_data.assign(pages_[frame_id].data(), pages_[frame_id].data() + PAGE_SIZE);
+        writing_.insert(victim_page_id);
     }
 
-    // 4. Update page metadata for the NEW page.
+    // 4. Update page metadata for the NEW page. Until it is read in, a
+    //    thread that finds it in the page table waits on reading_.
     page_table_[page_id] = frame_id;
     pages_[frame_id].page_id_ = page_id;
     pages_[frame_id].pin_count_ = 1;
     pages_[frame_id].is_dirty_ = false;
+    pages_[frame_id].page_lsn_ = INVALID_LSN;
     pages_[frame_id].reset_memory();
     replacer_.push_front(frame_id);
+    reading_[frame_id] = true;
+
+    // A page in the compressed tier is as current as the one on disk, or more:
+    // a dirty page enters evicting_ before its write-back starts, and we got
+    // here only once that write-back completed.
+    bool in_tier = false;
+    if (compressed_cache_ != nullptr) {
+        auto pending = evicting_.find(page_id);
+        if (pending != evicting_.end()) {
+            std::memcpy(pages_[frame_id].data_, pending->second->data(), PAGE_SIZE);
+            evicting_.erase(pending);
+            Metrics::Add(Counter::COMPRESSED_CACHE_HITS);
+            in_tier = true;
+        } else {
+            in_tier = compressed_cache_->Take(page_id, pages_[frame_id].data_);
+        }
+    }
 
     // 5. RELEASE THE LATCH before doing any I/O.
     lock.unlock();
 
     // 6. Perform I/O *after* the latch is released.
     if (victim_is_dirty) {
-        disk_manager_->WritePage(victim_page_id, temp_data.data());
-    }
-    if (!disk_manager_->ReadPage(page_id, pages_[frame_id].data())) {
-        // I/O Error! The page is invalid (e.g., doesn't exist).
-        // We must revert our changes and return nullptr.
-        lock.lock(); // Re-acquire latch to revert state
-        
-        // Undo the changes we made in step 4
+        wait_for_log(victim_lsn);
+        disk_manager_->WritePage(victim_page_id, victim_data, victim_lsn);
+        mark_changed(victim_page_id);
+        Metrics::Add(Counter::BUFFER_POOL_WRITEBACKS);
+    }
+    const bool read = in_tier || disk_manager_->ReadPage(page_id, pages_[frame_id].data_);
+    finish_eviction(eviction);
+
+    // 7. Publish the outcome to the threads waiting on either page.
+    lock_latch(&lock);
+    if (victim_is_dirty) {
+        writing_.erase(victim_page_id);
+    }
+    reading_[frame_id] = false;
+    if (!read) {
+        // I/O Error! The page is invalid (e.g., doesn't exist). Undo step 4;
+        // the frame is freed once the threads waiting on it have let go.
         page_table_.erase(page_id);
-        replacer_.remove(frame_id); // It's at the front
-        free_list_.push_front(frame_id); // Put the frame back on the free list
-        
-        // Reset the frame's metadata to be safe
         pages_[frame_id].page_id_ = INVALID_PAGE_ID;
-        pages_[frame_id].pin_count_ = 0;
-        
-        lock.unlock();
-        return nullptr; // <--- Signal failure to caller
+        release_failed_frame(frame_id);
     }
-
-    return &pages_[frame_id];
+    lock.unlock();
+    io_cv_.notify_all();
+    return read ? &pages_[frame_id] : nullptr;
 }
 
-Page* BufferPoolManager::NewPage(page_id_t* page_id) {
-    std::unique_lock<std::mutex> lock(latch_);
+Page* BufferPoolManager::NewPage(page_id_t* page_id, page_id_t hint) {
+    if (IsReadOnly()) {
+        return nullptr;
+    }
+    std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+    lock_latch(&lock);
 
-    // 1. Find a replacement frame.
+    // 1. Find a replacement frame, waiting for one to be unpinned if need be.
     frame_id_t frame_id;
-    if (!free_list_.empty()) {
-        frame_id = free_list_.front();
-        free_list_.pop_front();
-    } else {
-        if (!find_victim_frame(&frame_id)) {
-            return nullptr;
-        }
+    Eviction eviction;
+    while (!take_frame(&frame_id, &eviction)) {
+        wait_for_frame(&lock);
     }
 
     // 2. We have a victim frame. Get its details.
     bool victim_is_dirty = pages_[frame_id].is_dirty_;
     page_id_t victim_page_id = pages_[frame_id].page_id();
+    lsn_t victim_lsn = pages_[frame_id].page_lsn_;
     std::vector<char> temp_data;
-    if (victim_is_dirty) {
-        temp_data.assign(pages_[frame_id].data(), pages_[frame_id].data() + PAGE_SIZE);
+    if (victim_is_dirty && eviction.data == nullptr) {
+        temp_data.assign(pages_[frame_id].data_, pages_[frame_id].data_ + PAGE_SIZE);
     }
+    const char* victim_data = eviction.data != nullptr ? eviction.data->data() : temp_data.data();
     
     // 3. "Reserve" the frame by pinning it and resetting.
     // We can't add to page_table_ yet, as we don't know the new page_id.
     pages_[frame_id].pin_count_ = 1; 
+    pages_[frame_id].page_lsn_ = INVALID_LSN;
     pages_[frame_id].reset_memory();
+    if (victim_is_dirty) {
+        writing_.insert(victim_page_id);
+    }
     
     // 4. RELEASE THE LATCH before doing I/O.
     lock.unlock();
 
     // 5. Perform I/O.
     if (victim_is_dirty) {
-        disk_manager_->WritePage(victim_page_id, temp_data.data());
+        wait_for_log(victim_lsn);
+        disk_manager_->WritePage(victim_page_id, victim_data, victim_lsn);
+        mark_changed(victim_page_id);
+        Metrics::Add(Counter::BUFFER_POOL_WRITEBACKS);
     }
+    finish_eviction(eviction);
     // This is also I/O:
-    page_id_t new_page_id = disk_manager_->AllocatePage();
+    page_id_t new_page_id = disk_manager_->AllocatePage(hint);
     *page_id = new_page_id;
+    mark_changed(new_page_id - new_page_id % DiskManager::PAGES_PER_GROUP); // Its space map page
 
     // 6. RE-ACQUIRE LATCH to update metadata safely.
-    lock.lock();
+    lock_latch(&lock);
+    if (victim_is_dirty) {
+        writing_.erase(victim_page_id);
+        io_cv_.notify_all();
+    }
 
     // 7. Update metadata for the new page.
     pages_[frame_id].page_id_ = new_page_id;
     pages_[frame_id].is_dirty_ = true; // New page is always dirty.
+    if (compressed_cache_ != nullptr) {
+        compressed_cache_->Erase(new_page_id); // Left over from before the page was freed
+        evicting_.erase(new_page_id);
+    }
     // pin_count_ is already 1
     
     page_table_[new_page_id] = frame_id;
@@ -137,6 +272,9 @@ Page* BufferPoolManager::NewPage(page_id_t* page_id) {
 }
 
 bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
+    if (IsReadOnly()) {
+        return true; // Mapped pages are never pinned
+    }
     // ... (This function is unchanged)
     std::lock_guard<std::mutex> lock(latch_);
 
@@ -149,16 +287,53 @@ bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
         return false; // Cannot unpin a page with pin_count <= 0.
     }
 
-    pages_[frame_id].pin_count_--;
     if (is_dirty) {
         pages_[frame_id].is_dirty_ = true;
     }
+    if (--pages_[frame_id].pin_count_ == 0) {
+        frame_cv_.notify_all();
+    }
+    return true;
+}
+
+bool BufferPoolManager::DeletePage(page_id_t page_id) {
+    if (IsReadOnly()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(latch_);
+        auto it = page_table_.find(page_id);
+        if (it != page_table_.end()) {
+            frame_id_t frame_id = it->second;
+            if (pages_[frame_id].pin_count_ > 0) {
+                return false;
+            }
+            page_table_.erase(it);
+            replacer_.remove(frame_id);
+            pages_[frame_id].page_id_ = INVALID_PAGE_ID;
+            pages_[frame_id].is_dirty_ = false;
+            pages_[frame_id].page_lsn_ = INVALID_LSN;
+            pages_[frame_id].reset_memory();
+            free_lists_[numa_aware_ ? frame_nodes_[frame_id] : 0].push_back(frame_id);
+            frame_cv_.notify_all();
+        }
+        if (compressed_cache_ != nullptr) {
+            compressed_cache_->Erase(page_id);
+            evicting_.erase(page_id);
+        }
+    }
+    disk_manager_->DeallocatePage(page_id);
+    mark_changed(page_id);
+    mark_changed(page_id - page_id % DiskManager::PAGES_PER_GROUP);
     return true;
 }
 
 bool BufferPoolManager::FlushPage(page_id_t page_id) {
     // ... (This function is unchanged, but note it also does I/O inside a lock!)
     // ... (This is OK for now, as it's not called during a fetch/new)
+    if (IsReadOnly()) {
+        return false;
+    }
     std::lock_guard<std::mutex> lock(latch_);
 
     if (!page_table_.count(page_id)) {
@@ -166,38 +341,186 @@ bool BufferPoolManager::FlushPage(page_id_t page_id) {
     }
 
     frame_id_t frame_id = page_table_[page_id];
-    disk_manager_->WritePage(page_id, pages_[frame_id].data());
+    if (reading_[frame_id]) {
+        return true; // Still being read in, so it matches the disk
+    }
+    wait_for_log(pages_[frame_id].page_lsn_);
+    disk_manager_->WritePage(page_id, pages_[frame_id].data_, pages_[frame_id].page_lsn_);
+    mark_changed(page_id);
     pages_[frame_id].is_dirty_ = false;
+    Metrics::Add(Counter::BUFFER_POOL_WRITEBACKS);
     return true;
 }
 
 void BufferPoolManager::FlushAllPages() {
+    if (IsReadOnly()) {
+        return;
+    }
     // ... (This function is unchanged)
     std::lock_guard<std::mutex> lock(latch_);
+
+    // One log flush covers every page we are about to write.
+    lsn_t max_lsn = INVALID_LSN;
+    for (auto const& [page_id, frame_id] : page_table_) {
+        if (pages_[frame_id].is_dirty_) {
+            max_lsn = std::max(max_lsn, pages_[frame_id].page_lsn_);
+        }
+    }
+    wait_for_log(max_lsn);
+
     for (auto const& [page_id, frame_id] : page_table_) {
         if (pages_[frame_id].is_dirty_) {
-            disk_manager_->WritePage(page_id, pages_[frame_id].data());
+            disk_manager_->WritePage(page_id, pages_[frame_id].data_, pages_[frame_id].page_lsn_);
+            mark_changed(page_id);
             pages_[frame_id].is_dirty_ = false;
+            Metrics::Add(Counter::BUFFER_POOL_WRITEBACKS);
         }
     }
 }
 
-bool BufferPoolManager::find_victim_frame(frame_id_t* frame_id) {
-    // ... (Ensure the WritePage call we removed earlier is still gone)
-    for (auto it = replacer_.rbegin(); it != replacer_.rend(); ++it) {
-        frame_id_t current_frame_id = *it;
-        if (pages_[current_frame_id].pin_count_ == 0) {
-            // Found a victim.
-            *frame_id = current_frame_id;
-            
-            // Remove from page table and replacer.
-            page_table_.erase(pages_[current_frame_id].page_id());
-            replacer_.erase(std::next(it).base()); // Erase using forward iterator
-            
+std::vector<uint64_t> BufferPoolManager::TakeChangedPages() {
+    std::lock_guard<std::mutex> lock(changed_latch_);
+    std::vector<uint64_t> changed;
+    changed.swap(changed_pages_);
+    return changed;
+}
+
+void BufferPoolManager::MergeChangedPages(const std::vector<uint64_t>& changed) {
+    std::lock_guard<std::mutex> lock(changed_latch_);
+    if (changed_pages_.size() < changed.size()) {
+        changed_pages_.resize(changed.size(), 0);
+    }
+    for (size_t i = 0; i < changed.size(); ++i) {
+        changed_pages_[i] |= changed[i];
+    }
+}
+
+void BufferPoolManager::Prefetch(page_id_t page_id) {
+    // Chains run through contiguous extents, so read ahead to the end of this one.
+    if (page_id != INVALID_PAGE_ID) {
+        disk_manager_->Prefetch(page_id, EXTENT_SIZE - page_id % EXTENT_SIZE);
+    }
+}
+
+bool BufferPoolManager::take_frame(frame_id_t* frame_id, Eviction* eviction) {
+    const size_t nodes = free_lists_.size();
+    const size_t home = numa_aware_ ? NumaTopology::Get().CurrentNode() % nodes : 0;
+    // A free frame of this node, then of the others, before evicting anything.
+    for (size_t i = 0; i < nodes; ++i) {
+        std::list<frame_id_t>& free_list = free_lists_[(home + i) % nodes];
+        if (!free_list.empty()) {
+            *frame_id = free_list.front();
+            free_list.pop_front();
             return true;
         }
     }
-    return false; // No victim found.
+    return find_victim_frame(frame_id, home, eviction);
+}
+
+bool BufferPoolManager::find_victim_frame(frame_id_t* frame_id, size_t node, Eviction* eviction) {
+    // The least recently used unpinned frame of `node`, or else of any node.
+    auto victim = replacer_.rend();
+    for (auto it = replacer_.rbegin(); it != replacer_.rend(); ++it) {
+        if (pages_[*it].pin_count_ != 0) {
+            continue;
+        }
+        if (victim == replacer_.rend()) {
+            victim = it;
+        }
+        if (!numa_aware_ || frame_nodes_[*it] == node) {
+            victim = it;
+            break;
+        }
+    }
+    if (victim == replacer_.rend()) {
+        return false; // No victim found.
+    }
+
+    frame_id_t current_frame_id = *victim;
+    *frame_id = current_frame_id;
+    if (compressed_cache_ != nullptr) {
+        // Compressing here would hold every FetchPage and NewPage up; only copy.
+        const char* data = pages_[current_frame_id].data_;
+        eviction->page_id = pages_[current_frame_id].page_id();
+        eviction->data = std::make_shared<std::vector<char>>(data, data + PAGE_SIZE);
+        evicting_[eviction->page_id] = eviction->data;
+    }
+
+    // Remove from page table and replacer.
+    page_table_.erase(pages_[current_frame_id].page_id());
+    replacer_.erase(std::next(victim).base()); // Erase using forward iterator
+    Metrics::Add(Counter::BUFFER_POOL_EVICTIONS);
+    return true;
+}
+
+void BufferPoolManager::finish_eviction(const Eviction& eviction) {
+    if (eviction.data == nullptr) {
+        return;
+    }
+    std::vector<char> compressed;
+    const bool keep = CompressedPageCache::Compress(eviction.data->data(), &compressed);
+
+    std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+    lock_latch(&lock);
+    auto it = evicting_.find(eviction.page_id);
+    if (it == evicting_.end() || it->second != eviction.data) {
+        return; // Fetched, freed or evicted again while we compressed it
+    }
+    evicting_.erase(it);
+    if (keep) {
+        compressed_cache_->Insert(eviction.page_id, std::move(compressed));
+    }
+}
+
+void BufferPoolManager::release_failed_frame(frame_id_t frame_id) {
+    if (--pages_[frame_id].pin_count_ == 0) {
+        replacer_.remove(frame_id);
+        free_lists_[numa_aware_ ? frame_nodes_[frame_id] : 0].push_front(frame_id);
+        frame_cv_.notify_all();
+    }
+}
+
+void BufferPoolManager::wait_for_io(std::unique_lock<std::mutex>* lock, const std::function<bool()>& done) {
+    auto start = std::chrono::steady_clock::now();
+    io_cv_.wait(*lock, done);
+    Metrics::Add(Counter::BUFFER_POOL_PIN_WAIT_NS, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                       std::chrono::steady_clock::now() - start).count());
+}
+
+void BufferPoolManager::wait_for_frame(std::unique_lock<std::mutex>* lock) {
+    auto start = std::chrono::steady_clock::now();
+    frame_cv_.wait(*lock);
+    Metrics::Add(Counter::BUFFER_POOL_PIN_WAIT_NS, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                       std::chrono::steady_clock::now() - start).count());
+}
+
+void BufferPoolManager::wait_for_log(lsn_t page_lsn) {
+    if (log_manager_ != nullptr && page_lsn != INVALID_LSN && log_manager_->GetPersistentLsn() < page_lsn) {
+        auto start = std::chrono::steady_clock::now();
+        log_manager_->WaitForFlush(page_lsn);
+        Metrics::Add(Counter::BUFFER_POOL_PIN_WAIT_NS, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                           std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+void BufferPoolManager::lock_latch(std::unique_lock<std::mutex>* lock) {
+    // Only a contended latch is worth reading the clock for.
+    if (lock->try_lock()) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    lock->lock();
+    Metrics::Add(Counter::BUFFER_POOL_PIN_WAIT_NS, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                       std::chrono::steady_clock::now() - start).count());
+}
+
+void BufferPoolManager::mark_changed(page_id_t page_id) {
+    std::lock_guard<std::mutex> lock(changed_latch_);
+    size_t word = static_cast<size_t>(page_id) / 64;
+    if (word >= changed_pages_.size()) {
+        changed_pages_.resize(word + 1, 0);
+    }
+    changed_pages_[word] |= uint64_t{1} << (page_id % 64);
 }
 
 void BufferPoolManager::update_replacer(frame_id_t frame_id) {
@@ -1,140 +1,437 @@
 #include "columnar_db/storage/catalog.h"
 #include "columnar_db/storage/page.h"
 #include "columnar_db/storage/table.h"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
 namespace db {
 
+namespace {
 
-constexpr page_id_t CATALOG_PAGE_ID = 0;
+// Page 0 belongs to the DiskManager, so the first page allocated in a new
+// database is the catalog root.
+constexpr page_id_t CATALOG_ROOT_PAGE_ID = 1;
 constexpr uint32_t DB_MAGIC_NUMBER = 0xDEADBEEF;
+constexpr uint32_t CATALOG_FORMAT_VERSION = 5;
+
+struct CatalogRootPage {
+    uint32_t magic_;
+    uint32_t version_;
+    uint32_t next_table_id_;
+    page_id_t first_entry_page_id_;
+};
+
+struct CatalogEntryPage {
+    page_id_t next_page_id_;
+    uint32_t entry_count_;
+    uint32_t used_bytes_;
+
+    static constexpr uint32_t ENTRY_AREA_SIZE = PAGE_DATA_SIZE - sizeof(page_id_t) - 2 * sizeof(uint32_t);
+    char entries_[ENTRY_AREA_SIZE];
+};
+
+// A table entry is this header followed by `column_count_` Columns and, for a
+// materialized view, `view_column_count_` ViewColumns.
+struct CatalogEntryHeader {
+    uint32_t size_; // Of the whole entry, in bytes
+    uint32_t table_id_;
+    char name_[32];
+    uint32_t column_count_;
+    int32_t sort_column_;
+    uint64_t sorted_rows_;
+    PartitionKind partition_kind_;
+    int32_t partition_column_;
+    uint32_t partition_count_;
+    uint32_t parent_table_id_;
+    int64_t partition_lo_;
+    int64_t partition_hi_;
+    uint32_t view_base_table_id_;
+    uint32_t view_column_count_;
+};
+
+uint32_t entry_size(const TableSchema& schema) {
+    return static_cast<uint32_t>(sizeof(CatalogEntryHeader) + schema.columns.size() * sizeof(Column) +
+                                 schema.view_columns.size() * sizeof(ViewColumn));
+}
+
+void write_entry(char* dest, const TableSchema& schema) {
+    CatalogEntryHeader header{};
+    header.size_ = entry_size(schema);
+    header.table_id_ = schema.table_id;
+    std::memcpy(header.name_, schema.name, sizeof(header.name_));
+    header.column_count_ = static_cast<uint32_t>(schema.columns.size());
+    header.sort_column_ = schema.sort_column;
+    header.sorted_rows_ = schema.sorted_rows;
+    header.partition_kind_ = schema.partition_kind;
+    header.partition_column_ = schema.partition_column;
+    header.partition_count_ = schema.partition_count;
+    header.parent_table_id_ = schema.parent_table_id;
+    header.partition_lo_ = schema.partition_lo;
+    header.partition_hi_ = schema.partition_hi;
+    header.view_base_table_id_ = schema.view_base_table_id;
+    header.view_column_count_ = static_cast<uint32_t>(schema.view_columns.size());
+    std::memcpy(dest, &header, sizeof(header));
+    dest += sizeof(header);
+    std::memcpy(dest, schema.columns.data(), schema.columns.size() * sizeof(Column));
+    dest += schema.columns.size() * sizeof(Column);
+    if (!schema.view_columns.empty()) {
+        std::memcpy(dest, schema.view_columns.data(), schema.view_columns.size() * sizeof(ViewColumn));
+    }
+}
+
+// Returns the offset of table `table_id`'s entry in `data_page`, or -1.
+int64_t find_entry(const CatalogEntryPage* data_page, uint32_t table_id) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < data_page->entry_count_; ++i) {
+        CatalogEntryHeader header;
+        std::memcpy(&header, data_page->entries_ + offset, sizeof(header));
+        if (header.table_id_ == table_id) {
+            return offset;
+        }
+        offset += header.size_;
+    }
+    return -1;
+}
+
+} // namespace
 
 Catalog::Catalog(BufferPoolManager* buffer_pool_manager, bool is_new_db) : bpm_(buffer_pool_manager) {
     if (is_new_db) {
         std::cout << "Initializing new database file." << std::endl;
-        PersistToDisk();
+        page_id_t root_page_id;
+        Page* root = bpm_->NewPage(&root_page_id);
+        if (root == nullptr || root_page_id != CATALOG_ROOT_PAGE_ID) {
+            throw std::runtime_error("Failed to allocate the catalog root page.");
+        }
+        bpm_->UnpinPage(root_page_id, true);
+        persist_root();
     } else {
         LoadFromDisk();
     }
 }
 
+size_t Catalog::MaxColumnCount() {
+    return (CatalogEntryPage::ENTRY_AREA_SIZE - sizeof(CatalogEntryHeader)) / sizeof(Column);
+}
+
 void Catalog::LoadFromDisk() {
-    Page* page = bpm_->FetchPage(CATALOG_PAGE_ID);
+    Page* page = bpm_->FetchPage(CATALOG_ROOT_PAGE_ID);
     if (page == nullptr) throw std::runtime_error("Failed to fetch catalog page.");
     page->r_latch();
+    CatalogRootPage root;
+    std::memcpy(&root, page->data(), sizeof(root));
+    page->r_unlatch();
+    bpm_->UnpinPage(CATALOG_ROOT_PAGE_ID, false);
 
-    char* data = page->data();
-    uint32_t magic_number;
-    std::memcpy(&magic_number, data, sizeof(uint32_t));
-    std::cout << "Magic number: " << magic_number << std::endl;
-    std::cout << "DB_MAGIC_NUMBER: " << DB_MAGIC_NUMBER << std::endl;
-
-    if (magic_number != DB_MAGIC_NUMBER) {
-        page->r_unlatch();
-        bpm_->UnpinPage(CATALOG_PAGE_ID, false);
+    if (root.magic_ != DB_MAGIC_NUMBER) {
         throw std::runtime_error("Database file is corrupted or not a valid DB file.");
     }
+    if (root.version_ != CATALOG_FORMAT_VERSION) {
+        throw std::runtime_error("Database file has catalog format version " + std::to_string(root.version_) +
+                                 "; this version reads only format " + std::to_string(CATALOG_FORMAT_VERSION) + ".");
+    }
+    next_table_id_ = root.next_table_id_;
 
-    int offset = sizeof(uint32_t);
-    int table_count;
-    std::memcpy(&table_count, data + offset, sizeof(int));
-    offset += sizeof(int);
+    page_id_t current_pid = root.first_entry_page_id_;
+    while (current_pid != INVALID_PAGE_ID) {
+        page = bpm_->FetchPage(current_pid);
+        if (page == nullptr) {
+            throw std::runtime_error("Failed to fetch catalog page " + std::to_string(current_pid) + ".");
+        }
+        page->r_latch();
+        auto* data_page = reinterpret_cast<CatalogEntryPage*>(page->data());
 
-    for (int i = 0; i < table_count; ++i) {
-        TableSchema schema;
-        std::memcpy(schema.name, data + offset, sizeof(schema.name));
-        offset += sizeof(schema.name);
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < data_page->entry_count_; ++i) {
+            CatalogEntryHeader header;
+            std::memcpy(&header, data_page->entries_ + offset, sizeof(header));
 
-        int col_count;
-        std::memcpy(&col_count, data + offset, sizeof(int));
-        offset += sizeof(int);
+            TableSchema schema;
+            std::memcpy(schema.name, header.name_, sizeof(schema.name));
+            schema.table_id = header.table_id_;
+            schema.sort_column = header.sort_column_;
+            schema.sorted_rows = header.sorted_rows_;
+            schema.partition_kind = header.partition_kind_;
+            schema.partition_column = header.partition_column_;
+            schema.partition_count = header.partition_count_;
+            schema.parent_table_id = header.parent_table_id_;
+            schema.partition_lo = header.partition_lo_;
+            schema.partition_hi = header.partition_hi_;
+            schema.view_base_table_id = header.view_base_table_id_;
+            const char* data = data_page->entries_ + offset + sizeof(header);
+            schema.columns.resize(header.column_count_);
+            std::memcpy(schema.columns.data(), data, header.column_count_ * sizeof(Column));
+            data += header.column_count_ * sizeof(Column);
+            if (header.view_column_count_ > 0) {
+                schema.view_columns.resize(header.view_column_count_);
+                std::memcpy(schema.view_columns.data(), data, header.view_column_count_ * sizeof(ViewColumn));
+            }
+            offset += header.size_;
 
-        for (int j = 0; j < col_count; ++j) {
-            Column col;
-            std::memcpy(&col, data + offset, sizeof(Column));
-            offset += sizeof(Column);
-            schema.columns.push_back(col);
+            schemas_[schema.name] = schema;
+            table_names_[schema.table_id] = schema.name;
+            entry_page_of_[schema.name] = current_pid;
+            next_table_id_ = std::max(next_table_id_, schema.table_id + 1);
         }
-        schemas_[schema.name] = schema;
-    }
+        entry_pages_.emplace_back(current_pid, CatalogEntryPage::ENTRY_AREA_SIZE - data_page->used_bytes_);
+        page_id_t next_pid = data_page->next_page_id_;
 
-    page->r_unlatch();
-    bpm_->UnpinPage(CATALOG_PAGE_ID, false);
+        page->r_unlatch();
+        bpm_->UnpinPage(current_pid, false);
+        current_pid = next_pid;
+    }
 }
 
-void Catalog::PersistToDisk() {
-    Page* page = bpm_->FetchPage(CATALOG_PAGE_ID);
+void Catalog::persist_root() {
+    Page* page = bpm_->FetchPage(CATALOG_ROOT_PAGE_ID);
     if (page == nullptr) throw std::runtime_error("Failed to fetch catalog page for persisting.");
     page->w_latch();
-    
-    char* data = page->data();
-    std::memset(data, 0, PAGE_SIZE);
 
-    int offset = 0;
-    std::memcpy(data + offset, &DB_MAGIC_NUMBER, sizeof(uint32_t));
-    offset += sizeof(uint32_t);
-    std::cout << "Offset: " << data + offset  << std::endl;
+    CatalogRootPage root{DB_MAGIC_NUMBER, CATALOG_FORMAT_VERSION, next_table_id_,
+                         entry_pages_.empty() ? INVALID_PAGE_ID : entry_pages_.front().first};
+    std::memset(page->data(), 0, PAGE_DATA_SIZE);
+    std::memcpy(page->data(), &root, sizeof(root));
 
-    int table_count = schemas_.size();
-    std::memcpy(data + offset, &table_count, sizeof(int));
-    offset += sizeof(int);
+    page->w_unlatch();
+    bpm_->UnpinPage(CATALOG_ROOT_PAGE_ID, true);
+    bpm_->FlushPage(CATALOG_ROOT_PAGE_ID);
+}
 
-    for (const auto& [name, schema] : schemas_) {
-        std::memcpy(data + offset, schema.name, sizeof(schema.name));
-        offset += sizeof(schema.name);
+void Catalog::add_entry(const TableSchema& schema) {
+    const uint32_t size = entry_size(schema);
+
+    // First fit among the existing entry pages.
+    for (auto& [page_id, free_bytes] : entry_pages_) {
+        if (free_bytes < size) {
+            continue;
+        }
+        Page* page = bpm_->FetchPage(page_id);
+        if (page == nullptr) {
+            throw std::runtime_error("Failed to fetch catalog page " + std::to_string(page_id) + ".");
+        }
+        page->w_latch();
+        auto* data_page = reinterpret_cast<CatalogEntryPage*>(page->data());
+        write_entry(data_page->entries_ + data_page->used_bytes_, schema);
+        data_page->entry_count_++;
+        data_page->used_bytes_ += size;
+        page->w_unlatch();
+        bpm_->UnpinPage(page_id, true);
+        bpm_->FlushPage(page_id);
+
+        free_bytes -= size;
+        entry_page_of_[schema.name] = page_id;
+        return;
+    }
 
-        int col_count = schema.columns.size();
-        std::memcpy(data + offset, &col_count, sizeof(int));
-        offset += sizeof(int);
+    // No room anywhere: write a new entry page, then link it in.
+    page_id_t new_pid;
+    Page* page = bpm_->NewPage(&new_pid);
+    if (page == nullptr) {
+        throw std::runtime_error("Failed to allocate a catalog page.");
+    }
+    page->w_latch();
+    auto* data_page = reinterpret_cast<CatalogEntryPage*>(page->data());
+    data_page->next_page_id_ = INVALID_PAGE_ID;
+    data_page->entry_count_ = 1;
+    data_page->used_bytes_ = size;
+    write_entry(data_page->entries_, schema);
+    page->w_unlatch();
+    bpm_->UnpinPage(new_pid, true);
+    bpm_->FlushPage(new_pid);
 
-        for (const auto& col : schema.columns) {
-            std::memcpy(data + offset, &col, sizeof(Column));
-            offset += sizeof(Column);
+    if (entry_pages_.empty()) {
+        entry_pages_.emplace_back(new_pid, CatalogEntryPage::ENTRY_AREA_SIZE - size);
+        persist_root();
+    } else {
+        page_id_t last_pid = entry_pages_.back().first;
+        Page* last = bpm_->FetchPage(last_pid);
+        if (last == nullptr) {
+            throw std::runtime_error("Failed to fetch catalog page " + std::to_string(last_pid) + ".");
         }
+        last->w_latch();
+        reinterpret_cast<CatalogEntryPage*>(last->data())->next_page_id_ = new_pid;
+        last->w_unlatch();
+        bpm_->UnpinPage(last_pid, true);
+        bpm_->FlushPage(last_pid);
+        entry_pages_.emplace_back(new_pid, CatalogEntryPage::ENTRY_AREA_SIZE - size);
     }
+    entry_page_of_[schema.name] = new_pid;
+}
 
+void Catalog::remove_entry(page_id_t page_id, uint32_t table_id) {
+    Page* page = bpm_->FetchPage(page_id);
+    if (page == nullptr) {
+        throw std::runtime_error("Failed to fetch catalog page " + std::to_string(page_id) + ".");
+    }
+    page->w_latch();
+    auto* data_page = reinterpret_cast<CatalogEntryPage*>(page->data());
+    int64_t offset = find_entry(data_page, table_id);
+    uint32_t size = 0;
+    if (offset >= 0) {
+        // Close the gap so the page's free space stays at its end.
+        std::memcpy(&size, data_page->entries_ + offset, sizeof(size));
+        std::memmove(data_page->entries_ + offset, data_page->entries_ + offset + size,
+                     data_page->used_bytes_ - offset - size);
+        data_page->entry_count_--;
+        data_page->used_bytes_ -= size;
+    }
     page->w_unlatch();
-    bpm_->UnpinPage(CATALOG_PAGE_ID, true);
-    bpm_->FlushPage(CATALOG_PAGE_ID);
+    bpm_->UnpinPage(page_id, offset >= 0);
+    bpm_->FlushPage(page_id);
+
+    for (auto& [entry_page_id, free_bytes] : entry_pages_) {
+        if (entry_page_id == page_id) {
+            free_bytes += size;
+        }
+    }
 }
 
+void Catalog::update_entry(const TableSchema& schema) {
+    page_id_t page_id = entry_page_of_.at(schema.name);
+    Page* page = bpm_->FetchPage(page_id);
+    if (page == nullptr) {
+        throw std::runtime_error("Failed to fetch catalog page " + std::to_string(page_id) + ".");
+    }
+    page->w_latch();
+    auto* data_page = reinterpret_cast<CatalogEntryPage*>(page->data());
+    int64_t offset = find_entry(data_page, schema.table_id);
+    if (offset >= 0) {
+        write_entry(data_page->entries_ + offset, schema);
+    }
+    page->w_unlatch();
+    bpm_->UnpinPage(page_id, offset >= 0);
+    bpm_->FlushPage(page_id);
+}
 
-bool Catalog::CreateTable(TableSchema& schema) {
-    if (schemas_.count(schema.name)) {
+bool Catalog::CreateTable(const TableSchema& user_schema) {
+    if (schemas_.count(user_schema.name)) {
+        return false;
+    }
+    if (user_schema.columns.size() + MVCC_COLUMN_COUNT > MaxColumnCount() ||
+        entry_size(user_schema) + MVCC_COLUMN_COUNT * sizeof(Column) > CatalogEntryPage::ENTRY_AREA_SIZE) {
         return false;
     }
 
-    for (auto& col : schema.columns) {
+    TableSchema schema = user_schema;
+    for (const char* hidden_name : {XMIN_COLUMN_NAME, XMAX_COLUMN_NAME}) {
+        Column hidden_col{};
+        std::strncpy(hidden_col.name, hidden_name, sizeof(hidden_col.name) - 1);
+        hidden_col.type = DataType::BIGINT;
+        schema.columns.push_back(hidden_col);
+    }
+
+    // If a head cannot be allocated, the ones allocated before it are given back.
+    auto free_heads = [&](size_t count) {
+        for (size_t j = 0; j < count; ++j) {
+            bpm_->DeletePage(schema.columns[j].first_page_id);
+        }
+    };
+    for (size_t i = 0; i < schema.columns.size(); ++i) {
+        Column& col = schema.columns[i];
         page_id_t first_page_id;
-        Page* first_page = bpm_->NewPage(&first_page_id);
+        Page* first_page;
+        try {
+            first_page = bpm_->NewPage(&first_page_id);
+        } catch (...) {
+            free_heads(i);
+            throw;
+        }
         if (first_page == nullptr) {
-            // Not enough space in the buffer pool.
+            free_heads(i);
             return false;
         }
 
         // --- THE FIX: Initialize the new page as an empty ColumnDataPage ---
         first_page->w_latch(); // Lock for writing
         auto* data_page = reinterpret_cast<ColumnDataPage*>(first_page->data());
-        
+
         // This is the most important line: it marks the end of the segment.
         data_page->next_page_id_ = INVALID_PAGE_ID;
         data_page->value_count_ = 0;
-        
+        data_page->page_lsn_ = 0;
+
         first_page->w_unlatch();
         // --- END FIX ---
 
         col.first_page_id = first_page_id;
-        
+
         // The page is dirty because we initialized it, so the second param is true.
+        // Write it back right away: the catalog is about to point at it, and a
+        // segment head must never be found zeroed on disk after a crash.
         bpm_->UnpinPage(first_page_id, true);
+        bpm_->FlushPage(first_page_id);
     }
 
+    // Table ids are never reused, even across restarts, so log records of a
+    // dropped table can never be replayed into a new one.
+    schema.table_id = next_table_id_++;
+    persist_root();
+    add_entry(schema);
     schemas_[schema.name] = schema;
-    PersistToDisk();
+    table_names_[schema.table_id] = schema.name;
+    return true;
+}
+
+bool Catalog::DropTable(const std::string& table_name) {
+    auto it = schemas_.find(table_name);
+    if (it == schemas_.end()) {
+        return false;
+    }
+    std::vector<const TableSchema*> dependents = GetViews(&it->second);
+    if (it->second.IsPartitioned()) {
+        std::vector<const TableSchema*> partitions = GetPartitions(&it->second);
+        dependents.insert(dependents.end(), partitions.begin(), partitions.end());
+    }
+    for (const TableSchema* dependent : dependents) {
+        if (!DropTable(dependent->name)) {
+            return false;
+        }
+    }
+
+    // Forget the table durably before its pages can be handed out again.
+    std::vector<page_id_t> first_page_ids;
+    for (const auto& col : it->second.columns) {
+        first_page_ids.push_back(col.first_page_id);
+    }
+    remove_entry(entry_page_of_.at(table_name), it->second.table_id);
+    {
+        std::lock_guard<std::mutex> guard(handles_latch_);
+        handles_.erase(it->second.table_id);
+    }
+    table_names_.erase(it->second.table_id);
+    entry_page_of_.erase(table_name);
+    schemas_.erase(it);
+
+    FreeSegments(first_page_ids);
     return true;
 }
 
+void Catalog::FreeSegments(const std::vector<page_id_t>& first_page_ids) {
+    for (page_id_t current_pid : first_page_ids) {
+        while (current_pid != INVALID_PAGE_ID) {
+            Page* page = bpm_->FetchPage(current_pid);
+            if (page == nullptr) {
+                throw std::runtime_error("Failed to fetch page " + std::to_string(current_pid) + " to free it.");
+            }
+            page->r_latch();
+            auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+            page_id_t next_pid = data_page->next_page_id_;
+            // An empty page that was never written back ends the chain (see RecoveryManager).
+            if (data_page->value_count_ == 0 && next_pid == 0) {
+                next_pid = INVALID_PAGE_ID;
+            }
+            page->r_unlatch();
+            bpm_->UnpinPage(current_pid, false);
+
+            if (!bpm_->DeletePage(current_pid)) {
+                std::cerr << "Warning: Page " << current_pid << " is in use and was not freed." << std::endl;
+            }
+            current_pid = next_pid;
+        }
+    }
+}
+
 const TableSchema* Catalog::GetTableSchema(const std::string& table_name) {
     auto it = schemas_.find(table_name);
     if (it != schemas_.end()) {
@@ -143,4 +440,118 @@ const TableSchema* Catalog::GetTableSchema(const std::string& table_name) {
     return nullptr;
 }
 
-} 
+const TableSchema* Catalog::GetTableSchema(uint32_t table_id) {
+    auto it = table_names_.find(table_id);
+    if (it != table_names_.end()) {
+        return GetTableSchema(it->second);
+    }
+    return nullptr;
+}
+
+std::vector<std::string> Catalog::GetTableNames() const {
+    std::vector<std::string> names;
+    for (const auto& [name, schema] : schemas_) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+bool Catalog::SetSortColumn(const std::string& table_name, int32_t sort_column) {
+    auto it = schemas_.find(table_name);
+    if (it == schemas_.end() || sort_column < 0 ||
+        static_cast<size_t>(sort_column) >= it->second.UserColumnCount()) {
+        return false;
+    }
+    it->second.sort_column = sort_column;
+    it->second.sorted_rows = 0;
+    update_entry(it->second);
+    {
+        std::lock_guard<std::mutex> guard(handles_latch_);
+        handles_.erase(it->second.table_id);
+    }
+    return true;
+}
+
+bool Catalog::SetPartitioning(const std::string& table_name, PartitionKind kind, int32_t partition_column,
+                              uint32_t partition_count) {
+    auto it = schemas_.find(table_name);
+    if (it == schemas_.end() || it->second.IsPartitioned() || it->second.IsPartition() || partition_column < 0 ||
+        static_cast<size_t>(partition_column) >= it->second.UserColumnCount() ||
+        (kind == PartitionKind::HASH && partition_count == 0)) {
+        return false;
+    }
+    it->second.partition_kind = kind;
+    it->second.partition_column = partition_column;
+    it->second.partition_count = kind == PartitionKind::HASH ? partition_count : 0;
+    update_entry(it->second);
+    return true;
+}
+
+bool Catalog::CreatePartition(const std::string& parent_name, const std::string& partition_name, int64_t lo,
+                              int64_t hi) {
+    auto it = schemas_.find(parent_name);
+    if (it == schemas_.end() || !it->second.IsPartitioned() || partition_name.size() >= sizeof(TableSchema::name)) {
+        return false;
+    }
+    const TableSchema& parent = it->second;
+    TableSchema partition{};
+    std::strncpy(partition.name, partition_name.c_str(), sizeof(partition.name) - 1);
+    partition.columns.assign(parent.columns.begin(), parent.columns.begin() + parent.UserColumnCount());
+    partition.sort_column = parent.sort_column;
+    partition.parent_table_id = parent.table_id;
+    partition.partition_lo = lo;
+    partition.partition_hi = hi;
+    return CreateTable(partition);
+}
+
+std::vector<const TableSchema*> Catalog::GetPartitions(const TableSchema* parent) const {
+    std::vector<const TableSchema*> partitions;
+    for (const auto& [name, schema] : schemas_) {
+        if (schema.parent_table_id == parent->table_id) {
+            partitions.push_back(&schema);
+        }
+    }
+    std::sort(partitions.begin(), partitions.end(), [](const TableSchema* a, const TableSchema* b) {
+        return a->partition_lo < b->partition_lo;
+    });
+    return partitions;
+}
+
+std::vector<const TableSchema*> Catalog::GetViews(const TableSchema* base) const {
+    std::vector<const TableSchema*> views;
+    for (const auto& [name, schema] : schemas_) {
+        if (schema.view_base_table_id == base->table_id) {
+            views.push_back(&schema);
+        }
+    }
+    return views;
+}
+
+bool Catalog::ReplaceColumnSegments(const std::string& table_name, const std::vector<page_id_t>& first_page_ids,
+                                    uint64_t sorted_rows) {
+    auto it = schemas_.find(table_name);
+    if (it == schemas_.end() || first_page_ids.size() != it->second.columns.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < first_page_ids.size(); ++i) {
+        it->second.columns[i].first_page_id = first_page_ids[i];
+    }
+    it->second.sorted_rows = it->second.sort_column >= 0 ? sorted_rows : 0;
+    update_entry(it->second);
+    {
+        std::lock_guard<std::mutex> guard(handles_latch_);
+        handles_.erase(it->second.table_id);
+    }
+    return true;
+}
+
+std::shared_ptr<TableHandle> Catalog::GetTableHandle(const TableSchema* schema) {
+    std::lock_guard<std::mutex> guard(handles_latch_);
+    std::shared_ptr<TableHandle>& handle = handles_[schema->table_id];
+    if (handle == nullptr) {
+        handle = std::make_shared<TableHandle>(schema, bpm_);
+    }
+    return handle;
+}
+
+} // namespace db
@@ -0,0 +1,436 @@
+#include "columnar_db/storage/columnar_file.h"
+#include "columnar_db/common/crc32c.h"
+#include "columnar_db/common/varint.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <limits>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace db {
+
+namespace {
+
+constexpr uint32_t COLUMNAR_MAGIC_NUMBER = 0x43534550; // "PESC"
+constexpr uint32_t COLUMNAR_FORMAT_VERSION = 1;
+constexpr size_t FILE_HEADER_SIZE = 8;
+constexpr size_t FILE_TRAILER_SIZE = 12;
+
+struct ColumnarPageHeader {
+    uint32_t crc_;
+    uint32_t value_count_;
+    uint32_t data_length_;
+    uint8_t encoding_;
+    uint8_t reserved_[3];
+};
+
+static_assert(sizeof(ColumnarPageHeader) == 16, "The page header is part of the file format");
+
+// Bytes of the header covered by the checksum, which is stored in front of them.
+constexpr size_t CHECKSUMMED_HEADER_SIZE = sizeof(ColumnarPageHeader) - sizeof(uint32_t);
+
+uint32_t page_crc(const ColumnarPageHeader& header, const char* data) {
+    uint32_t crc = Crc32c(reinterpret_cast<const char*>(&header) + sizeof(uint32_t), CHECKSUMMED_HEADER_SIZE);
+    return Crc32c(data, header.data_length_, crc);
+}
+
+// A key that sorts values of `type` by value as a signed integer. DOUBLEs
+// follow IEEE 754 totalOrder: flipping all but the sign bit of a negative
+// one makes larger magnitudes sort lower.
+int64_t order_key(DataType type, int64_t value) {
+    return type == DataType::DOUBLE && value < 0 ? value ^ std::numeric_limits<int64_t>::max() : value;
+}
+
+void put_u32(std::vector<char>* out, uint32_t value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out->insert(out->end(), bytes, bytes + sizeof(value));
+}
+
+} // namespace
+
+// --- ColumnarFileWriter ---
+
+ColumnarFileWriter::ColumnarFileWriter(const std::string& file_name, std::vector<Column> columns)
+    : file_name_(file_name), temp_name_(file_name + ".tmp"), columns_(std::move(columns)) {
+    if (columns_.empty()) {
+        throw std::runtime_error("A columnar file needs at least one column.");
+    }
+    fd_ = ::open(temp_name_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot create file " + temp_name_ + ": " + std::strerror(errno));
+    }
+    chunks_.resize(columns_.size());
+    column_rows_.assign(columns_.size(), 0);
+    page_.reserve(COLUMNAR_PAGE_VALUES);
+
+    std::vector<char> header;
+    put_u32(&header, COLUMNAR_MAGIC_NUMBER);
+    put_u32(&header, COLUMNAR_FORMAT_VERSION);
+    write_all(header.data(), header.size());
+}
+
+ColumnarFileWriter::~ColumnarFileWriter() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    if (!finished_) {
+        ::unlink(temp_name_.c_str());
+    }
+}
+
+void ColumnarFileWriter::BeginColumn(size_t col_idx) {
+    if (column_open_) {
+        flush_page();
+        if (col_idx <= current_column_) {
+            throw std::runtime_error("Columns must be written in order.");
+        }
+    }
+    if (col_idx >= columns_.size()) {
+        throw std::runtime_error("Column index out of range.");
+    }
+    current_column_ = col_idx;
+    column_open_ = true;
+}
+
+void ColumnarFileWriter::Append(const int64_t* values, size_t count) {
+    while (count > 0) {
+        // A page never spans a row group boundary.
+        uint64_t rows = column_rows_[current_column_] + page_.size();
+        size_t room = std::min<uint64_t>(COLUMNAR_PAGE_VALUES - page_.size(), ROW_GROUP_SIZE - rows % ROW_GROUP_SIZE);
+        size_t n = std::min(room, count);
+        page_.insert(page_.end(), values, values + n);
+        values += n;
+        count -= n;
+        if (n == room) {
+            flush_page();
+        }
+    }
+}
+
+void ColumnarFileWriter::flush_page() {
+    if (page_.empty()) {
+        return;
+    }
+    std::vector<ColumnChunkInfo>& chunks = chunks_[current_column_];
+    uint64_t& rows = column_rows_[current_column_];
+    if (rows % ROW_GROUP_SIZE == 0) {
+        // First page of a new row group.
+        ColumnChunkInfo chunk;
+        chunk.offset = offset_;
+        chunk.min_value = page_[0];
+        chunk.max_value = page_[0];
+        chunks.push_back(chunk);
+    }
+    ColumnChunkInfo& chunk = chunks.back();
+    const DataType type = columns_[current_column_].type;
+
+    // Delta varints unless the values are so spread out that they take more room.
+    encoded_.clear();
+    encoded_.resize(sizeof(ColumnarPageHeader));
+    int64_t prev = 0;
+    for (int64_t value : page_) {
+        PutVarint(&encoded_, ZigzagEncode(static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(prev))));
+        prev = value;
+        if (order_key(type, value) < order_key(type, chunk.min_value)) {
+            chunk.min_value = value;
+        }
+        if (order_key(type, value) > order_key(type, chunk.max_value)) {
+            chunk.max_value = value;
+        }
+    }
+    ColumnarPageHeader header{};
+    header.value_count_ = static_cast<uint32_t>(page_.size());
+    header.encoding_ = static_cast<uint8_t>(ColumnEncoding::DELTA_VARINT);
+    size_t plain_size = page_.size() * sizeof(int64_t);
+    if (encoded_.size() - sizeof(ColumnarPageHeader) > plain_size) {
+        header.encoding_ = static_cast<uint8_t>(ColumnEncoding::PLAIN);
+        encoded_.resize(sizeof(ColumnarPageHeader) + plain_size);
+        std::memcpy(encoded_.data() + sizeof(ColumnarPageHeader), page_.data(), plain_size);
+    }
+    header.data_length_ = static_cast<uint32_t>(encoded_.size() - sizeof(ColumnarPageHeader));
+    header.crc_ = page_crc(header, encoded_.data() + sizeof(ColumnarPageHeader));
+    std::memcpy(encoded_.data(), &header, sizeof(header));
+    write_all(encoded_.data(), encoded_.size());
+
+    chunk.length += encoded_.size();
+    chunk.page_count++;
+    rows += page_.size();
+    page_.clear();
+}
+
+void ColumnarFileWriter::Finish() {
+    if (column_open_) {
+        flush_page();
+        column_open_ = false;
+    }
+    for (uint64_t rows : column_rows_) {
+        if (rows != column_rows_[0]) {
+            throw std::runtime_error("Every column of a columnar file must have the same number of rows.");
+        }
+    }
+
+    std::vector<char> footer;
+    PutVarint(&footer, columns_.size());
+    for (const Column& col : columns_) {
+        size_t name_length = strnlen(col.name, sizeof(col.name));
+        PutVarint(&footer, name_length);
+        footer.insert(footer.end(), col.name, col.name + name_length);
+        PutVarint(&footer, static_cast<uint64_t>(col.type));
+    }
+    const size_t row_groups = chunks_[0].size();
+    PutVarint(&footer, row_groups);
+    for (size_t rg = 0; rg < row_groups; ++rg) {
+        PutVarint(&footer, std::min<uint64_t>(ROW_GROUP_SIZE, column_rows_[0] - rg * ROW_GROUP_SIZE));
+        for (size_t c = 0; c < columns_.size(); ++c) {
+            const ColumnChunkInfo& chunk = chunks_[c][rg];
+            PutVarint(&footer, chunk.offset);
+            PutVarint(&footer, chunk.length);
+            PutVarint(&footer, chunk.page_count);
+            PutVarint(&footer, ZigzagEncode(chunk.min_value));
+            PutVarint(&footer, ZigzagEncode(chunk.max_value));
+        }
+    }
+    uint32_t footer_length = static_cast<uint32_t>(footer.size());
+    uint32_t footer_crc = Crc32c(footer.data(), footer.size());
+    put_u32(&footer, footer_length);
+    put_u32(&footer, footer_crc);
+    put_u32(&footer, COLUMNAR_MAGIC_NUMBER);
+    write_all(footer.data(), footer.size());
+
+    if (::fsync(fd_) != 0) {
+        throw std::runtime_error("Failed to sync file " + temp_name_ + ": " + std::strerror(errno));
+    }
+    ::close(fd_);
+    fd_ = -1;
+    if (std::rename(temp_name_.c_str(), file_name_.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + temp_name_ + " to " + file_name_ + ": " + std::strerror(errno));
+    }
+    finished_ = true;
+}
+
+void ColumnarFileWriter::write_all(const char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::write(fd_, data + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Failed to write file " + temp_name_ + ": " + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+    offset_ += size;
+}
+
+// --- ColumnarFileReader ---
+
+ColumnarFileReader::ColumnarFileReader(const std::string& file_name) : file_name_(file_name) {
+    fd_ = ::open(file_name_.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open file " + file_name_ + ": " + std::strerror(errno));
+    }
+    struct stat stat_buf;
+    if (::fstat(fd_, &stat_buf) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Cannot stat file " + file_name_);
+    }
+    file_size_ = static_cast<uint64_t>(stat_buf.st_size);
+
+    try {
+        const std::string not_columnar = file_name_ + " is not a valid columnar file.";
+        if (file_size_ < FILE_HEADER_SIZE + FILE_TRAILER_SIZE) {
+            throw std::runtime_error(not_columnar);
+        }
+        uint32_t header[2];
+        read_exact(0, reinterpret_cast<char*>(header), sizeof(header));
+        uint32_t trailer[3]; // footer length, footer crc, magic
+        read_exact(file_size_ - FILE_TRAILER_SIZE, reinterpret_cast<char*>(trailer), sizeof(trailer));
+        if (header[0] != COLUMNAR_MAGIC_NUMBER || trailer[2] != COLUMNAR_MAGIC_NUMBER) {
+            throw std::runtime_error(not_columnar);
+        }
+        if (header[1] != COLUMNAR_FORMAT_VERSION) {
+            throw std::runtime_error("Unsupported columnar file version " + std::to_string(header[1]) + " in " + file_name_);
+        }
+        if (trailer[0] > file_size_ - FILE_HEADER_SIZE - FILE_TRAILER_SIZE) {
+            throw std::runtime_error(not_columnar);
+        }
+
+        const uint64_t footer_offset = file_size_ - FILE_TRAILER_SIZE - trailer[0];
+        std::vector<char> footer(trailer[0]);
+        read_exact(footer_offset, footer.data(), footer.size());
+        if (Crc32c(footer.data(), footer.size()) != trailer[1]) {
+            throw std::runtime_error("Checksum mismatch in the footer of " + file_name_);
+        }
+
+        const char* p = footer.data();
+        const char* end = p + footer.size();
+        auto next = [&]() {
+            uint64_t value;
+            if (!GetVarint(&p, end, &value)) {
+                throw std::runtime_error("Truncated footer in " + file_name_);
+            }
+            return value;
+        };
+
+        uint64_t column_count = next();
+        if (column_count == 0 || column_count > footer.size()) {
+            throw std::runtime_error(not_columnar);
+        }
+        for (uint64_t c = 0; c < column_count; ++c) {
+            Column col{};
+            uint64_t name_length = next();
+            if (name_length >= sizeof(col.name) || name_length > static_cast<uint64_t>(end - p)) {
+                throw std::runtime_error("Invalid column name in " + file_name_);
+            }
+            std::memcpy(col.name, p, name_length);
+            p += name_length;
+            col.type = static_cast<DataType>(next());
+            col.first_page_id = INVALID_PAGE_ID;
+            columns_.push_back(col);
+        }
+
+        uint64_t row_groups = next();
+        if (row_groups > footer.size()) {
+            throw std::runtime_error(not_columnar);
+        }
+        for (uint64_t rg = 0; rg < row_groups; ++rg) {
+            row_group_rows_.push_back(next());
+            std::vector<ColumnChunkInfo> chunks(column_count);
+            for (ColumnChunkInfo& chunk : chunks) {
+                chunk.offset = next();
+                chunk.length = next();
+                chunk.page_count = static_cast<uint32_t>(next());
+                chunk.min_value = ZigzagDecode(next());
+                chunk.max_value = ZigzagDecode(next());
+                if (chunk.offset < FILE_HEADER_SIZE || chunk.length > footer_offset ||
+                    chunk.offset > footer_offset - chunk.length) {
+                    throw std::runtime_error("Column chunk out of bounds in " + file_name_);
+                }
+            }
+            chunks_.push_back(std::move(chunks));
+        }
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+ColumnarFileReader::~ColumnarFileReader() {
+    ::close(fd_);
+}
+
+uint64_t ColumnarFileReader::GetRowCount() const {
+    uint64_t rows = 0;
+    for (uint64_t rg_rows : row_group_rows_) {
+        rows += rg_rows;
+    }
+    return rows;
+}
+
+void ColumnarFileReader::ReadRowGroup(size_t row_group, std::vector<std::vector<int64_t>>* columns) const {
+    const std::vector<ColumnChunkInfo>& chunks = chunks_[row_group];
+    const uint64_t rows = row_group_rows_[row_group];
+    columns->assign(columns_.size(), {});
+
+    // Each worker decodes whole chunks; there is nothing to share between them.
+    size_t worker_count = std::min<size_t>(columns_.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::atomic<size_t> next_column{0};
+    std::vector<std::exception_ptr> errors(worker_count);
+    auto work = [&](size_t worker) {
+        try {
+            for (size_t c = next_column++; c < columns_.size(); c = next_column++) {
+                read_chunk(chunks[c], rows, &(*columns)[c]);
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < worker_count; ++i) {
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void ColumnarFileReader::read_chunk(const ColumnChunkInfo& chunk, uint64_t rows, std::vector<int64_t>* out) const {
+    const std::string corrupted = "Corrupted column chunk at offset " + std::to_string(chunk.offset) + " in " + file_name_;
+    std::vector<char> buffer(chunk.length);
+    read_exact(chunk.offset, buffer.data(), buffer.size());
+    out->reserve(rows);
+
+    const char* p = buffer.data();
+    const char* end = p + buffer.size();
+    for (uint32_t page = 0; page < chunk.page_count; ++page) {
+        ColumnarPageHeader header;
+        if (static_cast<size_t>(end - p) < sizeof(header)) {
+            throw std::runtime_error(corrupted);
+        }
+        std::memcpy(&header, p, sizeof(header));
+        p += sizeof(header);
+        if (header.data_length_ > static_cast<size_t>(end - p) || page_crc(header, p) != header.crc_) {
+            throw std::runtime_error(corrupted);
+        }
+        if (header.value_count_ > rows - out->size()) {
+            throw std::runtime_error(corrupted);
+        }
+
+        const char* data_end = p + header.data_length_;
+        if (header.encoding_ == static_cast<uint8_t>(ColumnEncoding::PLAIN)) {
+            if (header.data_length_ != header.value_count_ * sizeof(int64_t)) {
+                throw std::runtime_error(corrupted);
+            }
+            size_t old_size = out->size();
+            out->resize(old_size + header.value_count_);
+            std::memcpy(out->data() + old_size, p, header.data_length_);
+        } else if (header.encoding_ == static_cast<uint8_t>(ColumnEncoding::DELTA_VARINT)) {
+            int64_t value = 0;
+            for (uint32_t i = 0; i < header.value_count_; ++i) {
+                uint64_t delta;
+                if (!GetVarint(&p, data_end, &delta)) {
+                    throw std::runtime_error(corrupted);
+                }
+                value = static_cast<int64_t>(static_cast<uint64_t>(value) + static_cast<uint64_t>(ZigzagDecode(delta)));
+                out->push_back(value);
+            }
+        } else {
+            throw std::runtime_error("Unknown page encoding " + std::to_string(header.encoding_) + " in " + file_name_);
+        }
+        p = data_end;
+    }
+    if (out->size() != rows) {
+        throw std::runtime_error(corrupted);
+    }
+}
+
+void ColumnarFileReader::read_exact(uint64_t offset, char* buffer, size_t size) const {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd_, buffer + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Failed to read file " + file_name_ + (n < 0 ? ": " + std::string(std::strerror(errno)) : ""));
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+} // namespace db
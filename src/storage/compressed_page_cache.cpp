@@ -0,0 +1,58 @@
+#include "columnar_db/storage/compressed_page_cache.h"
+#include "columnar_db/common/lz.h"
+#include "columnar_db/common/metrics.h"
+#include <iterator>
+
+namespace db {
+
+bool CompressedPageCache::Compress(const char* data, std::vector<char>* compressed) {
+    LzCompress(data, PAGE_SIZE, compressed);
+    if (compressed->size() > COMPRESSED_PAGE_MAX_SIZE) {
+        return false; // Not worth the space; the page is read from disk again.
+    }
+    compressed->shrink_to_fit();
+    return true;
+}
+
+void CompressedPageCache::Insert(page_id_t page_id, std::vector<char> compressed) {
+    Erase(page_id);
+    const size_t bytes = compressed.size();
+    lru_.push_front(Entry{page_id, std::move(compressed)});
+    entries_.emplace(page_id, lru_.begin());
+    size_ += entry_size(lru_.front());
+    Metrics::Add(Counter::COMPRESSED_CACHE_INSERTS);
+    Metrics::Add(Counter::COMPRESSED_CACHE_INSERT_BYTES, bytes);
+    while (size_ > capacity_) {
+        erase(std::prev(lru_.end()));
+        Metrics::Add(Counter::COMPRESSED_CACHE_EVICTIONS);
+    }
+}
+
+bool CompressedPageCache::Take(page_id_t page_id, char* data) {
+    auto it = entries_.find(page_id);
+    if (it == entries_.end()) {
+        Metrics::Add(Counter::COMPRESSED_CACHE_MISSES);
+        return false;
+    }
+    const std::vector<char>& compressed = it->second->data;
+    const bool ok = LzDecompress(compressed.data(), compressed.size(), data, PAGE_SIZE);
+    erase(it->second);
+    // A copy that fails to decompress is dropped, and the page read from disk.
+    Metrics::Add(ok ? Counter::COMPRESSED_CACHE_HITS : Counter::COMPRESSED_CACHE_MISSES);
+    return ok;
+}
+
+void CompressedPageCache::Erase(page_id_t page_id) {
+    auto it = entries_.find(page_id);
+    if (it != entries_.end()) {
+        erase(it->second);
+    }
+}
+
+void CompressedPageCache::erase(std::list<Entry>::iterator it) {
+    size_ -= entry_size(*it);
+    entries_.erase(it->page_id);
+    lru_.erase(it);
+}
+
+} // namespace db
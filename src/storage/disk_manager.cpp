@@ -1,94 +1,479 @@
 #include "columnar_db/storage/disk_manager.h"
+#include "columnar_db/common/crc32c.h"
+#include "columnar_db/common/metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/falloc.h>
 #include <stdexcept>
+#include <sys/mman.h>
 #include <sys/stat.h>
-#include <vector>
+#include <unistd.h>
 
 namespace db {
 
-DiskManager::DiskManager(const std::string& db_file) : file_name_(std::move(db_file)) {
-    file_stream_.open(file_name_, std::ios::in | std::ios::out | std::ios::binary);
+namespace {
 
-    bool is_new_db = false;
-    if (!file_stream_.is_open()) {
-        // File doesn't exist, create it with 'trunc'
-        file_stream_.open(file_name_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
-        if (!file_stream_.is_open()) {
-            throw std::runtime_error("Cannot create or open database file: " + file_name_);
+constexpr uint32_t FILE_MAGIC_NUMBER = 0x50455344; // "PESD"
+constexpr uint32_t FILE_FORMAT_VERSION = 3;
+
+// Header of every page. The checksum covers everything after itself.
+struct PageHeader {
+    uint32_t checksum_;
+    page_id_t page_id_;
+    lsn_t lsn_;
+};
+
+static_assert(sizeof(PageHeader) == PAGE_HEADER_SIZE, "PAGE_HEADER_SIZE must match the page header");
+
+uint32_t page_checksum(const char* page_data) {
+    return Crc32c(page_data + sizeof(uint32_t), PAGE_SIZE - sizeof(uint32_t));
+}
+
+bool is_zero_page(const char* page_data) {
+    static const char zero_page[PAGE_SIZE] = {};
+    return std::memcmp(page_data, zero_page, PAGE_SIZE) == 0;
+}
+
+constexpr page_id_t SCRUB_BATCH_PAGES = 256; // Pages read per pread while scrubbing
+
+// Header of every space map page, after the page header; the rest of the page is the bitmap.
+struct SpaceMapHeader {
+    uint32_t magic_;
+    uint32_t version_;
+    uint32_t group_;
+    uint32_t reserved_;
+};
+
+static_assert(sizeof(SpaceMapHeader) == 16, "PAGES_PER_GROUP assumes a 16-byte space map header");
+static_assert(64 % EXTENT_SIZE == 0, "An extent's bits must lie within one bitmap word");
+static_assert(DiskManager::PAGES_PER_GROUP % 64 == 0 && DiskManager::PAGES_PER_GROUP % EXTENT_SIZE == 0,
+              "Groups must hold whole bitmap words and whole extents");
+
+constexpr size_t WORDS_PER_GROUP = DiskManager::PAGES_PER_GROUP / 64;
+constexpr page_id_t EXTENTS_PER_GROUP = DiskManager::PAGES_PER_GROUP / EXTENT_SIZE;
+constexpr uint64_t EXTENT_MASK = EXTENT_SIZE == 64 ? ~uint64_t{0} : ((uint64_t{1} << EXTENT_SIZE) - 1);
+
+} // namespace
+
+DiskManager::DiskManager(const std::string& db_file, bool read_only)
+    : file_name_(std::move(db_file)), read_only_(read_only) {
+    fd_ = read_only_ ? ::open(file_name_.c_str(), O_RDONLY) : ::open(file_name_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot create or open database file: " + file_name_);
+    }
+
+    struct stat stat_buf;
+    if (::fstat(fd_, &stat_buf) != 0) {
+        throw std::runtime_error("Cannot stat database file: " + file_name_);
+    }
+    next_page_id_ = static_cast<page_id_t>(stat_buf.st_size / PAGE_SIZE);
+
+    if (next_page_id_ == 0) {
+        if (read_only_) {
+            throw std::runtime_error("Cannot open an empty database file read-only: " + file_name_);
         }
-        is_new_db = true;
+        grow(); // Creates page 0, the first space map
+    } else {
+        load_space_maps();
     }
+}
 
-    // Manually seek to the end to get the size
-    file_stream_.seekg(0, std::ios::end);
-    off_t file_size = file_stream_.tellg();
-    next_page_id_ = file_size / PAGE_SIZE;
+DiskManager::~DiskManager() {
+    if (!read_only_ && fd_ >= 0) {
+        // Every page is written back by now, so the exact maps can replace the
+        // claimed extents (see claim_extent).
+        try {
+            std::lock_guard<std::mutex> lock(latch_);
+            for (page_id_t group = 0; group < static_cast<page_id_t>(dirty_groups_.size()); ++group) {
+                if (dirty_groups_[group] || group_has_claims(group)) {
+                    write_space_map(group, true);
+                }
+            }
+            ::fsync(fd_);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+    if (mapping_ != nullptr) {
+        ::munmap(mapping_, static_cast<size_t>(next_page_id_) * PAGE_SIZE);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
 
+void DiskManager::Sync() {
+    std::lock_guard<std::mutex> lock(latch_);
+    LatencyTimer timer(Histogram::DISK_SYNC_LATENCY);
+    Metrics::Add(Counter::DISK_SYNCS);
+    for (page_id_t group = 0; group < static_cast<page_id_t>(dirty_groups_.size()); ++group) {
+        if (dirty_groups_[group]) {
+            write_space_map(group, false);
+        }
+    }
+    if (::fsync(fd_) != 0) {
+        throw std::runtime_error("Failed to sync database file: " + file_name_);
+    }
+}
 
-    if (is_new_db || file_size == 0) {
-        allocate_and_zero_out_page(0); // Allocate space for Page 0
-        next_page_id_ = 1; 
+void DiskManager::Prefetch(page_id_t page_id, page_id_t count) {
+    count = std::min(count, next_page_id_ - page_id);
+    if (page_id < 0 || count <= 0) {
+        return;
+    }
+    if (mapping_ != nullptr) {
+        ::madvise(mapping_ + static_cast<size_t>(page_id) * PAGE_SIZE, static_cast<size_t>(count) * PAGE_SIZE,
+                  MADV_WILLNEED);
+    } else {
+        ::posix_fadvise(fd_, static_cast<off_t>(page_id) * PAGE_SIZE, static_cast<off_t>(count) * PAGE_SIZE,
+                        POSIX_FADV_WILLNEED);
     }
 }
 
-DiskManager::~DiskManager() {
-    if (file_stream_.is_open()) {
-        file_stream_.close();
+const char* DiskManager::Map() {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (!read_only_) {
+        throw std::runtime_error("Only a read-only database file can be mapped.");
+    }
+    if (mapping_ == nullptr) {
+        void* addr = ::mmap(nullptr, static_cast<size_t>(next_page_id_) * PAGE_SIZE, PROT_READ, MAP_SHARED, fd_, 0);
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error("Failed to map database file: " + std::string(std::strerror(errno)));
+        }
+        mapping_ = static_cast<char*>(addr);
+        // Scans walk column chains, which run through contiguous extents.
+        ::madvise(mapping_, static_cast<size_t>(next_page_id_) * PAGE_SIZE, MADV_SEQUENTIAL);
+    }
+    return mapping_;
+}
+
+void DiskManager::read_exact(off_t offset, char* buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd_, buffer + done, size - done, offset + static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw std::runtime_error("Failed to read database file: " + std::string(std::strerror(errno)));
+        }
+        if (n == 0) {
+            // Past the end of the file: the rest reads as zeros.
+            std::memset(buffer + done, 0, size - done);
+            return;
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+void DiskManager::write_exact(off_t offset, const char* buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pwrite(fd_, buffer + done, size - done, offset + static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Failed to write database file: " + std::string(std::strerror(errno)));
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+void DiskManager::load_space_maps() {
+    page_id_t groups = (next_page_id_ + PAGES_PER_GROUP - 1) / PAGES_PER_GROUP;
+    used_.assign(groups * WORDS_PER_GROUP, 0);
+
+    char buffer[PAGE_SIZE];
+    for (page_id_t group = 0; group < groups; ++group) {
+        read_exact(static_cast<off_t>(group) * PAGES_PER_GROUP * PAGE_SIZE, buffer, PAGE_SIZE);
+        SpaceMapHeader header;
+        if (!VerifyPage(group * PAGES_PER_GROUP, buffer)) {
+            throw std::runtime_error("Space map page " + std::to_string(group * PAGES_PER_GROUP) +
+                                     " failed its checksum, or the file is not a valid DB file: " + file_name_);
+        }
+        std::memcpy(&header, buffer + PAGE_HEADER_SIZE, sizeof(header));
+        if (header.magic_ != FILE_MAGIC_NUMBER || header.version_ != FILE_FORMAT_VERSION ||
+            header.group_ != static_cast<uint32_t>(group)) {
+            throw std::runtime_error("Database file is corrupted or not a valid DB file: " + file_name_);
+        }
+        std::memcpy(&used_[group * WORDS_PER_GROUP], buffer + PAGE_HEADER_SIZE + sizeof(header),
+                    WORDS_PER_GROUP * sizeof(uint64_t));
+    }
+
+    dirty_groups_.assign(groups, false);
+    claimed_.assign(groups * EXTENTS_PER_GROUP, false);
+
+    free_page_count_ = 0;
+    for (page_id_t page_id = 0; page_id < next_page_id_; ++page_id) {
+        free_page_count_ += is_used(page_id) ? 0 : 1;
+    }
+    for (page_id_t extent = 0; extent < next_page_id_ / EXTENT_SIZE; ++extent) {
+        if (extent_used_count(extent) == 0) {
+            free_extents_.insert(extent);
+        }
+    }
+}
+
+void DiskManager::write_space_map(page_id_t group, bool exact) {
+    char buffer[PAGE_SIZE] = {};
+    SpaceMapHeader header{FILE_MAGIC_NUMBER, FILE_FORMAT_VERSION, static_cast<uint32_t>(group), 0};
+    std::memcpy(buffer + PAGE_HEADER_SIZE, &header, sizeof(header));
+    uint64_t words[WORDS_PER_GROUP];
+    std::memcpy(words, &used_[group * WORDS_PER_GROUP], sizeof(words));
+    if (!exact) {
+        for (page_id_t i = 0; i < EXTENTS_PER_GROUP; ++i) {
+            if (claimed_[group * EXTENTS_PER_GROUP + i]) {
+                page_id_t first = i * EXTENT_SIZE;
+                words[first / 64] |= EXTENT_MASK << (first % 64);
+            }
+        }
     }
+    std::memcpy(buffer + PAGE_HEADER_SIZE + sizeof(header), words, sizeof(words));
+    write_page(group * PAGES_PER_GROUP, buffer, INVALID_LSN);
+    dirty_groups_[group] = false;
 }
 
-void DiskManager::allocate_and_zero_out_page(page_id_t page_id) {
-    // Create a buffer of zeros. Using a static vector is efficient.
-    static const std::vector<char> zero_buffer(PAGE_SIZE, 0);
-    
-    // Seek to the position of the new page and write zeros.
-    // This will extend the file to the required size.
-    file_stream_.seekp(static_cast<std::streampos>(page_id) * PAGE_SIZE);
-    file_stream_.write(zero_buffer.data(), PAGE_SIZE);
-    
-    // Ensure the write is flushed to disk.
-    file_stream_.flush();
+bool DiskManager::group_has_claims(page_id_t group) const {
+    auto first = claimed_.begin() + group * EXTENTS_PER_GROUP;
+    return std::find(first, first + EXTENTS_PER_GROUP, true) != first + EXTENTS_PER_GROUP;
+}
+
+void DiskManager::claim_extent(page_id_t extent) {
+    if (claimed_[extent]) {
+        return;
+    }
+    claimed_[extent] = true;
+    write_space_map(extent * EXTENT_SIZE / PAGES_PER_GROUP, false);
+}
+
+void DiskManager::set_used(page_id_t page_id, bool used) {
+    uint64_t bit = uint64_t{1} << (page_id % 64);
+    if (used) {
+        used_[page_id / 64] |= bit;
+    } else {
+        used_[page_id / 64] &= ~bit;
+    }
+    page_id_t extent = page_id / EXTENT_SIZE;
+    if (extent_used_count(extent) == 0) {
+        free_extents_.insert(extent);
+        if (extent == misc_extent_) {
+            misc_extent_ = INVALID_PAGE_ID; // Free for a chain to take now
+        }
+    } else {
+        free_extents_.erase(extent);
+    }
+    dirty_groups_[page_id / PAGES_PER_GROUP] = true;
+}
+
+int DiskManager::extent_used_count(page_id_t extent) const {
+    page_id_t first = extent * EXTENT_SIZE;
+    return __builtin_popcountll((used_[first / 64] >> (first % 64)) & EXTENT_MASK);
+}
+
+void DiskManager::grow() {
+    page_id_t first = next_page_id_;
+    off_t offset = static_cast<off_t>(first) * PAGE_SIZE;
+    off_t length = static_cast<off_t>(EXTENT_SIZE) * PAGE_SIZE;
+
+    // Reserve the blocks up front so the extent is contiguous on disk too.
+    // Filesystems without fallocate get a sparse extension instead.
+    int rc = ::posix_fallocate(fd_, offset, length);
+    if (rc != 0 && ::ftruncate(fd_, offset + length) != 0) {
+        throw std::runtime_error("Failed to extend database file: " + file_name_);
+    }
+    next_page_id_ += EXTENT_SIZE;
+    free_page_count_ += EXTENT_SIZE;
+    if (used_.size() * 64 < static_cast<size_t>(next_page_id_)) {
+        used_.resize(used_.size() + WORDS_PER_GROUP, 0);
+        dirty_groups_.push_back(false);
+        claimed_.resize(claimed_.size() + EXTENTS_PER_GROUP, false);
+    }
+
+    // An extent that starts a group holds the group's space map page, which
+    // must exist before the group's pages do. The rest of it takes the pages
+    // allocated without a hint, which is how page 1 becomes the catalog root.
+    if (first % PAGES_PER_GROUP == 0) {
+        set_used(first, true);
+        free_page_count_--;
+        write_space_map(first / PAGES_PER_GROUP, false);
+        misc_extent_ = first / EXTENT_SIZE;
+    } else {
+        free_extents_.insert(first / EXTENT_SIZE);
+    }
+}
+
+page_id_t DiskManager::first_free_page(page_id_t extent) const {
+    if (extent == INVALID_PAGE_ID) {
+        return INVALID_PAGE_ID;
+    }
+    for (page_id_t page_id = extent * EXTENT_SIZE; page_id < (extent + 1) * EXTENT_SIZE; ++page_id) {
+        if (!is_used(page_id)) {
+            return page_id;
+        }
+    }
+    return INVALID_PAGE_ID;
+}
+
+page_id_t DiskManager::find_free_extent() {
+    while (free_extents_.empty()) {
+        grow();
+    }
+    return *free_extents_.begin() * EXTENT_SIZE;
 }
 
 bool DiskManager::ReadPage(page_id_t page_id, char* page_data) {
-    std::lock_guard<std::mutex> lock(latch_);
-    
-    // Clear any previous error states before seeking
-    file_stream_.clear();
-    
-    std::streampos offset = static_cast<std::streampos>(page_id) * PAGE_SIZE;
-    file_stream_.seekg(offset);
-
-    // Check if the seek was successful
-    if (file_stream_.fail()) {
-         // This might happen if the page is beyond the file size.
-         // In a robust system, you'd handle this more gracefully.
-         // For now, we'll just return, leaving page_data as zeros.
-         return false;
-    }
-
-    file_stream_.read(page_data, PAGE_SIZE);
-    // No need to check gcount(), if it's less than PAGE_SIZE, that's okay,
-    // the rest of the buffer will be zeros from when the page was created.
+    {
+        std::lock_guard<std::mutex> lock(latch_);
+        if (page_id < 0 || page_id >= next_page_id_) {
+            return false;
+        }
+    }
+    // pread/pwrite carry their own offsets, so page I/O needs no latch.
+    {
+        LatencyTimer timer(Histogram::DISK_READ_LATENCY);
+        read_exact(static_cast<off_t>(page_id) * PAGE_SIZE, page_data, PAGE_SIZE);
+    }
+    Metrics::Add(Counter::DISK_READS);
+    Metrics::Add(Counter::DISK_READ_BYTES, PAGE_SIZE);
+    if (!VerifyPage(page_id, page_data)) {
+        std::cerr << "Error: Page " << page_id << " of " << file_name_ << " failed its checksum." << std::endl;
+        return false;
+    }
     return true;
 }
 
-void DiskManager::WritePage(page_id_t page_id, const char* page_data) {
+void DiskManager::WritePage(page_id_t page_id, const char* page_data, lsn_t lsn) {
+    if (read_only_) {
+        throw std::runtime_error("Cannot write to a database file opened read-only.");
+    }
+    write_page(page_id, page_data, lsn);
+}
+
+void DiskManager::write_page(page_id_t page_id, const char* page_data, lsn_t lsn) {
+    // Stamp a copy: the caller's buffer may be a frame that readers are looking at.
+    alignas(64) char buffer[PAGE_SIZE];
+    std::memcpy(buffer, page_data, PAGE_SIZE);
+    PageHeader header;
+    std::memcpy(&header, buffer, sizeof(header));
+    if (lsn != INVALID_LSN) {
+        header.lsn_ = lsn;
+    } else if (header.checksum_ == 0 && header.page_id_ == 0 && header.lsn_ == 0) {
+        header.lsn_ = INVALID_LSN; // Never written before
+    }
+    header.page_id_ = page_id;
+    std::memcpy(buffer, &header, sizeof(header));
+    header.checksum_ = page_checksum(buffer);
+    std::memcpy(buffer, &header.checksum_, sizeof(header.checksum_));
+    {
+        LatencyTimer timer(Histogram::DISK_WRITE_LATENCY);
+        write_exact(static_cast<off_t>(page_id) * PAGE_SIZE, buffer, PAGE_SIZE);
+    }
+    Metrics::Add(Counter::DISK_WRITES);
+    Metrics::Add(Counter::DISK_WRITE_BYTES, PAGE_SIZE);
+}
+
+bool DiskManager::VerifyPage(page_id_t page_id, const char* page_data) {
+    PageHeader header;
+    std::memcpy(&header, page_data, sizeof(header));
+    if (header.checksum_ == 0 && header.page_id_ == 0 && header.lsn_ == 0) {
+        // Allocated but never written -- unless the header alone was lost.
+        return is_zero_page(page_data);
+    }
+    return header.page_id_ == page_id && header.checksum_ == page_checksum(page_data);
+}
+
+DiskManager::ScrubResult DiskManager::Scrub() {
+    ScrubResult result;
+    page_id_t page_count;
+    {
+        std::lock_guard<std::mutex> lock(latch_);
+        page_count = next_page_id_;
+    }
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<char> batch(static_cast<size_t>(SCRUB_BATCH_PAGES) * PAGE_SIZE);
+    for (page_id_t first = 0; first < page_count; first += SCRUB_BATCH_PAGES) {
+        page_id_t n = std::min(SCRUB_BATCH_PAGES, page_count - first);
+        read_exact(static_cast<off_t>(first) * PAGE_SIZE, batch.data(), static_cast<size_t>(n) * PAGE_SIZE);
+        for (page_id_t i = 0; i < n; ++i) {
+            const char* page_data = batch.data() + static_cast<size_t>(i) * PAGE_SIZE;
+            PageHeader header;
+            std::memcpy(&header, page_data, sizeof(header));
+            if (!VerifyPage(first + i, page_data)) {
+                result.corrupted_pages.push_back(first + i);
+            } else if (header.checksum_ == 0 && header.page_id_ == 0 && header.lsn_ == 0) {
+                result.unwritten_pages++;
+            } else {
+                result.max_lsn = std::max(result.max_lsn, header.lsn_);
+            }
+            result.pages_checked++;
+        }
+    }
+    return result;
+}
+
+page_id_t DiskManager::AllocatePage(page_id_t hint) {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (read_only_) {
+        throw std::runtime_error("Cannot allocate pages in a database file opened read-only.");
+    }
+
+    page_id_t page_id = INVALID_PAGE_ID;
+    if (hint != INVALID_PAGE_ID) {
+        if (hint < next_page_id_ && !is_used(hint) && hint / EXTENT_SIZE != misc_extent_ &&
+            (hint % EXTENT_SIZE != 0 || extent_used_count(hint / EXTENT_SIZE) == 0)) {
+            // Continue the caller's extent, or the wholly free one right after it.
+            page_id = hint;
+        } else {
+            // The chain's extent is used up, or its head sits among the unhinted pages.
+            page_id = find_free_extent();
+        }
+    } else {
+        // Unhinted pages share an extent of their own, so they never land in
+        // the middle of a chain's run.
+        page_id = first_free_page(misc_extent_);
+        if (page_id == INVALID_PAGE_ID && free_extents_.empty()) {
+            grow(); // May start a group, whose first extent becomes the unhinted one
+            page_id = first_free_page(misc_extent_);
+        }
+        if (page_id == INVALID_PAGE_ID) {
+            misc_extent_ = find_free_extent() / EXTENT_SIZE;
+            page_id = misc_extent_ * EXTENT_SIZE;
+        }
+    }
+
+    claim_extent(page_id / EXTENT_SIZE);
+    set_used(page_id, true);
+    free_page_count_--;
+    return page_id;
+}
+
+void DiskManager::DeallocatePage(page_id_t page_id) {
     std::lock_guard<std::mutex> lock(latch_);
-    
-    // Clear any previous error states before seeking
-    file_stream_.clear();
+    if (read_only_) {
+        throw std::runtime_error("Cannot free pages in a database file opened read-only.");
+    }
+
+    // Free pages must read as zeros, so that recovery still recognizes a
+    // reallocated page that was never written back. Zeroing the range keeps
+    // its blocks allocated, so the extent stays contiguous for its next owner.
+    off_t offset = static_cast<off_t>(page_id) * PAGE_SIZE;
+    if (::fallocate(fd_, FALLOC_FL_ZERO_RANGE, offset, PAGE_SIZE) != 0) {
+        static const char zero_page[PAGE_SIZE] = {};
+        write_exact(offset, zero_page, PAGE_SIZE);
+    }
 
-    std::streampos offset = static_cast<std::streampos>(page_id) * PAGE_SIZE;
-    file_stream_.seekp(offset);
-    file_stream_.write(page_data, PAGE_SIZE);
-    file_stream_.flush();
+    set_used(page_id, false);
+    free_page_count_++;
 }
 
-page_id_t DiskManager::AllocatePage() {
+uint32_t DiskManager::GetFreePageCount() {
     std::lock_guard<std::mutex> lock(latch_);
-    page_id_t new_page_id = next_page_id_++;
-    allocate_and_zero_out_page(new_page_id);
-    return new_page_id;
+    return free_page_count_;
 }
 
-} // namespace db
\ No newline at end of file
+} // namespace db
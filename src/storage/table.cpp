@@ -1,88 +1,103 @@
 #include "columnar_db/storage/table.h"
+#include "columnar_db/common/metrics.h"
+#include "columnar_db/storage/column_kernels.h"
+#include "columnar_db/storage/visibility.h"
+#include "columnar_db/wal/log_record.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
 #include <cassert>
-#include <iostream>
 
 namespace db {
 
-Table::Table(const TableSchema* schema, BufferPoolManager* bpm) : schema_(schema), bpm_(bpm) {
+TableHandle::TableHandle(const TableSchema* table_schema, BufferPoolManager* bpm) : schema(table_schema) {
     assert(schema != nullptr && "Table schema cannot be null.");
-    if (schema->columns.empty()) {
-        return;
-    }
-
-    // Initialize the last_page_ids cache and determine num_rows.
-    // We assume all columns have the same number of rows.
-    for (const auto& col : schema->columns) {
-        last_page_ids_.push_back(col.first_page_id);
-    }
-
-    std::cout << "Table object created successfully." << std::endl;
-    // Determine num_rows by scanning the first column until the end.
-    // This is a one-time cost at initialization.
-    page_id_t current_page_id = schema->columns[0].first_page_id;
-    while (current_page_id != INVALID_PAGE_ID) {
-        Page* page = bpm_->FetchPage(current_page_id);
-        std::cout << "Fetching page " << current_page_id << std::endl;
-        if (page == nullptr) 
-        { 
-
-            std::cout << "Failed to fetch page to count rows." << std::endl;
-            throw std::runtime_error("Failed to fetch page to count rows.");
-        }
-        page->r_latch();
-
-        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
-        num_rows_ += data_page->value_count_;
-        last_page_ids_[0] = current_page_id; // Update last page for first col
-        current_page_id = data_page->next_page_id_;
 
-        page->r_unlatch();
-        bpm_->UnpinPage(page->page_id(), false);
-    }
-    std::cout << "Number of rows: " << num_rows_ << std::endl;
-
-    // Now, populate the last_page_ids for all other columns.
-    for (size_t i = 1; i < schema->columns.size(); ++i) {
-        current_page_id = schema->columns[i].first_page_id;
+    // Find the last page of every column. An insert running concurrently
+    // (into a table opened on another handle) may have reached only some of
+    // them, so the row count is the shortest column.
+    uint64_t rows = 0;
+    pages.resize(schema->columns.size());
+    page_blooms.resize(schema->columns.size());
+    for (size_t i = 0; i < schema->columns.size(); ++i) {
+        const bool is_sort_column = static_cast<int32_t>(i) == schema->sort_column;
+        uint64_t column_rows = 0;
+        page_id_t current_page_id = schema->columns[i].first_page_id;
+        last_page_ids.push_back(current_page_id);
         while (current_page_id != INVALID_PAGE_ID) {
-            Page* page = bpm_->FetchPage(current_page_id);
+            Page* page = bpm->FetchPage(current_page_id);
             if (page == nullptr) {
                 throw std::runtime_error("Failed to fetch page to count rows for column " + std::to_string(i));
             }
             page->r_latch();
             auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
-            last_page_ids_[i] = current_page_id;
+            pages[i].push_back({current_page_id, column_rows});
+            if (is_sort_column) {
+                // An empty page can only end the chain; give it the previous key to keep the list sorted.
+                first_keys.push_back(data_page->value_count_ > 0
+                                         ? SortKey(schema->columns[i].type, ReadColumnValue(data_page, schema->columns[i].type, 0))
+                                         : (first_keys.empty() ? INT64_MIN : first_keys.back()));
+            }
+            column_rows += data_page->value_count_;
+            last_page_ids[i] = current_page_id;
             current_page_id = data_page->next_page_id_;
             page->r_unlatch();
-            bpm_->UnpinPage(page->page_id(), false);
+            bpm->UnpinPage(page->page_id(), false);
         }
+        rows = i == 0 ? column_rows : std::min(rows, column_rows);
     }
+    num_rows.store(rows, std::memory_order_relaxed);
 }
 
-bool Table::InsertTuple(const std::vector<int64_t>& tuple) {
+Table::Table(const TableSchema* schema, BufferPoolManager* bpm, const Snapshot* snapshot)
+    : Table(std::make_shared<TableHandle>(schema, bpm), bpm, snapshot) {}
+
+Table::Table(std::shared_ptr<TableHandle> handle, BufferPoolManager* bpm, const Snapshot* snapshot)
+    : handle_(std::move(handle)), schema_(handle_->schema), bpm_(bpm), snapshot_(snapshot),
+      num_rows_(handle_->num_rows.load(std::memory_order_acquire)) {}
+
+std::unique_lock<std::mutex> Table::LockAppends() {
+    std::unique_lock<std::mutex> lock(handle_->append_latch);
+    num_rows_ = handle_->num_rows.load(std::memory_order_acquire);
+    return lock;
+}
+
+void Table::publish_rows(uint64_t row_count) {
+    num_rows_ = handle_->num_rows.load(std::memory_order_relaxed) + row_count;
+    handle_->num_rows.store(num_rows_, std::memory_order_release);
+}
+
+bool Table::InsertTuple(const std::vector<int64_t>& tuple, lsn_t lsn) {
     if (tuple.size() != schema_->columns.size()) {
         return false; // Tuple doesn't match schema
     }
 
+    std::vector<Page*> tails;
+    if (!pin_tails(&tails)) {
+        return false;
+    }
+    std::vector<page_id_t>& last_page_ids = handle_->last_page_ids;
     for (size_t i = 0; i < schema_->columns.size(); ++i) {
-        page_id_t current_pid = last_page_ids_[i];
-        Page* page = bpm_->FetchPage(current_pid);
+        page_id_t current_pid = last_page_ids[i];
+        Page* page = tails[i];
         page->w_latch();
         auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
 
-        if (data_page->value_count_ == ColumnDataPage::MAX_VALUES) {
-            // The last page is full. Allocate a new one.
+        if (data_page->value_count_ == ColumnPageCapacity(schema_->columns[i].type)) {
+            // The last page is full. Allocate a new one, right after it on disk if possible.
             page_id_t new_pid;
-            Page* new_page_raw = bpm_->NewPage(&new_pid);
+            Page* new_page_raw = bpm_->NewPage(&new_pid, current_pid + 1);
             if (new_page_raw == nullptr) {
-                page->w_unlatch();
-                bpm_->UnpinPage(current_pid, false);
-                return false; // Buffer pool is full
+                throw std::runtime_error("Failed to allocate a page for column " + std::to_string(i));
             }
 
             // Link the old page to the new page
             data_page->next_page_id_ = new_pid;
+            if (lsn != INVALID_LSN) {
+                StampColumnPage(page, data_page, lsn);
+            }
             page->w_unlatch();
             bpm_->UnpinPage(current_pid, true); // Old page is now dirty
 
@@ -95,25 +110,524 @@ bool Table::InsertTuple(const std::vector<int64_t>& tuple) {
             // We MUST initialize the new page header, just like in the Catalog!
             data_page->next_page_id_ = INVALID_PAGE_ID;
             data_page->value_count_ = 0;
+            data_page->page_lsn_ = 0;
             // --- END FIX ---
 
-            last_page_ids_[i] = new_pid;
+            last_page_ids[i] = new_pid;
         }
 
         // Insert the value into the page
-        data_page->values_[data_page->value_count_] = tuple[i];
+        WriteColumnValue(data_page, schema_->columns[i].type, data_page->value_count_, tuple[i]);
         data_page->value_count_++;
+        if (lsn != INVALID_LSN) {
+            StampColumnPage(page, data_page, lsn);
+        }
 
         page->w_unlatch();
         bpm_->UnpinPage(page->page_id(), true); // Page is dirty
     }
 
-    num_rows_++;
+    publish_rows(1);
+    return true;
+}
+
+bool Table::AppendRows(const std::vector<std::vector<int64_t>>& columns, lsn_t lsn) {
+    if (columns.size() != schema_->columns.size()) {
+        return false;
+    }
+    const size_t row_count = columns[0].size();
+    for (const auto& column : columns) {
+        if (column.size() != row_count) {
+            return false;
+        }
+    }
+    if (row_count == 0) {
+        return true;
+    }
+    // One column at a time; the rows are published once the last one is written.
+    std::vector<Page*> tails;
+    if (!pin_tails(&tails)) {
+        return false;
+    }
+    for (size_t i = 0; i < schema_->columns.size(); ++i) {
+        VisitStorageType(schema_->columns[i].type, [&](auto stored) {
+            append_column<decltype(stored)>(i, tails[i], columns[i], lsn);
+        });
+    }
+
+    publish_rows(row_count);
+    return true;
+}
+
+bool Table::pin_tails(std::vector<Page*>* tails) {
+    for (page_id_t page_id : handle_->last_page_ids) {
+        Page* page = bpm_->FetchPage(page_id);
+        if (page == nullptr) {
+            for (Page* tail : *tails) {
+                bpm_->UnpinPage(tail->page_id(), false);
+            }
+            tails->clear();
+            return false;
+        }
+        tails->push_back(page);
+    }
     return true;
 }
 
+template <typename T>
+void Table::append_column(size_t col_idx, Page* page, const std::vector<int64_t>& values, lsn_t lsn) {
+    const size_t row_count = values.size();
+    auto stamp = [&](Page* stamped, ColumnPage<T>* data_page, size_t row) {
+        if (lsn != INVALID_LSN) {
+            lsn_t row_lsn = LogRecord::RowLsn(lsn, static_cast<uint32_t>(row), static_cast<uint32_t>(row_count));
+            StampColumnPage(stamped, data_page, row_lsn);
+        }
+    };
+
+    std::vector<page_id_t>& last_page_ids = handle_->last_page_ids;
+    page_id_t current_pid = last_page_ids[col_idx];
+    page->w_latch();
+
+    size_t row = 0;
+    while (true) {
+        auto* data_page = reinterpret_cast<ColumnPage<T>*>(page->data());
+        size_t n = std::min<size_t>(ColumnPage<T>::MAX_VALUES - data_page->value_count_, row_count - row);
+        if (n > 0) {
+            if constexpr (std::is_same_v<T, int64_t>) {
+                std::memcpy(data_page->values_ + data_page->value_count_, values.data() + row, n * sizeof(int64_t));
+            } else {
+                T* out = data_page->values_ + data_page->value_count_;
+                for (size_t k = 0; k < n; ++k) {
+                    out[k] = ToStored<T>(values[row + k]);
+                }
+            }
+            data_page->value_count_ += static_cast<uint32_t>(n);
+            row += n;
+            stamp(page, data_page, row - 1);
+        }
+        if (row == row_count) {
+            break;
+        }
+
+        // The page is full: continue on a new one, right after it on disk if possible.
+        page_id_t new_pid;
+        Page* new_page = bpm_->NewPage(&new_pid, current_pid + 1);
+        if (new_page == nullptr) {
+            throw std::runtime_error("Failed to allocate a page for column " + std::to_string(col_idx));
+        }
+        data_page->next_page_id_ = new_pid;
+        stamp(page, data_page, row);
+        page->w_unlatch();
+        bpm_->UnpinPage(current_pid, true);
+
+        page = new_page;
+        page->w_latch();
+        data_page = reinterpret_cast<ColumnPage<T>*>(page->data());
+        data_page->next_page_id_ = INVALID_PAGE_ID;
+        data_page->value_count_ = 0;
+        data_page->page_lsn_ = 0;
+        current_pid = new_pid;
+        last_page_ids[col_idx] = new_pid;
+    }
+
+    page->w_unlatch();
+    bpm_->UnpinPage(current_pid, true);
+}
+
+std::unique_lock<std::mutex> Table::LockDeletes() {
+    return std::unique_lock<std::mutex>(handle_->delete_latch);
+}
+
+bool Table::can_delete(txn_id_t current) const {
+    return current == INVALID_TXN_ID || current == snapshot_->txn_id ||
+           (snapshot_->aborted != nullptr && snapshot_->aborted->count(current) > 0);
+}
+
+bool Table::CanDeleteRow(uint64_t row_id) {
+    assert(snapshot_ != nullptr && "Deleting requires a transaction.");
+    uint32_t slot;
+    Page* page = fetch_row_page(schema_->XmaxColumn(), row_id, &slot);
+    const bool ok = can_delete(reinterpret_cast<ColumnDataPage*>(page->data())->values_[slot]);
+    page->w_unlatch();
+    bpm_->UnpinPage(page->page_id(), false);
+    return ok;
+}
+
+bool Table::DeleteRow(uint64_t row_id, lsn_t lsn) {
+    assert(snapshot_ != nullptr && "Deleting requires a transaction.");
+    return set_xmax(row_id, snapshot_->txn_id, lsn, [this](txn_id_t current) { return can_delete(current); });
+}
+
+void Table::UndeleteRow(uint64_t row_id, lsn_t lsn) {
+    set_xmax(row_id, INVALID_TXN_ID, lsn, [](txn_id_t) { return true; });
+}
+
+void Table::UndoAppend(uint64_t first_row, uint64_t row_count, lsn_t lsn) {
+    assert(snapshot_ != nullptr && "Undoing an append requires a transaction.");
+    if (row_count == 0) {
+        return;
+    }
+    // One walk down the __xmax chain, rather than one per row as DeleteRow takes.
+    uint32_t slot;
+    Page* page = fetch_row_page(schema_->XmaxColumn(), first_row, &slot);
+    uint64_t done = 0;
+    while (true) {
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+        for (; slot < data_page->value_count_ && done < row_count; ++slot, ++done) {
+            data_page->values_[slot] = snapshot_->txn_id;
+        }
+        if (lsn != INVALID_LSN) {
+            StampColumnPage(page, data_page, lsn);
+        }
+        const page_id_t next_pid = data_page->next_page_id_;
+        page->w_unlatch();
+        bpm_->UnpinPage(page->page_id(), true);
+        if (done == row_count) {
+            return;
+        }
+        if (next_pid == INVALID_PAGE_ID || (page = bpm_->FetchPage(next_pid)) == nullptr) {
+            throw std::runtime_error("Failed to fetch page " + std::to_string(next_pid));
+        }
+        page->w_latch();
+        slot = 0;
+    }
+}
+
+bool Table::set_xmax(uint64_t row_id, txn_id_t xmax, lsn_t lsn,
+                     const std::function<bool(txn_id_t)>& can_overwrite) {
+    uint32_t slot;
+    Page* page = fetch_row_page(schema_->XmaxColumn(), row_id, &slot);
+    auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+
+    // Check and set under the page latch, so two deleters cannot both win.
+    bool ok = can_overwrite(data_page->values_[slot]);
+    if (ok) {
+        data_page->values_[slot] = xmax;
+        if (lsn != INVALID_LSN) {
+            StampColumnPage(page, data_page, lsn);
+        }
+    }
+
+    page->w_unlatch();
+    bpm_->UnpinPage(page->page_id(), ok);
+    return ok;
+}
+
+Page* Table::fetch_row_page(size_t col_idx, uint64_t row_id, uint32_t* slot) {
+    // Jump to the listed page holding the row, walking on only past pages appended since.
+    const TableHandle::PageRef& start = find_page(col_idx, row_id);
+    page_id_t current_pid = start.page_id;
+    uint64_t remaining_rows = row_id - start.first_row;
+
+    while (current_pid != INVALID_PAGE_ID) {
+        Page* page = bpm_->FetchPage(current_pid);
+        if (page == nullptr) {
+            throw std::runtime_error("Failed to fetch page " + std::to_string(current_pid));
+        }
+        page->w_latch();
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+        if (remaining_rows < data_page->value_count_) {
+            *slot = static_cast<uint32_t>(remaining_rows);
+            return page;
+        }
+        remaining_rows -= data_page->value_count_;
+        page_id_t next_pid = data_page->next_page_id_;
+        page->w_unlatch();
+        bpm_->UnpinPage(current_pid, false);
+        current_pid = next_pid;
+    }
+    throw std::out_of_range("Row " + std::to_string(row_id) + " does not exist.");
+}
+
+void Table::ForEachColumnPage(size_t col_idx,
+                              const std::function<void(uint64_t, const int64_t*, uint32_t)>& fn) const {
+    const DataType type = schema_->columns[col_idx].type;
+    if (TypeSize(type) == sizeof(int64_t)) {
+        // Stored in their int64_t form already (a DOUBLE as its bit pattern).
+        for_each_page(col_idx, 0, [&fn](uint64_t first_row, const ColumnDataPage* page, uint32_t count) {
+            fn(first_row, page->values_, count);
+        });
+        return;
+    }
+    std::vector<int64_t> widened;
+    VisitStorageType(type, [&](auto stored) {
+        using T = decltype(stored);
+        widened.resize(ColumnPage<T>::MAX_VALUES);
+        ForEachColumnPageAs<T>(col_idx, [&](uint64_t first_row, const T* values, uint32_t count) {
+            for (uint32_t i = 0; i < count; ++i) {
+                widened[i] = FromStored(values[i]);
+            }
+            fn(first_row, widened.data(), count);
+        });
+    });
+}
+
+void Table::for_each_page(size_t col_idx, uint64_t start_row,
+                          const std::function<void(uint64_t, const ColumnDataPage*, uint32_t)>& fn) const {
+    const TableHandle::PageRef& start = find_page(col_idx, start_row);
+    walk_pages(start.page_id, start.first_row, start_row, fn);
+}
+
+void Table::walk_pages(page_id_t page_id, uint64_t first_row, uint64_t start_row,
+                       const std::function<void(uint64_t, const ColumnDataPage*, uint32_t)>& fn,
+                       size_t max_pages) const {
+    page_id_t current_pid = page_id;
+    for (size_t visited = 0; visited < max_pages && current_pid != INVALID_PAGE_ID && first_row < num_rows_;
+         ++visited) {
+        Page* page = bpm_->FetchPage(current_pid);
+        if (page == nullptr) {
+            throw std::runtime_error("Failed to fetch page " + std::to_string(current_pid));
+        }
+        page->r_latch();
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+        auto count = static_cast<uint32_t>(std::min<uint64_t>(data_page->value_count_, num_rows_ - first_row));
+        if (first_row + count > start_row) {
+            fn(first_row, data_page, count);
+        }
+        first_row += data_page->value_count_;
+        page_id_t next_pid = data_page->next_page_id_;
+        page->r_unlatch();
+        bpm_->UnpinPage(current_pid, false);
+        current_pid = next_pid;
+    }
+}
+
+const TableHandle::PageRef& Table::find_page(size_t col_idx, uint64_t row_id) const {
+    const std::vector<TableHandle::PageRef>& pages = handle_->pages[col_idx];
+    auto it = std::upper_bound(pages.begin(), pages.end(), row_id,
+                               [](uint64_t row, const TableHandle::PageRef& page) { return row < page.first_row; });
+    return *std::prev(it); // The first page starts at row 0, so there is always one before.
+}
+
+namespace {
+
+// Converts [lo, hi], in int64_t form, to bounds of type T. Returns false if no value of T lies in it.
+template <typename T>
+bool stored_bounds(int64_t lo, int64_t hi, T* stored_lo, T* stored_hi) {
+    if constexpr (std::is_same_v<T, double>) {
+        *stored_lo = std::bit_cast<double>(lo);
+        *stored_hi = std::bit_cast<double>(hi);
+        return *stored_lo <= *stored_hi; // False for a NaN bound
+    } else {
+        lo = std::max<int64_t>(lo, std::numeric_limits<T>::min());
+        hi = std::min<int64_t>(hi, std::numeric_limits<T>::max());
+        *stored_lo = static_cast<T>(lo);
+        *stored_hi = static_cast<T>(hi);
+        return lo <= hi;
+    }
+}
+
+// Sets bits [first, last) of `bits`.
+void set_bits(uint64_t* bits, uint64_t first, uint64_t last) {
+    for (uint64_t bit = first; bit < last;) {
+        const uint64_t n = std::min<uint64_t>(last - bit, 64 - bit % 64);
+        bits[bit / 64] |= (n == 64 ? ~uint64_t{0} : ((uint64_t{1} << n) - 1)) << (bit % 64);
+        bit += n;
+    }
+}
+
+} // namespace
+
+void Table::FilterRange(size_t col_idx, int64_t lo, int64_t hi) {
+    const DataType type = schema_->columns[col_idx].type;
+    std::vector<uint64_t> matches((num_rows_ + 63) / 64, 0);
+
+    VisitStorageType(type, [&](auto stored) {
+        using T = decltype(stored);
+        T stored_lo;
+        T stored_hi;
+        if (!stored_bounds<T>(lo, hi, &stored_lo, &stored_hi)) {
+            return; // Nothing matches
+        }
+
+        // The sealed segment is sorted by the sort column, so the matching rows
+        // there are one run, found without reading the pages in between.
+        uint64_t scan_from = 0;
+        if (static_cast<int32_t>(col_idx) == schema_->sort_column) {
+            scan_from = std::min(schema_->sorted_rows, num_rows_);
+            // 0.0 == -0.0, but they have different sort keys.
+            int64_t lo_key = SortKey(type, FromStored(stored_lo == 0 ? T(-0.0) : stored_lo));
+            int64_t hi_key = SortKey(type, FromStored(stored_hi == 0 ? T(0) : stored_hi));
+            set_bits(matches.data(), std::min(sorted_bound(lo_key, false), scan_from),
+                     std::min(sorted_bound(hi_key, true), scan_from));
+        }
+
+        // The rest of the table, a page at a time.
+        auto match_page = [&](uint64_t first_row, const ColumnDataPage* page, uint32_t count) {
+            const T* values = reinterpret_cast<const ColumnPage<T>*>(page)->values_;
+            const uint32_t skip = first_row < scan_from ? static_cast<uint32_t>(scan_from - first_row) : 0;
+            MatchRange(values + skip, count - skip, stored_lo, stored_hi, matches.data(), first_row + skip);
+        };
+        // Bloom filters hash the int64_t form, and 0.0 == -0.0 has two of those.
+        // Deletes change __xmax in place, so the MVCC columns never get one.
+        // The sort column's sealed segment was searched already.
+        if (std::is_same_v<T, double> || stored_lo != stored_hi || col_idx >= schema_->UserColumnCount() ||
+            scan_from > 0) {
+            for_each_page(col_idx, scan_from, match_page);
+            return;
+        }
+
+        match_equal(col_idx, FromStored(stored_lo), match_page);
+    });
+
+    restrict_rows(std::move(matches));
+}
+
+void Table::match_equal(size_t col_idx, int64_t value,
+                        const std::function<void(uint64_t, const ColumnDataPage*, uint32_t)>& match_page) {
+    std::shared_ptr<const TableHandle::PageBlooms> known;
+    {
+        std::lock_guard<std::mutex> lock(handle_->bloom_latch);
+        known = handle_->page_blooms[col_idx];
+    }
+    page_id_t next_page_id = schema_->columns[col_idx].first_page_id;
+    uint64_t next_first_row = 0;
+    if (known != nullptr) {
+        for (const auto& entry : known->pages) {
+            if (entry.first_row >= num_rows_) {
+                break;
+            }
+            if (!entry.bloom.MayContain(value)) {
+                Metrics::Add(Counter::BLOOM_PAGES_SKIPPED);
+                continue;
+            }
+            walk_pages(entry.page_id, entry.first_row, 0, match_page, 1);
+        }
+        next_page_id = known->next_page_id;
+        next_first_row = known->next_first_row;
+    }
+
+    // Read the rest of the chain, building filters for the pages that are sealed
+    // and follow on from the known ones (a page's id is the previous one's next).
+    const DataType type = schema_->columns[col_idx].type;
+    std::vector<TableHandle::PageBlooms::Entry> sealed;
+    page_id_t sealed_next_page_id = next_page_id;
+    uint64_t sealed_next_first_row = next_first_row;
+    walk_pages(next_page_id, next_first_row, 0, [&](uint64_t first_row, const ColumnDataPage* page, uint32_t count) {
+        match_page(first_row, page, count);
+        if (first_row != sealed_next_first_row || page->next_page_id_ == INVALID_PAGE_ID ||
+            count != page->value_count_) {
+            return;
+        }
+        BloomFilter bloom(count);
+        VisitStorageType(type, [&](auto stored) {
+            using T = decltype(stored);
+            const T* values = reinterpret_cast<const ColumnPage<T>*>(page)->values_;
+            for (uint32_t i = 0; i < count; ++i) {
+                bloom.Add(FromStored(values[i]));
+            }
+        });
+        sealed.push_back({sealed_next_page_id, first_row, std::move(bloom)});
+        sealed_next_page_id = page->next_page_id_;
+        sealed_next_first_row = first_row + count;
+    });
+    if (sealed.empty()) {
+        return;
+    }
+
+    // Publish the longer list, unless another scan did first.
+    auto extended = std::make_shared<TableHandle::PageBlooms>();
+    if (known != nullptr) {
+        extended->pages = known->pages;
+    }
+    std::move(sealed.begin(), sealed.end(), std::back_inserter(extended->pages));
+    extended->next_page_id = sealed_next_page_id;
+    extended->next_first_row = sealed_next_first_row;
+    std::lock_guard<std::mutex> lock(handle_->bloom_latch);
+    if (handle_->page_blooms[col_idx] == known) {
+        handle_->page_blooms[col_idx] = std::move(extended);
+    }
+}
+
+void Table::SamplePages(double fraction, uint64_t seed) {
+    // The MVCC columns fill every page before starting the next, so their
+    // pages hold the same fixed run of rows throughout the table.
+    const uint64_t page_rows = ColumnPageCapacity(schema_->columns[schema_->XminColumn()].type);
+    std::vector<uint64_t> matches((num_rows_ + 63) / 64, 0);
+    for (uint64_t first_row = 0; first_row < num_rows_; first_row += page_rows) {
+        // splitmix64 of the page number: a uniform draw in [0, 1) per page.
+        uint64_t h = seed + (first_row / page_rows + 1) * 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        if (static_cast<double>(h >> 11) * 0x1.0p-53 < fraction) {
+            set_bits(matches.data(), first_row, std::min(first_row + page_rows, num_rows_));
+        }
+    }
+    restrict_rows(std::move(matches));
+}
+
+void Table::restrict_rows(std::vector<uint64_t> matches) {
+    if (row_filter_.empty()) {
+        row_filter_ = std::move(matches);
+    } else {
+        for (size_t w = 0; w < row_filter_.size(); ++w) {
+            row_filter_[w] &= w < matches.size() ? matches[w] : 0;
+        }
+    }
+}
+
+uint64_t Table::sorted_bound(int64_t key, bool after) const {
+    const size_t col_idx = static_cast<size_t>(schema_->sort_column);
+    const DataType type = schema_->columns[col_idx].type;
+    const uint64_t sealed = std::min(schema_->sorted_rows, num_rows_);
+    const std::vector<TableHandle::PageRef>& pages = handle_->pages[col_idx];
+    auto before_bound = [key, after](int64_t value_key) { return after ? value_key <= key : value_key < key; };
+
+    // The sealed segment's pages; the bound is in the one before the first
+    // page whose first key is already past it.
+    const size_t sealed_pages = static_cast<size_t>(
+        std::partition_point(pages.begin(), pages.end(),
+                             [sealed](const TableHandle::PageRef& page) { return page.first_row < sealed; }) -
+        pages.begin());
+    const size_t next = static_cast<size_t>(
+        std::partition_point(handle_->first_keys.begin(), handle_->first_keys.begin() + sealed_pages, before_bound) -
+        handle_->first_keys.begin());
+    if (next == 0) {
+        return 0;
+    }
+    const TableHandle::PageRef& ref = pages[next - 1];
+
+    Page* page = bpm_->FetchPage(ref.page_id);
+    if (page == nullptr) {
+        throw std::runtime_error("Failed to fetch page " + std::to_string(ref.page_id));
+    }
+    page->r_latch();
+    auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+    uint32_t low = 0;
+    uint32_t high = static_cast<uint32_t>(std::min<uint64_t>(data_page->value_count_, sealed - ref.first_row));
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        if (before_bound(SortKey(type, ReadColumnValue(data_page, type, mid)))) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    page->r_unlatch();
+    bpm_->UnpinPage(ref.page_id, false);
+    return ref.first_row + low;
+}
+
+uint64_t Table::next_filtered_row(uint64_t row_id) const {
+    size_t word_idx = row_id / 64;
+    if (word_idx >= row_filter_.size()) {
+        return num_rows_; // Appended after the filter was built
+    }
+    uint64_t word = row_filter_[word_idx] & (~uint64_t{0} << (row_id % 64));
+    while (word == 0) {
+        if (++word_idx == row_filter_.size()) {
+            return num_rows_;
+        }
+        word = row_filter_[word_idx];
+    }
+    return std::min<uint64_t>(word_idx * 64 + __builtin_ctzll(word), num_rows_);
+}
+
 Table::Iterator Table::begin() {
-    return Iterator(this, 0);
+    Iterator it(this, 0);
+    it.skip_invisible();
+    return it;
 }
 
 Table::Iterator Table::end() {
@@ -122,40 +636,172 @@ Table::Iterator Table::end() {
 
 // --- Iterator Implementation ---
 
+Table::Iterator::Iterator(Table* table, uint64_t row_id)
+    : table_(table), row_id_(row_id), cursors_(table->schema_->columns.size()) {
+    for (size_t i = 0; i < cursors_.size(); ++i) {
+        cursors_[i].next_page_id = table_->schema_->columns[i].first_page_id;
+    }
+}
+
+void Table::Iterator::seek(size_t col_idx) const {
+    Cursor& cursor = cursors_[col_idx];
+    if (row_id_ >= cursor.first_row + cursor.value_count) {
+        // Jump over whole pages, e.g. rows a filter skipped, with the handle's directory.
+        const TableHandle::PageRef& page = table_->find_page(col_idx, row_id_);
+        if (page.first_row > cursor.first_row + cursor.value_count) {
+            cursor.first_row = page.first_row;
+            cursor.value_count = 0;
+            cursor.next_page_id = page.page_id;
+        }
+    }
+    while (row_id_ >= cursor.first_row + cursor.value_count) {
+        if (cursor.next_page_id == INVALID_PAGE_ID) {
+            throw std::out_of_range("Row " + std::to_string(row_id_) + " does not exist.");
+        }
+        Page* page = table_->bpm_->FetchPage(cursor.next_page_id);
+        if (page == nullptr) {
+            throw std::runtime_error("Failed to fetch page " + std::to_string(cursor.next_page_id));
+        }
+        page->r_latch();
+        auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+        cursor.first_row += cursor.value_count;
+        cursor.page_id = cursor.next_page_id;
+        cursor.value_count = data_page->value_count_;
+        cursor.next_page_id = data_page->next_page_id_;
+        page->r_unlatch();
+        table_->bpm_->UnpinPage(cursor.page_id, false);
+
+        // Read ahead whenever the chain enters a new extent.
+        if (cursor.next_page_id != INVALID_PAGE_ID &&
+            (cursor.next_page_id != cursor.page_id + 1 || cursor.next_page_id % EXTENT_SIZE == 0)) {
+            table_->bpm_->Prefetch(cursor.next_page_id);
+        }
+    }
+}
+
+int64_t Table::Iterator::read(size_t col_idx) const {
+    seek(col_idx);
+    const Cursor& cursor = cursors_[col_idx];
+    Page* page = table_->bpm_->FetchPage(cursor.page_id);
+    if (page == nullptr) {
+        throw std::runtime_error("Failed to fetch page " + std::to_string(cursor.page_id));
+    }
+    page->r_latch();
+    int64_t value = ReadColumnValue(reinterpret_cast<ColumnDataPage*>(page->data()), table_->schema_->columns[col_idx].type,
+                                    static_cast<uint32_t>(row_id_ - cursor.first_row));
+    page->r_unlatch();
+    table_->bpm_->UnpinPage(cursor.page_id, false);
+    return value;
+}
+
 std::vector<int64_t> Table::Iterator::operator*() const {
     std::vector<int64_t> tuple;
-    tuple.reserve(table_->schema_->columns.size());
+    tuple.reserve(table_->schema_->UserColumnCount());
 
-    for (size_t i = 0; i < table_->schema_->columns.size(); ++i) {
-        page_id_t current_pid = table_->schema_->columns[i].first_page_id;
-        uint64_t remaining_rows = row_id_;
+    for (size_t i = 0; i < table_->schema_->UserColumnCount(); ++i) {
+        tuple.push_back(read(i));
+    }
+    return tuple;
+}
 
-        // Follow the page chain to find the correct page
-        while (true) {
-            Page* page = table_->bpm_->FetchPage(current_pid);
-            page->r_latch();
-            auto* data_page = reinterpret_cast<ColumnDataPage*>(page->data());
+Table::Iterator& Table::Iterator::operator++() {
+    row_id_++;
+    skip_invisible();
+    return *this;
+}
 
-            if (remaining_rows < data_page->value_count_) {
-                // The value is on this page
-                tuple.push_back(data_page->values_[remaining_rows]);
-                page->r_unlatch();
-                table_->bpm_->UnpinPage(current_pid, false);
+void Table::Iterator::skip_invisible() {
+    if (table_->snapshot_ == nullptr && table_->row_filter_.empty()) {
+        return;
+    }
+    while (row_id_ < table_->num_rows_) {
+        if (!table_->row_filter_.empty()) {
+            // Skip what the filter rules out before looking at any MVCC page.
+            row_id_ = table_->next_filtered_row(row_id_);
+            if (row_id_ >= table_->num_rows_) {
                 break;
             }
+        }
+        if (row_id_ >= mask_end_row_) {
+            load_mask();
+        }
+        // Jump straight to the next set bit in the mask.
+        uint64_t bit = row_id_ - mask_first_row_;
+        uint64_t word = mask_[bit / 64] & (~uint64_t{0} << (bit % 64));
+        size_t word_idx = bit / 64;
+        while (word == 0 && ++word_idx < mask_.size()) {
+            word = mask_[word_idx];
+        }
+        if (word != 0) {
+            row_id_ = std::min(mask_first_row_ + word_idx * 64 + __builtin_ctzll(word), mask_end_row_);
+            if (row_id_ < mask_end_row_) {
+                return;
+            }
+        }
+        row_id_ = mask_end_row_;
+    }
+    row_id_ = table_->num_rows_;
+}
 
-            remaining_rows -= data_page->value_count_;
-            current_pid = data_page->next_page_id_;
-            page->r_unlatch();
-            table_->bpm_->UnpinPage(page->page_id(), false);
+void Table::Iterator::load_mask() {
+    const std::vector<uint64_t>& filter = table_->row_filter_;
+    if (table_->snapshot_ == nullptr) {
+        // Every row is visible; only the filter decides.
+        mask_first_row_ = row_id_;
+        mask_end_row_ = std::min<uint64_t>(row_id_ + 64 * 64, table_->num_rows_);
+        mask_.assign((mask_end_row_ - mask_first_row_ + 63) / 64, ~uint64_t{0});
+    } else {
+        load_visibility_mask();
+    }
+    if (filter.empty()) {
+        return;
+    }
+    // AND in the filter's bits for the same rows. Rows appended after the
+    // filter was built have no bit and never match.
+    for (size_t w = 0; w < mask_.size(); ++w) {
+        const uint64_t first_bit = mask_first_row_ + w * 64;
+        const size_t idx = first_bit / 64;
+        const unsigned shift = first_bit % 64;
+        uint64_t bits = idx < filter.size() ? filter[idx] >> shift : 0;
+        if (shift != 0 && idx + 1 < filter.size()) {
+            bits |= filter[idx + 1] << (64 - shift);
         }
+        mask_[w] &= bits;
     }
-    return tuple;
 }
 
-Table::Iterator& Table::Iterator::operator++() {
-    row_id_++;
-    return *this;
+void Table::Iterator::load_visibility_mask() {
+    const size_t xmin_col = table_->schema_->XminColumn();
+    const size_t xmax_col = table_->schema_->XmaxColumn();
+    seek(xmin_col);
+    seek(xmax_col);
+    const Cursor& xmin_cursor = cursors_[xmin_col];
+    const Cursor& xmax_cursor = cursors_[xmax_col];
+
+    // The two MVCC columns fill their pages in lockstep, but only rely on the
+    // range both current pages cover.
+    mask_first_row_ = std::max(xmin_cursor.first_row, xmax_cursor.first_row);
+    mask_end_row_ = std::min({xmin_cursor.first_row + xmin_cursor.value_count,
+                              xmax_cursor.first_row + xmax_cursor.value_count, table_->num_rows_});
+    size_t n = mask_end_row_ - mask_first_row_;
+    mask_.assign((n + 63) / 64, 0);
+
+    Page* xmin_page = table_->bpm_->FetchPage(xmin_cursor.page_id);
+    Page* xmax_page = table_->bpm_->FetchPage(xmax_cursor.page_id);
+    if (xmin_page == nullptr || xmax_page == nullptr) {
+        if (xmin_page != nullptr) table_->bpm_->UnpinPage(xmin_cursor.page_id, false);
+        if (xmax_page != nullptr) table_->bpm_->UnpinPage(xmax_cursor.page_id, false);
+        throw std::runtime_error("Failed to fetch MVCC pages for visibility check.");
+    }
+    xmin_page->r_latch();
+    xmax_page->r_latch();
+    const int64_t* xmin = reinterpret_cast<ColumnDataPage*>(xmin_page->data())->values_ + (mask_first_row_ - xmin_cursor.first_row);
+    const int64_t* xmax = reinterpret_cast<ColumnDataPage*>(xmax_page->data())->values_ + (mask_first_row_ - xmax_cursor.first_row);
+    ComputeVisibilityMask(xmin, xmax, n, *table_->snapshot_, mask_.data());
+    xmax_page->r_unlatch();
+    xmin_page->r_unlatch();
+    table_->bpm_->UnpinPage(xmax_cursor.page_id, false);
+    table_->bpm_->UnpinPage(xmin_cursor.page_id, false);
 }
 
-} // namespace db
\ No newline at end of file
+} // namespace db
@@ -0,0 +1,70 @@
+#include "columnar_db/storage/visibility.h"
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PESDB_HAVE_AVX2_KERNELS 1
+#endif
+
+namespace db {
+
+namespace {
+
+// Sets the bit of every row in [begin, n) with xmin < bound and xmax == 0.
+void fast_mask_scalar(const int64_t* xmin, const int64_t* xmax, size_t begin, size_t n, int64_t bound,
+                      uint64_t* mask) {
+    for (size_t i = begin; i < n; ++i) {
+        uint64_t bit = static_cast<uint64_t>((xmin[i] < bound) & (xmax[i] == 0));
+        mask[i / 64] |= bit << (i % 64);
+    }
+}
+
+#ifdef PESDB_HAVE_AVX2_KERNELS
+__attribute__((target("avx2")))
+void fast_mask_avx2(const int64_t* xmin, const int64_t* xmax, size_t n, int64_t bound, uint64_t* mask) {
+    const __m256i vbound = _mm256_set1_epi64x(bound);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i vxmin = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xmin + i));
+        __m256i vxmax = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xmax + i));
+        __m256i visible = _mm256_and_si256(_mm256_cmpgt_epi64(vbound, vxmin), _mm256_cmpeq_epi64(vxmax, zero));
+        auto bits = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(visible)));
+        // i is a multiple of 4, so the 4 bits never straddle two words.
+        mask[i / 64] |= bits << (i % 64);
+    }
+    fast_mask_scalar(xmin, xmax, i, n, bound, mask);
+}
+
+const bool HAS_AVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+} // namespace
+
+void ComputeVisibilityMask(const int64_t* xmin, const int64_t* xmax, size_t n, const Snapshot& snapshot,
+                           uint64_t* mask) {
+    std::fill(mask, mask + (n + 63) / 64, 0);
+
+    // Below snapshot.xmin every transaction has finished, so such an xmin is
+    // committed unless it aborted. With aborted transactions around, leave
+    // everything to the exact check.
+    if (snapshot.aborted == nullptr || snapshot.aborted->empty()) {
+#ifdef PESDB_HAVE_AVX2_KERNELS
+        if (HAS_AVX2) {
+            fast_mask_avx2(xmin, xmax, n, snapshot.xmin, mask);
+        } else {
+            fast_mask_scalar(xmin, xmax, 0, n, snapshot.xmin, mask);
+        }
+#else
+        fast_mask_scalar(xmin, xmax, 0, n, snapshot.xmin, mask);
+#endif
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (((mask[i / 64] >> (i % 64)) & 1) == 0 && snapshot.IsVisible(xmin[i], xmax[i])) {
+            mask[i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+}
+
+} // namespace db
@@ -0,0 +1,324 @@
+#include "columnar_db/wal/log_manager.h"
+#include "columnar_db/common/metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/falloc.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+namespace db {
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of two.");
+
+// The magic number names the record format. Records of another format do
+// not parse, and would be mistaken for a torn tail and truncated, so a log
+// in any other format is refused rather than opened.
+constexpr uint32_t LOG_MAGIC_NUMBER = 0x57414C32;    // "WAL2": varint records with CRC32C
+constexpr uint32_t LOG_MAGIC_NUMBER_V1 = 0x57414C31; // "WAL1": fixed-width records
+
+bool LsnFuture::IsReady() const {
+    return log_manager_->GetPersistentLsn() >= lsn_;
+}
+
+void LsnFuture::Wait() const {
+    log_manager_->WaitForFlush(lsn_);
+}
+
+LogManager::LogManager(const std::string& log_file)
+    : file_name_(log_file), buffer_(new char[LOG_BUFFER_SIZE]) {
+    fd_ = ::open(file_name_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot create or open log file: " + file_name_);
+    }
+
+    init_header();
+    {
+        // A log written before space was reclaimed still holds everything.
+        std::lock_guard<std::mutex> guard(reclaim_latch_);
+        reclaim(GetCheckpointLsn());
+    }
+
+    // New records are appended after the last complete record. Anything past
+    // it is the torn tail of a write that was in flight during a crash.
+    lsn_t end = ScanLog(GetCheckpointLsn(), nullptr);
+    if (end < ::lseek(fd_, 0, SEEK_END) && ::ftruncate(fd_, end) != 0) {
+        throw std::runtime_error("Cannot truncate torn tail of log file: " + file_name_);
+    }
+    base_offset_ = end;
+    persistent_lsn_.store(base_offset_, std::memory_order_release);
+
+    flush_thread_ = std::thread(&LogManager::flush_loop, this);
+}
+
+LogManager::~LogManager() {
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+        stop_ = true;
+    }
+    flush_cv_.notify_one();
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+LsnFuture LogManager::AppendLogRecord(const LogRecord& record) {
+    if (io_error_.load(std::memory_order_acquire)) {
+        throw std::runtime_error("Log file " + file_name_ + " is not writable.");
+    }
+
+    // Serialize outside of the ring so the critical window below is just a memcpy.
+    std::vector<char> bytes;
+    record.SerializeTo(&bytes);
+    const uint64_t size = bytes.size();
+    if (size > LOG_BUFFER_SIZE) {
+        throw std::runtime_error("Log record is larger than the log buffer.");
+    }
+
+    // 1. Reserve [start, start + size) with a CAS on the tail. If the ring is
+    //    full, nudge the flusher and retry once it has made room (which it
+    //    never will after a failed write).
+    uint64_t start = reserved_.load(std::memory_order_relaxed);
+    while (true) {
+        if (start + size - flushed_.load(std::memory_order_acquire) > LOG_BUFFER_SIZE) {
+            if (io_error_.load(std::memory_order_acquire)) {
+                throw std::runtime_error("Log file " + file_name_ + " is not writable.");
+            }
+            if (!flush_requested_.exchange(true, std::memory_order_acq_rel)) {
+                flush_cv_.notify_one();
+            }
+            std::this_thread::yield();
+            start = reserved_.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (reserved_.compare_exchange_weak(start, start + size, std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    // 2. Copy the record into our reserved slot. Nobody else touches it.
+    copy_to_ring(start, bytes.data(), size);
+
+    // 3. Publish in LSN order: wait for every earlier reservation to be
+    //    published so the flusher only ever sees a contiguous prefix. An
+    //    earlier appender that gave up on a failed log never publishes.
+    while (committed_.load(std::memory_order_acquire) != start) {
+        if (io_error_.load(std::memory_order_acquire)) {
+            throw std::runtime_error("Log file " + file_name_ + " is not writable.");
+        }
+        std::this_thread::yield();
+    }
+    committed_.store(start + size, std::memory_order_release);
+    Metrics::Add(Counter::LOG_RECORDS);
+    Metrics::Add(Counter::LOG_BYTES, size);
+
+    // 4. Kick the flusher early if the pending batch is big enough.
+    if (start + size - flushed_.load(std::memory_order_acquire) >= LOG_FLUSH_THRESHOLD &&
+        !flush_requested_.exchange(true, std::memory_order_acq_rel)) {
+        flush_cv_.notify_one();
+    }
+
+    return LsnFuture(this, base_offset_ + static_cast<lsn_t>(start + size));
+}
+
+void LogManager::WaitForFlush(lsn_t lsn) {
+    if (GetPersistentLsn() >= lsn) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(durable_mutex_);
+    durable_cv_.wait(lock, [&] {
+        return GetPersistentLsn() >= lsn || io_error_.load(std::memory_order_acquire);
+    });
+    if (GetPersistentLsn() < lsn) {
+        throw std::runtime_error("Failed to flush log file: " + file_name_);
+    }
+}
+
+lsn_t LogManager::Flush() {
+    lsn_t target = base_offset_ + static_cast<lsn_t>(reserved_.load(std::memory_order_acquire));
+    flush_requested_.store(true, std::memory_order_release);
+    flush_cv_.notify_one();
+    WaitForFlush(target);
+    return target;
+}
+
+void LogManager::init_header() {
+    char header[LOG_HEADER_SIZE] = {};
+    if (::lseek(fd_, 0, SEEK_END) < static_cast<off_t>(LOG_HEADER_SIZE)) {
+        // Brand new log: nothing to recover, records start right after the header.
+        WriteCheckpoint(LOG_HEADER_SIZE, 1);
+        return;
+    }
+
+    if (::pread(fd_, header, LOG_HEADER_SIZE, 0) != static_cast<ssize_t>(LOG_HEADER_SIZE)) {
+        throw std::runtime_error("Cannot read log header: " + file_name_);
+    }
+    uint32_t magic;
+    lsn_t checkpoint_lsn;
+    txn_id_t next_txn_id;
+    std::memcpy(&magic, header, sizeof(magic));
+    std::memcpy(&checkpoint_lsn, header + sizeof(uint64_t), sizeof(checkpoint_lsn));
+    std::memcpy(&next_txn_id, header + 2 * sizeof(uint64_t), sizeof(next_txn_id));
+    if (magic == LOG_MAGIC_NUMBER_V1) {
+        throw std::runtime_error("Log file " + file_name_ + " was written by an older version in the WAL1 format; "
+                                 "open the database with that version to replay and checkpoint it first.");
+    }
+    if (magic != LOG_MAGIC_NUMBER || checkpoint_lsn < static_cast<lsn_t>(LOG_HEADER_SIZE)) {
+        throw std::runtime_error("Log file is corrupted or not a valid log file: " + file_name_);
+    }
+    checkpoint_lsn_.store(checkpoint_lsn, std::memory_order_release);
+    checkpoint_txn_id_.store(next_txn_id, std::memory_order_release);
+}
+
+void LogManager::WriteCheckpoint(lsn_t lsn, txn_id_t next_txn_id) {
+    // | magic (u32) | pad (u32) | checkpoint lsn (i64) | next txn id (i64) |
+    char header[LOG_HEADER_SIZE] = {};
+    std::memcpy(header, &LOG_MAGIC_NUMBER, sizeof(LOG_MAGIC_NUMBER));
+    std::memcpy(header + sizeof(uint64_t), &lsn, sizeof(lsn));
+    std::memcpy(header + 2 * sizeof(uint64_t), &next_txn_id, sizeof(next_txn_id));
+    if (::pwrite(fd_, header, LOG_HEADER_SIZE, 0) != static_cast<ssize_t>(LOG_HEADER_SIZE) ||
+        ::fdatasync(fd_) != 0) {
+        throw std::runtime_error("Cannot write checkpoint to log file: " + file_name_);
+    }
+    checkpoint_lsn_.store(lsn, std::memory_order_release);
+    checkpoint_txn_id_.store(next_txn_id, std::memory_order_release);
+
+    std::lock_guard<std::mutex> guard(reclaim_latch_);
+    reclaim(lsn);
+}
+
+lsn_t LogManager::RetainLog() {
+    std::lock_guard<std::mutex> guard(reclaim_latch_);
+    retained_lsn_ = GetCheckpointLsn();
+    return retained_lsn_;
+}
+
+void LogManager::ReleaseLog() {
+    std::lock_guard<std::mutex> guard(reclaim_latch_);
+    retained_lsn_ = INVALID_LSN;
+    reclaim(GetCheckpointLsn());
+}
+
+void LogManager::reclaim(lsn_t lsn) {
+    if (retained_lsn_ != INVALID_LSN) {
+        lsn = std::min(lsn, retained_lsn_);
+    }
+    if (lsn <= reclaimed_lsn_) {
+        return;
+    }
+    // Filesystems that cannot punch holes keep the space; nothing reads it either way.
+    if (::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, reclaimed_lsn_, lsn - reclaimed_lsn_) == 0) {
+        Metrics::Add(Counter::LOG_BYTES_RECLAIMED, static_cast<uint64_t>(lsn - reclaimed_lsn_));
+    }
+    reclaimed_lsn_ = lsn;
+}
+
+lsn_t LogManager::ScanLog(lsn_t from, const std::function<void(lsn_t, const LogRecord&)>& fn) {
+    // Read in large chunks; a record that straddles a chunk boundary is
+    // carried over to the front of the next read.
+    constexpr size_t CHUNK_SIZE = 1 << 20;
+    std::vector<char> chunk;
+    lsn_t file_pos = from;  // Next byte to read from the file.
+    lsn_t record_pos = from; // Start of the next unparsed record.
+
+    while (true) {
+        size_t carried = static_cast<size_t>(file_pos - record_pos);
+        size_t want = std::max(CHUNK_SIZE, carried * 2);
+        std::vector<char> next(carried + want);
+        if (carried > 0) {
+            std::memcpy(next.data(), chunk.data() + chunk.size() - carried, carried);
+        }
+        ssize_t n = ::pread(fd_, next.data() + carried, want, file_pos);
+        if (n <= 0) {
+            break;
+        }
+        file_pos += n;
+        next.resize(carried + n);
+        chunk.swap(next);
+
+        size_t offset = 0;
+        LogRecord record;
+        uint32_t consumed;
+        while (LogRecord::DeserializeFrom(chunk.data() + offset, chunk.size() - offset, &record, &consumed)) {
+            offset += consumed;
+            record_pos += consumed;
+            if (fn) {
+                fn(record_pos, record);
+            }
+        }
+    }
+    return record_pos;
+}
+
+void LogManager::flush_loop() {
+    std::unique_lock<std::mutex> lock(flush_mutex_);
+    while (true) {
+        flush_cv_.wait_for(lock, std::chrono::microseconds(LOG_FLUSH_INTERVAL_US), [&] {
+            return stop_ || flush_requested_.load(std::memory_order_acquire);
+        });
+        bool stopping = stop_;
+        flush_requested_.store(false, std::memory_order_release);
+        lock.unlock();
+
+        // Everything published since the last round goes out as one batch.
+        uint64_t begin = flushed_.load(std::memory_order_relaxed);
+        uint64_t end = committed_.load(std::memory_order_acquire);
+        if (end > begin && !io_error_.load(std::memory_order_acquire)) {
+            write_and_sync(begin, end);
+        }
+
+        lock.lock();
+        if (stopping && (io_error_.load(std::memory_order_acquire) ||
+                         flushed_.load(std::memory_order_acquire) == reserved_.load(std::memory_order_acquire))) {
+            break;
+        }
+    }
+}
+
+void LogManager::copy_to_ring(uint64_t pos, const char* src, size_t len) {
+    size_t offset = pos & (LOG_BUFFER_SIZE - 1);
+    size_t first = std::min(len, LOG_BUFFER_SIZE - offset);
+    std::memcpy(buffer_.get() + offset, src, first);
+    std::memcpy(buffer_.get(), src + first, len - first);
+}
+
+void LogManager::write_and_sync(uint64_t begin, uint64_t end) {
+    LatencyTimer timer(Histogram::LOG_FLUSH_LATENCY);
+    Metrics::Add(Counter::LOG_FLUSHES);
+    uint64_t pos = begin;
+    bool ok = true;
+    while (ok && pos < end) {
+        size_t offset = pos & (LOG_BUFFER_SIZE - 1);
+        size_t chunk = std::min<uint64_t>(end - pos, LOG_BUFFER_SIZE - offset);
+        ssize_t written = ::pwrite(fd_, buffer_.get() + offset, chunk, base_offset_ + static_cast<off_t>(pos));
+        if (written <= 0) {
+            ok = false;
+            break;
+        }
+        pos += written;
+    }
+    if (ok && ::fdatasync(fd_) != 0) {
+        ok = false;
+    }
+
+    if (!ok) {
+        std::cerr << "Error: Failed to write log file " << file_name_ << ": " << std::strerror(errno) << std::endl;
+        io_error_.store(true, std::memory_order_release);
+    } else {
+        flushed_.store(end, std::memory_order_release);
+        persistent_lsn_.store(base_offset_ + static_cast<lsn_t>(end), std::memory_order_release);
+    }
+
+    // Take the mutex so a committer between its check and its wait cannot miss this.
+    std::lock_guard<std::mutex> lock(durable_mutex_);
+    durable_cv_.notify_all();
+}
+
+} // namespace db
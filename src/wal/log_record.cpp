@@ -0,0 +1,181 @@
+#include "columnar_db/wal/log_record.h"
+#include "columnar_db/common/crc32c.h"
+#include "columnar_db/common/varint.h"
+#include <cstring>
+
+namespace db {
+
+namespace {
+
+// Appends `values` as zigzag varints of the difference from the previous value.
+// Wrapping arithmetic: the delta of any two 64-bit values round-trips.
+template <typename T>
+void put_deltas(std::vector<char>* out, const std::vector<T>& values) {
+    uint64_t previous = 0;
+    for (T value : values) {
+        PutVarint(out, ZigzagEncode(static_cast<int64_t>(static_cast<uint64_t>(value) - previous)));
+        previous = static_cast<uint64_t>(value);
+    }
+}
+
+template <typename T>
+bool get_deltas(const char** p, const char* end, uint64_t count, std::vector<T>* values) {
+    values->reserve(count);
+    uint64_t previous = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t encoded;
+        if (!GetVarint(p, end, &encoded)) {
+            return false;
+        }
+        previous += static_cast<uint64_t>(ZigzagDecode(encoded));
+        values->push_back(static_cast<T>(previous));
+    }
+    return true;
+}
+
+} // namespace
+
+LogRecord::LogRecord(LogRecordType type, uint32_t table_id, uint64_t row_id, const std::vector<int64_t>& tuple)
+    : type_(type), table_id_(table_id), first_row_id_(row_id) {
+    columns_.reserve(tuple.size());
+    for (int64_t value : tuple) {
+        columns_.push_back({value});
+    }
+}
+
+LogRecord::LogRecord(LogRecordType type, uint32_t table_id, uint64_t first_row_id,
+                     std::vector<std::vector<int64_t>> columns)
+    : type_(type), table_id_(table_id), first_row_id_(first_row_id), columns_(std::move(columns)) {}
+
+LogRecord::LogRecord(LogRecordType type, uint32_t table_id, txn_id_t xmax, std::vector<uint64_t> row_ids)
+    : type_(type), table_id_(table_id), xmax_(xmax), row_ids_(std::move(row_ids)) {}
+
+LogRecord::LogRecord(LogRecordType type, txn_id_t txn_id) : type_(type), xmax_(txn_id) {}
+
+uint32_t LogRecord::GetRowCount() const {
+    if (type_ == LogRecordType::COMMIT || type_ == LogRecordType::ABORT) {
+        return 0;
+    }
+    if (type_ == LogRecordType::DELETE_ROWS) {
+        return row_ids_.size();
+    }
+    return columns_.empty() ? 0 : columns_[0].size();
+}
+
+std::vector<int64_t> LogRecord::GetTuple() const {
+    std::vector<int64_t> tuple;
+    tuple.reserve(columns_.size());
+    for (const auto& column : columns_) {
+        tuple.push_back(column.empty() ? 0 : column[0]);
+    }
+    return tuple;
+}
+
+void LogRecord::SerializeTo(std::vector<char>* out) const {
+    // 1. Encode the body (everything the checksum covers).
+    std::vector<char> body;
+    body.push_back(static_cast<char>(type_));
+    PutVarint(&body, table_id_);
+    if (type_ == LogRecordType::DELETE_ROWS) {
+        PutVarint(&body, ZigzagEncode(xmax_));
+        PutVarint(&body, row_ids_.size());
+        put_deltas(&body, row_ids_);
+    } else if (type_ == LogRecordType::COMMIT || type_ == LogRecordType::ABORT) {
+        PutVarint(&body, ZigzagEncode(xmax_));
+    } else {
+        PutVarint(&body, first_row_id_);
+        if (type_ == LogRecordType::INSERT_BATCH) {
+            PutVarint(&body, GetRowCount());
+        }
+        PutVarint(&body, columns_.size());
+        for (const auto& column : columns_) {
+            put_deltas(&body, column);
+        }
+    }
+
+    // 2. Prefix it with its length and checksum.
+    uint32_t crc = Crc32c(body.data(), body.size());
+    PutVarint(out, body.size() + sizeof(crc));
+    size_t crc_offset = out->size();
+    out->resize(crc_offset + sizeof(crc));
+    std::memcpy(out->data() + crc_offset, &crc, sizeof(crc));
+    out->insert(out->end(), body.begin(), body.end());
+}
+
+bool LogRecord::DeserializeFrom(const char* buf, size_t len, LogRecord* record, uint32_t* consumed) {
+    const char* p = buf;
+    const char* end = buf + len;
+
+    uint64_t length;
+    if (!GetVarint(&p, end, &length) || length < sizeof(uint32_t) + 1 ||
+        length > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    end = p + length;
+
+    uint32_t crc;
+    std::memcpy(&crc, p, sizeof(crc));
+    p += sizeof(crc);
+    if (Crc32c(p, end - p) != crc) {
+        return false;
+    }
+
+    LogRecord result;
+    result.type_ = static_cast<LogRecordType>(*p++);
+    uint64_t table_id;
+    if (!GetVarint(&p, end, &table_id)) {
+        return false;
+    }
+    result.table_id_ = static_cast<uint32_t>(table_id);
+
+    // Every value takes at least one byte, which bounds the counts before we allocate.
+    if (result.type_ == LogRecordType::DELETE_ROWS) {
+        uint64_t xmax;
+        uint64_t row_count;
+        if (!GetVarint(&p, end, &xmax) || !GetVarint(&p, end, &row_count) ||
+            row_count > static_cast<uint64_t>(end - p) || !get_deltas(&p, end, row_count, &result.row_ids_)) {
+            return false;
+        }
+        result.xmax_ = ZigzagDecode(xmax);
+    } else if (result.type_ == LogRecordType::COMMIT || result.type_ == LogRecordType::ABORT) {
+        uint64_t txn_id;
+        if (!GetVarint(&p, end, &txn_id)) {
+            return false;
+        }
+        result.xmax_ = ZigzagDecode(txn_id);
+    } else {
+        uint64_t row_count = 1;
+        uint64_t column_count;
+        if (!GetVarint(&p, end, &result.first_row_id_)) {
+            return false;
+        }
+        if (result.type_ == LogRecordType::INSERT_BATCH && !GetVarint(&p, end, &row_count)) {
+            return false;
+        }
+        if (!GetVarint(&p, end, &column_count)) {
+            return false;
+        }
+        // A crafted count could overflow the product, so bound each one first.
+        const auto remaining = static_cast<uint64_t>(end - p);
+        uint64_t value_count;
+        if (column_count > remaining || row_count > remaining ||
+            __builtin_mul_overflow(column_count, row_count, &value_count) || value_count > remaining) {
+            return false;
+        }
+        result.columns_.resize(column_count);
+        for (auto& column : result.columns_) {
+            if (!get_deltas(&p, end, row_count, &column)) {
+                return false;
+            }
+        }
+    }
+    if (p != end) {
+        return false;
+    }
+
+    *record = std::move(result);
+    *consumed = static_cast<uint32_t>(end - buf);
+    return true;
+}
+
+} // namespace db